@@ -43,6 +43,7 @@ static ink_mutex insert_mutex;
 Continuation *aio_err_callbck = 0;
 RecInt cache_config_threads_per_disk = 12;
 RecInt api_config_threads_per_disk = 12;
+RecInt cache_config_aio_affinity = 0;
 int thread_is_created = 0;
 
 
@@ -160,6 +161,7 @@ ink_aio_init(ModuleVersion v)
   ink_mutex_init(&insert_mutex, NULL);
 
   IOCORE_ReadConfigInteger(cache_config_threads_per_disk, "proxy.config.cache.threads_per_disk");
+  IOCORE_ReadConfigInteger(cache_config_aio_affinity, "proxy.config.cache.aio_affinity");
 }
 
 int
@@ -180,6 +182,7 @@ struct AIOThreadInfo:public Continuation
 
   AIO_Reqs *req;
   int sleep_wait;
+  int thread_index;
 
   int start(int event, Event *e)
   {
@@ -189,7 +192,8 @@ struct AIOThreadInfo:public Continuation
     return EVENT_DONE;
   }
 
-  AIOThreadInfo(AIO_Reqs *thr_req, int sleep):Continuation(new_ProxyMutex()), req(thr_req), sleep_wait(sleep)
+  AIOThreadInfo(AIO_Reqs *thr_req, int sleep, int index)
+    : Continuation(new_ProxyMutex()), req(thr_req), sleep_wait(sleep), thread_index(index)
   {
     SET_HANDLER(&AIOThreadInfo::start);
   }
@@ -226,6 +230,7 @@ aio_init_fildes(int fildes, int fromAPI = 0)
 
   RecInt thread_num;
 
+  request->numa_node = -1;
   if (fromAPI) {
     request->index = 0;
     request->filedes = -1;
@@ -237,15 +242,20 @@ aio_init_fildes(int fildes, int fromAPI = 0)
     request->filedes = fildes;
     aio_reqs[num_filedes] = request;
     thread_num = cache_config_threads_per_disk;
+    // keep the threads of a disk near its controller
+    if (cache_config_aio_affinity) {
+      request->numa_node = ink_affinity_node_of_fd(fildes);
+      Debug("aio", "disk fd %d is on NUMA node %d", fildes, request->numa_node);
+    }
   }
 
   /* create the main thread */
   AIOThreadInfo *thr_info;
   for (i = 0; i < thread_num; i++) {
     if (i == (thread_num - 1))
-      thr_info = new AIOThreadInfo(request, 1);
+      thr_info = new AIOThreadInfo(request, 1, i);
     else
-      thr_info = new AIOThreadInfo(request, 0);
+      thr_info = new AIOThreadInfo(request, 0, i);
     snprintf(thr_name, MAX_THREAD_NAME_LENGTH, "[ET_AIO %d]", i);
     ink_assert(eventProcessor.spawn_thread(thr_info, thr_name));
   }
@@ -480,6 +490,16 @@ aio_thread_main(void *arg)
   AIO_Reqs *my_aio_req = (AIO_Reqs *) thr_info->req;
   AIO_Reqs *current_req = NULL;
   AIOCallback *op = NULL;
+
+  if (my_aio_req->numa_node >= 0) {
+    char thr_name[64];
+    snprintf(thr_name, sizeof(thr_name), "[ET_AIO %d %d]", my_aio_req->index, thr_info->thread_index);
+    int cpu = ink_affinity_bind_node(my_aio_req->numa_node);
+    if (cpu < 0)
+      Warning("unable to bind thread %s to NUMA node %d", thr_name, my_aio_req->numa_node);
+    set_thread_cpu_stat(thr_name, cpu);
+  }
+
   ink_mutex_acquire(&my_aio_req->aio_mutex);
   for (;;) {
     do {
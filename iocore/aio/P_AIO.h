@@ -95,6 +95,7 @@ struct AIO_Reqs
   volatile int queued;          /* total number of aio_todo and http_todo requests */
   volatile int filedes;         /* the file descriptor for the requests */
   volatile int requests_queued;
+  int numa_node;                /* NUMA node the disk hangs off, -1 if unknown */
 };
 
 #ifdef AIO_STATS
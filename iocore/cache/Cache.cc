@@ -75,6 +75,7 @@ int cache_config_target_fragment_size = DEFAULT_TARGET_FRAGMENT_SIZE;
 int cache_config_agg_write_backlog = AGG_SIZE * 2;
 int cache_config_enable_checksum = 0;
 int cache_config_alt_rewrite_max_size = 4096;
+int cache_config_compact_headers = 1;
 int cache_config_read_while_writer = 0;
 char cache_system_config_directory[PATH_NAME_MAX + 1];
 int cache_config_mutex_retry_delay = 2;
@@ -2449,7 +2450,12 @@ CacheVC::dead(int event, Event *e) {
 #define STORE_COLLISION 1
 
 #ifdef HTTP_CACHE
+// Headers written in the compact encoding are left as they are, they are
+// decoded by CacheHTTPInfoVector::get_handles() when the vector is used.
 static bool unmarshal_helper(Doc *doc, Ptr<IOBufferData> &buf, int &okay) {
+  if (HTTPInfo::is_compact(doc->hdr(), doc->hlen))
+    return true;
+
   char *tmp = doc->hdr();
   int len = doc->hlen;
   while (len > 0) {
@@ -3383,6 +3389,8 @@ register_cache_stats(RecRawStatBlock *rsb, const char *prefix)
   REG_INT("vector_marshals", cache_hdr_vector_marshal_stat);
   REG_INT("hdr_marshals", cache_hdr_marshal_stat);
   REG_INT("hdr_marshal_bytes", cache_hdr_marshal_bytes_stat);
+  REG_INT("hdr_compact_decodes", cache_hdr_compact_decode_stat);
+  REG_INT("hdr_compact_decode_time", cache_hdr_compact_decode_time_stat);
   REG_INT("gc_bytes_evacuated", cache_gc_bytes_evacuated_stat);
   REG_INT("gc_frags_evacuated", cache_gc_frags_evacuated_stat);
 }
@@ -3493,6 +3501,9 @@ ink_cache_init(ModuleVersion v)
   IOCORE_EstablishStaticConfigInt32(cache_config_alt_rewrite_max_size, "proxy.config.cache.alt_rewrite_max_size");
   Debug("cache_init", "proxy.config.cache.alt_rewrite_max_size = %d", cache_config_alt_rewrite_max_size);
 
+  IOCORE_EstablishStaticConfigInt32(cache_config_compact_headers, "proxy.config.cache.http.compact_headers");
+  Debug("cache_init", "proxy.config.cache.http.compact_headers = %d", cache_config_compact_headers);
+
   IOCORE_EstablishStaticConfigInt32(cache_config_read_while_writer, "proxy.config.cache.enable_read_while_writer");
   cache_config_read_while_writer = validate_rww(cache_config_read_while_writer);
   IOCORE_RegisterConfigUpdateFunc("proxy.config.cache.enable_read_while_writer", update_cache_config, NULL);
@@ -25,7 +25,6 @@
 #include <string.h>
 #include "P_Cache.h"
 
-
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 
@@ -57,10 +56,17 @@ CacheHTTPInfoVector::~CacheHTTPInfoVector()
   -------------------------------------------------------------------------*/
 
 int
-CacheHTTPInfoVector::insert(CacheHTTPInfo * info, int index)
+CacheHTTPInfoVector::insert(CacheHTTPInfo * info, int index, bool destroy)
 {
   if (index == CACHE_ALT_INDEX_DEFAULT)
     index = xcount++;
+  else if (destroy && index < xcount) {
+    // an alternate decoded from compact headers, or inserted by a writer,
+    // belongs to the vector, one in the document buffer does not
+    CacheHTTPInfo *old = &data[index].alternate;
+    if (old->m_alt && old->m_alt->m_writeable && old->m_alt != info->m_alt)
+      old->destroy();
+  }
 
   data(index).alternate.copy_shallow(info);
   return index;
@@ -172,7 +178,10 @@ CacheHTTPInfoVector::marshal_length()
   int length = 0;
 
   for (int i = 0; i < xcount; i++) {
-    length += data[i].alternate.marshal_length();
+    if (cache_config_compact_headers)
+      length += data[i].alternate.marshal_compact_length();
+    else
+      length += data[i].alternate.marshal_length();
   }
 
   return length;
@@ -189,7 +198,11 @@ CacheHTTPInfoVector::marshal(char *buf, int length)
   ink_assert(!(((intptr_t) buf) & 3));      // buf must be aligned
 
   for (int i = 0; i < xcount; i++) {
-    int tmp = data[i].alternate.marshal(buf, length);
+    int tmp;
+    if (cache_config_compact_headers)
+      tmp = data[i].alternate.marshal_compact(buf, length);
+    else
+      tmp = data[i].alternate.marshal(buf, length);
     length -= tmp;
     buf += tmp;
     count++;
@@ -226,6 +239,37 @@ CacheHTTPInfoVector::unmarshal(const char *buf, int length, RefCountObj * block_
   return ((caddr_t) buf - (caddr_t) start);
 }
 
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+// A compact vector is decoded straight into the heaps of new, writeable
+// alternates, which the vector owns and destroys in clear(). The buffer is
+// left as it was read, so this is done on every read of the document, RAM
+// cache hits included; hdr_compact_decodes and hdr_compact_decode_time
+// count it.
+uint32_t
+CacheHTTPInfoVector::get_compact_handles(const char *buf, int length)
+{
+  const char *start = buf;
+  CacheHTTPInfo info;
+  ink_hrtime t = ink_get_hrtime_internal();
+
+  while (length - (buf - start) > 0) {
+    int tmp = HTTPInfo::unmarshal_compact(buf, length - (buf - start), &info);
+    if (tmp < 0) {
+      clear();
+      return (uint32_t) -1;
+    }
+    buf += tmp;
+
+    data(xcount).alternate = info;
+    xcount++;
+  }
+
+  CACHE_SUM_GLOBAL_DYN_STAT(cache_hdr_compact_decode_stat, xcount);
+  CACHE_SUM_GLOBAL_DYN_STAT(cache_hdr_compact_decode_time_stat, ink_get_hrtime_internal() - t);
+  return ((caddr_t) buf - (caddr_t) start);
+}
 
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
@@ -240,6 +284,9 @@ CacheHTTPInfoVector::get_handles(const char *buf, int length, RefCountObj * bloc
 
   vector_buf = block_ptr;
 
+  if (HTTPInfo::is_compact(buf, length))
+    return get_compact_handles(buf, length);
+
   while (length - (buf - start) > (int) sizeof(HTTPCacheAlt)) {
 
     int tmp = info.get_handle((char *) buf, length - (buf - start));
@@ -274,7 +321,7 @@ CacheHTTPInfoVector::~CacheHTTPInfoVector()
   -------------------------------------------------------------------------*/
 
 int
-CacheHTTPInfoVector::insert(CacheHTTPInfo * info, int index)
+CacheHTTPInfoVector::insert(CacheHTTPInfo * info, int index, bool destroy)
 {
   ink_assert(0);
   return index;
@@ -248,7 +248,7 @@ CacheVC::openReadChooseWriter(int event, Event * e)
       }
       ink_assert(w->alternate.valid());
       if (w->alternate.valid())
-        vector.insert(&w->alternate, alt_ndx);
+        vector.insert(&w->alternate, alt_ndx, false);
     }
 
     if (!vector.count()) {
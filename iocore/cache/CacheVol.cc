@@ -239,7 +239,8 @@ CacheVC::scanObject(int event, Event * e)
       might_need_overlap_read = true;
       goto Lskip;
     }
-    {
+    // compact headers are decoded by get_handles()
+    if (!HTTPInfo::is_compact(doc->hdr(), doc->hlen)) {
       char *tmp = doc->hdr();
       int len = doc->hlen;
       while (len > 0) {
@@ -252,6 +253,8 @@ CacheVC::scanObject(int event, Event * e)
         tmp += r;
       }
     }
+    // destroys the alternates decoded for the previous document
+    vector.clear();
     if (vector.get_handles(doc->hdr(), doc->hlen) != doc->hlen)
       goto Lskip;
     changed = false;
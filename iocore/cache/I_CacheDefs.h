@@ -34,7 +34,7 @@
 #define CACHE_ALT_REMOVED           -2
 
 #define CACHE_DB_MAJOR_VERSION      23
-#define CACHE_DB_MINOR_VERSION      0
+#define CACHE_DB_MINOR_VERSION      1
 
 #define CACHE_DIR_MAJOR_VERSION     19
 #define CACHE_DIR_MINOR_VERSION     0
@@ -66,7 +66,7 @@ struct CacheHTTPInfoVector
   {
     return xcount;
   }
-  int insert(CacheHTTPInfo * info, int id = -1);
+  int insert(CacheHTTPInfo * info, int id = -1, bool destroy = true);
   CacheHTTPInfo *get(int idx);
   void detach(int idx, CacheHTTPInfo * r);
   void remove(int idx, bool destroy);
@@ -83,6 +83,14 @@ struct CacheHTTPInfoVector
   uint32_t get_handles(const char *buf, int length, RefCountObj * block_ptr = NULL);
   int unmarshal(const char *buf, int length, RefCountObj * block_ptr);
 
+  /**
+    get_handles() for a vector written in the compact encoding, see
+    proxy.config.cache.http.compact_headers. The alternates are decoded
+    into heaps of their own, which clear() destroys, so a vector holding
+    them must be cleared before get_handles() is called on it again.
+  */
+  uint32_t get_compact_handles(const char *buf, int length);
+
   CacheArray<vec_info> data;
   int xcount;
   Ptr<RefCountObj> vector_buf;
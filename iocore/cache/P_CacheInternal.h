@@ -164,6 +164,8 @@ enum
   cache_hdr_vector_marshal_stat,
   cache_hdr_marshal_stat,
   cache_hdr_marshal_bytes_stat,
+  cache_hdr_compact_decode_stat,
+  cache_hdr_compact_decode_time_stat,
   cache_stat_count
 };
 
@@ -222,6 +224,7 @@ extern int cache_config_min_average_object_size;
 extern int cache_config_agg_write_backlog;
 extern int cache_config_enable_checksum;
 extern int cache_config_alt_rewrite_max_size;
+extern int cache_config_compact_headers;
 extern int cache_config_read_while_writer;
 extern char cache_system_config_directory[PATH_NAME_MAX + 1];
 extern int cache_clustering_enabled;
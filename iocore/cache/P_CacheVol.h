@@ -323,6 +323,30 @@ struct AccessHistory {
 
 struct SSDVol;
 
+// The aggregation buffers are copied into on every cache write, back
+// them with huge pages when they are enabled.
+TS_INLINE char *
+agg_buffer_alloc(bool *hugepage)
+{
+  char *buf = (char *) ats_alloc_hugepage(AGG_SIZE);
+
+  *hugepage = (buf != NULL);
+  if (!buf)
+    buf = (char *) (ats_hugepage_enabled() ? ats_alloc_hugepage_fallback(AGG_SIZE)
+                                           : ats_memalign(sysconf(_SC_PAGESIZE), AGG_SIZE));
+  memset(buf, 0, AGG_SIZE);
+  return buf;
+}
+
+TS_INLINE void
+agg_buffer_free(char *buf, bool hugepage)
+{
+  if (hugepage)
+    ats_free_hugepage(buf, AGG_SIZE);
+  else
+    ats_memalign_free(buf);
+}
+
 struct MigrateToSSD
 {
   MigrateToSSD() { }
@@ -377,6 +401,7 @@ struct SSDVol: public Continuation
   off_t len;
   off_t data_blocks;
   char *agg_buffer;
+  bool agg_buffer_hugepage;
   int agg_todo_size;
   int agg_buf_pos;
   uint32_t sector_size;
@@ -422,8 +447,7 @@ struct SSDVol: public Continuation
     agg_todo_size = 0;
     agg_buf_pos = 0;
 
-    agg_buffer = (char *) ats_memalign(sysconf(_SC_PAGESIZE), AGG_SIZE);
-    memset(agg_buffer, 0, AGG_SIZE);
+    agg_buffer = agg_buffer_alloc(&agg_buffer_hugepage);
     cos.init(len);
     this->mutex = ((Continuation *)vol)->mutex;
   }
@@ -462,6 +486,7 @@ struct Vol: public Continuation
   Queue<CacheVC, Continuation::Link_link> stat_cache_vcs;
   Queue<CacheVC, Continuation::Link_link> sync;
   char *agg_buffer;
+  bool agg_buffer_hugepage;
   int agg_todo_size;
   int agg_buf_pos;
 
@@ -606,13 +631,12 @@ struct Vol: public Continuation
       evacuate_size(0), disk(NULL), last_sync_serial(0), last_write_serial(0), recover_wrapped(false),
       dir_sync_waiting(0), dir_sync_in_progress(0), writing_end_marker(0) {
     open_dir.mutex = mutex;
-    agg_buffer = (char *)ats_memalign(sysconf(_SC_PAGESIZE), AGG_SIZE);
-    memset(agg_buffer, 0, AGG_SIZE);
+    agg_buffer = agg_buffer_alloc(&agg_buffer_hugepage);
     SET_HANDLER(&Vol::aggWrite);
   }
 
   ~Vol() {
-    ats_memalign_free(agg_buffer);
+    agg_buffer_free(agg_buffer, agg_buffer_hugepage);
   }
 };
 
@@ -28,6 +28,7 @@
 ****************************************************************************/
 
 #include "P_Cluster.h"
+#include "P_SSLSessionCache.h"
 #include "global.h"
 #include "connection.h"
 
@@ -967,6 +968,9 @@ ClusterProcessor::start()
     pthread_t connection_tid;
     connection_manager_start(&connection_tid);
 
+    // Share new SSL sessions with the other nodes.
+    SSLSessionCacheSetReplicator(ssl_session_cluster_replicate);
+
     /*
 #ifdef DEBUG
   eventProcessor.schedule_every(new ClusterCacheVCPrinter, HRTIME_SECONDS(10));
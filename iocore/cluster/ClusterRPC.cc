@@ -28,6 +28,7 @@
 ****************************************************************************/
 
 #include "P_Cluster.h"
+#include "P_SSLSessionCache.h"
 /////////////////////////////////////////////////////////////////////////
 // All RPC function handlers (xxx_ClusterFunction() ) are invoked from
 // ClusterHandler::update_channels_read().
@@ -380,4 +381,49 @@ post_setchan_priority_ClusterFunction(ClusterHandler *ch, void *data, int len)
   }
 }
 
+//
+// Shared SSL session cache replication. Batches of new sessions are pushed
+// to all the other nodes from a task thread, each batch is a one way
+// message on a short lived session.
+//
+void
+ssl_session_cluster_replicate(const void *msg, int len)
+{
+  ClusterConfiguration *cc = this_cluster()->current_configuration();
+  ClusterMachine *self = this_cluster_machine();
+  Ptr<IOBufferData> d;
+
+  for (int i = 0; i < cc->n_machines; i++) {
+    ClusterMachine *m = cc->machines[i];
+    ClusterSession session;
+
+    if (m == self || m->dead || cluster_create_session(&session, m, NULL, 0))
+      continue;
+
+    if (!d) {
+      d = new_IOBufferData(iobuffer_size_to_index(len, MAX_BUFFER_SIZE_INDEX));
+      memcpy(d->data(), msg, len);
+    }
+
+    IOBufferBlock *b = new_IOBufferBlock(d, len, 0);
+    b->_buf_end = b->_end;
+    cluster_send_message(session, CLUSTER_SSL_SESSION_FUNCTION, b, -1, PRIORITY_LOW);
+    cluster_close_session(session);
+  }
+}
+
+void
+ssl_session_ClusterFunction(ClusterSession cs, void *context, void *data)
+{
+  ClusterCont *cc = (ClusterCont *) data;
+  NOWARN_UNUSED(context);
+
+  cluster_close_session(cs);
+
+  if (cc->data_len > 0 && cc->data_len <= DEFAULT_MAX_BUFFER_SIZE) {
+    Ptr<IOBufferData> buf = cc->copy_data();
+    SSLSessionCacheReceive(buf->data(), cc->data_len);
+  }
+}
+
 // End of ClusterRPC.cc
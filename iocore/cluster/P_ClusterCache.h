@@ -784,6 +784,8 @@ extern ClusterFunction default_api_ClusterFunction;
 
 extern ClusterFunctionExt cache_op_ClusterFunction;
 extern ClusterFunctionExt cache_op_result_ClusterFunction;
+extern ClusterFunctionExt ssl_session_ClusterFunction;
+void ssl_session_cluster_replicate(const void *msg, int len);
 
 struct ClusterFunctionDescriptor
 {
@@ -1038,6 +1040,8 @@ ClusterFuncToQpri(int cluster_func)
 #define CLUSTER_CACHE_DATA_READ_DONE           (CLUSTER_MSG_START+90)
 #define CLUSTER_CACHE_DATA_ERROR               (CLUSTER_MSG_START+91)
 
+#define CLUSTER_SSL_SESSION_FUNCTION           (CLUSTER_MSG_START+92)
+
 #define CLUSTER_INTERNEL_ERROR                 (CLUSTER_MSG_START+100)
 #define CLUSTER_PING_CLUSTER_FUNCTION          (CLUSTER_MSG_START+101)                        1
 #define CLUSTER_PING_REPLY_CLUSTER_FUNCTION    (CLUSTER_MSG_START+102)
@@ -32,6 +32,7 @@
 
 int g_worker_thread_count = 0;
 static int read_buffer_size = 2 * 1024 * 1024;
+static int thread_affinity = INK_AFFINITY_NONE;
 
 struct worker_thread_context *g_worker_thread_contexts = NULL;
 
@@ -322,6 +323,7 @@ int nio_init()
   REC_EstablishStaticConfigInt32(read_buffer_size, "proxy.config.cluster.read_buffer_size");
   Debug(CLUSTER_DEBUG_TAG, "file: " __FILE__ ", line: %d, "
       "read_buffer_size: %d", __LINE__, read_buffer_size);
+  thread_affinity = read_thread_affinity_config("proxy.config.cluster.threads.affinity");
 
 	if ((result=init_pthread_lock(&worker_thread_lock)) != 0) {
 		return result;
@@ -1588,13 +1590,25 @@ static void *work_thread_entrance(void* arg)
 
 	pThreadContext = (struct worker_thread_context *)arg;
 
-#if defined(HAVE_SYS_PRCTL_H) && defined(PR_SET_NAME)
   char name[32];
   sprintf(name, "[ET_CLUSTER %d]", (int)(pThreadContext -
         g_worker_thread_contexts) + 1);
+#if defined(HAVE_SYS_PRCTL_H) && defined(PR_SET_NAME)
   prctl(PR_SET_NAME, name, 0, 0, 0);
 #endif
 
+  if (thread_affinity != INK_AFFINITY_NONE) {
+    int cpu = ink_affinity_bind(thread_affinity, pThreadContext->thread_index);
+    if (cpu < 0) {
+      Warning("file: " __FILE__ ", line: %d, "
+          "bind thread %s to affinity level %d fail",
+          __LINE__, name, thread_affinity);
+    }
+    set_thread_cpu_stat(name, cpu);
+  } else {
+    ink_affinity_unbind();
+  }
+
 	while (g_continue_flag) {
     if (cache_clustering_enabled <= 0) {
       close_active_connections(pThreadContext);
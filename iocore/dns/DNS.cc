@@ -402,6 +402,12 @@ DNSEntry::init(const char *x, int len, int qtype_arg,
       ink_assert(!"T_PTR query to DNS must be IP address.");
   }
 
+  INK_DIGEST_CTX ctx;
+  ink_code_incr_md5_init(&ctx);
+  ink_code_incr_md5_update(&ctx, qname, qname_len);
+  ink_code_incr_md5_update(&ctx, (char *) &qtype, sizeof(qtype));
+  ink_code_incr_md5_final((char *) &qkey, &ctx);
+
   SET_HANDLER((DNSEntryHandler) & DNSEntry::mainEvent);
 }
 
@@ -869,18 +875,14 @@ get_dns(DNSHandler *h, uint16_t id)
   return NULL;
 }
 
-/** Find a DNSEntry by query name and type. */
+/** Find a DNSEntry by the query it was submitted with. */
 inline static DNSEntry *
-get_entry(DNSHandler *h, char *qname, int qtype)
+get_entry(DNSHandler *h, INK_MD5 &qkey)
 {
-  for (DNSEntry *e = h->entries.head; e; e = (DNSEntry *) e->link.next) {
-    if (e->qtype == qtype) {
-      if (is_addr_type_reply(qtype)) {
-        if (!strcmp(qname, e->qname))
-          return e;
-      } else if (0 == memcmp(qname, e->qname, e->qname_len))
-        return e;
-    }
+  Queue<DNSEntry, DNSEntry::Link_index_link> &q = h->entry_index[qkey.fold() % DNS_ENTRY_INDEX_SIZE];
+  for (DNSEntry *e = q.head; e; e = e->index_link.next) {
+    if (e->qkey == qkey)
+      return e;
   }
   return NULL;
 }
@@ -1059,13 +1061,15 @@ DNSEntry::mainEvent(int event, Event *e)
         ++domains;
       }
       Debug("dns", "enqueing query %s", qname);
-      DNSEntry *dup = get_entry(dnsH, qname, qtype);
+      DNSEntry *dup = get_entry(dnsH, qkey);
       if (dup) {
         Debug("dns", "collapsing NS request");
+        DNS_INCREMENT_DYN_STAT(dns_coalesced_lookups_stat);
         dup->dups.enqueue(this);
       } else {
         Debug("dns", "adding first to collapsing queue");
         dnsH->entries.enqueue(this);
+        dnsH->entry_index[qkey.fold() % DNS_ENTRY_INDEX_SIZE].enqueue(this);
         write_dns(dnsH);
       }
       return EVENT_DONE;
@@ -1194,6 +1198,7 @@ dns_result(DNSHandler *h, DNSEntry *e, HostEnt *ent, bool retry) {
     }
   }
   h->entries.remove(e);
+  h->entry_index[e->qkey.fold() % DNS_ENTRY_INDEX_SIZE].remove(e);
 
   if (is_addr_type_reply(e->qtype)) {
     ip_text_buffer buff;
@@ -1676,6 +1681,10 @@ ink_dns_init(ModuleVersion v)
                      "proxy.process.dns.in_flight",
                      RECD_INT, RECP_NON_PERSISTENT, (int) dns_in_flight_stat, RecRawStatSyncSum);
 
+  RecRegisterRawStat(dns_rsb, RECT_PROCESS,
+                     "proxy.process.dns.coalesced_lookups",
+                     RECD_INT, RECP_NULL, (int) dns_coalesced_lookups_stat, RecRawStatSyncSum);
+
 }
 
 
@@ -68,6 +68,7 @@ extern unsigned int dns_sequence_number;
 #define DNS_SEQUENCE_NUMBER_RESTART_OFFSET  4000
 #define DNS_PRIMARY_RETRY_PERIOD            HRTIME_SECONDS(5)
 #define DNS_PRIMARY_REOPEN_PERIOD           HRTIME_SECONDS(60)
+#define DNS_ENTRY_INDEX_SIZE                256
 #define BAD_DNS_RESULT                      ((HostEnt*)(uintptr_t)-1)
 
 #define DEFAULT_NUM_TRY_SERVER              8
@@ -103,6 +104,7 @@ enum DNS_Stats
   dns_max_retries_exceeded_stat,
   dns_sequence_number_stat,
   dns_in_flight_stat,
+  dns_coalesced_lookups_stat,
   DNS_Stat_Count
 };
 
@@ -156,6 +158,7 @@ struct DNSEntry: public Continuation
   ink_hrtime send_time;
   char qname[MAXDNAME];
   int qname_len;
+  INK_MD5 qkey;                 ///< Hash of the query as submitted (qname and qtype change on retries).
   char **domains;
   EThread *submit_thread;
   Action action;
@@ -167,6 +170,7 @@ struct DNSEntry: public Continuation
   bool last;
   LINK(DNSEntry, dup_link);
   Que(DNSEntry, dup_link) dups;
+  LINK(DNSEntry, index_link);
 
   int mainEvent(int event, Event *e);
   int delayEvent(int event, Event *e);
@@ -208,6 +212,8 @@ struct DNSHandler: public Continuation
   DNSConnection con[MAX_NAMED];
   int options;
   Queue<DNSEntry> entries;
+  /// @a entries by DNSEntry::qkey, so that identical queries can be collapsed.
+  Queue<DNSEntry, DNSEntry::Link_index_link> entry_index[DNS_ENTRY_INDEX_SIZE];
   Queue<DNSConnection> triggered;
   int in_flight;
   int name_server;
@@ -30,14 +30,53 @@
 
 #include "P_EventSystem.h"
 
+enum
+{
+  HUGEPAGE_STAT_ALLOCATED_BYTES,
+  HUGEPAGE_STAT_FALLBACK_BYTES,
+  HUGEPAGE_STAT_COUNT
+};
+
+static int
+hugepage_stats_cb(const char *name, RecDataT data_type, RecData *data, RecRawStatBlock *rsb, int id)
+{
+  NOWARN_UNUSED(name);
+  NOWARN_UNUSED(data_type);
+  NOWARN_UNUSED(rsb);
+
+  switch (id) {
+  case HUGEPAGE_STAT_ALLOCATED_BYTES:
+    data->rec_int = ats_hugepage_allocated;
+    break;
+  case HUGEPAGE_STAT_FALLBACK_BYTES:
+    data->rec_int = ats_hugepage_fallback;
+    break;
+  default:
+    ink_assert(0);
+  }
+  return 0;
+}
+
 void
 ink_event_system_init(ModuleVersion v)
 {
   ink_release_assert(!checkModuleVersion(v, EVENT_SYSTEM_MODULE_VERSION));
   int config_max_iobuffer_size = DEFAULT_MAX_BUFFER_SIZE;
+  int hugepages = 0;
 
   IOCORE_ReadConfigInteger(config_max_iobuffer_size, "proxy.config.io.max_buffer_size");
 
+  IOCORE_ReadConfigInteger(hugepages, "proxy.config.allocator.hugepages");
+  IOCORE_ReadConfigInteger(hugepage_min_iobuffer_size, "proxy.config.allocator.hugepages_min_size");
+  ats_hugepage_init(hugepages);
+  if (ats_hugepage_enabled()) {
+    RecRawStatBlock *rsb = RecAllocateRawStatBlock((int) HUGEPAGE_STAT_COUNT);
+    RecRegisterRawStat(rsb, RECT_PROCESS, "proxy.process.allocator.hugepages.allocated_bytes",
+                       RECD_INT, RECP_NULL, (int) HUGEPAGE_STAT_ALLOCATED_BYTES, hugepage_stats_cb);
+    RecRegisterRawStat(rsb, RECT_PROCESS, "proxy.process.allocator.hugepages.fallback_bytes",
+                       RECD_INT, RECP_NULL, (int) HUGEPAGE_STAT_FALLBACK_BYTES, hugepage_stats_cb);
+  }
+
   max_iobuffer_size = buffer_size_to_index(config_max_iobuffer_size, DEFAULT_BUFFER_SIZES - 1);
   if (default_small_iobuffer_size > max_iobuffer_size)
     default_small_iobuffer_size = max_iobuffer_size;
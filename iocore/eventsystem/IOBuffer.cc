@@ -41,6 +41,7 @@ inkcoreapi ClassAllocator<IOBufferBlock> ioBlockAllocator("ioBlockAllocator", DE
 int64_t default_large_iobuffer_size = DEFAULT_LARGE_BUFFER_SIZE;
 int64_t default_small_iobuffer_size = DEFAULT_SMALL_BUFFER_SIZE;
 int64_t max_iobuffer_size = DEFAULT_BUFFER_SIZES - 1;
+int64_t hugepage_min_iobuffer_size = BUFFER_SIZE_FOR_INDEX(BUFFER_SIZE_INDEX_1M);
 
 //
 // Initialization
@@ -57,17 +58,22 @@ init_buffer_allocators()
     if (s < a)
       a = s;
 
+    // Only the large size classes are worth huge pages. RAM cache buffers
+    // are long lived, so they get them whenever a chunk covers a huge page.
+    bool huge = ats_hugepage_enabled() && s >= hugepage_min_iobuffer_size;
+    bool ram_huge = huge || (ats_hugepage_enabled() && s * n >= (int64_t) ats_hugepage_size());
+
     name = NEW(new char[64]);
     snprintf(name, 64, "ioBufAllocator[%d]", i);
-    ioBufAllocator[i].re_init(name, s, n, a);
+    ioBufAllocator[i].re_init(name, s, n, a, huge);
 
     name = NEW(new char[64]);
     snprintf(name, 64, "cacheBufAllocator[%d]", i);
-    cacheBufAllocator[i].re_init(name, s, n, a);
+    cacheBufAllocator[i].re_init(name, s, n, a, huge);
 
     name = NEW(new char[64]);
     snprintf(name, 64, "ramBufAllocator[%d]", i);
-    ramBufAllocator[i].re_init(name, s, n, a);
+    ramBufAllocator[i].re_init(name, s, n, a, ram_huge);
   }
 }
 
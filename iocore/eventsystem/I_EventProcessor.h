@@ -120,10 +120,12 @@ public:
     returns the thread group id (or EventType). See the remarks section
     for Thread Groups.
 
+    @param affinity affinity level (an InkAffinityType) the threads of
+      the group are spread over, INK_AFFINITY_NONE to not bind them.
     @return EventType or thread id for the new group of threads.
 
   */
-  EventType spawn_event_threads(int n_threads, const char* et_name);
+  EventType spawn_event_threads(int n_threads, const char* et_name, int affinity = INK_AFFINITY_NONE);
 
 
   /**
@@ -248,6 +250,15 @@ public:
   */
   int start(int n_net_threads);
 
+  /**
+    Bind the thread start() was called on, the first ET_CALL thread, as
+    proxy.config.exec_thread.affinity says. Threads inherit the binding
+    of the thread that creates them, so call this after all the other
+    thread groups have been started.
+
+  */
+  void bind_main_thread();
+
   /**
     Stop the EventProcessor. Attempts to stop the EventProcessor and
     all of the threads in each of the thread groups.
@@ -53,6 +53,7 @@ class VIO;
 inkcoreapi extern int64_t max_iobuffer_size;
 extern int64_t default_small_iobuffer_size;
 extern int64_t default_large_iobuffer_size; // matched to size of OS buffers
+extern int64_t hugepage_min_iobuffer_size;  // smallest size class backed by huge pages
 
 #define TRACK_BUFFER_USER
 
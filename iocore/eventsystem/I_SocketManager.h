@@ -70,6 +70,11 @@ struct SocketManager
   int64_t writev(int fd, struct iovec *vector, size_t count);
   int64_t write_vector(int fd, struct iovec *vector, size_t count, void *pOLP = 0);
   int64_t pwrite(int fd, void *buf, int len, off_t offset, char *tag = NULL);
+#if TS_HAS_SPLICE
+  // move len bytes between fd_in and fd_out, one of which is a pipe,
+  // without copying through user space
+  int64_t splice(int fd_in, int fd_out, int64_t len, unsigned int flags);
+#endif
 
   int send(int fd, void *buf, int len, int flags);
   int sendto(int fd, void *buf, int len, int flags, struct sockaddr const* to, int tolen);
@@ -114,6 +114,28 @@ public:
   */
   ProxyMutex *mutex;
 
+  /**
+    CPU affinity of the thread. The affinity level (an InkAffinityType)
+    and the index of the topology object to bind to. The thread binds
+    itself when it starts, so these must be set before start().
+
+  */
+  int affinity_type;
+  int affinity_index;
+
+  /**
+    First CPU the thread is bound to, or -1 if the thread is not bound.
+
+  */
+  int cpu_id;
+
+  /**
+    Bind the calling thread according to affinity_type and
+    affinity_index, and publish the resulting CPU as a stat.
+
+  */
+  void bind_affinity(const char *name);
+
   // PRIVATE
   void set_specific();
   Thread();
@@ -135,6 +157,20 @@ public:
   {  }
 };
 
+/**
+  Read the affinity level in the configuration variable @a config_name,
+  INK_AFFINITY_NONE (with a warning) if this system doesn't support it.
+
+*/
+int read_thread_affinity_config(const char *config_name);
+
+/**
+  Publish the CPU a thread is bound to as the process stat
+  proxy.process.thread.<name>.cpu, -1 meaning not bound.
+
+*/
+void set_thread_cpu_stat(const char *name, int cpu);
+
 TS_INLINE ink_hrtime ink_get_hrtime();
 TS_INLINE ink_hrtime ink_get_based_hrtime();
 TS_INLINE Thread *this_thread();
@@ -235,6 +235,21 @@ SocketManager::writev(int fd, struct iovec *vector, size_t count)
   return r;
 }
 
+#if TS_HAS_SPLICE
+TS_INLINE int64_t
+SocketManager::splice(int fd_in, int fd_out, int64_t len, unsigned int flags)
+{
+  int64_t r;
+  do {
+    r =::splice(fd_in, NULL, fd_out, NULL, len, flags);
+    if (likely(r >= 0))
+      break;
+    r = -errno;
+  } while (r == -EINTR);
+  return r;
+}
+#endif
+
 TS_INLINE int64_t
 SocketManager::write_vector(int fd, struct iovec *vector, size_t count, void *pOLP)
 {
@@ -30,7 +30,9 @@ TasksProcessor tasksProcessor;
 int
 TasksProcessor::start(int task_threads)
 {
-  if (task_threads > 0)
-    ET_TASK = eventProcessor.spawn_event_threads(task_threads, "ET_TASK");
+  if (task_threads > 0) {
+    int affinity = read_thread_affinity_config("proxy.config.task_threads.affinity");
+    ET_TASK = eventProcessor.spawn_event_threads(task_threads, "ET_TASK", affinity);
+  }
   return 0;
 }
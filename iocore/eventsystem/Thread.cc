@@ -43,6 +43,7 @@ inkcoreapi ink_thread_key
   Thread::thread_data_key = init_thread_key();
 
 Thread::Thread()
+  : affinity_type(INK_AFFINITY_NONE), affinity_index(0), cpu_id(-1)
 {
   mutex = new_ProxyMutex();
   mutex_ptr = mutex;
@@ -82,6 +83,11 @@ spawn_thread_internal(void *a)
 
   p->me->set_specific();
   ink_set_thread_name(p->name);
+  // don't keep the binding of the thread that started this one
+  if (p->me->affinity_type != INK_AFFINITY_NONE)
+    p->me->bind_affinity(p->name);
+  else
+    ink_affinity_unbind();
   if (p->f)
     p->f(p->a);
   else
@@ -105,3 +111,46 @@ Thread::start(const char* name, ThreadFunction f, void *a, size_t stacksize)
   ink_strlcpy(p->name, name, MAX_THREAD_NAME_LENGTH);
   this->tid = ink_thread_create(spawn_thread_internal, (void *) p, 0, stacksize);
 }
+
+void
+Thread::bind_affinity(const char *name)
+{
+  cpu_id = ink_affinity_bind(affinity_type, affinity_index);
+  if (cpu_id < 0)
+    Warning("unable to bind thread %s to affinity level %d object %d", name, affinity_type, affinity_index);
+  else
+    Debug("iocore_thread", "bound thread %s to cpu %d", name, cpu_id);
+  set_thread_cpu_stat(name, cpu_id);
+}
+
+int
+read_thread_affinity_config(const char *config_name)
+{
+  int affinity = INK_AFFINITY_NONE;
+
+  REC_ReadConfigInteger(affinity, config_name);
+  if (affinity != INK_AFFINITY_NONE && ink_affinity_count(affinity) <= 0) {
+    Warning("%s %d is not supported on this system, threads will not be bound", config_name, affinity);
+    affinity = INK_AFFINITY_NONE;
+  }
+  return affinity;
+}
+
+void
+set_thread_cpu_stat(const char *name, int cpu)
+{
+  char stat_name[256];
+  char *p;
+
+  // "[ET_NET 3]" -> "proxy.process.thread.ET_NET_3.cpu"
+  p = stat_name + snprintf(stat_name, sizeof(stat_name), "proxy.process.thread.");
+  for (; *name && p < stat_name + sizeof(stat_name) - sizeof(".cpu"); ++name) {
+    if (*name == '[' || *name == ']')
+      continue;
+    *p++ = (*name == ' ') ? '_' : *name;
+  }
+  ink_strlcpy(p, ".cpu", sizeof(".cpu"));
+
+  RecRegisterStatInt(RECT_PROCESS, stat_name, -1, RECP_NON_PERSISTENT);
+  RecSetRecordInt(stat_name, cpu);
+}
@@ -26,7 +26,7 @@
 
 
 EventType
-EventProcessor::spawn_event_threads(int n_threads, const char* et_name)
+EventProcessor::spawn_event_threads(int n_threads, const char* et_name, int affinity)
 {
   char thr_name[MAX_THREAD_NAME_LENGTH];
   EventType new_thread_group_id;
@@ -43,6 +43,8 @@ EventProcessor::spawn_event_threads(int n_threads, const char* et_name)
     all_ethreads[n_ethreads + i] = t;
     eventthread[new_thread_group_id][i] = t;
     t->set_event_type(new_thread_group_id);
+    t->affinity_type = affinity;
+    t->affinity_index = i;
   }
 
   n_threads_for_type[new_thread_group_id] = n_threads;
@@ -80,6 +82,7 @@ EventProcessor::start(int n_event_threads)
   n_thread_groups = 1;
 
   int first_thread = 1;
+  int affinity = read_thread_affinity_config("proxy.config.exec_thread.affinity");
 
   for (i = 0; i < n_event_threads; i++) {
     EThread *t = NEW(new EThread(REGULAR, i));
@@ -92,8 +95,13 @@ EventProcessor::start(int n_event_threads)
 
     eventthread[ET_CALL][i] = t;
     t->set_event_type((EventType) ET_CALL);
+    t->affinity_type = affinity;
+    t->affinity_index = i;
   }
   n_threads_for_type[ET_CALL] = n_event_threads;
+
+  // The first thread is the one we are running on, it is bound by
+  // bind_main_thread() once the other threads have been started.
   for (i = first_thread; i < n_ethreads; i++) {
     snprintf(thr_name, MAX_THREAD_NAME_LENGTH, "[ET_NET %d]", i);
     all_ethreads[i]->start(thr_name);
@@ -103,6 +111,18 @@ EventProcessor::start(int n_event_threads)
   return 0;
 }
 
+void
+EventProcessor::bind_main_thread()
+{
+  char thr_name[MAX_THREAD_NAME_LENGTH];
+
+  ink_release_assert(this_ethread() == all_ethreads[0]);
+  if (all_ethreads[0]->affinity_type != INK_AFFINITY_NONE) {
+    snprintf(thr_name, MAX_THREAD_NAME_LENGTH, "[ET_NET %d]", 0);
+    all_ethreads[0]->bind_affinity(thr_name);
+  }
+}
+
 void
 EventProcessor::shutdown()
 {
@@ -43,6 +43,7 @@
 #define USE_MMH
 
 #include "ink_apidefs.h"
+#include "ts/TestBox.h"
 
 HostDBProcessor hostDBProcessor;
 int HostDBProcessor::hostdb_strict_round_robin = 0;
@@ -60,6 +61,7 @@ unsigned int hostdb_ip_stale_interval = HOST_DB_IP_STALE;
 unsigned int hostdb_ip_timeout_interval = HOST_DB_IP_TIMEOUT;
 unsigned int hostdb_ip_fail_timeout_interval = HOST_DB_IP_FAIL_TIMEOUT;
 unsigned int hostdb_serve_stale_but_revalidate = 0;
+int hostdb_refresh_ahead = 0;
 char hostdb_filename[PATH_NAME_MAX + 1] = DEFAULT_HOST_DB_FILENAME;
 int hostdb_size = DEFAULT_HOST_DB_SIZE;
 //int hostdb_timestamp = 0;
@@ -68,6 +70,10 @@ int hostdb_disable_reverse_lookup = 0;
 
 ClassAllocator<HostDBContinuation> hostDBContAllocator("hostDBContAllocator");
 
+// Forward lookups go to this DNSHandler (NULL is the default one) unless
+// split DNS picks another; the regression tests point it at a stub.
+static DNSHandler *hostdb_dns_handler = NULL;
+
 // Static configuration information
 
 HostDBCache
@@ -307,6 +313,8 @@ HostDBCache::start(int flags)
   Span *hostDBSpan;
   char storage_path[PATH_NAME_MAX + 1];
   int storage_size = 0;
+  int read_cache_size = 0;
+  int snapshot = 0;
 
   bool reconfigure = ((flags & PROCESSOR_RECONFIGURE) ? true : false);
   bool fix = ((flags & PROCESSOR_FIX) ? true : false);
@@ -319,6 +327,9 @@ HostDBCache::start(int flags)
   IOCORE_ReadConfigInt32(hostdb_size, "proxy.config.hostdb.size");
   IOCORE_ReadConfigString(storage_path, "proxy.config.hostdb.storage_path", PATH_NAME_MAX);
   IOCORE_ReadConfigInt32(storage_size, "proxy.config.hostdb.storage_size");
+  IOCORE_ReadConfigInt32(read_cache_size, "proxy.config.hostdb.read_cache.size");
+  IOCORE_ReadConfigInt32(snapshot, "proxy.config.hostdb.snapshot");
+  snapshot_enabled = snapshot != 0;
 
   if (storage_path[0] != '/') {
     Layout::relative_to(storage_path, PATH_NAME_MAX,
@@ -364,6 +375,8 @@ HostDBCache::start(int flags)
     }
   }
   HOSTDB_SET_DYN_COUNT(hostdb_bytes_stat, totalsize);
+  read_cache.init(read_cache_size);
+  Debug("hostdb", "read cache for %d entries", read_cache_size);
   //  XXX I don't see this being reference in the previous function calls, so I am going to delete it -bcall
   delete hostDBStore;
   return 0;
@@ -410,6 +423,7 @@ HostDBProcessor::start(int)
   IOCORE_EstablishStaticConfigInt32U(hostdb_ip_stale_interval, "proxy.config.hostdb.verify_after");
   IOCORE_EstablishStaticConfigInt32U(hostdb_ip_fail_timeout_interval, "proxy.config.hostdb.fail.timeout");
   IOCORE_EstablishStaticConfigInt32U(hostdb_serve_stale_but_revalidate, "proxy.config.hostdb.serve_stale_for");
+  IOCORE_EstablishStaticConfigInt32(hostdb_refresh_ahead, "proxy.config.hostdb.refresh_ahead");
 
   //
   // Set up hostdb_current_interval
@@ -491,6 +505,15 @@ make_md5(INK_MD5 & md5, const char *hostname, int len, int port, char *pDNSServe
 #endif
 }
 
+// Only single address entries are copied into the read cache, anything
+// with data in the MultiCache heap has to be read under the lock.
+static inline void
+publish_to_read_cache(HostDBInfo * r)
+{
+  if (!r->round_robin && !r->is_srv && !r->reverse_dns && !r->failed())
+    hostDB.read_cache.put(r->md5_high, r);
+}
+
 static bool
 reply_to_cont(Continuation * cont, HostDBInfo * ar, bool is_srv = false)
 {
@@ -519,6 +542,7 @@ reply_to_cont(Continuation * cont, HostDBInfo * ar, bool is_srv = false)
       }
       if (is_srv) {
         cont->handleEvent(EVENT_SRV_LOOKUP, r);
+        hostDB.read_cache.remove(r->md5_high);
         if (!r->full)
           goto Ldelete;
         return true;
@@ -527,6 +551,8 @@ reply_to_cont(Continuation * cont, HostDBInfo * ar, bool is_srv = false)
       Debug("hostdb", "RR of %d with %d good, 1st IP = %s", r->rr()->n, r->rr()->good, ats_ip_ntop(r->ip(), ipb, sizeof ipb));
     }
     cont->handleEvent(is_srv ? EVENT_SRV_LOOKUP : EVENT_HOST_DB_LOOKUP, r->is_srv ? NULL : r);
+    // the callback may have updated the entry (e.g. marked the host down)
+    hostDB.read_cache.remove(r->md5_high);
     if (!r->full)
       goto Ldelete;
     return true;
@@ -580,16 +606,23 @@ probe(ProxyMutex *mutex, INK_MD5 & md5, const char *hostname, int len, sockaddr
       }
       // Check for stale (revalidate offline if we are the owner)
       // -or-
+      // we are close to the end of our TTL [hostdb_refresh_ahead percent of it]
+      // -or-
       // we are beyond our TTL but we choose to serve for another N seconds [hostdb_serve_stale_but_revalidate seconds]
-      if ((!ignore_timeout && r->is_ip_stale()
+      if ((!ignore_timeout && (r->is_ip_stale() || r->is_ip_refresh_due())
 #ifdef NON_MODULAR
            && !cluster_machine_at_depth(master_hash(md5))
 #endif
            && !r->reverse_dns) || (r->is_ip_timeout() && r->serve_stale_but_revalidate())) {
-        Debug("hostdb", "stale %u %u %u, using it and refreshing it", r->ip_interval(),
-              r->ip_timestamp, r->ip_timeout_interval);
-        r->refresh_ip();
-        if (!is_dotted_form_hostname(hostname)) {
+        if (is_dotted_form_hostname(hostname)) {
+          r->refresh_ip();
+        } else if (!hostDB.is_pending_dns_for_hash(md5)) {
+          // The entry keeps its timestamp, so it stays bounded by its TTL
+          // (and serve_stale_for) should the refresh fail; the pending
+          // query is what keeps us from starting another one.
+          Debug("hostdb", "stale %u %u %u, using it and refreshing it", r->ip_interval(),
+                r->ip_timestamp, r->ip_timeout_interval);
+          HOSTDB_INCREMENT_DYN_STAT(hostdb_refresh_stat);
           HostDBContinuation *c = hostDBContAllocator.alloc();
           c->init(hostname, len, ip, md5, NULL, pDS, is_srv_lookup, 0);
           c->do_dns();
@@ -599,6 +632,7 @@ probe(ProxyMutex *mutex, INK_MD5 & md5, const char *hostname, int len, sockaddr
       r->hits++;
       if (!r->hits)
         r->hits--;
+      publish_to_read_cache(r);
       return r;
     }
   }
@@ -619,6 +653,7 @@ HostDBContinuation::insert(unsigned int attl)
   HostDBInfo *old_r = hostDB.lookup_block(folded_md5, 3);
   if (old_r)
     hostDB.delete_block(old_r);
+  hostDB.read_cache.remove(md5[1]);
   HostDBInfo *r = hostDB.insert_block(folded_md5, NULL, 0);
   Debug("hostdb_insert", "inserting in bucket %d", (int) (folded_md5 % hostDB.buckets));
   r->md5_high = md5[1];
@@ -902,6 +937,20 @@ HostDBProcessor::getbyname_imm(Continuation * cont, process_hostdb_info_pfn proc
 
   // Attempt to find the result in-line, for level 1 hits
   if (!force_dns) {
+    // A copy from the read cache answers without touching the partition
+    // lock. Anything that needs attention (stale, expiring) goes the long
+    // way so that probe() can refresh it.
+    HostDBInfo copy;
+    if (hostDB.read_cache.get(md5[1], &copy) && copy.md5_high == md5[1] && !copy.is_deleted() &&
+        !copy.round_robin && !copy.is_srv && !copy.reverse_dns && !copy.failed() &&
+        !copy.is_ip_timeout() && !copy.is_ip_stale() && !copy.is_ip_refresh_due()) {
+      Debug("hostdb", "read cache answer for %s", hostname);
+      HOSTDB_INCREMENT_DYN_STAT(hostdb_total_hits_stat);
+      HOSTDB_INCREMENT_DYN_STAT(hostdb_read_cache_hits_stat);
+      (cont->*process_hostdb_info) (&copy);
+      return ACTION_RESULT_DONE;
+    }
+
     // find the partition lock
     ProxyMutex *bucket_mutex = hostDB.lock_for_bucket((int) (fold_md5(md5) % hostDB.buckets));
     MUTEX_TRY_LOCK(lock, bucket_mutex, thread);
@@ -990,6 +1039,8 @@ do_setby(HostDBInfo * r, HostDBApplicationInfo * app, const char *hostname, sock
   if (is_srv && (!r->is_srv || !rr))
     return;
 
+  hostDB.read_cache.remove(r->md5_high);
+
   if (rr) {
     if (is_srv) {
       uint32_t key = makeHostHash(hostname);
@@ -1479,7 +1530,14 @@ HostDBContinuation::dnsEvent(int event, HostEnt * e)
     ats_ip_invalidate(tip_ptr);
     if (first) ip_addr_set(tip_ptr, af, first);
 
-    if (is_byname())
+    // A failed refresh does not take away an answer we can still serve,
+    // it stays until its TTL (plus serve_stale_for) runs out.
+    if (failed && old_r && !old_r->failed() && !old_r->reverse_dns &&
+        (!old_r->is_ip_timeout() || old_r->serve_stale_but_revalidate())) {
+      Debug("hostdb", "DNS failed for %s, keeping the old entry", name);
+      HOSTDB_INCREMENT_DYN_STAT(hostdb_stale_kept_stat);
+      r = old_r;
+    } else if (is_byname())
       r = lookup_done(tip_ptr, name, rr, ttl_seconds, failed ? 0 : &e->srv_hosts);
     else if (is_srv())
       r = lookup_done(tip_ptr,  /* junk: FIXME: is the code in lookup_done() wrong to NEED this? */
@@ -1921,14 +1979,14 @@ HostDBContinuation::do_dns()
   if (set_check_pending_dns()) {
     SET_HANDLER((HostDBContHandler) & HostDBContinuation::dnsEvent);
     if (is_byname()) {
-      DNSHandler *dnsH = 0;
+      DNSHandler *dnsH = hostdb_dns_handler;
 #ifdef SPLIT_DNS
       if (m_pDS)
         dnsH = static_cast<DNSServer *>(m_pDS)->x_dnsH;
 #endif
       pending_action = dnsProcessor.gethostbyname(this, name, dnsH, dns_lookup_timeout);
     } else if (is_srv()) {
-      DNSHandler *dnsH = 0;
+      DNSHandler *dnsH = hostdb_dns_handler;
       Debug("dns_srv", "SRV lookup of %s", name);
       pending_action = dnsProcessor.getSRVbyname(this, name, dnsH, dns_lookup_timeout);
     } else {
@@ -2450,6 +2508,428 @@ run_HostDBTest()
     eventProcessor.schedule_imm(new HostDBTestReverse, ET_CACHE);
   }
 }
+
+REGRESSION_TEST(HostDB_ReadCache)(RegressionTest * t, int atype, int * pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  ReadMostlyCache<HostDBInfo> cache;
+  HostDBInfo info, out;
+
+  box = REGRESSION_TEST_PASSED;
+
+  cache.init(8);
+  box.check(cache.enabled() && cache.set_mask == 1, "expected 2 sets, mask is %" PRIu64, cache.set_mask);
+
+  info.md5_high = 0x1234;
+  ats_ip4_set(info.ip(), htonl(0x7f000001));
+  cache.put(info.md5_high, &info);
+  box.check(cache.get(0x1234, &out) && out.md5_high == 0x1234 && ats_ip_addr_eq(out.ip(), info.ip()), "missed an entry just put");
+  box.check(!cache.get(0x1236, &out), "hit an entry never put");
+  box.check(!cache.get(0, &out), "hit the empty key");
+
+  // the set is 4 ways, so a fifth key has to displace one of the others
+  for (uint64_t k = 2; k <= 10; k += 2) {
+    info.md5_high = k;
+    cache.put(k, &info);
+  }
+  int found = 0;
+  for (uint64_t k = 2; k <= 10; k += 2)
+    found += cache.get(k, &out);
+  box.check(found == READ_CACHE_WAYS, "expected %d entries in a full set, found %d", READ_CACHE_WAYS, found);
+
+  cache.remove(0x1234);
+  box.check(!cache.get(0x1234, &out), "hit an entry after remove");
+  info.md5_high = 0x1234;
+  cache.put(0x1234, &info);
+  box.check(cache.get(0x1234, &out), "missed an entry put again after remove");
+}
+
+// A DNS server on a local UDP port which answers A queries for any name
+// with one address, or with SERVFAIL, and which can hold the queries it
+// gets until it is told to answer them.
+struct StubResolver
+{
+  struct Query
+  {
+    IpEndpoint from;
+    unsigned char buf[512];
+    int len;
+  };
+
+  int fd;
+  IpEndpoint addr;
+  const char *name;
+  int queries;                  // A queries for name
+  bool hold;
+  bool fail;
+  in_addr_t answer;
+  Query held[32];
+  int n_held;
+
+  StubResolver(const char *aname)
+    : fd(-1), name(aname), queries(0), hold(false), fail(false), answer(0), n_held(0)
+  {
+    socklen_t l = sizeof(addr);
+    ats_ip4_set(&addr.sa, htonl(INADDR_LOOPBACK), 0);
+    if ((fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+      return;
+    if (bind(fd, &addr.sa, ats_ip_size(&addr.sa)) < 0 || getsockname(fd, &addr.sa, &l) < 0 ||
+        fcntl(fd, F_SETFL, O_NONBLOCK) < 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+
+  ~StubResolver()
+  {
+    if (fd >= 0)
+      close(fd);
+  }
+
+  // End of the question in @a q, with its name in @a qname, or -1.
+  static int question(Query & q, char *qname, int *qtype)
+  {
+    int i = HFIXEDSZ, n = 0;
+    while (i < q.len && q.buf[i]) {
+      int l = q.buf[i++];
+      if (l > 63 || i + l >= q.len || n + l + 1 >= MAXDNAME)
+        return -1;
+      if (n)
+        qname[n++] = '.';
+      for (int j = 0; j < l; j++)
+        qname[n++] = ParseRules::ink_tolower(q.buf[i + j]);
+      i += l;
+    }
+    qname[n] = 0;
+    if (i + 5 > q.len)
+      return -1;
+    *qtype = (q.buf[i + 1] << 8) | q.buf[i + 2];
+    return i + 5;
+  }
+
+  void reply(Query & q)
+  {
+    char qname[MAXDNAME];
+    int qtype;
+    int end = question(q, qname, &qtype);
+    if (end < 0)
+      return;
+    unsigned char r[512];
+    memcpy(r, q.buf, end);
+    bool an = qtype == T_A && !fail;
+    r[2] = 0x80 | (q.buf[2] & 0x01);    // a response, with the RD bit of the query
+    r[3] = 0x80 | (fail ? SERVFAIL : NOERROR);
+    r[6] = r[8] = r[9] = r[10] = r[11] = 0;
+    r[7] = an;
+    int n = end;
+    if (an) {
+      static const unsigned char rr[] = { 0xc0, 0x0c, 0, T_A, 0, C_IN, 0, 0, 0, 100, 0, 4 };
+      memcpy(r + n, rr, sizeof(rr));
+      n += sizeof(rr);
+      memcpy(r + n, &answer, 4);
+      n += 4;
+    }
+    sendto(fd, r, n, 0, &q.from.sa, ats_ip_size(&q.from.sa));
+  }
+
+  void poll()
+  {
+    Query q;
+    for (;;) {
+      socklen_t l = sizeof(q.from);
+      if ((q.len = recvfrom(fd, q.buf, sizeof(q.buf), 0, &q.from.sa, &l)) < 0)
+        break;
+      char qname[MAXDNAME];
+      int qtype;
+      if (question(q, qname, &qtype) < 0)
+        continue;
+      if (qtype == T_A && !strcmp(qname, name))
+        queries++;
+      if (hold && n_held < (int) (sizeof(held) / sizeof(held[0])))
+        held[n_held++] = q;
+      else
+        reply(q);
+    }
+  }
+
+  void release()
+  {
+    hold = false;
+    for (int i = 0; i < n_held; i++)
+      reply(held[i]);
+    n_held = 0;
+  }
+};
+
+// Runs lookups of one name through a DNSHandler which talks to a
+// StubResolver. Concurrent lookups for the name, on several ports so
+// that they are different HostDB entries, have to make one query; an
+// entry being refreshed, or whose refresh failed, has to be served until
+// its TTL plus serve_stale_for runs out.
+struct HostDBStubTest: public Continuation
+{
+  enum
+  {
+    COLLAPSE_START, COLLAPSE_HELD, COLLAPSE_DONE,
+    REFRESH_START, REFRESH_SENT, REFRESH_AGAIN,
+    FAIL_WAIT, FAIL_CHECK, STALE_WAIT, STALE_CHECK, EXPIRED_WAIT, EXPIRED_CHECK
+  };
+
+  RegressionTest *t;
+  int *pstatus;
+  int phase;
+  char name[64];
+  StubResolver stub;
+  DNSHandler *dnsH;
+  int answers;
+  int found;
+  in_addr_t last;
+  in_addr_t first_ip;
+  ink_hrtime start;
+  ink_hrtime wait_until;
+  int save_ttl_mode;
+  int save_refresh_ahead;
+  unsigned int save_serve_stale;
+
+  HostDBStubTest(RegressionTest * at, int *apstatus)
+    : Continuation(new_ProxyMutex()), t(at), pstatus(apstatus), phase(COLLAPSE_START), stub(name), dnsH(NULL),
+      answers(0), found(0), last(0), first_ip(inet_addr("10.9.8.7")), start(ink_get_hrtime()), wait_until(0)
+  {
+    // a name of its own, the entries of earlier runs stay in the database
+    snprintf(name, sizeof(name), "h%ld-%d.hostdb-stub.test", (long) getpid(), (int) (start / HRTIME_MSECOND % 100000));
+    stub.answer = first_ip;
+    save_ttl_mode = hostdb_ttl_mode;
+    save_refresh_ahead = hostdb_refresh_ahead;
+    save_serve_stale = hostdb_serve_stale_but_revalidate;
+    SET_HANDLER(&HostDBStubTest::mainEvent);
+  }
+
+  bool start_handler()
+  {
+    ink_res_state res = new ts_imp_res_state;
+    memset(res, 0, sizeof(ts_imp_res_state));
+    if (stub.fd < 0 || -1 == ink_res_init(res, &stub.addr, 1, NULL, NULL, NULL)) {
+      delete res;
+      return false;
+    }
+    dnsH = new DNSHandler;
+    dnsH->m_res = res;
+    dnsH->mutex = new_ProxyMutex();
+    dnsH->options = res->options;
+    ats_ip_invalidate(&dnsH->ip.sa);
+    SET_CONTINUATION_HANDLER(dnsH, &DNSHandler::startEvent_sdns);
+    eventProcessor.eventthread[ET_DNS][0]->schedule_imm(dnsH);
+
+    hostdb_ttl_mode = TTL_OBEY;
+    hostdb_refresh_ahead = 50;
+    hostdb_serve_stale_but_revalidate = 30;
+    hostdb_dns_handler = dnsH;
+    return true;
+  }
+
+  void lookup(int port)
+  {
+    hostDBProcessor.getbyname_re(this, name, 0, port);
+  }
+
+  // Ages the entry for @a port by @a seconds, or tells if it is being
+  // refreshed if @a seconds is 0. False if its partition is busy.
+  bool entry(int port, int seconds, bool *pending = NULL)
+  {
+    INK_MD5 md5;
+    make_md5(md5, name, strlen(name), port, NULL);
+    ProxyMutex *bmutex = hostDB.lock_for_bucket((int) (fold_md5(md5) % hostDB.buckets));
+    MUTEX_TRY_LOCK(lock, bmutex, this_ethread());
+    if (!lock)
+      return false;
+    if (pending)
+      *pending = hostDB.is_pending_dns_for_hash(md5);
+    HostDBInfo *r = hostDB.lookup_block(fold_md5(md5), hostDB.levels);
+    if (seconds && r && r->md5_high == md5[1]) {
+      r->ip_timestamp -= seconds;
+      hostDB.read_cache.remove(r->md5_high);
+    }
+    return true;
+  }
+
+  // True once nothing is refreshing the entry for @a port.
+  bool settled(int port)
+  {
+    bool pending = true;
+    return entry(port, 0, &pending) && !pending;
+  }
+
+  void check_last(in_addr_t ip, const char *what)
+  {
+    ip_text_buffer b1, b2;
+    rprintf(t, "%s: got %s\n", what, last ? inet_ntop(AF_INET, &last, b1, sizeof(b1)) : "nothing");
+    if (last != ip) {
+      rprintf(t, "%s: expected %s\n", what, ip ? inet_ntop(AF_INET, &ip, b2, sizeof(b2)) : "nothing");
+      *pstatus = REGRESSION_TEST_FAILED;
+    }
+  }
+
+  void check(bool ok, const char *what)
+  {
+    if (!ok) {
+      rprintf(t, "%s\n", what);
+      *pstatus = REGRESSION_TEST_FAILED;
+    }
+  }
+
+  void step(ink_hrtime now)
+  {
+    in_addr_t second_ip = inet_addr("10.9.8.6");
+
+    switch (phase) {
+    case COLLAPSE_START:
+      stub.hold = true;
+      for (int port = 80; port < 84; port++) {
+        lookup(port);
+        lookup(port);
+      }
+      wait_until = now + HRTIME_MSECONDS(200);
+      phase = COLLAPSE_HELD;
+      break;
+    case COLLAPSE_HELD:
+      // give the other lookups time to reach the stub as well
+      if (!stub.queries || now < wait_until)
+        break;
+      check(stub.queries == 1, "concurrent lookups made more than one query");
+      rprintf(t, "%d lookups made %d queries\n", 8, stub.queries);
+      stub.release();
+      phase = COLLAPSE_DONE;
+      break;
+    case COLLAPSE_DONE:
+      if (answers < 8)
+        break;
+      check(found == 8, "a concurrent lookup did not get the answer");
+      check_last(first_ip, "concurrent lookups");
+      phase = REFRESH_START;
+      break;
+    case REFRESH_START:
+      // most of the TTL gone, the lookup has to refresh the entry
+      if (!entry(80, 60))
+        break;
+      stub.hold = true;
+      stub.answer = second_ip;
+      lookup(80);
+      phase = REFRESH_SENT;
+      break;
+    case REFRESH_SENT:
+      if (answers < 9 || stub.queries < 2)
+        break;
+      check_last(first_ip, "lookup starting a refresh");
+      lookup(80);
+      wait_until = now + HRTIME_MSECONDS(100);
+      phase = REFRESH_AGAIN;
+      break;
+    case REFRESH_AGAIN:
+      if (answers < 10 || now < wait_until)
+        break;
+      check_last(first_ip, "lookup during a refresh");
+      check(stub.queries == 2, "a lookup during a refresh made another query");
+      stub.fail = true;
+      stub.release();
+      phase = FAIL_WAIT;
+      break;
+    case FAIL_WAIT:
+      if (!settled(80))
+        break;
+      lookup(80);
+      phase = FAIL_CHECK;
+      break;
+    case FAIL_CHECK:
+      if (answers < 11)
+        break;
+      check_last(first_ip, "lookup after a failed refresh");
+      phase = STALE_WAIT;
+      break;
+    case STALE_WAIT:
+      // past the TTL of 100, inside serve_stale_for
+      if (!settled(80) || !entry(80, 50))
+        break;
+      lookup(80);
+      phase = STALE_CHECK;
+      break;
+    case STALE_CHECK:
+      if (answers < 12)
+        break;
+      check_last(first_ip, "lookup past the TTL");
+      phase = EXPIRED_WAIT;
+      break;
+    case EXPIRED_WAIT:
+      // past serve_stale_for as well
+      if (!settled(80) || !entry(80, 30))
+        break;
+      lookup(80);
+      phase = EXPIRED_CHECK;
+      break;
+    case EXPIRED_CHECK:
+      if (answers < 13)
+        break;
+      check_last(0, "lookup past serve_stale_for");
+      done();
+      return;
+    }
+    if (now - start > HRTIME_SECONDS(30)) {
+      rprintf(t, "timed out in phase %d with %d answers\n", phase, answers);
+      *pstatus = REGRESSION_TEST_FAILED;
+      done();
+    }
+  }
+
+  void done()
+  {
+    hostdb_dns_handler = NULL;
+    hostdb_ttl_mode = save_ttl_mode;
+    hostdb_refresh_ahead = save_refresh_ahead;
+    hostdb_serve_stale_but_revalidate = save_serve_stale;
+    if (*pstatus == REGRESSION_TEST_INPROGRESS)
+      *pstatus = REGRESSION_TEST_PASSED;
+    phase = -1;
+  }
+
+  int mainEvent(int event, void *data)
+  {
+    if (event == EVENT_HOST_DB_LOOKUP) {
+      HostDBInfo *r = (HostDBInfo *) data;
+      answers++;
+      last = r && r->ip()->sa_family == AF_INET ? ats_ip4_addr_cast(r->ip()) : 0;
+      found += !!last;
+      return EVENT_DONE;
+    }
+    if (phase < 0) {
+      // every lookup has been answered; the DNSHandler keeps running
+      ((Event *) data)->cancel();
+      delete this;
+      return EVENT_DONE;
+    }
+    stub.poll();
+    step(ink_get_hrtime());
+    return EVENT_CONT;
+  }
+};
+
+EXCLUSIVE_REGRESSION_TEST(HostDB_StubResolver)(RegressionTest * t, int atype, int * pstatus)
+{
+  NOWARN_UNUSED(atype);
+  if (!hostdb_enable) {
+    rprintf(t, "HostDB is disabled, skipping\n");
+    *pstatus = REGRESSION_TEST_PASSED;
+    return;
+  }
+  HostDBStubTest *test = new HostDBStubTest(t, pstatus);
+  if (!test->start_handler()) {
+    rprintf(t, "could not start the stub resolver\n");
+    *pstatus = REGRESSION_TEST_FAILED;
+    delete test;
+    return;
+  }
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+  eventProcessor.schedule_every(test, HRTIME_MSECONDS(10), ET_CALL);
+}
 #endif
 
 
@@ -2498,4 +2978,16 @@ ink_hostdb_init(ModuleVersion v)
 
   RecRegisterRawStat(hostdb_rsb, RECT_PROCESS,
                      "proxy.process.hostdb.bytes", RECD_INT, RECP_NULL, (int) hostdb_bytes_stat, RecRawStatSyncCount);
+
+  RecRegisterRawStat(hostdb_rsb, RECT_PROCESS,
+                     "proxy.process.hostdb.read_cache_hits",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) hostdb_read_cache_hits_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(hostdb_rsb, RECT_PROCESS,
+                     "proxy.process.hostdb.refreshes",
+                     RECD_INT, RECP_NULL, (int) hostdb_refresh_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(hostdb_rsb, RECT_PROCESS,
+                     "proxy.process.hostdb.stale_kept",
+                     RECD_INT, RECP_NULL, (int) hostdb_stale_kept_stat, RecRawStatSyncSum);
 }
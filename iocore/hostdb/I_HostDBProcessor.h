@@ -59,6 +59,7 @@ extern unsigned int hostdb_ip_stale_interval;
 extern unsigned int hostdb_ip_timeout_interval;
 extern unsigned int hostdb_ip_fail_timeout_interval;
 extern unsigned int hostdb_serve_stale_but_revalidate;
+extern int hostdb_refresh_ahead;
 
 
 static inline unsigned int
@@ -218,6 +219,11 @@ struct HostDBInfo
     return ip_interval() >= ip_timeout_interval;
   }
 
+  // within the last hostdb_refresh_ahead percent of the TTL
+  bool is_ip_refresh_due() {
+    return hostdb_refresh_ahead > 0 && ip_time_remaining() * 100 <= (int) ip_timeout_interval * hostdb_refresh_ahead;
+  }
+
   bool is_ip_fail_timeout() {
     return ip_interval() >= hostdb_ip_fail_timeout_interval;
   }
@@ -38,6 +38,7 @@
 
 #include "P_MultiCache.h"
 #include "P_EventSystem.h"      // FIXME: need to have this in I_* header files.
+#include "I_Tasks.h"
 
 //dxu: disable all Diags.h's functions
 //#define Note
@@ -45,9 +46,11 @@
 #define MULTI_CACHE_PAUSE_TIME       HRTIME_MSECONDS(1000)
 
 MultiCacheBase::MultiCacheBase()
-  : store(0), mapped_header(NULL), data(0), lowest_level_data(0), miss_stat(0), buckets_per_partitionF8(0)
+  : store(0), mapped_header(NULL), data(0), lowest_level_data(0), miss_stat(0), buckets_per_partitionF8(0),
+    snapshot_enabled(false)
 {
   filename[0] = 0;
+  snapshot_path[0] = 0;
   memset(hit_stat, 0, sizeof(hit_stat));
   memset(unsunk, 0, sizeof(unsunk));
   for (int i = 0; i < MULTI_CACHE_PARTITIONS; i++)
@@ -650,6 +653,8 @@ MultiCacheBase::open(Store *s, const char *config_filename, char *db_filename, i
       if (mmap_data() < 0)
         goto LfailMap;
       clear();
+      set_snapshot_path();
+      load_snapshot();
     } else {
 
       // don't know how to rebuild from this problem
@@ -746,6 +751,7 @@ MultiCacheBase::open(Store *s, const char *config_filename, char *db_filename, i
   }
   if (store)
     ink_assert(store_verify(store));
+  set_snapshot_path();
 Lcontinue:
   return ret;
 
@@ -1055,6 +1061,238 @@ MultiCacheBase::sync_all()
   return res;
 }
 
+//
+// Writes the snapshot, one partition at a time, on a task thread. Only
+// copying the entries out happens under the partition lock; the file is
+// opened, written, synced and renamed without any lock held. It is
+// written under a temporary name and renamed over the previous snapshot
+// only once it is complete. The continuation that asked for the sync is
+// called back on a net thread, as it is without a snapshot.
+//
+struct MultiCacheSnapshot;
+typedef int (MultiCacheSnapshot::*MCacheSnapshotHandler) (int, void *);
+struct MultiCacheSnapshot: public Continuation
+{
+  int partition;
+  MultiCacheBase *mc;
+  Continuation *cont;
+  int fd;
+  MultiCacheSnapshotHeader header;
+  INK_DIGEST_CTX md5;
+  MultiCacheSnapshotBuffer buf;
+  char tmp_path[PATH_NAME_MAX + 1];
+
+  int openEvent(int event, Event *e)
+  {
+    (void) event;
+    fd = ::open(tmp_path, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    if (fd < 0)
+      Warning("unable to open snapshot '%s': %d, %s", tmp_path, errno, strerror(errno));
+    else if (lseek(fd, sizeof(header), SEEK_SET) < 0) {
+      close(fd);
+      fd = -1;
+    }
+    if (fd < 0)
+      return done();
+    mutex = mc->locks[partition];
+    SET_HANDLER((MCacheSnapshotHandler) & MultiCacheSnapshot::copyEvent);
+    e->schedule_imm();
+    return EVENT_CONT;
+  }
+
+  int copyEvent(int event, Event *e)
+  {
+    (void) event;
+    buf.len = 0;
+    header.entries += mc->snapshot_partition(partition, buf);
+    mutex = e->ethread->mutex;
+    SET_HANDLER((MCacheSnapshotHandler) & MultiCacheSnapshot::writeEvent);
+    e->schedule_imm();
+    return EVENT_CONT;
+  }
+
+  int writeEvent(int event, Event *e)
+  {
+    (void) event;
+    if (fd >= 0 && buf.len) {
+      ink_code_incr_md5_update(&md5, buf.data, buf.len);
+      if (write(fd, buf.data, buf.len) != buf.len) {
+        Warning("unable to write snapshot '%s': %d, %s", tmp_path, errno, strerror(errno));
+        close(fd);
+        fd = -1;
+        unlink(tmp_path);
+      }
+      header.length += buf.len;
+    }
+    partition++;
+    if (fd >= 0 && partition < MULTI_CACHE_PARTITIONS) {
+      mutex = mc->locks[partition];
+      SET_HANDLER((MCacheSnapshotHandler) & MultiCacheSnapshot::copyEvent);
+      e->schedule_imm();
+      return EVENT_CONT;
+    }
+    if (fd >= 0)
+      finish();
+    return done();
+  }
+
+  int done()
+  {
+    mutex = cont->mutex;
+    SET_HANDLER((MCacheSnapshotHandler) & MultiCacheSnapshot::doneEvent);
+    eventProcessor.schedule_imm(this, ET_CALL);
+    return EVENT_DONE;
+  }
+
+  int doneEvent(int event, Event *e)
+  {
+    (void) event;
+    (void) e;
+    cont->handleEvent(MULTI_CACHE_EVENT_SYNC, 0);
+    delete this;
+    return EVENT_DONE;
+  }
+
+  void finish()
+  {
+    ink_code_incr_md5_final(header.digest, &md5);
+    if (pwrite(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header) || fsync(fd) < 0) {
+      Warning("unable to write snapshot '%s': %d, %s", tmp_path, errno, strerror(errno));
+      close(fd);
+      unlink(tmp_path);
+      return;
+    }
+    close(fd);
+    if (rename(tmp_path, mc->snapshot_path) < 0) {
+      Warning("unable to rename snapshot '%s': %d, %s", tmp_path, errno, strerror(errno));
+      unlink(tmp_path);
+      return;
+    }
+    Debug("multicache", "snapshot %s: %d entries, %" PRId64 " bytes", mc->snapshot_path, header.entries, header.length);
+  }
+
+  MultiCacheSnapshot(Continuation *acont, MultiCacheBase *amc)
+    : Continuation(new_ProxyMutex()), partition(0), mc(amc), cont(acont), fd(-1)
+  {
+    memset(&header, 0, sizeof(header));
+    header.magic = MULTI_CACHE_SNAPSHOT_MAGIC;
+    header.version.ink_major = MULTI_CACHE_SNAPSHOT_MAJOR_VERSION;
+    header.version.ink_minor = MULTI_CACHE_SNAPSHOT_MINOR_VERSION;
+    header.cache_version = mc->version;
+    header.elementsize = mc->elementsize;
+    ink_code_incr_md5_init(&md5);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", mc->snapshot_path);
+    SET_HANDLER((MCacheSnapshotHandler) & MultiCacheSnapshot::openEvent);
+  }
+};
+
+void
+MultiCacheSnapshotBuffer::append(const void *p, int n)
+{
+  if (len + n > size) {
+    int s = size ? size : 65536;
+    while (len + n > s)
+      s *= 2;
+    data = (char *) ats_realloc(data, s);
+    size = s;
+  }
+  memcpy(data + len, p, n);
+  len += n;
+}
+
+void
+MultiCacheSnapshotBuffer::pad(int alignment)
+{
+  static const char zeros[MULTI_CACHE_HEAP_ALIGNMENT] = { 0 };
+  int n = (alignment - (len % alignment)) % alignment;
+  ink_assert(n <= MULTI_CACHE_HEAP_ALIGNMENT);
+  if (n)
+    append(zeros, n);
+}
+
+//
+// The snapshot goes next to the database file. Raw devices do not get one.
+//
+void
+MultiCacheBase::set_snapshot_path()
+{
+  snapshot_path[0] = 0;
+  if (!snapshot_enabled || !store || !store->n_disks || !store->disk[0] || store->disk[0]->file_pathname)
+    return;
+  char path[PATH_NAME_MAX + 1];
+  if (store->disk[0]->path(filename, NULL, path, PATH_NAME_MAX) < 0 ||
+      strlen(path) + sizeof(MULTI_CACHE_SNAPSHOT_SUFFIX) + sizeof(".tmp") > sizeof(snapshot_path))
+    return;
+  snprintf(snapshot_path, sizeof(snapshot_path), "%s%s", path, MULTI_CACHE_SNAPSHOT_SUFFIX);
+}
+
+int
+MultiCacheBase::load_snapshot()
+{
+  if (!snapshot_path[0])
+    return -1;
+  int fd = ::open(snapshot_path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  struct stat st;
+  int res = -1;
+  char *buf = NULL;
+  if (fstat(fd, &st) >= 0 && st.st_size > 0) {
+    buf = (char *) ats_malloc(st.st_size);
+    if (read(fd, buf, st.st_size) == st.st_size)
+      res = load_snapshot_data(buf, st.st_size);
+  }
+  ats_free(buf);
+  close(fd);
+  if (res < 0)
+    Note("ignoring snapshot '%s': unreadable or from another version", snapshot_path);
+  else
+    Note("loaded %d entries from snapshot '%s'", res, snapshot_path);
+  return res;
+}
+
+int
+MultiCacheBase::load_snapshot_data(char *buf, int64_t len)
+{
+  MultiCacheSnapshotHeader h;
+  if (len < (int64_t) sizeof(h))
+    return -1;
+  memcpy(&h, buf, sizeof(h));
+  if (h.magic != MULTI_CACHE_SNAPSHOT_MAGIC ||
+      h.version.ink_major != MULTI_CACHE_SNAPSHOT_MAJOR_VERSION ||
+      h.cache_version.ink_major != version.ink_major ||
+      h.cache_version.ink_minor != version.ink_minor ||
+      h.elementsize != elementsize || h.entries < 0 || h.length != len - (int64_t) sizeof(h))
+    return -1;
+
+  char *p = buf + sizeof(h), *end = buf + len;
+  char digest[16];
+  INK_DIGEST_CTX md5;
+  ink_code_incr_md5_init(&md5);
+  ink_code_incr_md5_update(&md5, p, (int) h.length);
+  ink_code_incr_md5_final(digest, &md5);
+  if (memcmp(digest, h.digest, sizeof(digest)))
+    return -1;
+
+  int loaded = 0;
+  for (int i = 0; i < h.entries; i++) {
+    MultiCacheSnapshotRecord rec;
+    if (end - p < (int64_t) sizeof(rec) + elementsize)
+      return -1;
+    memcpy(&rec, p, sizeof(rec));
+    p += sizeof(rec);
+    char *elem = p;
+    p += elementsize;
+    int padded = (rec.heap_size + MULTI_CACHE_HEAP_ALIGNMENT - 1) & ~(MULTI_CACHE_HEAP_ALIGNMENT - 1);
+    if (rec.heap_size < 0 || rec.heap_size > halfspace_size() || end - p < padded)
+      return -1;
+    if (insert_snapshot_element(rec.folded_md5, elem, rec.heap_size ? p : NULL, rec.heap_size))
+      loaded++;
+    p += padded;
+  }
+  return p == end ? loaded : -1;
+}
+
 //
 // Syncs MulitCache
 //
@@ -1091,8 +1329,11 @@ struct MultiCacheSync: public Continuation
   {
     (void) event;
     if (partition >= MULTI_CACHE_PARTITIONS) {
-      cont->handleEvent(MULTI_CACHE_EVENT_SYNC, 0);
       Debug("multicache", "MultiCacheSync done (%d, %d)", mc->heap_used[0], mc->heap_used[1]);
+      if (mc->snapshot_path[0])
+        eventProcessor.schedule_imm(NEW(new MultiCacheSnapshot(cont, mc)), ET_TASK);
+      else
+        cont->handleEvent(MULTI_CACHE_EVENT_SYNC, 0);
       delete this;
       return EVENT_DONE;
     }
@@ -1185,11 +1426,19 @@ struct OffsetTable
 
 struct MultiCacheHeapGC;
 typedef int (MultiCacheHeapGC::*MCacheHeapGCHandler) (int, void *);
+//
+// Copies the live heap data into the other halfspace. The work is done
+// MULTI_CACHE_GC_STEP elements at a time, letting go of the partition
+// lock in between, so a lookup never waits for a whole partition to be
+// copied. Until the GC is done the old halfspace is left alone and
+// the entries not copied yet keep pointing into it.
+//
 struct MultiCacheHeapGC: public Continuation
 {
   Continuation *cont;
   MultiCacheBase *mc;
   int partition;
+  int position;                 // next element of the partition
   int n_offsets;
   OffsetTable *offset_table;
 
@@ -1202,7 +1451,7 @@ struct MultiCacheHeapGC: public Continuation
       // copy heap data
 
       char *before = mc->heap + mc->heap_used[mc->heap_halfspace];
-        mc->copy_heap(partition, this);
+      bool done = mc->copy_heap(partition, &position, this);
       char *after = mc->heap + mc->heap_used[mc->heap_halfspace];
 
       // sync new heap data and header (used)
@@ -1215,17 +1464,15 @@ struct MultiCacheHeapGC: public Continuation
       }
       // update table to point to new entries
 
-      for (int i = 0; i < n_offsets; i++) {
-        int *i1, i2;
-        // BAD CODE GENERATION ON THE ALPHA
-        //*(offset_table[i].poffset) = offset_table[i].new_offset + 1;
-        i1 = offset_table[i].poffset;
-        i2 = offset_table[i].new_offset + 1;
-        *i1 = i2;
+      update_offsets();
+      if (!done) {
+        // same partition, retake the lock after anyone waiting for it
+        e->schedule_imm();
+        return EVENT_CONT;
       }
-      n_offsets = 0;
       mc->sync_partition(partition);
       partition++;
+      position = 0;
       if (partition < MULTI_CACHE_PARTITIONS)
         mutex = mc->locks[partition];
       else
@@ -1244,12 +1491,25 @@ struct MultiCacheHeapGC: public Continuation
     return EVENT_DONE;
   }
 
+  void update_offsets()
+  {
+    for (int i = 0; i < n_offsets; i++) {
+      int *i1, i2;
+      // BAD CODE GENERATION ON THE ALPHA
+      //*(offset_table[i].poffset) = offset_table[i].new_offset + 1;
+      i1 = offset_table[i].poffset;
+      i2 = offset_table[i].new_offset + 1;
+      *i1 = i2;
+    }
+    n_offsets = 0;
+  }
+
 MultiCacheHeapGC(Continuation *acont, MultiCacheBase *amc):
-  Continuation(amc->locks[0]), cont(acont), mc(amc), partition(0), n_offsets(0) {
+  Continuation(amc->locks[0]), cont(acont), mc(amc), partition(0), position(0), n_offsets(0) {
 
     SET_HANDLER((MCacheHeapGCHandler) & MultiCacheHeapGC::startEvent);
-    offset_table = (OffsetTable *)ats_malloc(sizeof(OffsetTable) *
-        ((mc->totalelements / MULTI_CACHE_PARTITIONS) + mc->elements[mc->levels - 1] * 3 + 1));
+    // at most one offset per element of a step
+    offset_table = (OffsetTable *)ats_malloc(sizeof(OffsetTable) * (MULTI_CACHE_GC_STEP + 1));
     // flip halfspaces
     mutex = mc->locks[partition];
     mc->heap_halfspace = mc->heap_halfspace ? 0 : 1;
@@ -1502,3 +1762,283 @@ stealStore(Store & s, int blocks)
     d++;
   }
 }
+
+#if TS_HAS_TESTS
+#include "ts/TestBox.h"
+
+// The smallest block MultiCache can hold, with optional heap data
+struct SnapshotTestBlock
+{
+  unsigned int backed:1;
+  unsigned int deleted:1;
+  unsigned int full:1;
+  unsigned int hits:3;
+  int heap_offset;
+  int heap_bytes;
+  uint64_t t;
+
+  uint64_t tag() { return t; }
+  bool is_deleted() { return deleted; }
+  void set_deleted() { deleted = 1; }
+  bool is_empty() { return !full; }
+  void set_empty() { full = 0; t = 0; }
+  void reset() { backed = deleted = full = hits = 0; heap_offset = heap_bytes = 0; t = 0; }
+  void set_full(uint64_t folded_md5, int buckets)
+  {
+    t = folded_md5 / buckets;
+    if (!t)
+      t = 1;
+    full = 1;
+  }
+  int heap_size() { return heap_bytes; }
+  int *heap_offset_ptr() { return heap_bytes ? &heap_offset : NULL; }
+};
+
+// A single level cache in plain memory, enough for insert and lookup
+static void
+snapshot_test_cache(MultiCache<SnapshotTestBlock> & mc, int buckets)
+{
+  mc.levels = 1;
+  mc.tag_bits = 56;
+  mc.max_hits = 7;
+  mc.elementsize = sizeof(SnapshotTestBlock);
+  mc.buckets = buckets;
+  mc.elements[0] = 4;
+  mc.bucketsize[0] = mc.elements[0] * mc.elementsize;
+  mc.totalelements = buckets * mc.elements[0];
+  mc.level_offset[1] = mc.level_offset[2] = buckets * mc.bucketsize[0];
+  mc.buckets_per_partitionF8 = (buckets << 8) / MULTI_CACHE_PARTITIONS;
+  mc.heap_size = 8192;
+  mc.data = (char *) ats_malloc(mc.level_offset[1] + mc.heap_size);
+  memset(mc.data, 0, mc.level_offset[1] + mc.heap_size);
+  mc.heap = mc.data + mc.level_offset[1];
+}
+
+static void
+snapshot_test_free(MultiCache<SnapshotTestBlock> & mc)
+{
+  ats_free(mc.data);
+  mc.data = NULL;
+}
+
+REGRESSION_TEST(MultiCache_Snapshot)(RegressionTest * t, int atype, int *pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  MultiCache<SnapshotTestBlock> a, b;
+  SnapshotTestBlock e;
+  const uint64_t keys[] = { 0x123456789abcdefULL, 0xfedcba987654321ULL, 0x1111222233334444ULL };
+  const char text[] = "snapshot heap data";
+
+  box = REGRESSION_TEST_PASSED;
+  snapshot_test_cache(a, 2 * MULTI_CACHE_PARTITIONS);
+  snapshot_test_cache(b, 3 * MULTI_CACHE_PARTITIONS);
+
+  for (int i = 0; i < 3; i++) {
+    e.reset();
+    e.heap_bytes = i == 1 ? sizeof(text) : 0;
+    box.check(a.insert_snapshot_element(keys[i], (char *) &e, (char *) text, e.heap_bytes),
+              "unable to insert entry %d", i);
+  }
+
+  MultiCacheSnapshotBuffer records;
+  int entries = 0;
+  for (int p = 0; p < MULTI_CACHE_PARTITIONS; p++)
+    entries += a.snapshot_partition(p, records);
+  box.check(entries == 3, "expected 3 entries in the snapshot, got %d", entries);
+
+  MultiCacheSnapshotHeader h;
+  memset(&h, 0, sizeof(h));
+  h.magic = MULTI_CACHE_SNAPSHOT_MAGIC;
+  h.version.ink_major = MULTI_CACHE_SNAPSHOT_MAJOR_VERSION;
+  h.version.ink_minor = MULTI_CACHE_SNAPSHOT_MINOR_VERSION;
+  h.cache_version = a.version;
+  h.elementsize = a.elementsize;
+  h.entries = entries;
+  h.length = records.len;
+  INK_DIGEST_CTX md5;
+  ink_code_incr_md5_init(&md5);
+  ink_code_incr_md5_update(&md5, records.data, records.len);
+  ink_code_incr_md5_final(h.digest, &md5);
+
+  MultiCacheSnapshotBuffer file;
+  file.append(&h, sizeof(h));
+  file.append(records.data, records.len);
+
+  // loaded into a cache with another number of buckets
+  box.check(b.load_snapshot_data(file.data, file.len) == 3, "snapshot did not load 3 entries");
+  for (int i = 0; i < 3; i++) {
+    SnapshotTestBlock *x = b.lookup_block(keys[i], 0);
+    if (!box.check(x != NULL, "entry %d missing after load", i))
+      continue;
+    if (i == 1) {
+      char *d = (char *) b.ptr(x->heap_offset_ptr(), b.partition_of_bucket((int) (keys[i] % b.buckets)));
+      box.check(d && x->heap_size() == (int) sizeof(text) && !memcmp(d, text, sizeof(text)),
+                "heap data of entry %d lost", i);
+    }
+  }
+
+  // anything damaged is refused as a whole
+  box.check(b.load_snapshot_data(file.data, file.len - 1) < 0, "loaded a truncated snapshot");
+  file.data[file.len - 1] ^= 1;
+  box.check(b.load_snapshot_data(file.data, file.len) < 0, "loaded a snapshot with a bad digest");
+  file.data[file.len - 1] ^= 1;
+  ((MultiCacheSnapshotHeader *) file.data)->cache_version.ink_major++;
+  box.check(b.load_snapshot_data(file.data, file.len) < 0, "loaded a snapshot of another version");
+
+  snapshot_test_free(a);
+  snapshot_test_free(b);
+}
+
+// Two levels of GC_TEST_BUCKETS_PER_PARTITION * 4 elements per partition,
+// so that the GC of a partition takes one step per level.
+#define GC_TEST_BUCKETS_PER_PARTITION (MULTI_CACHE_GC_STEP / 4)
+#define GC_TEST_BUCKETS (GC_TEST_BUCKETS_PER_PARTITION * MULTI_CACHE_PARTITIONS)
+
+static void
+gc_test_cache(MultiCache<SnapshotTestBlock> & mc)
+{
+  mc.levels = 2;
+  mc.tag_bits = 56;
+  mc.max_hits = 7;
+  mc.elementsize = sizeof(SnapshotTestBlock);
+  mc.buckets = GC_TEST_BUCKETS;
+  mc.elements[0] = mc.elements[1] = 4;
+  mc.bucketsize[0] = mc.bucketsize[1] = 4 * mc.elementsize;
+  mc.totalelements = GC_TEST_BUCKETS * 8;
+  mc.level_offset[1] = GC_TEST_BUCKETS * mc.bucketsize[0];
+  mc.level_offset[2] = mc.level_offset[1] + GC_TEST_BUCKETS * mc.bucketsize[1];
+  mc.buckets_per_partitionF8 = (GC_TEST_BUCKETS << 8) / MULTI_CACHE_PARTITIONS;
+  mc.heap_size = 1024 * 1024;
+  mc.data = (char *) ats_malloc(mc.level_offset[2] + mc.heap_size);
+  memset(mc.data, 0, mc.level_offset[2] + mc.heap_size);
+  mc.heap = mc.data + mc.level_offset[2];
+  mc.lowest_level_data = new char[mc.lowest_level_data_size()];
+  memset(mc.lowest_level_data, 0, mc.lowest_level_data_size());
+}
+
+// The n-th key of a bucket, and the heap data that goes with it
+static uint64_t
+gc_test_key(int bucket, int n)
+{
+  return (uint64_t) (n + 1) * GC_TEST_BUCKETS + bucket;
+}
+
+static int
+gc_test_data(uint64_t key, char *d)
+{
+  int len = 16 + 8 * (int) (key % 5);
+  for (int i = 0; i < len; i++)
+    d[i] = (char) (key * 31 + i);
+  return len;
+}
+
+static bool
+gc_test_insert(MultiCache<SnapshotTestBlock> & mc, uint64_t key)
+{
+  SnapshotTestBlock e;
+  char d[64];
+
+  e.reset();
+  e.heap_bytes = gc_test_data(key, d);
+  return mc.insert_snapshot_element(key, (char *) &e, d, e.heap_bytes);
+}
+
+// Check the heap data of every element, and that it is in the current halfspace
+static int
+gc_test_check_heap(MultiCache<SnapshotTestBlock> & mc)
+{
+  int bad = 0;
+  for (int level = 0; level < mc.levels; level++) {
+    for (int bucket = 0; bucket < mc.buckets; bucket++) {
+      SnapshotTestBlock *x = (SnapshotTestBlock *) (mc.data + mc.level_offset[level] + bucket * mc.bucketsize[level]);
+      for (int i = 0; i < mc.elements[level]; i++) {
+        SnapshotTestBlock *e = &x[i];
+        if (e->is_empty())
+          continue;
+        uint64_t key = e->tag() * (uint64_t) mc.buckets + bucket;
+        char expected[64];
+        int len = gc_test_data(key, expected);
+        char *d = (char *) mc.ptr(e->heap_offset_ptr(), mc.partition_of_bucket(bucket));
+        char *half = mc.heap + (mc.heap_halfspace ? mc.halfspace_size() : 0);
+        if (!d || e->heap_size() != len || memcmp(d, expected, len) || d < half || d >= half + mc.halfspace_size())
+          bad++;
+      }
+    }
+  }
+  return bad;
+}
+
+REGRESSION_TEST(MultiCache_HeapGC)(RegressionTest * t, int atype, int *pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  MultiCache<SnapshotTestBlock> mc;
+  // keys per bucket of the first two partitions: 3, 5 once flushed, -1 when one is deleted
+  int n_keys[2 * GC_TEST_BUCKETS_PER_PARTITION];
+  int bucket, n, steps = 0;
+
+  box = REGRESSION_TEST_PASSED;
+  gc_test_cache(mc);
+
+  for (bucket = 0; bucket < 2 * GC_TEST_BUCKETS_PER_PARTITION; bucket++) {
+    n_keys[bucket] = 3;
+    for (n = 0; n < 3; n++)
+      box.check(gc_test_insert(mc, gc_test_key(bucket, n)), "unable to insert key %d of bucket %d", n, bucket);
+  }
+
+  // The entries so far are synced, the ones inserted while the GC runs are not.
+  for (int p = 0; p < MULTI_CACHE_PARTITIONS; p++)
+    mc.fixup_heap_offsets(p, mc.heap_used[mc.heap_halfspace]);
+
+  MultiCacheHeapGC *gc = NEW(new MultiCacheHeapGC(NULL, &mc));
+  int old_halfspace = mc.heap_halfspace ? 0 : 1;
+
+  for (int p = 0; p < MULTI_CACHE_PARTITIONS; p++) {
+    int position = 0;
+    bool done;
+    do {
+      done = mc.copy_heap(p, &position, gc);
+      gc->update_offsets();
+      steps++;
+
+      // Between the steps of the first partition, change both the part
+      // already copied and the part that is not: a fifth key flushes
+      // the bucket to level 1, and a key is deleted from another one.
+      if (p == 0 && !done) {
+        for (int first = 0; first < 2 * GC_TEST_BUCKETS_PER_PARTITION; first += GC_TEST_BUCKETS_PER_PARTITION) {
+          for (bucket = first; bucket < first + GC_TEST_BUCKETS_PER_PARTITION / 4; bucket++) {
+            for (n = 3; n < 5; n++)
+              box.check(gc_test_insert(mc, gc_test_key(bucket, n)), "unable to insert key %d of bucket %d", n, bucket);
+            n_keys[bucket] = 5;
+          }
+          for (; bucket < first + GC_TEST_BUCKETS_PER_PARTITION / 2; bucket++) {
+            SnapshotTestBlock *b = mc.lookup_block(gc_test_key(bucket, 2), 1);
+            if (box.check(b != NULL, "key 2 of bucket %d missing", bucket))
+              mc.delete_block(b);
+            n_keys[bucket] = 2;
+          }
+        }
+      }
+    } while (!done);
+  }
+  mc.heap_used[old_halfspace] = 8;
+  delete gc;
+
+  box.check(steps == 2 * MULTI_CACHE_PARTITIONS, "the GC took %d steps, expected %d", steps, 2 * MULTI_CACHE_PARTITIONS);
+
+  // Nothing may still point into the old halfspace.
+  memset(mc.heap + (old_halfspace ? mc.halfspace_size() : 0), 0xff, mc.halfspace_size());
+
+  for (bucket = 0; bucket < 2 * GC_TEST_BUCKETS_PER_PARTITION; bucket++) {
+    for (n = 0; n < 5; n++) {
+      SnapshotTestBlock *b = mc.lookup_block(gc_test_key(bucket, n), 1);
+      box.check((b != NULL) == (n < n_keys[bucket]), "key %d of bucket %d is %s", n, bucket, b ? "present" : "missing");
+    }
+  }
+  n = gc_test_check_heap(mc);
+  box.check(n == 0, "%d elements have lost their heap data", n);
+
+  snapshot_test_free(mc);
+}
+#endif
@@ -50,6 +50,7 @@
 // HostDB files
 #include "P_DNS.h"
 #include "P_MultiCache.h"
+#include "P_HostDBReadCache.h"
 #include "P_HostDBProcessor.h"
 
 
@@ -109,6 +109,9 @@ enum HostDB_Stats
   hostdb_ttl_expires_stat,      // D == TTL Expires
   hostdb_re_dns_on_reload_stat,
   hostdb_bytes_stat,
+  hostdb_read_cache_hits_stat,
+  hostdb_refresh_stat,          // background refreshes of entries still in use
+  hostdb_stale_kept_stat,       // failed refreshes that kept the old entry
   HostDB_Stat_Count
 };
 
@@ -161,6 +164,19 @@ struct HostDBCache: public MultiCache<HostDBInfo>
 
   Queue<HostDBContinuation, Continuation::Link_link> pending_dns[MULTI_CACHE_PARTITIONS];
   Queue<HostDBContinuation, Continuation::Link_link> &pending_dns_for_hash(INK_MD5 & md5);
+  bool is_pending_dns_for_hash(INK_MD5 & md5);
+
+  // Copies of plain (single address) entries, keyed by md5_high, which
+  // getbyname_imm() can read without the partition lock. Anything that
+  // changes or drops an entry must drop its copy here as well.
+  ReadMostlyCache<HostDBInfo> read_cache;
+
+  void delete_block(HostDBInfo * b)
+  {
+    read_cache.remove(b->md5_high);
+    MultiCache<HostDBInfo>::delete_block(b);
+  }
+
   HostDBCache();
 };
 
@@ -683,6 +699,17 @@ HostDBCache::pending_dns_for_hash(INK_MD5 & md5)
   return pending_dns[partition_of_bucket((int) (fold_md5(md5) % hostDB.buckets))];
 }
 
+inline bool
+HostDBCache::is_pending_dns_for_hash(INK_MD5 & md5)
+{
+  Queue<HostDBContinuation> &q = pending_dns_for_hash(md5);
+  for (HostDBContinuation *c = q.head; c; c = (HostDBContinuation *) c->link.next) {
+    if (md5 == c->md5)
+      return true;
+  }
+  return false;
+}
+
 inline int
 HostDBContinuation::key_partition()
 {
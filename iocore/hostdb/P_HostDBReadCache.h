@@ -0,0 +1,155 @@
+/** @file
+
+  A small set-associative cache that can be read without locks, used
+  to answer HostDB lookups without taking the MultiCache partition
+  lock.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+ */
+
+#ifndef _P_HostDBReadCache_h_
+#define _P_HostDBReadCache_h_
+
+#include "ink_atomic.h"
+#include "ink_memory.h"
+
+// Ordering between the sequence counter and the slot contents. x86
+// does not reorder loads with loads or stores with stores, so keeping
+// the compiler honest is enough there.
+#if defined(__i386__) || defined(__x86_64__)
+#define READ_CACHE_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+#define READ_CACHE_BARRIER() __sync_synchronize()
+#endif
+
+#define READ_CACHE_WAYS 4
+
+/**
+  Copies of values keyed by a 64 bit hash, with lock free reads.
+
+  Each slot carries a sequence counter which is odd while a writer owns
+  the slot. Readers copy the value out and retry nothing: if the
+  counter moved under them the read is simply reported as a miss and
+  the caller falls back to the authoritative (locked) store. Writers
+  claim a slot by moving its counter from even to odd with a CAS, so
+  writers on different threads never need a common lock either; a
+  writer that loses the race drops its update.
+
+  The cache never owns the data, it only holds copies of entries that
+  live elsewhere, so it can lose anything at any time. A key of 0 marks
+  an empty slot.
+*/
+template<class C> struct ReadMostlyCache
+{
+  struct Slot
+  {
+    volatile int32_t seq;
+    uint64_t key;
+    C value;
+  };
+
+  Slot *slots;
+  uint64_t set_mask;
+  volatile uint32_t clock;
+
+  /// Size the cache for about @a entries values, 0 disables it.
+  void init(int entries)
+  {
+    if (slots || entries <= 0)
+      return;
+    uint64_t sets = 1;
+    while (sets * READ_CACHE_WAYS < (uint64_t) entries)
+      sets <<= 1;
+    slots = (Slot *) ats_malloc(sets * READ_CACHE_WAYS * sizeof(Slot));
+    memset(slots, 0, sets * READ_CACHE_WAYS * sizeof(Slot));
+    set_mask = sets - 1;
+  }
+
+  bool enabled() const { return slots != NULL; }
+
+  /// Copy the value for @a key into @a out, returns false on a miss.
+  bool get(uint64_t key, C *out) const
+  {
+    if (!slots || !key)
+      return false;
+    Slot *set = &slots[(key & set_mask) * READ_CACHE_WAYS];
+    for (int i = 0; i < READ_CACHE_WAYS; i++) {
+      Slot *s = &set[i];
+      int32_t seq = s->seq;
+      READ_CACHE_BARRIER();
+      if ((seq & 1) || s->key != key)
+        continue;
+      memcpy((void *) out, (void *) &s->value, sizeof(C));
+      READ_CACHE_BARRIER();
+      return s->seq == seq;
+    }
+    return false;
+  }
+
+  void put(uint64_t key, const C *value)
+  {
+    if (!slots || !key)
+      return;
+    Slot *set = &slots[(key & set_mask) * READ_CACHE_WAYS];
+    Slot *s = NULL;
+    for (int i = 0; i < READ_CACHE_WAYS && !s; i++)
+      if (set[i].key == key)
+        s = &set[i];
+    for (int i = 0; i < READ_CACHE_WAYS && !s; i++)
+      if (!set[i].key)
+        s = &set[i];
+    if (!s)
+      s = &set[ink_atomic_increment(&clock, 1) % READ_CACHE_WAYS];
+
+    int32_t seq = s->seq;
+    if ((seq & 1) || !ink_atomic_cas(&s->seq, seq, seq + 1))
+      return;
+    s->key = key;
+    memcpy((void *) &s->value, (void *) value, sizeof(C));
+    READ_CACHE_BARRIER();
+    s->seq = seq + 2;
+  }
+
+  /// Drop every copy of @a key. Unlike put() this waits out other writers.
+  void remove(uint64_t key)
+  {
+    if (!slots || !key)
+      return;
+    Slot *set = &slots[(key & set_mask) * READ_CACHE_WAYS];
+    for (int i = 0; i < READ_CACHE_WAYS; i++) {
+      Slot *s = &set[i];
+      if (s->key != key)
+        continue;
+      int32_t seq;
+      do {
+        seq = s->seq;
+      } while ((seq & 1) || !ink_atomic_cas(&s->seq, seq, seq + 1));
+      if (s->key == key)
+        s->key = 0;
+      READ_CACHE_BARRIER();
+      s->seq = seq + 2;
+    }
+  }
+
+  ReadMostlyCache() : slots(NULL), set_mask(0), clock(0) { }
+  ~ReadMostlyCache() { ats_free(slots); }
+};
+
+#endif /* _P_HostDBReadCache_h_ */
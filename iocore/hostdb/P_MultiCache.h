@@ -63,6 +63,17 @@
 #define MULTI_CACHE_HEAP_INITIAL     sizeof(uint32_t)
 #define MULTI_CACHE_HEAP_ALIGNMENT   8
 
+// elements the heap GC looks at before it lets go of the partition lock
+#define MULTI_CACHE_GC_STEP          1024
+
+// The snapshot is written next to the database at every sync and read
+// back when the database has to be reinitialized. It has its own
+// version so that it stays readable across MultiCache layout changes.
+#define MULTI_CACHE_SNAPSHOT_MAGIC          0x534E4150
+#define MULTI_CACHE_SNAPSHOT_MAJOR_VERSION  1
+#define MULTI_CACHE_SNAPSHOT_MINOR_VERSION  0
+#define MULTI_CACHE_SNAPSHOT_SUFFIX         ".snap"
+
 // unused.. possible optimization
 #define MULTI_CACHE_OFFSET_PARITION(_x)  ((_x)%MULTI_CACHE_PARTITIONS)
 #define MULTI_CACHE_OFFSET_INDEX(_x)     ((_x)/MULTI_CACHE_PARTITIONS)
@@ -194,6 +205,40 @@ typedef int two_ints[2];
 
 struct MultiCacheHeapGC;
 
+// Snapshot file: a MultiCacheSnapshotHeader, then for each entry a
+// MultiCacheSnapshotRecord, the element and its heap data padded to
+// MULTI_CACHE_HEAP_ALIGNMENT.
+struct MultiCacheSnapshotHeader
+{
+  unsigned int magic;
+  VersionNumber version;        // of the snapshot format
+  VersionNumber cache_version;  // of the elements, MultiCacheHeader::version
+  int elementsize;
+  int entries;
+  int64_t length;               // bytes of records after the header
+  char digest[16];              // md5 of the records
+};
+
+struct MultiCacheSnapshotRecord
+{
+  uint64_t folded_md5;
+  int heap_size;
+  int reserved;
+};
+
+struct MultiCacheSnapshotBuffer
+{
+  char *data;
+  int len;
+  int size;
+
+  void append(const void *p, int n);
+  void pad(int alignment);
+
+  MultiCacheSnapshotBuffer():data(NULL), len(0), size(0) { }
+  ~MultiCacheSnapshotBuffer() { ats_free(data); }
+};
+
 struct MultiCacheBase: public MultiCacheHeader
 {
   Store *store;
@@ -343,6 +388,30 @@ struct MultiCacheBase: public MultiCacheHeader
   int sync_partition(int partition);
   void sync_partitions(Continuation * cont);
 
+  // Snapshot support, empty if there is no snapshot
+  char snapshot_path[PATH_NAME_MAX + 1];
+  bool snapshot_enabled;
+  void set_snapshot_path();
+  // number of entries loaded, -1 if there is no usable snapshot
+  int load_snapshot();
+  int load_snapshot_data(char *buf, int64_t len);
+
+  // Append the entries of a partition, the partition lock must be held.
+  virtual int snapshot_partition(int partition, MultiCacheSnapshotBuffer & b)
+  {
+    (void) partition;
+    (void) b;
+    return 0;
+  }
+  virtual bool insert_snapshot_element(uint64_t folded_md5, char *elem, char *heap_data, int heap_bytes)
+  {
+    (void) folded_md5;
+    (void) elem;
+    (void) heap_data;
+    (void) heap_bytes;
+    return false;
+  }
+
   MultiCacheBase();
   virtual ~ MultiCacheBase() {
     reset();
@@ -389,10 +458,15 @@ struct MultiCacheBase: public MultiCacheHeader
   }
   UnsunkPtrRegistry *fixup_heap_offsets(int partition, int before_used, UnsunkPtrRegistry * r = NULL, int base = 0);
 
-  virtual void copy_heap(int partition, MultiCacheHeapGC * gc)
+  // Copy the heap data of up to MULTI_CACHE_GC_STEP elements of the
+  // partition, starting at element *position, which is advanced.
+  // Returns true when the partition is done.
+  virtual bool copy_heap(int partition, int *position, MultiCacheHeapGC * gc)
   {
     (void) partition;
+    (void) position;
     (void) gc;
+    return true;
   }
 
   //
@@ -443,7 +517,9 @@ template<class C> struct MultiCache: public MultiCacheBase
   void flush(C * b, int bucket, int level);
   void delete_block(C * block);
   C *lookup_block(uint64_t folded_md5, int level);
-  void copy_heap(int paritition, MultiCacheHeapGC *);
+  bool copy_heap(int paritition, int *position, MultiCacheHeapGC *);
+  int snapshot_partition(int partition, MultiCacheSnapshotBuffer & b);
+  bool insert_snapshot_element(uint64_t folded_md5, char *elem, char *heap_data, int heap_bytes);
 };
 
 inline uint64_t
@@ -641,15 +717,26 @@ template<class C> inline void MultiCache<C>::rebuild_element(int bucket, char *e
   }
 }
 
-template<class C> inline void MultiCache<C>::copy_heap(int partition, MultiCacheHeapGC * gc)
+// Elements are visited level by level. flush() only moves blocks to a
+// higher level of the same bucket, so a block that was not copied yet
+// cannot move behind *position between two steps.
+template<class C> inline bool MultiCache<C>::copy_heap(int partition, int *position, MultiCacheHeapGC * gc)
 {
   int b = first_bucket_of_partition(partition);
   int n = buckets_of_partition(partition);
+  int start = *position, pos = 0;
   for (int level = 0; level < levels; level++) {
     int e = n * elements[level];
+    if (start >= pos + e) {
+      pos += e;
+      continue;
+    }
     char *d = data + level_offset[level] + b * bucketsize[level];
     C *x = (C *) d;
-    for (int i = 0; i < e; i++) {
+    for (int i = start > pos ? start - pos : 0; i < e; i++) {
+      if (*position - start >= MULTI_CACHE_GC_STEP)
+        return false;
+      (*position)++;
       int s = x[i].heap_size();
       if (s) {
         int *pi = x[i].heap_offset_ptr();
@@ -666,7 +753,70 @@ template<class C> inline void MultiCache<C>::copy_heap(int partition, MultiCache
         }
       }
     }
+    pos += e;
+  }
+  return true;
+}
+
+template<class C> inline int MultiCache<C>::snapshot_partition(int partition, MultiCacheSnapshotBuffer & b)
+{
+  int first = first_bucket_of_partition(partition);
+  int n = buckets_of_partition(partition);
+  int entries = 0;
+  // Higher levels first, as rebuild() does, so that when the snapshot
+  // is loaded the copy in the lowest level wins.
+  for (int level = levels - 1; level >= 0; level--) {
+    for (int bucket = first; bucket < first + n; bucket++) {
+      C *x = (C *) (data + level_offset[level] + bucket * bucketsize[level]);
+      for (int i = 0; i < elements[level]; i++) {
+        C *e = &x[i];
+        if (e->is_empty() || e->is_deleted())
+          continue;
+        int s = e->heap_size();
+        char *h = NULL;
+        if (s) {
+          int *pi = e->heap_offset_ptr();
+          if (!pi || !(h = (char *) ptr(pi, partition)))
+            continue;
+        }
+        MultiCacheSnapshotRecord rec;
+        rec.folded_md5 = REBUILD_FOLDED_MD5(e);
+        rec.heap_size = s;
+        rec.reserved = 0;
+        b.append(&rec, sizeof(rec));
+        b.append(e, sizeof(C));
+        if (s) {
+          b.append(h, s);
+          b.pad(MULTI_CACHE_HEAP_ALIGNMENT);
+        }
+        entries++;
+      }
+    }
+  }
+  return entries;
+}
+
+template<class C> inline bool
+MultiCache<C>::insert_snapshot_element(uint64_t folded_md5, char *elem, char *heap_data, int heap_bytes)
+{
+  C e;
+  memcpy((void *) &e, elem, sizeof(C));
+  int *hop = e.heap_offset_ptr();
+  if (heap_bytes && !hop)
+    return false;
+  // the offset is from the old heap, alloc() sets a new one below
+  if (hop)
+    *hop = 0;
+  C *b = insert_block(folded_md5, &e, 0);
+  if (heap_bytes) {
+    void *p = alloc(b->heap_offset_ptr(), heap_bytes);
+    if (!p) {
+      delete_block(b);
+      return false;
+    }
+    memcpy(p, heap_data, heap_bytes);
   }
+  return true;
 }
 
 // store either free or in the cache, can be stolen for reconfiguration
@@ -324,6 +324,24 @@ public:
   */
   virtual void cancel_OOB();
 
+  /**
+    Splices the current read VIO of this connection into the current
+    write VIO of dst, through a kernel pipe. Once spliced, data read
+    from this connection is no longer placed in the read VIO's buffer
+    but moved directly to dst, after dst has written out whatever is
+    in its own write buffer. Both VIOs still count the bytes moved in
+    ndone and signal their continuations as usual, so the caller
+    drives the transfer with the regular READ_READY / WRITE_READY
+    reenable protocol. The splice ends when either VIO is replaced by
+    another do_io or the connection is closed.
+
+    @param dst connection to splice into.
+    @return true if the connections were spliced, false if the
+    transfer has to go through the VIO buffers.
+
+  */
+  virtual bool splice_to(NetVConnection * dst);
+
   ////////////////////////////////////////////////////////////
   // Set the timeouts associated with this connection.      //
   // active_timeout is for the total elasped time of        //
@@ -33,6 +33,7 @@
 
 RecRawStatBlock *net_rsb = NULL;
 int net_config_poll_timeout = DEFAULT_POLL_TIMEOUT;
+int net_splice_pipe_size = 0;
 
 static inline void
 configure_net(void)
@@ -40,6 +41,7 @@ configure_net(void)
   IOCORE_RegisterConfigUpdateFunc("proxy.config.net.connections_throttle", change_net_connections_throttle, NULL);
   IOCORE_ReadConfigInteger(fds_throttle, "proxy.config.net.connections_throttle");
   IOCORE_ReadConfigInteger(throttle_enabled,"proxy.config.net.throttle_enabled");
+  IOCORE_ReadConfigInteger(net_splice_pipe_size, "proxy.config.net.splice_pipe_size");
 }
 
 
@@ -110,6 +112,66 @@ register_net_stats()
                      RECD_INT, RECP_NULL, (int) net_calls_to_write_nodata_stat, RecRawStatSyncSum);
   NET_CLEAR_DYN_STAT(net_calls_to_write_nodata_stat);
 
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.net.splice_bytes",
+                     RECD_INT, RECP_NULL, (int) net_splice_bytes_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_cache.hit",
+                     RECD_INT, RECP_NULL, (int) ssl_session_cache_hit_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_cache.miss",
+                     RECD_INT, RECP_NULL, (int) ssl_session_cache_miss_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_cache.evict",
+                     RECD_INT, RECP_NULL, (int) ssl_session_cache_evict_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_cache.remote_insert",
+                     RECD_INT, RECP_NULL, (int) ssl_session_cache_remote_insert_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_ticket.key_miss",
+                     RECD_INT, RECP_NULL, (int) ssl_session_ticket_key_miss_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.handshake.full",
+                     RECD_INT, RECP_NULL, (int) ssl_handshake_full_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.handshake.full_time",
+                     RECD_INT, RECP_NULL, (int) ssl_handshake_full_time_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.handshake.resumed",
+                     RECD_INT, RECP_NULL, (int) ssl_handshake_resumed_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.handshake.resumed_time",
+                     RECD_INT, RECP_NULL, (int) ssl_handshake_resumed_time_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.handshake.time_saved",
+                     RECD_INT, RECP_NULL, (int) ssl_handshake_time_saved_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.context_cache.hit",
+                     RECD_INT, RECP_NULL, (int) ssl_context_cache_hit_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.context_cache.miss",
+                     RECD_INT, RECP_NULL, (int) ssl_context_cache_miss_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.context_cache.evict",
+                     RECD_INT, RECP_NULL, (int) ssl_context_cache_evict_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.context_cache.load_time",
+                     RECD_INT, RECP_NULL, (int) ssl_context_load_time_stat, RecRawStatSyncSum);
+
 #ifndef INK_NO_SOCKS
   RecRegisterRawStat(net_rsb, RECT_PROCESS,
                      "proxy.process.socks.connections_successful",
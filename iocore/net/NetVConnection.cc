@@ -44,3 +44,9 @@ NetVConnection::cancel_OOB()
   return;
 }
 
+bool
+NetVConnection::splice_to(NetVConnection *)
+{
+  return false;
+}
+
@@ -52,6 +52,21 @@ enum Net_Stats
   net_calls_to_writetonet_afterpoll_stat,
   net_calls_to_write_stat,
   net_calls_to_write_nodata_stat,
+  net_splice_bytes_stat,
+  ssl_session_cache_hit_stat,
+  ssl_session_cache_miss_stat,
+  ssl_session_cache_evict_stat,
+  ssl_session_cache_remote_insert_stat,
+  ssl_session_ticket_key_miss_stat,
+  ssl_handshake_full_stat,
+  ssl_handshake_full_time_stat,
+  ssl_handshake_resumed_stat,
+  ssl_handshake_resumed_time_stat,
+  ssl_handshake_time_saved_stat,
+  ssl_context_cache_hit_stat,
+  ssl_context_cache_miss_stat,
+  ssl_context_cache_evict_stat,
+  ssl_context_load_time_stat,
   socks_connections_successful_stat,
   socks_connections_unsuccessful_stat,
   socks_connections_currently_open_stat,
@@ -77,6 +92,10 @@ RecIncrRawStatSum(net_rsb, mutex->thread_holding, (int)_x, -1)
 #define NET_SUM_DYN_STAT(_x, _r) \
 RecIncrRawStatSum(net_rsb, mutex->thread_holding, (int)_x, _r)
 
+// For SSL code that runs outside of a continuation, e.g. in OpenSSL callbacks.
+#define SSL_INCREMENT_DYN_STAT(_x, _n) \
+RecIncrRawStat(net_rsb, this_ethread(), (int)_x, _n)
+
 #define NET_READ_DYN_SUM(_x, _sum)  RecGetRawStatSum(net_rsb, (int)_x, &_sum)
 
 #define NET_READ_DYN_STAT(_x, _count, _sum) do {\
@@ -30,6 +30,46 @@
 struct SSLConfigParams;
 struct SSLContextStorage;
 
+/** A certificate whose SSL_CTX is created on first use.
+
+    With many certificates configured, creating every context up front
+    costs a lot of startup time and memory for certificates that are
+    rarely or never used. A loader stands in for the context until a
+    lookup first resolves to it; the loaded context is then kept in the
+    SSLCertLookup's context cache, which evicts the least recently used
+    contexts to stay within its size.
+ */
+struct SSLContextLoader
+{
+  SSLContextLoader() : ctx(NULL), failed(false), owned(false) {}
+  virtual ~SSLContextLoader() {}
+
+  // Create the context, or return NULL if it can't be created. Called
+  // without any locks held, possibly from several threads at once. This
+  // runs on the thread doing the lookup, usually a net thread in the middle
+  // of a handshake, and blocks it for as long as the load takes.
+  virtual SSL_CTX * load() = 0;
+
+  // The context was evicted, release the cache's reference to it. Every
+  // lookup that returned it holds a reference of its own.
+  virtual void unload(SSL_CTX * ctx) = 0;
+
+  // A lookup was satisfied by the cached context.
+  virtual void hit() {}
+
+  // A lookup loaded the context and it went into the cache. When several
+  // lookups load it at once, only the one whose context is kept counts.
+  virtual void miss() {}
+
+private:
+  friend struct SSLContextStorage;
+
+  SSL_CTX * ctx;  // The loaded context, protected by the storage lock.
+  bool failed;    // Don't keep retrying a certificate that fails to load.
+  bool owned;     // Set once the storage has taken ownership.
+  LINK(SSLContextLoader, lru_link);
+};
+
 struct SSLCertLookup : public ConfigInfo
 {
   SSLContextStorage * ssl_storage;
@@ -37,9 +77,18 @@ struct SSLCertLookup : public ConfigInfo
 
   bool insert(SSL_CTX * ctx, const char * name);
   bool insert(SSL_CTX * ctx, const IpEndpoint& address);
+
+  // Index a lazily loaded certificate. The lookup takes ownership of the loader.
+  bool insert(SSLContextLoader * loader, const char * name);
+  bool insert(SSLContextLoader * loader, const IpEndpoint& address);
+
+  // The returned context carries a reference for the caller, release it with SSLReleaseContext.
   SSL_CTX * findInfoInHash(const char * address) const;
   SSL_CTX * findInfoInHash(const IpEndpoint& address) const;
 
+  // Bound the number of lazily loaded contexts that are kept loaded. 0 means no limit.
+  void setContextCacheSize(int size);
+
   // Return the last-resort default TLS context if there is no name or address match.
   SSL_CTX * defaultContext() const { return ssl_default; }
 
@@ -49,7 +49,8 @@ struct SSLConfigParams : public ConfigInfo
   enum SSL_SESSION_CACHE_MODE
   {
     SSL_SESSION_CACHE_MODE_OFF = 0,
-    SSL_SESSION_CACHE_MODE_SERVER = 1
+    SSL_SESSION_CACHE_MODE_SERVER = 1,
+    SSL_SESSION_CACHE_MODE_SHARED = 2
   };
 
   SSLConfigParams();
@@ -64,11 +65,18 @@ struct SSLConfigParams : public ConfigInfo
   char *serverCACertFilename;
   char *serverCACertPath;
   char *configFilePath;
+  int ssl_context_cache_size;
   char *cipherSuite;
   int clientCertLevel;
   int verify_depth;
   int ssl_session_cache;
   int ssl_session_cache_size;
+  int ssl_session_cache_timeout;
+  int ssl_session_cache_replicate;
+
+  char *ticketKeyFilename;
+  int ticket_key_rotation_period;
+  int ticket_key_keep;
 
   char *clientCertPath;
   char *clientKeyPath;
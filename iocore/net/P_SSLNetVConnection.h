@@ -117,6 +117,7 @@ private:
 
   bool sslHandShakeComplete;
   bool sslClientConnection;
+  ink_hrtime sslHandshakeTime;  // time spent in SSL_accept(), for the handshake stats
   const SSLNextProtocolSet * npnSet;
   Continuation * npnEndpoint;
 };
@@ -0,0 +1,78 @@
+/** @file
+
+  Cluster-wide TLS session resumption: a shared session cache and
+  rotating session ticket keys.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef __P_SSLSESSIONCACHE_H__
+#define __P_SSLSESSIONCACHE_H__
+
+#include "ink_hrtime.h"
+#include "P_SSLUtils.h"
+
+struct SSLConfigParams;
+
+/** Replication hook for the shared session cache.
+
+    When proxy.config.ssl.session_cache.cluster_replicate is set, the
+    sessions that are added to the local cache are queued, and a task
+    thread periodically hands them to the replicator as batches of
+    opaque, self contained messages. The clustering code installs a
+    replicator that sends each batch to all the other cluster nodes,
+    which feed it to SSLSessionCacheReceive(). Without a replicator the
+    cache is just a process wide cache.
+
+    The messages contain the session master secrets and are not
+    encrypted, the cluster network must be trusted.
+ */
+typedef void (*SSLSessionCacheReplicator)(const void * msg, int len);
+
+// Create the shared session cache. Called once, when SSL starts up.
+void SSLSessionCacheInitialize(const SSLConfigParams * params);
+
+// Install the shared session cache callbacks on a server context.
+void SSLSessionCacheAttach(SSL_CTX * ctx);
+
+// Set (or clear, with NULL) the replication hook.
+void SSLSessionCacheSetReplicator(SSLSessionCacheReplicator replicator);
+
+// Apply a batch of sessions received from another cluster node. It is
+// ignored unless replication is enabled, and stops at a malformed message.
+void SSLSessionCacheReceive(const void * msg, int len);
+
+/** (Re)load the shared session ticket secret.
+
+    Ticket keys are derived from the secret and the current rotation
+    period, so every node that shares the secret (the file is synced
+    around the cluster by the manager) encrypts with the same key and
+    accepts the same recent keys, without any further coordination.
+
+    @return @c true if a secret was loaded.
+ */
+bool SSLTicketKeysLoad(const SSLConfigParams * params);
+
+// Enable the shared ticket keys on a server context, if a secret is loaded.
+bool SSLTicketKeysAttach(SSL_CTX * ctx);
+
+// Account for a completed server handshake that took @a elapsed of SSL_accept() time.
+void SSLHandshakeRecord(SSL * ssl, ink_hrtime elapsed);
+
+#endif /* __P_SSLSESSIONCACHE_H__ */
@@ -35,6 +35,14 @@
 struct SSLConfigParams;
 struct SSLCertLookup;
 
+// Session ticket key: key_name (16Byte) + HMAC_secret (16Byte) + AES_key (16Byte)
+struct ssl_ticket_key_t
+{
+  unsigned char key_name[16];
+  unsigned char hmac_secret[16];
+  unsigned char aes_key[16];
+};
+
 // Create a default SSL server context.
 SSL_CTX * SSLDefaultServerContext();
 
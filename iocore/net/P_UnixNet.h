@@ -130,6 +130,7 @@ extern ink_hrtime emergency_throttle_time;
 extern int net_connections_throttle;
 extern int fds_throttle;
 extern bool throttle_enabled;
+extern int net_splice_pipe_size;
 extern int fds_limit;
 extern ink_hrtime last_transient_accept_error;
 extern int http_accept_port_number;
@@ -124,6 +124,18 @@ struct OOB_callback:public Continuation
   }
 };
 
+// A kernel pipe connecting the read side of one UnixNetVConnection to
+// the write side of another, see UnixNetVConnection::splice_to().
+// Each side holds a reference; the side that fills the pipe stops
+// using it once it is the last holder.
+struct NetSplicePipe
+{
+  int fd[2];
+  int64_t size;                 // capacity of the pipe
+  volatile int64_t avail;       // bytes in the pipe
+  volatile int refcount;
+};
+
 class UnixNetVConnection:public NetVConnection
 {
 public:
@@ -136,6 +148,8 @@ public:
   virtual Action *send_OOB(Continuation *cont, char *buf, int len);
   virtual void cancel_OOB();
 
+  virtual bool splice_to(NetVConnection *dst);
+
   virtual void setSSLHandshakeWantsRead(bool flag) { NOWARN_UNUSED(flag); return; }
   virtual bool getSSLHandshakeWantsRead() { return false; }
   virtual void setSSLHandshakeWantsWrite(bool flag) { NOWARN_UNUSED(flag); return; }
@@ -264,6 +278,8 @@ public:
   ProbeType pt;
   FlowControl read_fct;
   FlowControl write_fct;
+  NetSplicePipe *read_splice;   // pipe the read side fills
+  NetSplicePipe *write_splice;  // pipe the write side drains
 
   int startEvent(int event, Event *e);
   int acceptEvent(int event, Event *e);
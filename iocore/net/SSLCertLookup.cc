@@ -29,7 +29,7 @@
 #include "I_EventSystem.h"
 #include "I_Layout.h"
 #include "Regex.h"
-#include "Trie.h"
+#include "HostLookup.h"
 #include "ts/TestBox.h"
 
 struct SSLAddressLookupKey
@@ -68,28 +68,66 @@ private:
   unsigned char sep; // offset of address/port separator
 };
 
+struct ats_wildcard_matcher
+{
+  ats_wildcard_matcher() {
+    if (regex.compile("^\\*\\.[^\\*.]+") != 0) {
+      Fatal("failed to compile TLS wildcard matching regex");
+    }
+  }
+
+  ~ats_wildcard_matcher() {
+  }
+
+  bool match(const char * hostname) const {
+    return regex.match(hostname) != -1;
+  }
+
+private:
+  DFA regex;
+};
+
 struct SSLContextStorage
 {
   SSLContextStorage();
   ~SSLContextStorage();
 
-  bool insert(SSL_CTX * ctx, const char * name);
-  SSL_CTX * lookup(const char * name) const;
+  bool insert(SSL_CTX * ctx, SSLContextLoader * loader, const char * name);
+  bool insert_address(SSL_CTX * ctx, SSLContextLoader * loader, const char * key);
+  SSL_CTX * lookup(const char * name);
+  SSL_CTX * lookup_address(const char * key);
+
+  void set_cache_size(int size) { this->cache_size = size; }
 
 private:
+  // What a name or address key maps to. Either the context was created up front, or it
+  // is loaded on demand. Names also record how specific they are, so that the longest
+  // of several matching names wins.
   struct SSLEntry
   {
-    explicit SSLEntry(SSL_CTX * c) : ctx(c) {}
-
-    void Print() const { Debug("ssl", "SSLEntry=%p SSL_CTX=%p", this, ctx); }
+    SSLEntry(SSL_CTX * c, SSLContextLoader * l, int len, bool w) : ctx(c), loader(l), match_len(len), wildcard(w) {}
 
     SSL_CTX * ctx;
-    LINK(SSLEntry, link);
+    SSLContextLoader * loader;
+    int match_len;
+    bool wildcard;
   };
 
-  Trie<SSLEntry>  wildcards;
-  InkHashTable *  hostnames;
+  SSLEntry * new_entry(SSL_CTX * ctx, SSLContextLoader * loader, int len, bool wildcard);
+  SSL_CTX * context(SSLEntry * entry);
+
+  ats_wildcard_matcher wildcard;
+  HostLookup      hostnames;  // Exact and wildcard names.
+  InkHashTable *  addresses;  // Address keys, see SSLAddressLookupKey.
+  Vec<SSLEntry *> entries;
   Vec<SSL_CTX *>  references;
+  Vec<SSLContextLoader *> loaders;
+
+  // Cache of loaded contexts, most recently used first.
+  ink_mutex       mutex;
+  Queue<SSLContextLoader, SSLContextLoader::Link_lru_link> lru;
+  int             cached;
+  int             cache_size;
 };
 
 SSLCertLookup::SSLCertLookup() : ssl_storage(NEW(new SSLContextStorage())), ssl_default(NULL)
@@ -113,14 +151,14 @@ SSLCertLookup::findInfoInHash(const IpEndpoint& address) const
   SSL_CTX * ctx;
   SSLAddressLookupKey key(address);
   // First try the full address.
-  if ((ctx = this->ssl_storage->lookup(key.get()))) {
+  if ((ctx = this->ssl_storage->lookup_address(key.get()))) {
     return ctx;
   }
 
   // If that failed, try the address without the port.
   if (address.port()) {
     key.split();
-    return this->ssl_storage->lookup(key.get());
+    return this->ssl_storage->lookup_address(key.get());
   }
 
   return NULL;
@@ -129,158 +167,233 @@ SSLCertLookup::findInfoInHash(const IpEndpoint& address) const
 bool
 SSLCertLookup::insert(SSL_CTX * ctx, const char * name)
 {
-  return this->ssl_storage->insert(ctx, name);
+  return this->ssl_storage->insert(ctx, NULL, name);
 }
 
 bool
 SSLCertLookup::insert(SSL_CTX * ctx, const IpEndpoint& address)
 {
   SSLAddressLookupKey key(address);
-  return this->ssl_storage->insert(ctx, key.get());
+  return this->ssl_storage->insert_address(ctx, NULL, key.get());
 }
 
-struct ats_wildcard_matcher
+bool
+SSLCertLookup::insert(SSLContextLoader * loader, const char * name)
 {
-  ats_wildcard_matcher() {
-    if (regex.compile("^\\*\\.[^\\*.]+") != 0) {
-      Fatal("failed to compile TLS wildcard matching regex");
-    }
-  }
+  return this->ssl_storage->insert(NULL, loader, name);
+}
 
-  ~ats_wildcard_matcher() {
-  }
+bool
+SSLCertLookup::insert(SSLContextLoader * loader, const IpEndpoint& address)
+{
+  SSLAddressLookupKey key(address);
+  return this->ssl_storage->insert_address(NULL, loader, key.get());
+}
 
-  bool match(const char * hostname) const {
-    return regex.match(hostname) != -1;
-  }
+void
+SSLCertLookup::setContextCacheSize(int size)
+{
+  this->ssl_storage->set_cache_size(size);
+}
 
-private:
-  DFA regex;
-};
+SSLContextStorage::SSLContextStorage()
+  : hostnames("SSLContextStorage"), addresses(ink_hash_table_create(InkHashTableKeyType_String)), cached(0), cache_size(0)
+{
+  ink_mutex_init(&this->mutex, "SSLContextStorage");
+}
 
-static char *
-reverse_dns_name(const char * hostname, char (&reversed)[TS_MAX_HOST_NAME_LEN+1])
+SSLContextStorage::~SSLContextStorage()
 {
-  char * ptr = reversed + sizeof(reversed);
-  const char * part = hostname;
-
-  *(--ptr) = '\0'; // NUL-terminate
-
-  while (*part) {
-    ssize_t len = strcspn(part, ".");
-    ssize_t remain = ptr - reversed;
-
-    // We are going to put the '.' separator back for all components except the first.
-    if (*ptr == '\0') {
-      if (remain < len) {
-        return NULL;
-      }
-    } else {
-      if (remain < (len + 1)) {
-        return NULL;
-      }
-      *(--ptr) = '.';
+  // References is an open hashed set, skip the empty slots.
+  for (int i = 0; i < this->references.length(); ++i) {
+    if (this->references[i]) {
+      SSLReleaseContext(this->references[i]);
     }
+  }
 
-    ptr -= len;
-    memcpy(ptr, part, len);
-
-    // Skip to the next domain component. This will take us to either a '.' or a NUL.
-    // If it's a '.' we need to skip over it.
-    part += len;
-    if (*part == '.') {
-      ++part;
+  // By now no handshake can be using this configuration, so loaded contexts can go right away.
+  for (int i = 0; i < this->loaders.length(); ++i) {
+    if (this->loaders[i]->ctx) {
+      SSLReleaseContext(this->loaders[i]->ctx);
     }
+    delete this->loaders[i];
   }
 
-  return ptr;
-}
+  for (int i = 0; i < this->entries.length(); ++i) {
+    delete this->entries[i];
+  }
 
-SSLContextStorage::SSLContextStorage()
-  :wildcards(), hostnames(ink_hash_table_create(InkHashTableKeyType_String))
-{
+  ink_hash_table_destroy(this->addresses);
+  ink_mutex_destroy(&this->mutex);
 }
 
-SSLContextStorage::~SSLContextStorage()
+SSLContextStorage::SSLEntry *
+SSLContextStorage::new_entry(SSL_CTX * ctx, SSLContextLoader * loader, int len, bool wildcard)
 {
-  for (int i = 0; i < this->references.count(); ++i) {
-    SSLReleaseContext(this->references[i]);
+  SSLEntry * entry = new SSLEntry(ctx, loader, len, wildcard);
+
+  this->entries.push_back(entry);
+
+  // Keep a unique reference to the SSL_CTX, so that we can free it later. Since we index by name, multiple
+  // names are indexed for the same certificate.
+  if (ctx) {
+    this->references.set_add(ctx);
   }
 
-  ink_hash_table_destroy(this->hostnames);
-}
+  if (loader && !loader->owned) {
+    loader->owned = true;
+    this->loaders.push_back(loader);
+  }
 
+  return entry;
+}
 
 bool
-SSLContextStorage::insert(SSL_CTX * ctx, const char * name)
+SSLContextStorage::insert(SSL_CTX * ctx, SSLContextLoader * loader, const char * name)
 {
-  ats_wildcard_matcher wildcard;
-  bool inserted = true;
-
-  if (wildcard.match(name)) {
-    // We turn wildcards into the reverse DNS form, then insert them into the trie
-    // so that we can do a longest match lookup.
-    char namebuf[TS_MAX_HOST_NAME_LEN + 1];
-    char * reversed;
-    xptr<SSLEntry> entry;
+  if (this->wildcard.match(name)) {
+    // Wildcards are domain records, matching any name in the domain. A more specific
+    // name or wildcard wins at lookup time.
+    const char * domain = name + 2;
 
-    reversed = reverse_dns_name(name + 2, namebuf);
-    if (!reversed) {
+    if (strlen(domain) > TS_MAX_HOST_NAME_LEN) {
       Error("wildcard name '%s' is too long", name);
       return false;
     }
 
-    Debug("ssl", "indexed wildcard certificate for '%s' as '%s' with SSL_CTX %p", name, reversed, ctx);
-    entry = new SSLEntry(ctx);
-    inserted = this->wildcards.Insert(reversed, entry, 0 /* rank */, -1 /* keylen */);
-    if (inserted) {
-      entry.release();
-    }
+    Debug("ssl", "indexed wildcard certificate for '%s' as '%s' with SSL_CTX %p loader %p", name, domain, ctx, loader);
+    this->hostnames.NewEntry(domain, true, new_entry(ctx, loader, strlen(domain), true));
   } else {
-    Debug("ssl", "indexed '%s' with SSL_CTX %p", name, ctx);
-    ink_hash_table_insert(this->hostnames, name, (void *)ctx);
+    Debug("ssl", "indexed '%s' with SSL_CTX %p loader %p", name, ctx, loader);
+    this->hostnames.NewEntry(name, false, new_entry(ctx, loader, strlen(name), false));
   }
 
-  // Keep a unique reference to the SSL_CTX, so that we can free it later. Since we index by name, multiple
-  // certificates can be indexed for the same name. If this happens, we will overwrite the previous pointer
-  // and leak a context. So if we insert a certificate, keep an ownership reference to it.
-  if (inserted) {
-    if (this->references.in(ctx) == NULL) {
-      this->references.push_back(ctx);
+  return true;
+}
+
+bool
+SSLContextStorage::insert_address(SSL_CTX * ctx, SSLContextLoader * loader, const char * key)
+{
+  Debug("ssl", "indexed address '%s' with SSL_CTX %p loader %p", key, ctx, loader);
+  ink_hash_table_insert(this->addresses, key, (void *)new_entry(ctx, loader, strlen(key), false));
+  return true;
+}
+
+SSL_CTX *
+SSLContextStorage::lookup(const char * name)
+{
+  HostLookupState state;
+  void * opaque;
+  SSLEntry * best = NULL;
+
+  // All the matching names come back, least specific first. Take the longest one, preferring
+  // an exact name over a wildcard for the same domain and the first indexed one over later
+  // duplicates.
+  for (bool found = this->hostnames.MatchFirst(name, &state, &opaque); found;
+       found = this->hostnames.MatchNext(&state, &opaque)) {
+    SSLEntry * entry = (SSLEntry *)opaque;
+
+    if (best == NULL || entry->match_len > best->match_len ||
+        (entry->match_len == best->match_len && best->wildcard && !entry->wildcard)) {
+      best = entry;
     }
   }
 
-  return inserted;
+  return best ? this->context(best) : NULL;
 }
 
 SSL_CTX *
-SSLContextStorage::lookup(const char * name) const
+SSLContextStorage::lookup_address(const char * key)
 {
   InkHashTableValue value;
 
-  if (ink_hash_table_lookup(const_cast<InkHashTable *>(this->hostnames), name, &value)) {
-    return (SSL_CTX *)value;
+  if (ink_hash_table_lookup(this->addresses, key, &value)) {
+    return this->context((SSLEntry *)value);
   }
 
-  if (!this->wildcards.Empty()) {
-    char namebuf[TS_MAX_HOST_NAME_LEN + 1];
-    char * reversed;
-    SSLEntry * entry;
+  return NULL;
+}
 
-    reversed = reverse_dns_name(name, namebuf);
-    if (!reversed) {
-      Error("failed to reverse hostname name '%s' is too long", name);
-      return NULL;
-    }
+// Return the context of @a entry with a reference for the caller, loading it if this
+// is the first use. A loaded context can be evicted and released as soon as the lock
+// is dropped, so its reference has to be taken while the lock is still held.
+SSL_CTX *
+SSLContextStorage::context(SSLEntry * entry)
+{
+  SSLContextLoader * loader = entry->loader;
+  SSLContextLoader * victim = NULL;
+  SSL_CTX * ctx;
+  SSL_CTX * evicted = NULL;
+  bool failed;
+  bool installed = false;
+
+  if (loader == NULL) {
+    // Lives as long as this storage, which the caller's configuration holds.
+    CRYPTO_add(&entry->ctx->references, 1, CRYPTO_LOCK_SSL_CTX);
+    return entry->ctx;
+  }
+
+  ink_mutex_acquire(&this->mutex);
+  ctx = loader->ctx;
+  failed = loader->failed;
+  if (ctx) {
+    CRYPTO_add(&ctx->references, 1, CRYPTO_LOCK_SSL_CTX);
+    this->lru.remove(loader);
+    this->lru.push(loader);
+  }
+  ink_mutex_release(&this->mutex);
+
+  if (ctx) {
+    loader->hit();
+    return ctx;
+  }
+
+  if (failed) {
+    return NULL;
+  }
+
+  SSL_CTX * loaded = loader->load();
 
-    Debug("ssl", "attempting wildcard match for %s", reversed);
-    entry = this->wildcards.Search(reversed);
-    if (entry) {
-      return entry->ctx;
+  ink_mutex_acquire(&this->mutex);
+  if (loader->ctx) {
+    // Another thread loaded it first, use theirs.
+    ctx = loader->ctx;
+    CRYPTO_add(&ctx->references, 1, CRYPTO_LOCK_SSL_CTX);
+  } else if (loaded == NULL) {
+    loader->failed = true;
+  } else {
+    // The cache keeps the reference from the load, the caller gets another.
+    ctx = loader->ctx = loaded;
+    CRYPTO_add(&ctx->references, 1, CRYPTO_LOCK_SSL_CTX);
+    loaded = NULL;
+    installed = true;
+    this->lru.push(loader);
+    this->cached++;
+
+    if (this->cache_size > 0 && this->cached > this->cache_size) {
+      victim = this->lru.tail;
+      this->lru.remove(victim);
+      evicted = victim->ctx;
+      victim->ctx = NULL;
+      this->cached--;
     }
   }
+  ink_mutex_release(&this->mutex);
 
-  return NULL;
+  if (loaded) {
+    // Never handed out, so it's safe to free now.
+    SSLReleaseContext(loaded);
+  }
+
+  if (installed) {
+    loader->miss();
+  }
+
+  if (victim) {
+    victim->unload(evicted);
+  }
+
+  return ctx;
 }
 
 #if TS_HAS_TESTS
@@ -298,21 +411,4 @@ REGRESSION_TEST(SSLWildcardMatch)(RegressionTest * t, int atype, int * pstatus)
   box.check(wildcard.match("") == false, "'' is not a wildcard");
 }
 
-REGRESSION_TEST(SSLReverseHostname)(RegressionTest * t, int atype, int * pstatus)
-{
-  TestBox box(t, pstatus);
-
-  char reversed[TS_MAX_HOST_NAME_LEN + 1];
-
-#define _R(name) reverse_dns_name(name, reversed)
-
-  box = REGRESSION_TEST_PASSED;
-
-  box.check(strcmp(_R("foo.com"), "com.foo") == 0, "reversed foo.com");
-  box.check(strcmp(_R("bar.foo.com"), "com.foo.bar") == 0, "reversed bar.foo.com");
-  box.check(strcmp(_R("foo"), "foo") == 0, "reversed foo");
-
-#undef _R
-}
-
 #endif // TS_HAS_TESTS
@@ -37,6 +37,7 @@
 #include "P_SSLConfig.h"
 #include "P_SSLUtils.h"
 #include "P_SSLCertLookup.h"
+#include "P_SSLSessionCache.h"
 #include <records/I_RecHttp.h>
 
 int SSLConfig::configid = 0;
@@ -54,6 +55,7 @@ SSLConfigParams::SSLConfigParams()
     clientCertPath = clientKeyPath =
     clientCACertFilename = clientCACertPath =
     cipherSuite =
+    ticketKeyFilename =
     serverKeyPathOnly = NULL;
 
   clientCertLevel = client_verify_depth = verify_depth = clientVerify = 0;
@@ -61,6 +63,11 @@ SSLConfigParams::SSLConfigParams()
   ssl_ctx_options = 0;
   ssl_session_cache = SSL_SESSION_CACHE_MODE_SERVER;
   ssl_session_cache_size = 1024*20;
+  ssl_session_cache_timeout = 0;
+  ssl_session_cache_replicate = 0;
+  ticket_key_rotation_period = 3600;
+  ticket_key_keep = 3;
+  ssl_context_cache_size = 0;
 }
 
 SSLConfigParams::~SSLConfigParams()
@@ -82,6 +89,7 @@ SSLConfigParams::cleanup()
   ats_free_null(serverCertPathOnly);
   ats_free_null(serverKeyPathOnly);
   ats_free_null(cipherSuite);
+  ats_free_null(ticketKeyFilename);
 
   clientCertLevel = client_verify_depth = verify_depth = clientVerify = 0;
 }
@@ -186,6 +194,7 @@ SSLConfigParams::initialize()
   IOCORE_ReadConfigStringAlloc(multicert_config_file, "proxy.config.ssl.server.multicert.filename");
   set_paths_helper(Layout::get()->sysconfdir, multicert_config_file, NULL, &configFilePath);
   ats_free(multicert_config_file);
+  IOCORE_ReadConfigInteger(ssl_context_cache_size, "proxy.config.ssl.server.context_cache.size");
 
   IOCORE_ReadConfigStringAlloc(ssl_server_private_key_path, "proxy.config.ssl.server.private_key.path");
   set_paths_helper(ssl_server_private_key_path, NULL, &serverKeyPathOnly, NULL);
@@ -199,6 +208,18 @@ SSLConfigParams::initialize()
   // SSL session cache configurations
   IOCORE_ReadConfigInteger(ssl_session_cache, "proxy.config.ssl.session_cache");
   IOCORE_ReadConfigInteger(ssl_session_cache_size, "proxy.config.ssl.session_cache.size");
+  IOCORE_ReadConfigInteger(ssl_session_cache_timeout, "proxy.config.ssl.session_cache.timeout");
+  IOCORE_ReadConfigInteger(ssl_session_cache_replicate, "proxy.config.ssl.session_cache.cluster_replicate");
+
+  // Cluster wide session ticket keys
+  char *ticket_key_file = NULL;
+  IOCORE_ReadConfigStringAlloc(ticket_key_file, "proxy.config.ssl.server.ticket_key.filename");
+  if (ticket_key_file && *ticket_key_file) {
+    set_paths_helper(Layout::get()->sysconfdir, ticket_key_file, NULL, &ticketKeyFilename);
+  }
+  ats_free(ticket_key_file);
+  IOCORE_ReadConfigInteger(ticket_key_rotation_period, "proxy.config.ssl.server.ticket_key.rotation_period");
+  IOCORE_ReadConfigInteger(ticket_key_keep, "proxy.config.ssl.server.ticket_key.keep");
 
   // SSL record size
   REC_EstablishStaticConfigInt32(ssl_maxrecord, "proxy.config.ssl.max_record_size");
@@ -295,6 +316,7 @@ SSLCertificateConfig::startup()
   REC_RegisterConfigUpdateFunc("proxy.config.ssl.server.cert.path", sslCertFile_CB, NULL);
   REC_RegisterConfigUpdateFunc("proxy.config.ssl.server.private_key.path", sslCertFile_CB, NULL);
   REC_RegisterConfigUpdateFunc("proxy.config.ssl.server.cert_chain.filename", sslCertFile_CB, NULL);
+  REC_RegisterConfigUpdateFunc("proxy.config.ssl.server.ticket_key.filename", sslCertFile_CB, NULL);
 }
 
 void
@@ -303,6 +325,9 @@ SSLCertificateConfig::reconfigure()
   SSLConfig::scoped_config params;
   SSLCertLookup * lookup = NEW(new SSLCertLookup());
 
+  // The server contexts pick up the cluster wide ticket keys as they are created.
+  SSLTicketKeysLoad(params);
+
   if (SSLParseCertificateConfiguration(params, lookup)) {
     configid = configProcessor.set(configid, lookup);
   } else
@@ -25,6 +25,7 @@
 #include "I_Layout.h"
 #include "I_RecHttp.h"
 #include "P_SSLUtils.h"
+#include "P_SSLSessionCache.h"
 
 //
 // Global Data
@@ -50,11 +51,15 @@ SSLNetProcessor::start(int number_of_ssl_threads)
   SSLInitializeLibrary();
   SSLConfig::startup();
 
+  // Acquire a SSLConfigParams instance *after* we start SSL up.
+  SSLConfig::scoped_config params;
+
+  // The shared session cache must exist before any server context is created.
+  SSLSessionCacheInitialize(params);
+
   if (HttpProxyPort::hasSSL()) {
     SSLCertificateConfig::startup();
   }
-  // Acquire a SSLConfigParams instance *after* we start SSL up.
-  SSLConfig::scoped_config params;
 
   // Enable client regardless of config file setttings as remap file
   // can cause HTTP layer to connect using SSL. But only if SSL
@@ -23,6 +23,7 @@
 #include "ink_config.h"
 #include "P_Net.h"
 #include "P_SSLNextProtocolSet.h"
+#include "P_SSLSessionCache.h"
 
 #define SSL_READ_ERROR_NONE	  0
 #define SSL_READ_ERROR		  1
@@ -417,6 +418,7 @@ SSLNetVConnection::load_buffer_and_write(int64_t towrite, int64_t &wattempted, i
 SSLNetVConnection::SSLNetVConnection():
   sslHandShakeComplete(false),
   sslClientConnection(false),
+  sslHandshakeTime(0),
   npnSet(NULL),
   npnEndpoint(NULL)
 {
@@ -440,13 +442,17 @@ SSLNetVConnection::free(EThread * t) {
   closed = 0;
   ink_assert(con.fd == NO_FD);
   if (ssl != NULL) {
-    /*if (sslHandShakeComplete)
-       SSL_set_shutdown(ssl, SSL_SENT_SHUTDOWN|SSL_RECEIVED_SHUTDOWN); */
+    // Contexts use quiet shutdown, so mark a completed session as cleanly
+    // shut down. Otherwise SSL_free() drops it from the session cache and
+    // the client can never resume it.
+    if (sslHandShakeComplete)
+      SSL_set_shutdown(ssl, SSL_SENT_SHUTDOWN|SSL_RECEIVED_SHUTDOWN);
     SSL_free(ssl);
     ssl = NULL;
   }
   sslHandShakeComplete = false;
   sslClientConnection = false;
+  sslHandshakeTime = 0;
   npnSet = NULL;
   npnEndpoint = NULL;
 
@@ -491,7 +497,9 @@ SSLNetVConnection::sslServerHandShakeEvent(int &err)
   int ret;
   int ssl_error;
 
+  ink_hrtime start = ink_get_hrtime_internal();
   ret = SSL_accept(ssl);
+  sslHandshakeTime += ink_get_hrtime_internal() - start;
   ssl_error = SSL_get_error(ssl, ret);
 
   if (ssl_error != SSL_ERROR_NONE) {
@@ -517,6 +525,7 @@ SSLNetVConnection::sslServerHandShakeEvent(int &err)
       X509_free(client_cert);
     }
     sslHandShakeComplete = 1;
+    SSLHandshakeRecord(ssl, sslHandshakeTime);
 
 #if TS_USE_TLS_NPN
     {
@@ -0,0 +1,889 @@
+/** @file
+
+  Cluster-wide TLS session resumption: a shared session cache and
+  rotating session ticket keys.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "ink_config.h"
+#include "libts.h"
+#include "P_Net.h"
+#include "P_SSLConfig.h"
+#include "P_SSLSessionCache.h"
+#include "I_Tasks.h"
+#include "ts/TestBox.h"
+
+#include <openssl/rand.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+// Number of independently locked partitions of the session cache.
+#define SSL_SESSION_CACHE_STRIPES       64
+
+// Sessions bigger than this (e.g. with a large client certificate) are
+// not shared, they still resume through tickets.
+#define SSL_SESSION_CACHE_MAX_DER       4096
+
+#define SSL_SESSION_CACHE_MSG_MAGIC     0x5353434d    // "SSCM"
+
+// New sessions are queued and sent to the other nodes from a task thread,
+// in batches of at most SSL_SESSION_CACHE_MAX_BATCH bytes. Sessions that
+// don't fit in the queue are not replicated.
+#define SSL_SESSION_CACHE_MAX_BATCH     32768
+#define SSL_SESSION_CACHE_MAX_QUEUED    (1024 * 1024)
+#define SSL_SESSION_CACHE_FLUSH_MSEC    100
+
+#define SSL_TICKET_SECRET_MAX           64
+#define SSL_TICKET_KEYS_MAX             26
+
+#if (OPENSSL_VERSION_NUMBER >= 0x10100000L)
+typedef const unsigned char * ink_ssl_session_id_t;
+#else
+typedef unsigned char * ink_ssl_session_id_t;
+#endif
+
+// Replicated session, as exchanged between the cluster nodes. The DER
+// encoded session follows the header, a batch is a sequence of messages.
+// Messages are not aligned, the header is copied out before it is read.
+struct SSLSessionCacheMsg
+{
+  uint32_t magic;
+  uint32_t id_len;
+  int64_t expire;
+  int32_t der_len;
+  unsigned char id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+};
+
+struct SSLSessionCacheEntry
+{
+  SSLSessionCacheEntry * hash_next;
+  LINK(SSLSessionCacheEntry, lru_link);
+  ink_time_t expire;
+  unsigned id_len;
+  unsigned char id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+  int der_len;
+
+  unsigned char * der() { return (unsigned char *)(this + 1); }
+};
+
+struct SSLSessionCacheStripe
+{
+  ink_mutex mutex;
+  SSLSessionCacheEntry ** buckets;
+  unsigned nbuckets;
+  int count;
+  int max_count;
+  Queue<SSLSessionCacheEntry, SSLSessionCacheEntry::Link_lru_link> lru;
+};
+
+// Serialized sessions waiting to be replicated.
+struct SSLSessionCacheQueue
+{
+  ink_mutex mutex;
+  char * buf;
+  int len;
+  int size;
+};
+
+static SSLSessionCacheStripe * session_cache = NULL;
+static int session_cache_timeout = 0;
+static bool session_cache_replicate = false;
+static SSLSessionCacheQueue session_cache_queue;
+static volatile SSLSessionCacheReplicator session_cache_replicator = NULL;
+
+static inline uint32_t
+session_id_hash(const unsigned char * id, unsigned len)
+{
+  // FNV-1a; the ids are random already, this just folds them.
+  uint32_t h = 2166136261U;
+  for (unsigned i = 0; i < len; ++i) {
+    h = (h ^ id[i]) * 16777619U;
+  }
+  return h;
+}
+
+static inline SSLSessionCacheStripe *
+session_cache_stripe(uint32_t hash)
+{
+  return &session_cache[hash % SSL_SESSION_CACHE_STRIPES];
+}
+
+static inline SSLSessionCacheEntry **
+session_cache_bucket(SSLSessionCacheStripe * stripe, uint32_t hash)
+{
+  return &stripe->buckets[(hash / SSL_SESSION_CACHE_STRIPES) % stripe->nbuckets];
+}
+
+// Unlink and free @a entry. The stripe must be locked.
+static void
+session_cache_unlink(SSLSessionCacheStripe * stripe, SSLSessionCacheEntry * entry, uint32_t hash)
+{
+  for (SSLSessionCacheEntry ** p = session_cache_bucket(stripe, hash); *p; p = &(*p)->hash_next) {
+    if (*p == entry) {
+      *p = entry->hash_next;
+      break;
+    }
+  }
+  stripe->lru.remove(entry);
+  stripe->count--;
+  ats_free(entry);
+}
+
+// Find the entry for @a id. The stripe must be locked.
+static SSLSessionCacheEntry *
+session_cache_find(SSLSessionCacheStripe * stripe, const unsigned char * id, unsigned len, uint32_t hash)
+{
+  for (SSLSessionCacheEntry * e = *session_cache_bucket(stripe, hash); e; e = e->hash_next) {
+    if (e->id_len == len && memcmp(e->id, id, len) == 0) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+static void
+session_cache_insert(const unsigned char * id, unsigned len, const unsigned char * der, int der_len, ink_time_t expire)
+{
+  uint32_t hash = session_id_hash(id, len);
+  SSLSessionCacheStripe * stripe = session_cache_stripe(hash);
+  SSLSessionCacheEntry * entry = (SSLSessionCacheEntry *)ats_malloc(sizeof(SSLSessionCacheEntry) + der_len);
+  int evicted = 0;
+
+  memset(entry, 0, sizeof(SSLSessionCacheEntry));
+  memcpy(entry->id, id, len);
+  entry->id_len = len;
+  entry->expire = expire;
+  entry->der_len = der_len;
+  memcpy(entry->der(), der, der_len);
+
+  ink_mutex_acquire(&stripe->mutex);
+
+  SSLSessionCacheEntry * old = session_cache_find(stripe, id, len, hash);
+  if (old) {
+    session_cache_unlink(stripe, old, hash);
+  }
+
+  SSLSessionCacheEntry ** bucket = session_cache_bucket(stripe, hash);
+  entry->hash_next = *bucket;
+  *bucket = entry;
+  stripe->lru.push(entry);
+  stripe->count++;
+
+  while (stripe->count > stripe->max_count && stripe->lru.tail) {
+    SSLSessionCacheEntry * victim = stripe->lru.tail;
+    session_cache_unlink(stripe, victim, session_id_hash(victim->id, victim->id_len));
+    ++evicted;
+  }
+
+  ink_mutex_release(&stripe->mutex);
+
+  if (evicted) {
+    SSL_INCREMENT_DYN_STAT(ssl_session_cache_evict_stat, evicted);
+  }
+}
+
+// Copy the DER encoding of session @a id to @a der.
+// @return the length of the encoding, or 0 if the session is not cached.
+static int
+session_cache_lookup(const unsigned char * id, unsigned len, unsigned char * der, int der_size)
+{
+  uint32_t hash = session_id_hash(id, len);
+  SSLSessionCacheStripe * stripe = session_cache_stripe(hash);
+  int der_len = 0;
+
+  ink_mutex_acquire(&stripe->mutex);
+
+  SSLSessionCacheEntry * entry = session_cache_find(stripe, id, len, hash);
+  if (entry) {
+    if (entry->expire <= ink_get_hrtime() / HRTIME_SECOND) {
+      session_cache_unlink(stripe, entry, hash);
+    } else if (entry->der_len <= der_size) {
+      // Refresh the entry's position in the LRU.
+      stripe->lru.remove(entry);
+      stripe->lru.push(entry);
+      der_len = entry->der_len;
+      memcpy(der, entry->der(), der_len);
+    }
+  }
+
+  ink_mutex_release(&stripe->mutex);
+  return der_len;
+}
+
+static void
+session_cache_remove(const unsigned char * id, unsigned len)
+{
+  uint32_t hash = session_id_hash(id, len);
+  SSLSessionCacheStripe * stripe = session_cache_stripe(hash);
+
+  ink_mutex_acquire(&stripe->mutex);
+
+  SSLSessionCacheEntry * entry = session_cache_find(stripe, id, len, hash);
+  if (entry) {
+    session_cache_unlink(stripe, entry, hash);
+  }
+
+  ink_mutex_release(&stripe->mutex);
+}
+
+static void
+session_queue_init(SSLSessionCacheQueue * queue)
+{
+  ink_mutex_init(&queue->mutex, "SSLSessionCacheQueue");
+  queue->buf = NULL;
+  queue->len = 0;
+  queue->size = 0;
+}
+
+// Append a message to @a queue.
+// @return @c false if the queue is full.
+static bool
+session_queue_push(SSLSessionCacheQueue * queue, const SSLSessionCacheMsg * msg, const unsigned char * der)
+{
+  int len = sizeof(SSLSessionCacheMsg) + msg->der_len;
+  bool queued = false;
+
+  ink_mutex_acquire(&queue->mutex);
+
+  if (queue->len + len <= SSL_SESSION_CACHE_MAX_QUEUED) {
+    if (queue->len + len > queue->size) {
+      int size = queue->size ? queue->size : SSL_SESSION_CACHE_MAX_BATCH;
+      while (queue->len + len > size) {
+        size *= 2;
+      }
+      queue->buf = (char *)ats_realloc(queue->buf, size);
+      queue->size = size;
+    }
+    memcpy(queue->buf + queue->len, msg, sizeof(SSLSessionCacheMsg));
+    memcpy(queue->buf + queue->len + sizeof(SSLSessionCacheMsg), der, msg->der_len);
+    queue->len += len;
+    queued = true;
+  }
+
+  ink_mutex_release(&queue->mutex);
+  return queued;
+}
+
+// Hand everything queued so far to @a replicator, a batch at a time. The
+// queue is only locked while its buffer is taken.
+static void
+session_queue_flush(SSLSessionCacheQueue * queue, SSLSessionCacheReplicator replicator)
+{
+  char * buf;
+  int len;
+
+  ink_mutex_acquire(&queue->mutex);
+  buf = queue->buf;
+  len = queue->len;
+  queue->buf = NULL;
+  queue->len = 0;
+  queue->size = 0;
+  ink_mutex_release(&queue->mutex);
+
+  int start = 0, end = 0;
+  while (end < len) {
+    SSLSessionCacheMsg msg;
+    int msg_len;
+
+    memcpy(&msg, buf + end, sizeof(msg));
+    msg_len = sizeof(SSLSessionCacheMsg) + msg.der_len;
+    if (end + msg_len - start > SSL_SESSION_CACHE_MAX_BATCH) {
+      replicator(buf + start, end - start);
+      start = end;
+    }
+    end += msg_len;
+  }
+
+  if (end > start) {
+    replicator(buf + start, end - start);
+  }
+
+  ats_free(buf);
+}
+
+// Cache a new session locally and, when replication is enabled, queue it
+// for the other nodes.
+static void
+session_cache_add(SSLSessionCacheQueue * queue, const unsigned char * id, unsigned len, const unsigned char * der,
+                  int der_len, ink_time_t expire)
+{
+  session_cache_insert(id, len, der, der_len, expire);
+
+  if (queue) {
+    SSLSessionCacheMsg msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.magic = SSL_SESSION_CACHE_MSG_MAGIC;
+    msg.id_len = len;
+    msg.expire = expire;
+    msg.der_len = der_len;
+    memcpy(msg.id, id, len);
+
+    if (!session_queue_push(queue, &msg, der)) {
+      Debug("ssl", "session replication queue is full, session not replicated");
+    }
+  }
+}
+
+// Insert the sessions of a replicated batch.
+// @return the number of sessions inserted.
+static int
+session_cache_receive(const void * data, int len)
+{
+  const char * p = (const char *)data;
+  const char * end = p + len;
+  ink_time_t now = ink_get_hrtime() / HRTIME_SECOND;
+  int count = 0;
+
+  while (p < end) {
+    SSLSessionCacheMsg msg;
+
+    if (end - p < (int)sizeof(SSLSessionCacheMsg)) {
+      Debug("ssl", "dropping truncated replicated session (%d bytes)", (int)(end - p));
+      break;
+    }
+
+    memcpy(&msg, p, sizeof(msg));
+    if (msg.magic != SSL_SESSION_CACHE_MSG_MAGIC || msg.id_len == 0 || msg.id_len > SSL_MAX_SSL_SESSION_ID_LENGTH ||
+        msg.der_len <= 0 || msg.der_len > SSL_SESSION_CACHE_MAX_DER ||
+        end - p - (int)sizeof(SSLSessionCacheMsg) < msg.der_len) {
+      Debug("ssl", "dropping malformed replicated session (%d bytes left)", (int)(end - p));
+      break;
+    }
+
+    if (msg.expire > now) {
+      session_cache_insert(msg.id, msg.id_len, (const unsigned char *)p + sizeof(SSLSessionCacheMsg), msg.der_len,
+                           (ink_time_t)msg.expire);
+      ++count;
+    }
+    p += sizeof(SSLSessionCacheMsg) + msg.der_len;
+  }
+
+  return count;
+}
+
+struct SSLSessionCacheFlusher: public Continuation
+{
+  SSLSessionCacheFlusher():Continuation(new_ProxyMutex())
+  {
+    SET_HANDLER(&SSLSessionCacheFlusher::mainEvent);
+  }
+
+  int mainEvent(int event, Event * e)
+  {
+    SSLSessionCacheReplicator replicator = session_cache_replicator;
+
+    NOWARN_UNUSED(event);
+    NOWARN_UNUSED(e);
+
+    if (replicator) {
+      session_queue_flush(&session_cache_queue, replicator);
+    }
+    return EVENT_CONT;
+  }
+};
+
+static int
+ssl_session_cache_new(SSL * ssl, SSL_SESSION * sess)
+{
+  unsigned int id_len;
+  const unsigned char * id = SSL_SESSION_get_id(sess, &id_len);
+  int der_len = i2d_SSL_SESSION(sess, NULL);
+  unsigned char der[SSL_SESSION_CACHE_MAX_DER];
+  unsigned char * p = der;
+
+  NOWARN_UNUSED(ssl);
+
+  if (id_len == 0 || id_len > SSL_MAX_SSL_SESSION_ID_LENGTH || der_len <= 0 || der_len > SSL_SESSION_CACHE_MAX_DER) {
+    return 0;
+  }
+
+  if (i2d_SSL_SESSION(sess, &p) == der_len) {
+    // Nothing is queued until there are other nodes to send it to.
+    bool replicate = session_cache_replicate && session_cache_replicator != NULL;
+
+    session_cache_add(replicate ? &session_cache_queue : NULL, id, id_len, der, der_len,
+                      SSL_SESSION_get_time(sess) + SSL_SESSION_get_timeout(sess));
+  }
+
+  // We did not keep a reference to the session.
+  return 0;
+}
+
+static SSL_SESSION *
+ssl_session_cache_get(SSL * ssl, ink_ssl_session_id_t id, int len, int * copy)
+{
+  unsigned char der[SSL_SESSION_CACHE_MAX_DER];
+  int der_len;
+
+  NOWARN_UNUSED(ssl);
+  *copy = 0;
+
+  if (len <= 0 || len > SSL_MAX_SSL_SESSION_ID_LENGTH) {
+    return NULL;
+  }
+
+  der_len = session_cache_lookup(id, len, der, sizeof(der));
+  if (der_len == 0) {
+    SSL_INCREMENT_DYN_STAT(ssl_session_cache_miss_stat, 1);
+    return NULL;
+  }
+
+  const unsigned char * p = der;
+  SSL_SESSION * sess = d2i_SSL_SESSION(NULL, &p, der_len);
+
+  SSL_INCREMENT_DYN_STAT(sess ? ssl_session_cache_hit_stat : ssl_session_cache_miss_stat, 1);
+  return sess;
+}
+
+static void
+ssl_session_cache_remove(SSL_CTX * ctx, SSL_SESSION * sess)
+{
+  unsigned int id_len;
+  const unsigned char * id = SSL_SESSION_get_id(sess, &id_len);
+
+  NOWARN_UNUSED(ctx);
+
+  if (id_len > 0 && id_len <= SSL_MAX_SSL_SESSION_ID_LENGTH) {
+    session_cache_remove(id, id_len);
+  }
+}
+
+static void
+session_cache_create(int size)
+{
+  int per_stripe = size / SSL_SESSION_CACHE_STRIPES;
+  if (per_stripe < 1) {
+    per_stripe = 1;
+  }
+
+  session_cache = NEW(new SSLSessionCacheStripe[SSL_SESSION_CACHE_STRIPES]);
+  for (int i = 0; i < SSL_SESSION_CACHE_STRIPES; ++i) {
+    SSLSessionCacheStripe * stripe = &session_cache[i];
+
+    ink_mutex_init(&stripe->mutex, "SSLSessionCache");
+    stripe->nbuckets = per_stripe;
+    stripe->buckets = (SSLSessionCacheEntry **)ats_malloc(sizeof(SSLSessionCacheEntry *) * per_stripe);
+    memset(stripe->buckets, 0, sizeof(SSLSessionCacheEntry *) * per_stripe);
+    stripe->count = 0;
+    stripe->max_count = per_stripe;
+  }
+
+  session_queue_init(&session_cache_queue);
+  Debug("ssl", "shared session cache of %d sessions", per_stripe * SSL_SESSION_CACHE_STRIPES);
+}
+
+void
+SSLSessionCacheInitialize(const SSLConfigParams * params)
+{
+  if (session_cache || params->ssl_session_cache != SSLConfigParams::SSL_SESSION_CACHE_MODE_SHARED) {
+    return;
+  }
+
+  session_cache_create(params->ssl_session_cache_size);
+  session_cache_timeout = params->ssl_session_cache_timeout;
+
+  // Replicated sessions carry their master secret in the clear, so they are
+  // only sent (and accepted) when that has been explicitly enabled.
+  session_cache_replicate = params->ssl_session_cache_replicate != 0;
+  if (session_cache_replicate) {
+    Note("SSL sessions are replicated to the cluster unencrypted, the cluster network must be trusted");
+    eventProcessor.schedule_every(NEW(new SSLSessionCacheFlusher), HRTIME_MSECONDS(SSL_SESSION_CACHE_FLUSH_MSEC), ET_TASK);
+  }
+}
+
+void
+SSLSessionCacheAttach(SSL_CTX * ctx)
+{
+  ink_release_assert(session_cache != NULL);
+
+  SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+  SSL_CTX_sess_set_new_cb(ctx, ssl_session_cache_new);
+  SSL_CTX_sess_set_get_cb(ctx, ssl_session_cache_get);
+  SSL_CTX_sess_set_remove_cb(ctx, ssl_session_cache_remove);
+  if (session_cache_timeout > 0) {
+    SSL_CTX_set_timeout(ctx, session_cache_timeout);
+  }
+}
+
+void
+SSLSessionCacheSetReplicator(SSLSessionCacheReplicator replicator)
+{
+  session_cache_replicator = replicator;
+}
+
+void
+SSLSessionCacheReceive(const void * data, int len)
+{
+  if (session_cache == NULL || !session_cache_replicate) {
+    return;
+  }
+
+  int count = session_cache_receive(data, len);
+  if (count > 0) {
+    SSL_INCREMENT_DYN_STAT(ssl_session_cache_remote_insert_stat, count);
+  }
+}
+
+//
+// Session ticket keys.
+//
+// keys[0] is the key of the next rotation period, so that a node whose
+// clock is slightly ahead doesn't cause misses, keys[1] is the current
+// key and the rest are the previous keys, which are still accepted.
+//
+struct SSLTicketKeyRing
+{
+  ink_mutex mutex;
+  bool loaded;
+  unsigned char secret[SSL_TICKET_SECRET_MAX];
+  int secret_len;
+  int64_t rotation_period;
+  int nkeys;
+  int64_t period;
+  ssl_ticket_key_t keys[SSL_TICKET_KEYS_MAX];
+};
+
+static SSLTicketKeyRing ticket_ring;
+static bool ticket_ring_initialized = false;
+
+static void
+ticket_key_derive(const SSLTicketKeyRing * ring, int64_t period, ssl_ticket_key_t * key)
+{
+  unsigned char material[2 * EVP_MAX_MD_SIZE];
+  unsigned char input[sizeof("ats ticket key") + 9];
+  unsigned int len = 0;
+  unsigned int n;
+
+  memcpy(input, "ats ticket key", sizeof("ats ticket key"));
+  for (int i = 0; i < 8; ++i) {
+    input[sizeof("ats ticket key") + i] = (unsigned char)(period >> (56 - 8 * i));
+  }
+
+  for (unsigned char block = 1; len < sizeof(ssl_ticket_key_t); ++block) {
+    input[sizeof(input) - 1] = block;
+    HMAC(EVP_sha256(), ring->secret, ring->secret_len, input, sizeof(input), material + len, &n);
+    len += n;
+  }
+
+  memcpy(key->key_name, material, sizeof(key->key_name));
+  memcpy(key->hmac_secret, material + 16, sizeof(key->hmac_secret));
+  memcpy(key->aes_key, material + 32, sizeof(key->aes_key));
+}
+
+// Find the key named @a name, or the current key if @a name is NULL.
+// @return the index of the key in the ring, or -1 if there is no such key.
+static int
+ticket_key_find(const unsigned char * name, ssl_ticket_key_t * key)
+{
+  SSLTicketKeyRing * ring = &ticket_ring;
+  int index = -1;
+
+  ink_mutex_acquire(&ring->mutex);
+
+  if (ring->secret_len > 0) {
+    int64_t period = (ink_get_hrtime() / HRTIME_SECOND) / ring->rotation_period;
+
+    if (period != ring->period) {
+      ring->period = period;
+      for (int i = 0; i < ring->nkeys; ++i) {
+        ticket_key_derive(ring, period + 1 - i, &ring->keys[i]);
+      }
+    }
+
+    if (name == NULL) {
+      index = 1;
+    } else {
+      for (int i = 0; i < ring->nkeys; ++i) {
+        if (memcmp(name, ring->keys[i].key_name, sizeof(ring->keys[i].key_name)) == 0) {
+          index = i;
+          break;
+        }
+      }
+    }
+
+    if (index >= 0) {
+      *key = ring->keys[index];
+    }
+  }
+
+  ink_mutex_release(&ring->mutex);
+  return index;
+}
+
+#if TS_USE_TLS_TICKETS
+static int
+ssl_callback_ticket_ring(SSL * ssl, unsigned char * keyname, unsigned char * iv, EVP_CIPHER_CTX * cipher_ctx,
+                         HMAC_CTX * hctx, int enc)
+{
+  ssl_ticket_key_t key;
+  int index;
+
+  NOWARN_UNUSED(ssl);
+
+  if (enc == 1) {
+    if (ticket_key_find(NULL, &key) < 0 || RAND_bytes(iv, EVP_MAX_IV_LENGTH) <= 0) {
+      return -1;
+    }
+
+    memcpy(keyname, key.key_name, sizeof(key.key_name));
+    EVP_EncryptInit_ex(cipher_ctx, EVP_aes_128_cbc(), NULL, key.aes_key, iv);
+    HMAC_Init_ex(hctx, key.hmac_secret, sizeof(key.hmac_secret), EVP_sha256(), NULL);
+    return 1;
+  }
+
+  index = ticket_key_find(keyname, &key);
+  if (index < 0) {
+    // Unknown or expired key, fall back to a full handshake.
+    SSL_INCREMENT_DYN_STAT(ssl_session_ticket_key_miss_stat, 1);
+    return 0;
+  }
+
+  EVP_DecryptInit_ex(cipher_ctx, EVP_aes_128_cbc(), NULL, key.aes_key, iv);
+  HMAC_Init_ex(hctx, key.hmac_secret, sizeof(key.hmac_secret), EVP_sha256(), NULL);
+
+  // Have the client renew tickets that were not issued under the current key.
+  return index == 1 ? 1 : 2;
+}
+#endif /* TS_USE_TLS_TICKETS */
+
+static int
+ticket_secret_parse(const char * data, int len, unsigned char * secret)
+{
+  const char * p = data;
+  const char * end = data + len;
+  int n = 0;
+
+  // The secret is the first line that is not a comment, in hex.
+  while (p < end) {
+    while (p < end && ParseRules::is_space(*p)) {
+      ++p;
+    }
+    if (p < end && *p == '#') {
+      while (p < end && *p != '\n') {
+        ++p;
+      }
+      continue;
+    }
+    break;
+  }
+
+  while (p + 1 < end && ParseRules::is_hex(p[0]) && ParseRules::is_hex(p[1]) && n < SSL_TICKET_SECRET_MAX) {
+    secret[n++] = (ink_get_hex(p[0]) << 4) | ink_get_hex(p[1]);
+    p += 2;
+  }
+
+  return n;
+}
+
+bool
+SSLTicketKeysLoad(const SSLConfigParams * params)
+{
+  SSLTicketKeyRing * ring = &ticket_ring;
+  unsigned char secret[SSL_TICKET_SECRET_MAX];
+  int secret_len = 0;
+
+  if (!ticket_ring_initialized) {
+    ink_mutex_init(&ring->mutex, "SSLTicketKeyRing");
+    ticket_ring_initialized = true;
+  }
+
+  if (params->ticketKeyFilename) {
+    int len = 0;
+    xptr<char> data(readIntoBuffer(params->ticketKeyFilename, __func__, &len));
+
+    if (data) {
+      secret_len = ticket_secret_parse(data, len, secret);
+      if (secret_len > 0 && secret_len < 16) {
+        Error("SSL session ticket secret in %s is too short (16 bytes are required)", params->ticketKeyFilename);
+        secret_len = 0;
+      }
+    }
+  }
+
+  ink_mutex_acquire(&ring->mutex);
+
+  // Contexts from an earlier configuration may still call back for a
+  // while, so the previous secret is only replaced, never cleared.
+  ring->loaded = secret_len > 0;
+  if (ring->loaded) {
+    memcpy(ring->secret, secret, secret_len);
+    ring->secret_len = secret_len;
+    ring->rotation_period = params->ticket_key_rotation_period > 0 ? params->ticket_key_rotation_period : 3600;
+    ring->nkeys = params->ticket_key_keep + 2;
+    if (ring->nkeys > SSL_TICKET_KEYS_MAX) {
+      ring->nkeys = SSL_TICKET_KEYS_MAX;
+    } else if (ring->nkeys < 2) {
+      ring->nkeys = 2;
+    }
+    ring->period = -1;
+  }
+
+  ink_mutex_release(&ring->mutex);
+
+  memset(secret, 0, sizeof(secret));
+  Debug("ssl", "cluster session ticket keys %s", ring->loaded ? "loaded" : "disabled");
+  return ring->loaded;
+}
+
+bool
+SSLTicketKeysAttach(SSL_CTX * ctx)
+{
+#if TS_USE_TLS_TICKETS
+  if (ticket_ring_initialized && ticket_ring.loaded) {
+    if (SSL_CTX_set_tlsext_ticket_key_cb(ctx, ssl_callback_ticket_ring) == 0) {
+      Error("failed to set session ticket callback");
+      return false;
+    }
+    return true;
+  }
+#else
+  NOWARN_UNUSED(ctx);
+#endif /* TS_USE_TLS_TICKETS */
+
+  return false;
+}
+
+void
+SSLHandshakeRecord(SSL * ssl, ink_hrtime elapsed)
+{
+  if (SSL_session_reused(ssl)) {
+    int64_t full_count = 0, full_time = 0;
+
+    SSL_INCREMENT_DYN_STAT(ssl_handshake_resumed_stat, 1);
+    SSL_INCREMENT_DYN_STAT(ssl_handshake_resumed_time_stat, elapsed);
+
+    // Credit the difference to the average cost of a full handshake.
+    RecGetGlobalRawStatSum(net_rsb, (int) ssl_handshake_full_stat, &full_count);
+    RecGetGlobalRawStatSum(net_rsb, (int) ssl_handshake_full_time_stat, &full_time);
+    if (full_count > 0 && full_time / full_count > elapsed) {
+      SSL_INCREMENT_DYN_STAT(ssl_handshake_time_saved_stat, full_time / full_count - elapsed);
+    }
+  } else {
+    SSL_INCREMENT_DYN_STAT(ssl_handshake_full_stat, 1);
+    SSL_INCREMENT_DYN_STAT(ssl_handshake_full_time_stat, elapsed);
+  }
+}
+
+#if TS_HAS_TESTS
+
+#define TEST_SESSIONS 24
+
+static char test_replicated[2 * TEST_SESSIONS * (sizeof(SSLSessionCacheMsg) + SSL_SESSION_CACHE_MAX_DER)];
+static int test_replicated_len;
+static int test_batches;
+static int test_max_batch;
+
+static void
+test_replicator(const void * msg, int len)
+{
+  memcpy(test_replicated + test_replicated_len, msg, len);
+  test_replicated_len += len;
+  test_batches++;
+  if (len > test_max_batch) {
+    test_max_batch = len;
+  }
+}
+
+static void
+test_session(int n, unsigned char * id, unsigned char * der, int * der_len)
+{
+  memset(id, 0, SSL_MAX_SSL_SESSION_ID_LENGTH);
+  memcpy(id, "regression", sizeof("regression") - 1);
+  id[SSL_MAX_SSL_SESSION_ID_LENGTH - 1] = (unsigned char)n;
+
+  // Sizes up to the limit, so that the sessions need several batches.
+  *der_len = SSL_SESSION_CACHE_MAX_DER - n * 100;
+  for (int i = 0; i < *der_len; ++i) {
+    der[i] = (unsigned char)(n + i);
+  }
+}
+
+REGRESSION_TEST(SSLSessionCache_Replicate)(RegressionTest * t, int atype, int * pstatus)
+{
+  TestBox box(t, pstatus);
+  SSLSessionCacheQueue queue;
+  ink_time_t expire = ink_get_hrtime() / HRTIME_SECOND + 300;
+  unsigned char id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+  unsigned char der[SSL_SESSION_CACHE_MAX_DER];
+  unsigned char found[SSL_SESSION_CACHE_MAX_DER];
+  int der_len, found_len, i;
+
+  NOWARN_UNUSED(atype);
+  box = REGRESSION_TEST_PASSED;
+
+  if (session_cache == NULL) {
+    // The shared cache isn't configured; it is never attached to a context.
+    session_cache_create(TEST_SESSIONS * SSL_SESSION_CACHE_STRIPES);
+  }
+
+  // Serialize: every new session is cached and queued.
+  session_queue_init(&queue);
+  for (i = 0; i < TEST_SESSIONS; ++i) {
+    test_session(i, id, der, &der_len);
+    session_cache_add(&queue, id, sizeof(id), der, der_len, expire);
+  }
+
+  test_replicated_len = test_batches = test_max_batch = 0;
+  session_queue_flush(&queue, test_replicator);
+  box.check(test_batches > 1, "%d sessions were sent in %d batch", TEST_SESSIONS, test_batches);
+  box.check(test_max_batch <= SSL_SESSION_CACHE_MAX_BATCH, "a batch of %d bytes is too big", test_max_batch);
+  box.check(queue.len == 0, "the queue still holds %d bytes after a flush", queue.len);
+
+  i = test_batches;
+  session_queue_flush(&queue, test_replicator);
+  box.check(test_batches == i, "an empty queue sent a batch");
+
+  // Replicate: the sessions come back from another node.
+  for (i = 0; i < TEST_SESSIONS; ++i) {
+    test_session(i, id, der, &der_len);
+    session_cache_remove(id, sizeof(id));
+    box.check(session_cache_lookup(id, sizeof(id), found, sizeof(found)) == 0, "session %d wasn't removed", i);
+  }
+
+  i = session_cache_receive(test_replicated, test_replicated_len);
+  box.check(i == TEST_SESSIONS, "received %d of %d sessions", i, TEST_SESSIONS);
+
+  for (i = 0; i < TEST_SESSIONS; ++i) {
+    test_session(i, id, der, &der_len);
+    found_len = session_cache_lookup(id, sizeof(id), found, sizeof(found));
+    box.check(found_len == der_len && memcmp(found, der, der_len) == 0, "session %d didn't round trip", i);
+    session_cache_remove(id, sizeof(id));
+  }
+
+  // A truncated batch is applied up to the last complete session.
+  i = session_cache_receive(test_replicated, test_replicated_len - 1);
+  box.check(i == TEST_SESSIONS - 1, "a truncated batch inserted %d sessions", i);
+
+  // Expired sessions are dropped.
+  test_session(0, id, der, &der_len);
+  session_cache_add(&queue, id, sizeof(id), der, der_len, expire - 600);
+  test_replicated_len = 0;
+  session_queue_flush(&queue, test_replicator);
+  box.check(session_cache_receive(test_replicated, test_replicated_len) == 0, "an expired session was inserted");
+
+  for (i = 0; i < TEST_SESSIONS; ++i) {
+    test_session(i, id, der, &der_len);
+    session_cache_remove(id, sizeof(id));
+  }
+  ink_mutex_destroy(&queue.mutex);
+}
+
+#endif /* TS_HAS_TESTS */
@@ -23,6 +23,7 @@
 #include "libts.h"
 #include "I_Layout.h"
 #include "P_Net.h"
+#include "P_SSLSessionCache.h"
 
 #include <openssl/err.h>
 #include <openssl/bio.h>
@@ -68,13 +69,6 @@ typedef SSL_METHOD * ink_ssl_method_t;
 static ink_mutex * sslMutexArray;
 static bool open_ssl_initialized = false;
 
-struct ssl_ticket_key_t
-{
-  unsigned char key_name[16];
-  unsigned char hmac_secret[16];
-  unsigned char aes_key[16];
-};
-
 #if TS_USE_TLS_TICKETS
 static int ssl_callback_session_ticket(SSL *, unsigned char *, unsigned char *, EVP_CIPHER_CTX *, HMAC_CTX *, int);
 #endif /* TS_USE_TLS_TICKETS */
@@ -177,8 +171,10 @@ ssl_servername_callback(SSL * ssl, int * ad, void * arg)
     ctx = lookup->findInfoInHash(ip);
   }
 
+  // The connection takes its own reference, drop the one from the lookup.
   if (ctx != NULL) {
     SSL_set_SSL_CTX(ssl, ctx);
+    SSLReleaseContext(ctx);
   }
 
   ctx = SSL_get_SSL_CTX(ssl);
@@ -391,6 +387,9 @@ SSLInitServerContext(
     SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
     SSL_CTX_sess_set_cache_size(ctx, params->ssl_session_cache_size);
     break;
+  case SSLConfigParams::SSL_SESSION_CACHE_MODE_SHARED:
+    SSLSessionCacheAttach(ctx);
+    break;
   }
 
 #ifdef SSL_MODE_RELEASE_BUFFERS
@@ -571,16 +570,23 @@ asn1_strdup(ASN1_STRING * s)
     return ats_strndup((const char *)ASN1_STRING_data(s), ASN1_STRING_length(s));
 }
 
-// Given a certificate and it's corresponding SSL_CTX context, insert hash
-// table aliases for all of the subject and subjectAltNames. Note that we don't
-// deal with wildcards (yet).
-static void
-ssl_index_certificate(SSLCertLookup * lookup, SSL_CTX * ctx, const char * certfile)
+// Given a certificate and it's corresponding SSL_CTX context (or the loader that
+// will create it), insert lookup aliases for all of the subject and subjectAltNames.
+// Only the certificate is read, so this is cheap even if the context is not created.
+// Returns the number of names indexed.
+static int
+ssl_index_certificate(SSLCertLookup * lookup, SSL_CTX * ctx, SSLContextLoader * loader, const char * certfile)
 {
   X509_NAME * subject = NULL;
+  int indexed = 0;
 
   ats_file_bio bio(certfile, "r");
-  X509* cert = PEM_read_bio_X509_AUX(bio.bio, NULL, NULL, NULL);
+  X509* cert = bio ? PEM_read_bio_X509_AUX(bio.bio, NULL, NULL, NULL) : NULL;
+
+  if (cert == NULL) {
+    SSLError("failed to read certificate %s", certfile);
+    return 0;
+  }
 
   // Insert a key for the subject CN.
   subject = X509_get_subject_name(cert);
@@ -597,7 +603,7 @@ ssl_index_certificate(SSLCertLookup * lookup, SSL_CTX * ctx, const char * certfi
       xptr<char> name(asn1_strdup(cn));
 
       Debug("ssl", "mapping '%s' to certificate %s", (const char *)name, certfile);
-      lookup->insert(ctx, name);
+      indexed += ctx ? lookup->insert(ctx, name) : lookup->insert(loader, name);
     }
   }
 
@@ -613,7 +619,7 @@ ssl_index_certificate(SSLCertLookup * lookup, SSL_CTX * ctx, const char * certfi
       if (name->type == GEN_DNS) {
         xptr<char> dns(asn1_strdup(name->d.dNSName));
         Debug("ssl", "mapping '%s' to certificate %s", (const char *)dns, certfile);
-        lookup->insert(ctx, dns);
+        indexed += ctx ? lookup->insert(ctx, dns) : lookup->insert(loader, dns);
       }
     }
 
@@ -621,68 +627,156 @@ ssl_index_certificate(SSLCertLookup * lookup, SSL_CTX * ctx, const char * certfi
   }
 #endif // HAVE_OPENSSL_TS_H
   X509_free(cert);
+  return indexed;
 }
 
-static void
-ssl_store_ssl_context(
+static SSL_CTX *
+ssl_create_ssl_context(
     const SSLConfigParams * params,
     SSLCertLookup *         lookup,
-    xptr<char>& addr,
-    xptr<char>& cert,
-    xptr<char>& ca,
-    xptr<char>& key,
-    const int session_ticket_enabled,
-    xptr<char>& ticket_key_filename)
+    const char *            cert,
+    const char *            ca,
+    const char *            key,
+    const int               session_ticket_enabled,
+    const char *            ticket_key_filename)
 {
-  SSL_CTX *   ctx;
-  xptr<char>  certpath;
-  xptr<char>  session_key_path;
+  SSL_CTX * ctx;
 
   ctx = ssl_context_enable_sni(SSLInitServerContext(params, cert, ca, key), lookup);
   if (!ctx) {
     SSLError("failed to create new SSL server context");
-    return;
+    return NULL;
   }
 
 #if TS_USE_TLS_NPN
   SSL_CTX_set_next_protos_advertised_cb(ctx, SSLNetVConnection::advertise_next_protocol, NULL);
 #endif /* TS_USE_TLS_NPN */
 
+#if defined(SSL_OP_NO_TICKET)
+  // Session tickets are enabled by default. Disable if explicitly requested.
+  if (session_ticket_enabled == 0) {
+      SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+      Debug("ssl", "ssl session ticket is disabled");
+  }
+#endif
+  // Load the session ticket key if session tickets are not disabled and we have key name. Otherwise
+  // use the cluster wide ticket keys, if they are configured.
+  if (session_ticket_enabled != 0 && ticket_key_filename) {
+    xptr<char> ticket_key_path(Layout::relative_to(params->serverCertPathOnly, ticket_key_filename));
+    ssl_context_enable_tickets(ctx, ticket_key_path);
+  } else if (session_ticket_enabled != 0) {
+    SSLTicketKeysAttach(ctx);
+  }
+
+  return ctx;
+}
+
+// A ssl_multicert.config entry whose context is created when a handshake first needs it.
+struct SSLMulticertLoader : public SSLContextLoader
+{
+  SSLMulticertLoader(SSLCertLookup * l, xptr<char>& c, xptr<char>& a, xptr<char>& k, int ticket, xptr<char>& t)
+    : lookup(l), cert(c.release()), ca(a.release()), key(k.release()), session_ticket_enabled(ticket),
+      ticket_key_filename(t.release())
+  {
+  }
+
+  // Reads the certificate and key files, blocking the net thread whose handshake
+  // needed them. The load time stat shows how long that takes.
+  virtual SSL_CTX * load()
+  {
+    SSLConfig::scoped_config params;
+    ink_hrtime start = ink_get_hrtime_internal();
+    SSL_CTX * ctx = ssl_create_ssl_context(params, lookup, cert, ca, key, session_ticket_enabled, ticket_key_filename);
+
+    SSL_INCREMENT_DYN_STAT(ssl_context_load_time_stat, ink_get_hrtime_internal() - start);
+    Debug("ssl", "loaded certificate %s as SSL_CTX %p", (const char *)cert, ctx);
+    return ctx;
+  }
+
+  virtual void unload(SSL_CTX * ctx)
+  {
+    SSL_INCREMENT_DYN_STAT(ssl_context_cache_evict_stat, 1);
+    Debug("ssl", "evicting SSL_CTX %p for certificate %s", ctx, (const char *)cert);
+    // Handshakes still using it hold their own references.
+    SSLReleaseContext(ctx);
+  }
+
+  virtual void hit()
+  {
+    SSL_INCREMENT_DYN_STAT(ssl_context_cache_hit_stat, 1);
+  }
+
+  virtual void miss()
+  {
+    SSL_INCREMENT_DYN_STAT(ssl_context_cache_miss_stat, 1);
+  }
+
+  SSLCertLookup * lookup;
+  xptr<char> cert;
+  xptr<char> ca;
+  xptr<char> key;
+  int session_ticket_enabled;
+  xptr<char> ticket_key_filename;
+};
+
+static void
+ssl_store_ssl_context(
+    const SSLConfigParams * params,
+    SSLCertLookup *         lookup,
+    xptr<char>& addr,
+    xptr<char>& cert,
+    xptr<char>& ca,
+    xptr<char>& key,
+    const int session_ticket_enabled,
+    xptr<char>& ticket_key_filename)
+{
+  SSL_CTX *   ctx = NULL;
+  SSLMulticertLoader * loader = NULL;
+  xptr<char>  certpath;
+  bool        is_default = addr && strcmp(addr, "*") == 0;
+  int         indexed = 0;
+
   certpath = Layout::relative_to(params->serverCertPathOnly, cert);
 
+  // The default context bootstraps every handshake, so it is always created up front.
+  if (params->ssl_context_cache_size > 0 && !is_default) {
+    loader = new SSLMulticertLoader(lookup, cert, ca, key, session_ticket_enabled, ticket_key_filename);
+  } else {
+    ctx = ssl_create_ssl_context(params, lookup, cert, ca, key, session_ticket_enabled, ticket_key_filename);
+    if (!ctx) {
+      return;
+    }
+  }
+
   // Index this certificate by the specified IP(v6) address. If the address is "*", make it the default context.
   if (addr) {
-    if (strcmp(addr, "*") == 0) {
+    if (is_default) {
       lookup->ssl_default = ctx;
-      lookup->insert(ctx, addr);
+      indexed += lookup->insert(ctx, addr);
     } else {
       IpEndpoint ep;
 
       if (ats_ip_pton(addr, &ep) == 0) {
         Debug("ssl", "mapping '%s' to certificate %s", (const char *)addr, (const char *)certpath);
-        lookup->insert(ctx, ep);
+        indexed += ctx ? lookup->insert(ctx, ep) : lookup->insert(loader, ep);
       } else {
         Error("'%s' is not a valid IPv4 or IPv6 address", (const char *)addr);
       }
     }
   }
-#if defined(SSL_OP_NO_TICKET)
-  // Session tickets are enabled by default. Disable if explicitly requested.
-  if (session_ticket_enabled == 0) {
-      SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
-      Debug("ssl", "ssl session ticket is disabled");
-  }
-#endif
-  // Load the session ticket key if session tickets are not disabled and we have key name.
-  if (session_ticket_enabled != 0 && ticket_key_filename) {
-    xptr<char> ticket_key_path(Layout::relative_to(params->serverCertPathOnly, ticket_key_filename));
-    ssl_context_enable_tickets(ctx, ticket_key_path);
-  }
 
   // Insert additional mappings. Note that this maps multiple keys to the same value, so when
   // this code is updated to reconfigure the SSL certificates, it will need some sort of
   // refcounting or alternate way of avoiding double frees.
-  ssl_index_certificate(lookup, ctx, certpath);
+  indexed += ssl_index_certificate(lookup, ctx, loader, certpath);
+
+  // Once indexed, the lookup owns the context or loader.
+  if (indexed == 0) {
+    if (ctx) {
+      SSLReleaseContext(ctx);
+    }
+    delete loader;
+  }
 }
 
 static bool
@@ -758,6 +852,7 @@ SSLParseCertificateConfiguration(
   };
 
   Note("loading SSL certificate configuration from %s", params->configFilePath);
+  lookup->setContextCacheSize(params->ssl_context_cache_size);
 
   if (params->configFilePath) {
     file_buf = readIntoBuffer(params->configFilePath, __func__, NULL);
@@ -165,6 +165,48 @@ net_activity(UnixNetVConnection *vc, EThread *thread)
 
 }
 
+//
+// Kernel pipes used to splice a read side into a write side
+//
+#if TS_HAS_SPLICE
+static NetSplicePipe *
+splice_pipe_create()
+{
+  NetSplicePipe *p = new NetSplicePipe;
+
+  if (pipe2(p->fd, O_NONBLOCK | O_CLOEXEC) < 0) {
+    delete p;
+    return NULL;
+  }
+#if defined(F_SETPIPE_SZ) && defined(F_GETPIPE_SZ)
+  // A larger pipe means fewer round trips through the tunnel per byte.
+  // The kernel caps it at fs.pipe-max-size, so failure is not an error.
+  if (net_splice_pipe_size > 0)
+    fcntl(p->fd[1], F_SETPIPE_SZ, net_splice_pipe_size);
+  int size = fcntl(p->fd[1], F_GETPIPE_SZ);
+  p->size = size > 0 ? size : 65536;
+#else
+  p->size = 65536;
+#endif
+  p->avail = 0;
+  p->refcount = 2;
+  return p;
+}
+#endif
+
+static void
+splice_pipe_release(NetSplicePipe *&p)
+{
+  if (p) {
+    if (ink_atomic_increment(&p->refcount, -1) == 1) {
+      close(p->fd[0]);
+      close(p->fd[1]);
+      delete p;
+    }
+    p = NULL;
+  }
+}
+
 //
 // Function used to close a UnixNetVConnection and free the vc
 //
@@ -277,6 +319,95 @@ write_signal_error(NetHandler *nh, UnixNetVConnection *vc, int lerrno)
   return write_signal_done(VC_EVENT_ERROR, nh, vc);
 }
 
+#if TS_HAS_SPLICE
+// Read from the network straight into the splice pipe of the VC.
+// Mirrors read_from_net, except that the data never touches the
+// VIO buffer.
+static void
+read_splice_from_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread, int64_t ntodo)
+{
+  NetState *s = &vc->read;
+  ProxyMutex *mutex = thread->mutex;
+  ProxyMutex *vio_mutex = s->vio.mutex.m_ptr;
+  NetSplicePipe *p = vc->read_splice;
+
+  // If the pipe is full, wait for the write side to drain it. The
+  // consumer reenables us when it gets the WRITE_READY.
+  int64_t toread = p->size - p->avail;
+  if (toread > ntodo)
+    toread = ntodo;
+  if (toread <= 0) {
+    read_disable(nh, vc);
+    return;
+  }
+
+  int64_t r = socketManager.splice(vc->con.fd, p->fd[1], toread, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  NET_DEBUG_COUNT_DYN_STAT(net_calls_to_read_stat, 1);
+
+  if (r <= 0) {
+    if (r == -EAGAIN || r == -ENOTCONN) {
+      NET_DEBUG_COUNT_DYN_STAT(net_calls_to_read_nodata_stat, 1);
+      // A pipe can run out of buffer slots before it is full in bytes,
+      // in which case the socket is still readable and won't trigger
+      // again. Keep the trigger and retry once the pipe is drained.
+      if (p->avail > 0) {
+        read_disable(nh, vc);
+        return;
+      }
+      vc->read.triggered = 0;
+      nh->read_ready_list.remove(vc);
+      return;
+    }
+    // Not every descriptor can be spliced from. If nothing went into the
+    // pipe yet, drop it and read into the buffer instead; the write side
+    // lets go of the pipe once it sees it empty and unreferenced.
+    if ((r == -EINVAL || r == -ENOSYS) && p->avail == 0) {
+      Debug("iocore_net", "read_splice_from_net: fd %d can't be spliced (%d), using the buffer", vc->con.fd, (int)-r);
+      splice_pipe_release(vc->read_splice);
+      read_reschedule(nh, vc);
+      return;
+    }
+
+    if (!r || r == -ECONNRESET) {
+      vc->read.triggered = 0;
+      nh->read_ready_list.remove(vc);
+      splice_pipe_release(vc->read_splice);
+      read_signal_done(VC_EVENT_EOS, nh, vc);
+      return;
+    }
+    vc->read.triggered = 0;
+    splice_pipe_release(vc->read_splice);
+    read_signal_error(nh, vc, (int)-r);
+    return;
+  }
+  NET_SUM_DYN_STAT(net_read_bytes_stat, r);
+
+  ink_atomic_increment64(&p->avail, r);
+  s->vio.ndone += r;
+  net_activity(vc, thread);
+
+  if (s->vio.ntodo() <= 0) {
+    splice_pipe_release(vc->read_splice);
+    read_signal_done(VC_EVENT_READ_COMPLETE, nh, vc);
+    return;
+  }
+  if (read_signal_and_update(VC_EVENT_READ_READY, vc) != EVENT_CONT)
+    return;
+  // change of lock... don't look at shared variables!
+  if (vio_mutex != s->vio.mutex.m_ptr) {
+    read_reschedule(nh, vc);
+    return;
+  }
+
+  p = vc->read_splice;
+  if (s->vio.ntodo() <= 0 || !s->enabled || (p && p->avail >= p->size)) {
+    read_disable(nh, vc);
+    return;
+  }
+  read_reschedule(nh, vc);
+}
+#endif
+
 // Read the data for a UnixNetVConnection.
 // Rescheduling the UnixNetVConnection by moving the VC
 // onto or off of the ready_list.
@@ -309,6 +440,17 @@ read_from_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
     read_disable(nh, vc);
     return;
   }
+#if TS_HAS_SPLICE
+  if (vc->read_splice) {
+    if (vc->read_splice->refcount > 1) {
+      read_splice_from_net(nh, vc, thread, ntodo);
+      return;
+    }
+    // the write side went away, fall back to the buffer
+    splice_pipe_release(vc->read_splice);
+  }
+#endif
+
   int64_t toread = buf.writer()->write_avail();
   if (toread > ntodo)
     toread = ntodo;
@@ -429,6 +571,91 @@ read_from_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
 }
 
 
+#if TS_HAS_SPLICE
+// Write the contents of the splice pipe of the VC to the network.
+// Mirrors write_to_net_io, with the pipe in place of the VIO buffer.
+static void
+write_splice_to_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread, int64_t ntodo)
+{
+  NetState *s = &vc->write;
+  ProxyMutex *mutex = thread->mutex;
+  ProxyMutex *vio_mutex = s->vio.mutex.m_ptr;
+  NetSplicePipe *p = vc->write_splice;
+  int signalled = 0;
+
+  int64_t towrite = p->avail;
+  if (towrite > ntodo)
+    towrite = ntodo;
+
+  // signal write ready to let the producer refill the pipe
+  if (towrite <= 0) {
+    if (write_signal_and_update(VC_EVENT_WRITE_READY, vc) != EVENT_CONT)
+      return;
+    if (vio_mutex != s->vio.mutex.m_ptr || !vc->write_splice) {
+      write_reschedule(nh, vc);
+      return;
+    }
+    signalled = 1;
+    p = vc->write_splice;
+    ntodo = s->vio.ntodo();
+    towrite = p->avail;
+    if (towrite > ntodo)
+      towrite = ntodo;
+    if (towrite <= 0) {
+      write_disable(nh, vc);
+      return;
+    }
+  }
+
+  int64_t r = socketManager.splice(p->fd[0], vc->con.fd, towrite, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  NET_DEBUG_COUNT_DYN_STAT(net_calls_to_write_stat, 1);
+
+  if (r <= 0) {
+    if (r == -EAGAIN || r == -ENOTCONN) {
+      NET_DEBUG_COUNT_DYN_STAT(net_calls_to_write_nodata_stat, 1);
+      vc->write.triggered = 0;
+      nh->write_ready_list.remove(vc);
+      return;
+    }
+    if (!r || r == -ECONNRESET) {
+      vc->write.triggered = 0;
+      write_signal_done(VC_EVENT_EOS, nh, vc);
+      return;
+    }
+    vc->write.triggered = 0;
+    write_signal_error(nh, vc, (int)-r);
+    return;
+  }
+  NET_SUM_DYN_STAT(net_write_bytes_stat, r);
+  NET_SUM_DYN_STAT(net_splice_bytes_stat, r);
+
+  ink_atomic_increment64(&p->avail, -r);
+  s->vio.ndone += r;
+  net_activity(vc, thread);
+
+  if (s->vio.ntodo() <= 0) {
+    splice_pipe_release(vc->write_splice);
+    write_signal_done(VC_EVENT_WRITE_COMPLETE, nh, vc);
+    return;
+  } else if (!signalled) {
+    if (write_signal_and_update(VC_EVENT_WRITE_READY, vc) != EVENT_CONT)
+      return;
+    // change of lock... don't look at shared variables!
+    if (vio_mutex != s->vio.mutex.m_ptr) {
+      write_reschedule(nh, vc);
+      return;
+    }
+  }
+
+  p = vc->write_splice;
+  if (p && (s->vio.ntodo() <= 0 || p->avail <= 0)) {
+    write_disable(nh, vc);
+    return;
+  }
+  write_reschedule(nh, vc);
+}
+#endif
+
 //
 // Write the data for a UnixNetVConnection.
 // Rescheduling the UnixNetVConnection when necessary.
@@ -501,6 +728,18 @@ write_to_net_io(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
   MIOBufferAccessor & buf = s->vio.buffer;
   ink_debug_assert(buf.writer());
 
+#if TS_HAS_SPLICE
+  // A spliced VC writes out its buffer first, then continues from the pipe.
+  // An empty pipe the read side let go of means it fell back to the buffer.
+  if (vc->write_splice && !buf.reader()->read_avail()) {
+    if (vc->write_splice->refcount > 1 || vc->write_splice->avail > 0) {
+      write_splice_to_net(nh, vc, thread, ntodo);
+      return;
+    }
+    splice_pipe_release(vc->write_splice);
+  }
+#endif
+
   // Calculate amount to write
   int64_t towrite = buf.reader()->read_avail();
   if (towrite > ntodo)
@@ -628,6 +867,7 @@ VIO *
 UnixNetVConnection::do_io_read(Continuation *c, int64_t nbytes, MIOBuffer *buf)
 {
   ink_assert(!closed);
+  splice_pipe_release(read_splice);
   read.vio.op = VIO::READ;
   read.vio.mutex = c->mutex;
   read.vio._cont = c;
@@ -649,6 +889,7 @@ VIO *
 UnixNetVConnection::do_io_write(Continuation *c, int64_t nbytes, IOBufferReader *reader, bool owner)
 {
   ink_assert(!closed);
+  splice_pipe_release(write_splice);
   write.vio.op = VIO::WRITE;
   write.vio.mutex = c->mutex;
   write.vio._cont = c;
@@ -677,6 +918,8 @@ UnixNetVConnection::do_io_close(int alerrno /* = -1 */ )
   write.vio.buffer.clear();
   write.vio.nbytes = 0;
   write.vio.op = VIO::NONE;
+  splice_pipe_release(read_splice);
+  splice_pipe_release(write_splice);
 
   EThread *t = this_ethread();
   bool close_inline = !recursion && nh->mutex->thread_holding == t;
@@ -703,6 +946,7 @@ UnixNetVConnection::do_io_shutdown(ShutdownHowTo_t howto)
     disable_read(this);
     read.vio.buffer.clear();
     read.vio.nbytes = 0;
+    splice_pipe_release(read_splice);
     f.shutdown = NET_VC_SHUTDOWN_READ;
     break;
   case IO_SHUTDOWN_WRITE:
@@ -711,6 +955,7 @@ UnixNetVConnection::do_io_shutdown(ShutdownHowTo_t howto)
     disable_write(this);
     write.vio.buffer.clear();
     write.vio.nbytes = 0;
+    splice_pipe_release(write_splice);
     f.shutdown = NET_VC_SHUTDOWN_WRITE;
     break;
   case IO_SHUTDOWN_READWRITE:
@@ -723,6 +968,8 @@ UnixNetVConnection::do_io_shutdown(ShutdownHowTo_t howto)
     read.vio.nbytes = 0;
     write.vio.buffer.clear();
     write.vio.nbytes = 0;
+    splice_pipe_release(read_splice);
+    splice_pipe_release(write_splice);
     f.shutdown = NET_VC_SHUTDOWN_READ | NET_VC_SHUTDOWN_WRITE;
     break;
   default:
@@ -757,6 +1004,33 @@ UnixNetVConnection::cancel_OOB()
   }
 }
 
+bool
+UnixNetVConnection::splice_to(NetVConnection *dst)
+{
+#if TS_HAS_SPLICE
+  UnixNetVConnection *udst = dynamic_cast<UnixNetVConnection *>(dst);
+
+  // SSL has to see the bytes and flow control meters them through the
+  // buffers, neither works with a pipe.
+  if (!udst || udst == this || dynamic_cast<SSLNetVConnection *>(this) || dynamic_cast<SSLNetVConnection *>(udst) ||
+      read.vio.op != VIO::READ || udst->write.vio.op != VIO::WRITE || read_fct.bps_max || udst->write_fct.bps_max ||
+      read_splice || udst->write_splice)
+    return false;
+
+  NetSplicePipe *p = splice_pipe_create();
+  if (!p)
+    return false;
+
+  read_splice = p;
+  udst->write_splice = p;
+  Debug("iocore_net", "splice_to: fd %d -> fd %d, pipe size %" PRId64, con.fd, udst->con.fd, p->size);
+  return true;
+#else
+  NOWARN_UNUSED(dst);
+  return false;
+#endif
+}
+
 Action *
 UnixNetVConnection::send_OOB(Continuation *cont, char *buf, int len)
 {
@@ -894,7 +1168,7 @@ UnixNetVConnection::UnixNetVConnection()
 #endif
     active_timeout(NULL), nh(NULL),
     id(0), flags(0), recursion(0), submit_time(0), oob_ptr(0),
-    from_accept_thread(false), pt(PROBE_NONE)
+    from_accept_thread(false), pt(PROBE_NONE), read_splice(NULL), write_splice(NULL)
 {
   memset(&local_addr, 0, sizeof local_addr);
   memset(&server_addr, 0, sizeof server_addr);
@@ -1275,6 +1549,7 @@ UnixNetVConnection::free(EThread *t)
   ink_debug_assert(!link.next && !link.prev);
   ink_debug_assert(!active_timeout);
   ink_debug_assert(con.fd == NO_FD);
+  ink_debug_assert(!read_splice && !write_splice);
   ink_debug_assert(t == this_ethread());
 
   if (from_accept_thread) {
@@ -1289,3 +1564,288 @@ UnixNetVConnection::apply_options()
 {
   con.apply_options(options);
 }
+
+#if TS_HAS_TESTS && TS_HAS_SPLICE
+#include <sys/eventfd.h>
+#include "ts/TestBox.h"
+
+#define SPLICE_TEST_BYTES (1024 * 1024)
+#define SPLICE_TEST_EVENTFD_VALUE 0x0102030405060708ULL
+
+// A connected TCP pair over loopback, both ends non-blocking. fd[0] is
+// for a VC, the test reads and writes fd[1].
+static bool
+splice_test_tcp_pair(int fd[2])
+{
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  int lfd = socket(AF_INET, SOCK_STREAM, 0);
+  bool ok = false;
+
+  fd[0] = fd[1] = -1;
+  if (lfd < 0)
+    return false;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(lfd, (struct sockaddr *) &addr, sizeof(addr)) == 0 && listen(lfd, 1) == 0 &&
+      getsockname(lfd, (struct sockaddr *) &addr, &len) == 0 && (fd[1] = socket(AF_INET, SOCK_STREAM, 0)) >= 0 &&
+      connect(fd[1], (struct sockaddr *) &addr, sizeof(addr)) == 0 && (fd[0] = accept(lfd, NULL, NULL)) >= 0) {
+    fcntl(fd[0], F_SETFL, O_NONBLOCK);
+    fcntl(fd[1], F_SETFL, O_NONBLOCK);
+    ok = true;
+  } else {
+    if (fd[1] >= 0)
+      close(fd[1]);
+    fd[0] = fd[1] = -1;
+  }
+  close(lfd);
+  return ok;
+}
+
+// Hand an open descriptor to the net threads as if it had been accepted.
+static void
+splice_test_vc(Continuation *cont, int fd)
+{
+  UnixNetVConnection *vc = netVCAllocator.alloc();
+
+  NET_SUM_GLOBAL_DYN_STAT(net_connections_currently_open_stat, 1);
+  vc->from_accept_thread = true;
+  vc->id = net_next_connection_number();
+  vc->submit_time = ink_get_hrtime();
+  vc->con.fd = fd;
+  vc->mutex = new_ProxyMutex();
+  vc->action_ = cont;
+  vc->closed = 0;
+  SET_CONTINUATION_HANDLER(vc, (NetVConnHandler) & UnixNetVConnection::acceptEvent);
+  eventProcessor.schedule_imm(vc, ET_NET);
+}
+
+// Copies from one VC to another the way HttpTunnel does, with the read
+// side spliced into the write side. The first run reads a TCP socket and
+// has to go through the pipe. The second reads an eventfd, which the
+// kernel refuses to splice from, and has to fall back to the buffer.
+struct NetSpliceTest:public Continuation
+{
+  RegressionTest *t;
+  int *pstatus;
+  bool fallback;
+  bool expect_fallback;
+  int source[2];
+  int sink[2];
+  UnixNetVConnection *rvc, *wvc;
+  MIOBuffer *buf;
+  VIO *rvio, *wvio;
+  bool spliced, saw_pipe, saw_buffer;
+  int64_t total, sent, received, mismatched;
+  ink_hrtime start;
+  bool finished;
+
+  NetSpliceTest(RegressionTest *at, int *apstatus)
+    : Continuation(new_ProxyMutex()), t(at), pstatus(apstatus), fallback(false), expect_fallback(false), finished(false)
+  {
+    SET_HANDLER(&NetSpliceTest::mainEvent);
+  }
+
+  char expected(int64_t i)
+  {
+    uint64_t value = SPLICE_TEST_EVENTFD_VALUE;
+    return fallback ? ((char *) &value)[i] : (char) (i % 251);
+  }
+
+  void check(bool ok, const char *what)
+  {
+    if (!ok) {
+      rprintf(t, "%s: %s\n", fallback ? "eventfd" : "tcp", what);
+      *pstatus = REGRESSION_TEST_FAILED;
+    }
+  }
+
+  bool start_run()
+  {
+    rvc = wvc = NULL;
+    buf = NULL;
+    rvio = wvio = NULL;
+    spliced = saw_pipe = saw_buffer = false;
+    sent = received = mismatched = 0;
+    start = ink_get_hrtime();
+    if (!splice_test_tcp_pair(sink))
+      return false;
+    if (fallback) {
+      source[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      source[1] = -1;
+      total = sizeof(uint64_t);
+    } else {
+      if (!splice_test_tcp_pair(source))
+        source[0] = -1;
+      total = SPLICE_TEST_BYTES;
+    }
+    if (source[0] < 0) {
+      close(sink[0]);
+      close(sink[1]);
+      return false;
+    }
+    // the VCs are set up one after the other from the accept events
+    splice_test_vc(this, source[0]);
+    return true;
+  }
+
+  void start_io()
+  {
+    buf = new_MIOBuffer();
+    IOBufferReader *reader = buf->alloc_reader();
+
+    rvio = rvc->do_io_read(this, INT64_MAX, buf);
+    wvio = wvc->do_io_write(this, total, reader);
+    spliced = rvc->splice_to(wvc);
+    check(spliced, "the connections were not spliced");
+    if (fallback) {
+      uint64_t value = SPLICE_TEST_EVENTFD_VALUE;
+      check(write(source[0], &value, sizeof(value)) == sizeof(value), "could not write the eventfd");
+      sent = total;
+    }
+  }
+
+  void step()
+  {
+    char data[32768];
+    int64_t n;
+
+    if (!wvio)
+      return;
+    while (sent < total) {
+      for (n = 0; n < (int64_t) sizeof(data) && sent + n < total; ++n)
+        data[n] = expected(sent + n);
+      if ((n = write(source[1], data, n)) <= 0)
+        break;
+      sent += n;
+    }
+    while ((n = read(sink[1], data, sizeof(data))) > 0) {
+      for (int64_t i = 0; i < n && received + i < total; ++i)
+        mismatched += data[i] != expected(received + i);
+      received += n;
+    }
+    if (received >= total)
+      end_run();
+  }
+
+  void end_run()
+  {
+    rprintf(t, "%s: %" PRId64 " bytes through the %s\n", fallback ? "eventfd" : "tcp", received,
+            saw_pipe ? "pipe" : "buffer");
+    check(received == total && !mismatched, "the data did not arrive intact");
+    if (expect_fallback)
+      check(!saw_pipe && saw_buffer, "did not fall back to the buffer");
+    else if (!fallback)
+      check(saw_pipe && !saw_buffer, "did not go through the pipe");
+
+    if (rvc)
+      rvc->do_io_close();
+    if (wvc)
+      wvc->do_io_close();
+    if (buf)
+      free_MIOBuffer(buf);
+    if (source[1] >= 0)
+      close(source[1]);
+    close(sink[1]);
+
+    if (fallback) {
+      finished = true;
+      return;
+    }
+    fallback = true;
+    expect_fallback = eventfd_unspliceable();
+    if (!expect_fallback)
+      rprintf(t, "this kernel splices from an eventfd, the fallback is not exercised\n");
+    if (!start_run()) {
+      check(false, "could not set up the connections");
+      finished = true;
+    }
+  }
+
+  // Whether the kernel refuses to splice from an eventfd, as it does
+  // since 5.10 (no generic splice_read any more).
+  static bool eventfd_unspliceable()
+  {
+    int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int pfd[2];
+    bool refused = false;
+
+    if (efd < 0)
+      return false;
+    if (pipe2(pfd, O_NONBLOCK | O_CLOEXEC) == 0) {
+      refused = socketManager.splice(efd, pfd[1], sizeof(uint64_t), SPLICE_F_NONBLOCK) == -EINVAL;
+      close(pfd[0]);
+      close(pfd[1]);
+    }
+    close(efd);
+    return refused;
+  }
+
+  int mainEvent(int event, void *data)
+  {
+    switch (event) {
+    case NET_EVENT_ACCEPT: {
+      // called from the net thread without our lock
+      MUTEX_LOCK(lock, mutex, this_ethread());
+      if (!rvc) {
+        rvc = (UnixNetVConnection *) data;
+        splice_test_vc(this, sink[0]);
+      } else {
+        wvc = (UnixNetVConnection *) data;
+        start_io();
+      }
+      return EVENT_DONE;
+    }
+    case VC_EVENT_READ_READY:
+    case VC_EVENT_READ_COMPLETE:
+      // the pipe is still there while the read side uses it
+      if (rvc->read_splice)
+        saw_pipe = true;
+      else
+        saw_buffer = true;
+      wvio->reenable();
+      return EVENT_CONT;
+    case VC_EVENT_WRITE_READY:
+      rvio->reenable();
+      return EVENT_CONT;
+    case VC_EVENT_WRITE_COMPLETE:
+      return EVENT_CONT;
+    case VC_EVENT_EOS:
+    case VC_EVENT_ERROR:
+      check(false, data == rvio ? "the read side failed" : "the write side failed");
+      end_run();
+      return EVENT_CONT;
+    }
+
+    if (finished) {
+      if (*pstatus == REGRESSION_TEST_INPROGRESS)
+        *pstatus = REGRESSION_TEST_PASSED;
+      ((Event *) data)->cancel();
+      delete this;
+      return EVENT_DONE;
+    }
+    step();
+    if (!finished && wvio && ink_get_hrtime() - start > HRTIME_SECONDS(10)) {
+      check(false, "timed out");
+      end_run();
+    }
+    return EVENT_CONT;
+  }
+};
+
+EXCLUSIVE_REGRESSION_TEST(UnixNetVConnection_Splice)(RegressionTest * t, int atype, int * pstatus)
+{
+  NOWARN_UNUSED(atype);
+  NetSpliceTest *test = new NetSpliceTest(t, pstatus);
+
+  if (!test->start_run()) {
+    rprintf(t, "could not set up the connections\n");
+    *pstatus = REGRESSION_TEST_FAILED;
+    delete test;
+    return;
+  }
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+  eventProcessor.schedule_every(test, HRTIME_MSECONDS(10), ET_CALL);
+}
+#endif /* TS_HAS_TESTS && TS_HAS_SPLICE */
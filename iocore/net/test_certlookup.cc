@@ -34,6 +34,18 @@ make_endpoint(const char * address)
   return ip;
 }
 
+// Look up a context and drop the reference the lookup took for us. The
+// lookup holds its own, so the pointer stays good for comparing.
+template <typename Key> static SSL_CTX *
+find_context(const SSLCertLookup& lookup, const Key& key)
+{
+  SSL_CTX * ctx = lookup.findInfoInHash(key);
+
+  if (ctx) {
+    SSL_CTX_free(ctx);
+  }
+  return ctx;
+}
 
 REGRESSION_TEST(SSLCertificateLookup)(RegressionTest* t, int atype, int * pstatus)
 {
@@ -65,18 +77,121 @@ REGRESSION_TEST(SSLCertificateLookup)(RegressionTest* t, int atype, int * pstatu
   lookup.insert(b_notwild, "*.b.notwild.com");
 
   // Basic wildcard cases.
-  box.check(lookup.findInfoInHash("a.wild.com") == wild, "wildcard lookup for a.wild.com");
-  box.check(lookup.findInfoInHash("b.wild.com") == wild, "wildcard lookup for b.wild.com");
-  box.check(lookup.findInfoInHash("wild.com") == wild, "wildcard lookup for wild.com");
+  box.check(find_context(lookup, "a.wild.com") == wild, "wildcard lookup for a.wild.com");
+  box.check(find_context(lookup, "b.wild.com") == wild, "wildcard lookup for b.wild.com");
+  box.check(find_context(lookup, "wild.com") == wild, "wildcard lookup for wild.com");
 
   // Verify that wildcard does longest match.
-  box.check(lookup.findInfoInHash("a.notwild.com") == notwild, "wildcard lookup for a.notwild.com");
-  box.check(lookup.findInfoInHash("notwild.com") == notwild, "wildcard lookup for notwild.com");
-  box.check(lookup.findInfoInHash("c.b.notwild.com") == b_notwild, "wildcard lookup for c.b.notwild.com");
+  box.check(find_context(lookup, "a.notwild.com") == notwild, "wildcard lookup for a.notwild.com");
+  box.check(find_context(lookup, "notwild.com") == notwild, "wildcard lookup for notwild.com");
+  box.check(find_context(lookup, "c.b.notwild.com") == b_notwild, "wildcard lookup for c.b.notwild.com");
+
+  // Wildcards only match on domain component boundaries.
+  box.check(find_context(lookup, "a.wildcat.com") == NULL, "wildcard lookup for a.wildcat.com");
+  box.check(find_context(lookup, "a.b.wild.com") == wild, "wildcard lookup for a.b.wild.com");
 
   // Basic hostname cases.
-  box.check(lookup.findInfoInHash("www.foo.com") == foo, "host lookup for www.foo.com");
-  box.check(lookup.findInfoInHash("www.bar.com") == NULL, "host lookup for www.bar.com");
+  box.check(find_context(lookup, "www.foo.com") == foo, "host lookup for www.foo.com");
+  box.check(find_context(lookup, "WWW.Foo.com") == foo, "host lookup for WWW.Foo.com");
+  box.check(find_context(lookup, "www.bar.com") == NULL, "host lookup for www.bar.com");
+  box.check(find_context(lookup, "foo.com") == NULL, "host lookup for foo.com");
+
+  // A hostname is more specific than a wildcard.
+  box.check(lookup.insert(foo, "x.wild.com"), "insert host context");
+  box.check(find_context(lookup, "x.wild.com") == foo, "host lookup for x.wild.com");
+  box.check(find_context(lookup, "y.wild.com") == wild, "wildcard lookup for y.wild.com");
+}
+
+struct TestContextLoader : public SSLContextLoader
+{
+  TestContextLoader() : loads(0), unloads(0), hits(0), misses(0) {}
+
+  virtual SSL_CTX * load() { ++loads; return SSL_CTX_new(SSLv23_server_method()); }
+  virtual void unload(SSL_CTX * ctx) { ++unloads; SSL_CTX_free(ctx); }
+  virtual void hit() { ++hits; }
+  virtual void miss() { ++misses; }
+
+  int loads;
+  int unloads;
+  int hits;
+  int misses;
+};
+
+// Loses the race to load its context: another lookup of the same name
+// loads and installs it while the first load is still going.
+struct RacingContextLoader : public TestContextLoader
+{
+  RacingContextLoader(SSLCertLookup * l, const char * n) : lookup(l), name(n), other(NULL) {}
+
+  virtual SSL_CTX * load()
+  {
+    if (loads == 0) {
+      ++loads;
+      other = lookup->findInfoInHash(name);
+      return SSL_CTX_new(SSLv23_server_method());
+    }
+    return TestContextLoader::load();
+  }
+
+  SSLCertLookup * lookup;
+  const char * name;
+  SSL_CTX * other;
+};
+
+REGRESSION_TEST(SSLLazyContextLookup)(RegressionTest* t, int atype, int * pstatus)
+{
+  TestBox       box(t, pstatus);
+  SSLCertLookup lookup;
+  TestContextLoader * a = new TestContextLoader();
+  TestContextLoader * b = new TestContextLoader();
+  SSL_CTX * ctx;
+
+  box = REGRESSION_TEST_PASSED;
+
+  lookup.setContextCacheSize(1);
+  box.check(lookup.insert(a, "a.lazy.com"), "insert lazy context");
+  box.check(lookup.insert(a, "*.a.lazy.com"), "insert lazy wildcard context");
+  box.check(lookup.insert(b, "b.lazy.com"), "insert lazy context");
+  box.check(a->loads == 0 && b->loads == 0, "contexts are not loaded when indexed");
+
+  // Hold on to the context like a handshake would.
+  ctx = lookup.findInfoInHash("a.lazy.com");
+  box.check(ctx != NULL && a->loads == 1 && a->misses == 1, "first lookup loads the context");
+  box.check(find_context(lookup, "www.a.lazy.com") == ctx && a->loads == 1 && a->hits == 1 && a->misses == 1,
+      "names of the same certificate share the context");
+
+  box.check(find_context(lookup, "b.lazy.com") != NULL && b->loads == 1, "first lookup loads the context");
+  box.check(a->unloads == 1, "least recently used context is evicted");
+  box.check(ctx->references == 1, "an evicted context stays alive while a handshake holds it");
+  SSL_CTX_free(ctx);
+
+  box.check(find_context(lookup, "a.lazy.com") != NULL && a->loads == 2, "evicted context is loaded again");
+  box.check(b->unloads == 1, "least recently used context is evicted");
+  box.check(find_context(lookup, "c.lazy.com") == NULL, "host lookup for c.lazy.com");
+}
+
+REGRESSION_TEST(SSLLazyContextRace)(RegressionTest* t, int atype, int * pstatus)
+{
+  TestBox       box(t, pstatus);
+  SSLCertLookup lookup;
+  RacingContextLoader * r = new RacingContextLoader(&lookup, "race.lazy.com");
+  SSL_CTX * ctx;
+
+  box = REGRESSION_TEST_PASSED;
+
+  lookup.setContextCacheSize(1);
+  box.check(lookup.insert(r, "race.lazy.com"), "insert lazy context");
+
+  ctx = lookup.findInfoInHash("race.lazy.com");
+  box.check(ctx != NULL && ctx == r->other, "both lookups get the context that was kept");
+  box.check(r->loads == 2 && r->misses == 1, "only the lookup whose context was kept counts a miss");
+  box.check(ctx != NULL && ctx->references == 3, "the cache and each lookup hold a reference");
+  if (ctx) {
+    SSL_CTX_free(ctx);
+  }
+  if (r->other) {
+    SSL_CTX_free(r->other);
+  }
 }
 
 REGRESSION_TEST(SSLAddressLookup)(RegressionTest* t, int atype, int * pstatus)
@@ -114,20 +229,20 @@ REGRESSION_TEST(SSLAddressLookup)(RegressionTest* t, int atype, int * pstatus)
   // the most specific match (ie. find the context with the port if it is available) ...
 
   box.check(lookup.insert(context.ip6, endpoint.ip6), "insert IPv6 address");
-  box.check(lookup.findInfoInHash(endpoint.ip6) == context.ip6, "IPv6 exact match lookup");
-  box.check(lookup.findInfoInHash(endpoint.ip6p) == context.ip6, "IPv6 exact match lookup w/ port");
+  box.check(find_context(lookup, endpoint.ip6) == context.ip6, "IPv6 exact match lookup");
+  box.check(find_context(lookup, endpoint.ip6p) == context.ip6, "IPv6 exact match lookup w/ port");
 
   box.check(lookup.insert(context.ip6p, endpoint.ip6p), "insert IPv6 address w/ port");
-  box.check(lookup.findInfoInHash(endpoint.ip6) == context.ip6, "IPv6 longest match lookup");
-  box.check(lookup.findInfoInHash(endpoint.ip6p) == context.ip6p, "IPv6 longest match lookup w/ port");
+  box.check(find_context(lookup, endpoint.ip6) == context.ip6, "IPv6 longest match lookup");
+  box.check(find_context(lookup, endpoint.ip6p) == context.ip6p, "IPv6 longest match lookup w/ port");
 
   box.check(lookup.insert(context.ip4, endpoint.ip4), "insert IPv4 address");
-  box.check(lookup.findInfoInHash(endpoint.ip4) == context.ip4, "IPv4 exact match lookup");
-  box.check(lookup.findInfoInHash(endpoint.ip4p) == context.ip4, "IPv4 exact match lookup w/ port");
+  box.check(find_context(lookup, endpoint.ip4) == context.ip4, "IPv4 exact match lookup");
+  box.check(find_context(lookup, endpoint.ip4p) == context.ip4, "IPv4 exact match lookup w/ port");
 
   box.check(lookup.insert(context.ip4p, endpoint.ip4p), "insert IPv4 address w/ port");
-  box.check(lookup.findInfoInHash(endpoint.ip4) == context.ip4, "IPv4 longest match lookup");
-  box.check(lookup.findInfoInHash(endpoint.ip4p) == context.ip4p, "IPv4 longest match lookup w/ port");
+  box.check(find_context(lookup, endpoint.ip4) == context.ip4, "IPv4 longest match lookup");
+  box.check(find_context(lookup, endpoint.ip4p) == context.ip4p, "IPv4 longest match lookup w/ port");
 }
 
 static unsigned
@@ -160,6 +160,50 @@ struct RecRawStatBlock
 };
 
 
+//-------------------------------------------------------------------------
+// RawStat Histograms
+//-------------------------------------------------------------------------
+// Log-linear buckets: values below REC_HISTOGRAM_SUB_BUCKETS have a bucket
+// each, above that every power of two is split into REC_HISTOGRAM_SUB_BUCKETS
+// equal buckets, so a bucket is never wider than 1/8th of its values.
+// Values of 2^REC_HISTOGRAM_MAX_BITS and up all go in the last bucket.
+#define REC_HISTOGRAM_SUB_BITS      3
+#define REC_HISTOGRAM_SUB_BUCKETS   (1 << REC_HISTOGRAM_SUB_BITS)
+#define REC_HISTOGRAM_MAX_BITS      40
+#define REC_HISTOGRAM_BUCKETS       ((REC_HISTOGRAM_MAX_BITS - REC_HISTOGRAM_SUB_BITS + 1) << REC_HISTOGRAM_SUB_BITS)
+// The percentiles are over the values added in the last REC_HISTOGRAM_WINDOW
+// raw stat syncs, a minute with the default 5 second sync interval.
+#define REC_HISTOGRAM_WINDOW        12
+
+// The records derived from each histogram, "<name>.count", "<name>.p50" ...
+enum RecHistogramRecordT
+{
+  REC_HISTOGRAM_COUNT,
+  REC_HISTOGRAM_P50,
+  REC_HISTOGRAM_P90,
+  REC_HISTOGRAM_P99,
+  REC_HISTOGRAM_P999,
+  REC_HISTOGRAM_RECORDS
+};
+
+struct RecRecord;
+
+// WARNING!  As for the RecRawStatBlock, leave the contents alone.
+struct RecRawStatHistogramBlock
+{
+  off_t ethr_stat_offset;   // thread local buckets, REC_HISTOGRAM_BUCKETS per histogram
+  int64_t *global;          // buckets of all threads combined, as of the last sync
+  int64_t *window;          // REC_HISTOGRAM_WINDOW earlier copies of global per histogram, a ring
+  int window_pos;           // the oldest copy in the ring
+  RecRecord **records;      // REC_HISTOGRAM_RECORDS derived records per histogram
+  int num_stats;            // number of histograms in this block
+  int max_stats;            // maximum number of histograms for this block
+  ink_mutex mutex;
+  bool linked;              // on the list of blocks, once a histogram is registered
+  RecRawStatHistogramBlock *next;  // all blocks, for the sync thread
+};
+
+
 //-------------------------------------------------------------------------
 // RecCore Callback Types
 //-------------------------------------------------------------------------
@@ -47,17 +47,37 @@ void RecProcess_set_remote_sync_interval_ms(int ms);
 //-------------------------------------------------------------------------
 RecRawStatBlock *RecAllocateRawStatBlock(int num_stats);
 int RecRegisterRawStat(RecRawStatBlock * rsb, RecT rec_type, const char *name, RecDataT data_type, RecPersistT persist_type, int id, RecRawStatSyncCb sync_cb);
+// Free a block that is no longer used, its records stay registered but are
+// not synced any more. The thread local memory is not given back.
+void RecFreeRawStatBlock(RecRawStatBlock * rsb);
 
-
-// RecRawStatRange* RecAllocateRawStatRange (int num_buckets);
-
-// int RecRegisterRawStatRange (RecRawStatRange *rsr,
-//                           RecT rec_type,
-//                           char *name,
-//                           RecPersistT persist_type,
-//                           int id,
-//                           RecInt min,
-//                           RecInt max);
+//-------------------------------------------------------------------------
+// RawStat Histogram Registration
+//-------------------------------------------------------------------------
+// Each histogram registers the RECD_INT records "<name>.count", "<name>.p50",
+// "<name>.p90", "<name>.p99" and "<name>.p999", updated on every raw stat
+// sync. The count is of all the values ever added, the percentiles only
+// cover those added in the last REC_HISTOGRAM_WINDOW syncs. They are the
+// middle of the bucket they fall in, in the unit the values were added in.
+RecRawStatHistogramBlock *RecAllocateRawStatHistogramBlock(int num_stats);
+int RecRegisterRawStatHistogram(RecRawStatHistogramBlock * rsh, RecT rec_type, const char *name,
+                                RecPersistT persist_type, int id);
+// Free a block none of whose histograms could be registered. The thread
+// local memory is not given back.
+void RecFreeRawStatHistogramBlock(RecRawStatHistogramBlock * rsh);
+
+// Copy the REC_HISTOGRAM_BUCKETS buckets of a histogram, as of the last sync.
+int RecGetRawStatHistogram(RecRawStatHistogramBlock * rsh, int id, int64_t * buckets);
+
+// Call back with the buckets of every registered histogram, as of the last
+// sync. The name is the one the histogram was registered with.
+typedef void (*RecDumpHistogramCb) (void *edata, const char *name, const int64_t * buckets, int num_buckets);
+void RecDumpRawStatHistograms(RecDumpHistogramCb callback, void *edata);
+
+// Bucket math, for readers of the buckets.
+int64_t RecHistogramBucketLow(int bucket);
+int64_t RecHistogramBucketHigh(int bucket);
+int64_t RecHistogramPercentile(const int64_t * buckets, int64_t count, double percentile);
 
 
 //-------------------------------------------------------------------------
@@ -82,6 +102,7 @@ int RecRawStatSyncMHrTimeAvg(const char *name, RecDataT data_type, RecData * dat
 inline int RecIncrRawStat(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t incr = 1);
 inline int RecIncrRawStatSum(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t incr = 1);
 inline int RecIncrRawStatCount(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t incr = 1);
+inline int RecIncrRawStatHistogram(RecRawStatHistogramBlock * rsh, EThread * ethread, int id, int64_t value);
 int RecIncrRawStatBlock(RecRawStatBlock * rsb, EThread * ethread, RecRawStat * stat_array);
 
 int RecSetRawStatSum(RecRawStatBlock * rsb, int id, int64_t data);
@@ -162,4 +183,30 @@ RecIncrRawStatCount(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t in
   return REC_ERR_OKAY;
 }
 
+inline int
+rec_histogram_bucket(int64_t value)
+{
+  if (value < REC_HISTOGRAM_SUB_BUCKETS)
+    return value < 0 ? 0 : (int) value;
+
+  int msb = 63 - __builtin_clzll((uint64_t) value);
+  if (msb >= REC_HISTOGRAM_MAX_BITS)
+    return REC_HISTOGRAM_BUCKETS - 1;
+
+  int shift = msb - REC_HISTOGRAM_SUB_BITS;
+  return ((shift + 1) << REC_HISTOGRAM_SUB_BITS) + (int) ((value >> shift) & (REC_HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+inline int
+RecIncrRawStatHistogram(RecRawStatHistogramBlock * rsh, EThread * ethread, int id, int64_t value)
+{
+  ink_debug_assert((id >= 0) && (id < rsh->max_stats));
+  if (ethread == NULL) {
+    ethread = this_ethread();
+  }
+  int64_t *tlp = ((int64_t *) ((char *) (ethread) + rsh->ethr_stat_offset)) + id * REC_HISTOGRAM_BUCKETS;
+  tlp[rec_histogram_bucket(value)] += 1;
+  return REC_ERR_OKAY;
+}
+
 #endif /* !_I_REC_PROCESS_H_ */
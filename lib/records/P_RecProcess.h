@@ -40,5 +40,6 @@
 int RecRegisterRawStatSyncCb(const char *name, RecRawStatSyncCb sync_cb, RecRawStatBlock * rsb, int id);
 
 int RecExecRawStatSyncCbs();
+int RecExecRawStatHistogramSyncs();
 
 #endif
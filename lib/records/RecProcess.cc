@@ -39,6 +39,11 @@ static EventNotify g_force_req_notify;
 static int g_rec_raw_stat_sync_interval_ms = REC_RAW_STAT_SYNC_INTERVAL_MS;
 static int g_rec_config_update_interval_ms = REC_CONFIG_UPDATE_INTERVAL_MS;
 static int g_rec_remote_sync_interval_ms = REC_REMOTE_SYNC_INTERVAL_MS;
+static RecRawStatHistogramBlock *g_histogram_blocks = NULL;
+static ink_mutex g_histogram_blocks_mutex = INK_MUTEX_INIT;
+
+static const char *g_histogram_record_suffix[REC_HISTOGRAM_RECORDS] = { "count", "p50", "p90", "p99", "p999" };
+static const double g_histogram_record_percentile[REC_HISTOGRAM_RECORDS] = { 0, 50.0, 90.0, 99.0, 99.9 };
 
 //-------------------------------------------------------------------------
 // i_am_the_record_owner, only used for librecprocess.a
@@ -242,6 +247,85 @@ raw_stat_clear_count(RecRawStatBlock *rsb, int id)
 }
 
 
+//-------------------------------------------------------------------------
+// raw_stat_histogram_window
+//-------------------------------------------------------------------------
+// Moves the window of one histogram on by a sync: recent gets the values
+// added since the copy at pos in the ring, which is then replaced by the
+// current buckets. Returns the number of values in recent.
+static int64_t
+raw_stat_histogram_window(const int64_t *global, int64_t *window, int pos, int64_t *recent)
+{
+  int64_t *oldest = window + pos * REC_HISTOGRAM_BUCKETS;
+  int64_t count = 0;
+
+  for (int b = 0; b < REC_HISTOGRAM_BUCKETS; b++) {
+    recent[b] = global[b] - oldest[b];
+    oldest[b] = global[b];
+    count += recent[b];
+  }
+  return count;
+}
+
+//-------------------------------------------------------------------------
+// raw_stat_histogram_sync
+//-------------------------------------------------------------------------
+static void
+raw_stat_histogram_sync(RecRawStatHistogramBlock *rsh)
+{
+  int i, j, b;
+  int64_t *tlp;
+  int64_t recent[REC_HISTOGRAM_BUCKETS];
+
+  for (i = 0; i < rsh->num_stats; i++) {
+    int64_t *global = rsh->global + i * REC_HISTOGRAM_BUCKETS;
+    int64_t *window = rsh->window + i * REC_HISTOGRAM_WINDOW * REC_HISTOGRAM_BUCKETS;
+    int64_t recent_count;
+    RecInt values[REC_HISTOGRAM_RECORDS];
+
+    // lock so readers of the global buckets see them all from the same sync
+    ink_mutex_acquire(&(rsh->mutex));
+    memset(global, 0, REC_HISTOGRAM_BUCKETS * sizeof(int64_t));
+
+    // sum the thread local buckets, the threads only ever add to them
+    for (j = 0; j < eventProcessor.n_ethreads; j++) {
+      tlp = ((int64_t *) ((char *) (eventProcessor.all_ethreads[j]) + rsh->ethr_stat_offset)) + i * REC_HISTOGRAM_BUCKETS;
+      for (b = 0; b < REC_HISTOGRAM_BUCKETS; b++)
+        global[b] += tlp[b];
+    }
+
+    for (j = 0; j < eventProcessor.n_dthreads; j++) {
+      tlp = ((int64_t *) ((char *) (eventProcessor.all_dthreads[j]) + rsh->ethr_stat_offset)) + i * REC_HISTOGRAM_BUCKETS;
+      for (b = 0; b < REC_HISTOGRAM_BUCKETS; b++)
+        global[b] += tlp[b];
+    }
+
+    values[REC_HISTOGRAM_COUNT] = 0;
+    for (b = 0; b < REC_HISTOGRAM_BUCKETS; b++)
+      values[REC_HISTOGRAM_COUNT] += global[b];
+    ink_mutex_release(&(rsh->mutex));
+
+    // the percentiles of the values since the start of the window, only
+    // this thread syncs so the window needs no lock
+    recent_count = raw_stat_histogram_window(global, window, rsh->window_pos, recent);
+    for (j = REC_HISTOGRAM_P50; j < REC_HISTOGRAM_RECORDS; j++)
+      values[j] = RecHistogramPercentile(recent, recent_count, g_histogram_record_percentile[j]);
+
+    for (j = 0; j < REC_HISTOGRAM_RECORDS; j++) {
+      RecRecord *r = rsh->records[i * REC_HISTOGRAM_RECORDS + j];
+
+      if (r == NULL)            // not registered
+        continue;
+      rec_mutex_acquire(&(r->lock));
+      r->data.rec_int = values[j];
+      r->sync_required = REC_SYNC_REQUIRED;
+      rec_mutex_release(&(r->lock));
+    }
+  }
+  rsh->window_pos = (rsh->window_pos + 1) % REC_HISTOGRAM_WINDOW;
+}
+
+
 //-------------------------------------------------------------------------
 // recv_message_cb__process
 //-------------------------------------------------------------------------
@@ -277,6 +361,7 @@ struct raw_stat_sync_cont: public Continuation
     REC_NOWARN_UNUSED(event);
     REC_NOWARN_UNUSED(e);
     while (true) {
+      RecExecRawStatHistogramSyncs();
       RecExecRawStatSyncCbs();
       Debug("statsproc", "raw_stat_sync_cont() processed");
       usleep(g_rec_raw_stat_sync_interval_ms * 1000);
@@ -478,6 +563,36 @@ RecAllocateRawStatBlock(int num_stats)
 }
 
 
+//-------------------------------------------------------------------------
+// RecFreeRawStatBlock
+//-------------------------------------------------------------------------
+void
+RecFreeRawStatBlock(RecRawStatBlock *rsb)
+{
+  RecRecord *r;
+  int i, num_records;
+
+  // stop the syncs of the records registered in it, under the record lock
+  // like RecExecRawStatSyncCbs
+  ink_rwlock_rdlock(&g_records_rwlock);
+  num_records = g_num_records;
+  for (i = 0; i < num_records; i++) {
+    r = &(g_records[i]);
+    rec_mutex_acquire(&(r->lock));
+    if (REC_TYPE_IS_STAT(r->rec_type) && r->stat_meta.sync_rsb == rsb) {
+      r->stat_meta.sync_cb = NULL;
+      r->stat_meta.sync_rsb = NULL;
+    }
+    rec_mutex_release(&(r->lock));
+  }
+  ink_rwlock_unlock(&g_records_rwlock);
+
+  ink_mutex_destroy(&(rsb->mutex));
+  ats_free(rsb->global);
+  ats_free(rsb);
+}
+
+
 //-------------------------------------------------------------------------
 // RecRegisterRawStat
 //-------------------------------------------------------------------------
@@ -521,6 +636,188 @@ Ldone:
 }
 
 
+//-------------------------------------------------------------------------
+// RecAllocateRawStatHistogramBlock
+//-------------------------------------------------------------------------
+RecRawStatHistogramBlock *
+RecAllocateRawStatHistogramBlock(int num_stats)
+{
+  off_t ethr_stat_offset;
+  RecRawStatHistogramBlock *rsh;
+
+  // allocate thread-local bucket memory
+  if ((ethr_stat_offset = eventProcessor.allocate(num_stats * REC_HISTOGRAM_BUCKETS * sizeof(int64_t))) == -1) {
+    return NULL;
+  }
+  // create the histogram-block structure
+  rsh = (RecRawStatHistogramBlock *)ats_malloc(sizeof(RecRawStatHistogramBlock));
+  memset(rsh, 0, sizeof(RecRawStatHistogramBlock));
+  rsh->ethr_stat_offset = ethr_stat_offset;
+  rsh->global = (int64_t *)ats_malloc(num_stats * REC_HISTOGRAM_BUCKETS * sizeof(int64_t));
+  memset(rsh->global, 0, num_stats * REC_HISTOGRAM_BUCKETS * sizeof(int64_t));
+  rsh->window = (int64_t *)ats_malloc(num_stats * REC_HISTOGRAM_WINDOW * REC_HISTOGRAM_BUCKETS * sizeof(int64_t));
+  memset(rsh->window, 0, num_stats * REC_HISTOGRAM_WINDOW * REC_HISTOGRAM_BUCKETS * sizeof(int64_t));
+  rsh->records = (RecRecord **)ats_malloc(num_stats * REC_HISTOGRAM_RECORDS * sizeof(RecRecord *));
+  memset(rsh->records, 0, num_stats * REC_HISTOGRAM_RECORDS * sizeof(RecRecord *));
+  rsh->num_stats = num_stats;
+  rsh->max_stats = num_stats;
+  ink_mutex_init(&(rsh->mutex), "histogram stat mutex");
+  return rsh;
+}
+
+
+//-------------------------------------------------------------------------
+// RecRegisterRawStatHistogram
+//-------------------------------------------------------------------------
+int
+RecRegisterRawStatHistogram(RecRawStatHistogramBlock *rsh, RecT rec_type, const char *name, RecPersistT persist_type,
+                            int id)
+{
+  Debug("stats", "RecRegisterRawStatHistogram(%s): rsh pointer:%p id:%d\n", name, rsh, id);
+
+  // check to see if we're good to proceed
+  ink_debug_assert(id < rsh->max_stats);
+
+  char rec_name[256];
+  RecRecord *r;
+  RecData data_default;
+  memset(&data_default, 0, sizeof(RecData));
+
+  for (int i = 0; i < REC_HISTOGRAM_RECORDS; i++) {
+    snprintf(rec_name, sizeof(rec_name), "%s.%s", name, g_histogram_record_suffix[i]);
+    if ((r = RecRegisterStat(rec_type, rec_name, RECD_INT, data_default, persist_type)) == NULL) {
+      return REC_ERR_FAIL;
+    }
+    if (i_am_the_record_owner(r->rec_type)) {
+      r->sync_required = r->sync_required | REC_PEER_SYNC_REQUIRED;
+    } else {
+      send_register_message(r);
+    }
+    rsh->records[id * REC_HISTOGRAM_RECORDS + i] = r;
+  }
+
+  // only now is the block synced, until then it can be freed
+  ink_mutex_acquire(&g_histogram_blocks_mutex);
+  if (!rsh->linked) {
+    rsh->next = g_histogram_blocks;
+    g_histogram_blocks = rsh;
+    rsh->linked = true;
+  }
+  ink_mutex_release(&g_histogram_blocks_mutex);
+
+  return REC_ERR_OKAY;
+}
+
+
+//-------------------------------------------------------------------------
+// RecFreeRawStatHistogramBlock
+//-------------------------------------------------------------------------
+void
+RecFreeRawStatHistogramBlock(RecRawStatHistogramBlock *rsh)
+{
+  // the sync thread walks the list without the lock
+  ink_release_assert(!rsh->linked);
+
+  ink_mutex_destroy(&(rsh->mutex));
+  ats_free(rsh->global);
+  ats_free(rsh->window);
+  ats_free(rsh->records);
+  ats_free(rsh);
+}
+
+
+//-------------------------------------------------------------------------
+// RecGetRawStatHistogram
+//-------------------------------------------------------------------------
+int
+RecGetRawStatHistogram(RecRawStatHistogramBlock *rsh, int id, int64_t *buckets)
+{
+  ink_mutex_acquire(&(rsh->mutex));
+  memcpy(buckets, rsh->global + id * REC_HISTOGRAM_BUCKETS, REC_HISTOGRAM_BUCKETS * sizeof(int64_t));
+  ink_mutex_release(&(rsh->mutex));
+  return REC_ERR_OKAY;
+}
+
+
+//-------------------------------------------------------------------------
+// RecDumpRawStatHistograms
+//-------------------------------------------------------------------------
+void
+RecDumpRawStatHistograms(RecDumpHistogramCb callback, void *edata)
+{
+  RecRawStatHistogramBlock *rsh;
+  int64_t buckets[REC_HISTOGRAM_BUCKETS];
+  char name[256];
+
+  ink_mutex_acquire(&g_histogram_blocks_mutex);
+  rsh = g_histogram_blocks;
+  ink_mutex_release(&g_histogram_blocks_mutex);
+
+  for (; rsh != NULL; rsh = rsh->next) {
+    for (int i = 0; i < rsh->num_stats; i++) {
+      RecRecord *r = rsh->records[i * REC_HISTOGRAM_RECORDS + REC_HISTOGRAM_COUNT];
+
+      if (r == NULL)            // not registered
+        continue;
+      // the histogram name is the count record's, less ".count"
+      int len = strlen(r->name) - strlen(g_histogram_record_suffix[REC_HISTOGRAM_COUNT]) - 1;
+      if (len <= 0 || len >= (int) sizeof(name))
+        continue;
+      memcpy(name, r->name, len);
+      name[len] = '\0';
+
+      RecGetRawStatHistogram(rsh, i, buckets);
+      callback(edata, name, buckets, REC_HISTOGRAM_BUCKETS);
+    }
+  }
+}
+
+
+//-------------------------------------------------------------------------
+// RecHistogramBucketXXX
+//-------------------------------------------------------------------------
+int64_t
+RecHistogramBucketLow(int bucket)
+{
+  if (bucket < REC_HISTOGRAM_SUB_BUCKETS)
+    return bucket;
+
+  int shift = (bucket >> REC_HISTOGRAM_SUB_BITS) - 1;
+  return (int64_t) (REC_HISTOGRAM_SUB_BUCKETS + (bucket & (REC_HISTOGRAM_SUB_BUCKETS - 1))) << shift;
+}
+
+int64_t
+RecHistogramBucketHigh(int bucket)
+{
+  if (bucket >= REC_HISTOGRAM_BUCKETS - 1)
+    return INT64_MAX;
+  return RecHistogramBucketLow(bucket + 1) - 1;
+}
+
+int64_t
+RecHistogramPercentile(const int64_t *buckets, int64_t count, double percentile)
+{
+  int64_t rank, seen = 0;
+  int b;
+
+  if (count <= 0)
+    return 0;
+
+  // the smallest value with at least percentile % of them at or below it
+  rank = (int64_t) ceil(count * percentile / 100.0);
+  if (rank < 1)
+    rank = 1;
+  for (b = 0; b < REC_HISTOGRAM_BUCKETS - 1; b++) {
+    seen += buckets[b];
+    if (seen >= rank)
+      break;
+  }
+  if (b == REC_HISTOGRAM_BUCKETS - 1)   // open ended
+    return RecHistogramBucketLow(b);
+  return (RecHistogramBucketLow(b) + RecHistogramBucketHigh(b)) / 2;
+}
+
+
 //-------------------------------------------------------------------------
 // RecRawStatSync...
 //-------------------------------------------------------------------------
@@ -841,3 +1138,148 @@ RecExecRawStatSyncCbs()
 
   return REC_ERR_OKAY;
 }
+
+
+//-------------------------------------------------------------------------
+// RecExecRawStatHistogramSyncs
+//-------------------------------------------------------------------------
+int
+RecExecRawStatHistogramSyncs()
+{
+  RecRawStatHistogramBlock *rsh;
+
+  ink_mutex_acquire(&g_histogram_blocks_mutex);
+  rsh = g_histogram_blocks;
+  ink_mutex_release(&g_histogram_blocks_mutex);
+
+  // blocks are only ever added at the head, so the rest of the list is stable
+  for (; rsh != NULL; rsh = rsh->next)
+    raw_stat_histogram_sync(rsh);
+
+  return REC_ERR_OKAY;
+}
+
+
+#if TS_HAS_TESTS
+#include "ts/TestBox.h"
+
+REGRESSION_TEST(RecHistogram_Buckets)(RegressionTest *t, int atype, int *pstatus)
+{
+  REC_NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  static const struct
+  {
+    int64_t value;
+    int bucket;
+  } values[] = {
+    { -5, 0 }, { 0, 0 }, { 7, 7 }, { 8, 8 }, { 15, 15 }, { 16, 16 }, { 17, 16 }, { 18, 17 },
+    { 31, 23 }, { 32, 24 }, { 1000, 63 }, { (1LL << 40) - 1, REC_HISTOGRAM_BUCKETS - 1 },
+    { 1LL << 40, REC_HISTOGRAM_BUCKETS - 1 }, { INT64_MAX, REC_HISTOGRAM_BUCKETS - 1 }
+  };
+
+  box = REGRESSION_TEST_PASSED;
+
+  for (unsigned i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    box.check(rec_histogram_bucket(values[i].value) == values[i].bucket, "%" PRId64 " is in bucket %d, expected %d",
+              values[i].value, rec_histogram_bucket(values[i].value), values[i].bucket);
+
+  box.check(RecHistogramBucketLow(16) == 16 && RecHistogramBucketHigh(16) == 17, "bucket 16 is not [16, 17]");
+  box.check(RecHistogramBucketLow(63) == 960 && RecHistogramBucketHigh(63) == 1023, "bucket 63 is not [960, 1023]");
+  box.check(RecHistogramBucketHigh(REC_HISTOGRAM_BUCKETS - 1) == INT64_MAX, "the last bucket is not open ended");
+
+  // the buckets cover every value once, and each holds its own bounds
+  box.check(RecHistogramBucketLow(0) == 0, "the first bucket does not start at 0");
+  for (int b = 0; b < REC_HISTOGRAM_BUCKETS - 1; b++) {
+    box.check(RecHistogramBucketLow(b + 1) == RecHistogramBucketHigh(b) + 1, "bucket %d and %d are not adjacent", b, b + 1);
+    box.check(rec_histogram_bucket(RecHistogramBucketLow(b)) == b && rec_histogram_bucket(RecHistogramBucketHigh(b)) == b,
+              "the bounds of bucket %d are not in it", b);
+    box.check(b < REC_HISTOGRAM_SUB_BUCKETS ||
+              (RecHistogramBucketHigh(b) - RecHistogramBucketLow(b) + 1) * REC_HISTOGRAM_SUB_BUCKETS <= RecHistogramBucketLow(b),
+              "bucket %d is wider than 1/%d of its values", b, REC_HISTOGRAM_SUB_BUCKETS);
+  }
+}
+
+REGRESSION_TEST(RecHistogram_Percentile)(RegressionTest *t, int atype, int *pstatus)
+{
+  REC_NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  int64_t buckets[REC_HISTOGRAM_BUCKETS];
+  int64_t v;
+
+  box = REGRESSION_TEST_PASSED;
+
+  // 1 to 100, the percentiles are the middle of the bucket of the exact one
+  memset(buckets, 0, sizeof(buckets));
+  for (v = 1; v <= 100; v++)
+    buckets[rec_histogram_bucket(v)]++;
+  box.check(RecHistogramPercentile(buckets, 100, 0.0) == 1, "p0 is %" PRId64 ", expected 1",
+            RecHistogramPercentile(buckets, 100, 0.0));
+  box.check(RecHistogramPercentile(buckets, 100, 50.0) == 49, "p50 is %" PRId64 ", expected 49",
+            RecHistogramPercentile(buckets, 100, 50.0));
+  box.check(RecHistogramPercentile(buckets, 100, 90.0) == 91, "p90 is %" PRId64 ", expected 91",
+            RecHistogramPercentile(buckets, 100, 90.0));
+  box.check(RecHistogramPercentile(buckets, 100, 99.0) == 99, "p99 is %" PRId64 ", expected 99",
+            RecHistogramPercentile(buckets, 100, 99.0));
+  box.check(RecHistogramPercentile(buckets, 100, 99.9) == 99, "p999 is %" PRId64 ", expected 99",
+            RecHistogramPercentile(buckets, 100, 99.9));
+  box.check(RecHistogramPercentile(buckets, 0, 50.0) == 0, "the percentile of no values is not 0");
+
+  // 999 fast values and one slow one, only p999 sees it
+  memset(buckets, 0, sizeof(buckets));
+  buckets[rec_histogram_bucket(10)] = 999;
+  buckets[rec_histogram_bucket(5000)] = 1;
+  box.check(RecHistogramPercentile(buckets, 1000, 99.0) == 10, "p99 is %" PRId64 ", expected 10",
+            RecHistogramPercentile(buckets, 1000, 99.0));
+  v = RecHistogramPercentile(buckets, 1000, 99.9);
+  box.check(v == 10, "p999 is %" PRId64 ", expected 10", v);
+  v = RecHistogramPercentile(buckets, 1000, 100.0);
+  box.check(v >= RecHistogramBucketLow(rec_histogram_bucket(5000)) && v <= RecHistogramBucketHigh(rec_histogram_bucket(5000)),
+            "p100 is %" PRId64 ", not in the bucket of 5000", v);
+
+  // open ended
+  memset(buckets, 0, sizeof(buckets));
+  buckets[REC_HISTOGRAM_BUCKETS - 1] = 1;
+  box.check(RecHistogramPercentile(buckets, 1, 50.0) == RecHistogramBucketLow(REC_HISTOGRAM_BUCKETS - 1),
+            "the percentile in the last bucket is not its low bound");
+}
+
+REGRESSION_TEST(RecHistogram_Window)(RegressionTest *t, int atype, int *pstatus)
+{
+  REC_NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  int64_t global[REC_HISTOGRAM_BUCKETS], recent[REC_HISTOGRAM_BUCKETS];
+  int64_t *window = (int64_t *)ats_malloc(REC_HISTOGRAM_WINDOW * REC_HISTOGRAM_BUCKETS * sizeof(int64_t));
+  int pos = 0;
+
+  box = REGRESSION_TEST_PASSED;
+
+  memset(global, 0, sizeof(global));
+  memset(window, 0, REC_HISTOGRAM_WINDOW * REC_HISTOGRAM_BUCKETS * sizeof(int64_t));
+
+  // one value per sync, each in a bucket of its own, the window keeps the
+  // last REC_HISTOGRAM_WINDOW of them
+  for (int s = 0; s < REC_HISTOGRAM_WINDOW + 3; s++) {
+    int64_t count;
+
+    global[rec_histogram_bucket((int64_t)1 << (s + 3))]++;
+    count = raw_stat_histogram_window(global, window, pos, recent);
+    pos = (pos + 1) % REC_HISTOGRAM_WINDOW;
+
+    box.check(count == (s < REC_HISTOGRAM_WINDOW ? s + 1 : REC_HISTOGRAM_WINDOW), "%" PRId64 " values after sync %d",
+              count, s);
+    box.check(recent[rec_histogram_bucket((int64_t)1 << (s + 3))] == 1, "the value of sync %d is not in the window", s);
+    if (s >= REC_HISTOGRAM_WINDOW)
+      box.check(recent[rec_histogram_bucket((int64_t)1 << (s - REC_HISTOGRAM_WINDOW + 3))] == 0,
+                "the value of sync %d is still in the window after sync %d", s - REC_HISTOGRAM_WINDOW, s);
+  }
+
+  // nothing new, the window empties
+  for (int s = 0; s < REC_HISTOGRAM_WINDOW; s++) {
+    raw_stat_histogram_window(global, window, pos, recent);
+    pos = (pos + 1) % REC_HISTOGRAM_WINDOW;
+  }
+  box.check(raw_stat_histogram_window(global, window, pos, recent) == 0, "old values are still in the window");
+
+  ats_free(window);
+}
+#endif
@@ -0,0 +1,205 @@
+/** @file
+
+  Aho-Corasick automaton to find any of a set of strings in a text in
+  a single pass.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "libts.h"
+#include "AhoCorasick.h"
+
+AhoCorasick::AhoCorasick()
+  : m_nclasses(0), m_nstates(0), m_next(NULL), m_output(NULL), m_own(NULL), m_dict(NULL), m_same(NULL)
+{
+  memset(m_class, 0, sizeof(m_class));
+}
+
+AhoCorasick::~AhoCorasick()
+{
+  clear();
+}
+
+void
+AhoCorasick::clear()
+{
+  ats_free(m_next);
+  ats_free(m_output);
+  ats_free(m_own);
+  ats_free(m_dict);
+  ats_free(m_same);
+  m_next = m_output = m_own = m_dict = m_same = NULL;
+  m_nstates = m_nclasses = 0;
+  memset(m_class, 0, sizeof(m_class));
+}
+
+void
+AhoCorasick::compile(const char *const *patterns, int n, bool case_insensitive)
+{
+  size_t total = 0;
+
+  clear();
+  if (n <= 0)
+    return;
+
+  // input classes
+  m_nclasses = 1;
+  for (int i = 0; i < n; i++) {
+    for (const unsigned char *p = (const unsigned char *) patterns[i]; *p; p++) {
+      if (m_class[*p])
+        continue;
+      if (case_insensitive && ParseRules::is_alpha(*p)) {
+        m_class[(unsigned char) ParseRules::ink_toupper(*p)] = m_nclasses;
+        m_class[(unsigned char) ParseRules::ink_tolower(*p)] = m_nclasses;
+      } else {
+        m_class[*p] = m_nclasses;
+      }
+      m_nclasses++;
+    }
+    total += strlen(patterns[i]);
+  }
+
+  // the trie, -1 for missing edges
+  int max_states = total + 1;
+  m_next = (int32_t *) ats_malloc(max_states * m_nclasses * sizeof(int32_t));
+  m_output = (int32_t *) ats_malloc(max_states * sizeof(int32_t));
+  m_own = (int32_t *) ats_malloc(max_states * sizeof(int32_t));
+  m_dict = (int32_t *) ats_malloc(max_states * sizeof(int32_t));
+  m_same = (int32_t *) ats_malloc(n * sizeof(int32_t));
+  memset(m_next, 0xff, max_states * m_nclasses * sizeof(int32_t));
+  memset(m_own, 0xff, max_states * sizeof(int32_t));
+  memset(m_dict, 0xff, max_states * sizeof(int32_t));
+  m_output[0] = -1;
+  m_nstates = 1;
+
+  for (int i = 0; i < n; i++) {
+    int s = 0;
+    for (const unsigned char *p = (const unsigned char *) patterns[i]; *p; p++) {
+      int32_t *t = &m_next[s * m_nclasses + m_class[*p]];
+      if (*t < 0) {
+        m_output[m_nstates] = -1;
+        *t = m_nstates++;
+      }
+      s = *t;
+    }
+    if (m_output[s] < 0)
+      m_output[s] = i;
+    // duplicates chain off the first pattern to end here
+    m_same[i] = -1;
+    if (m_own[s] < 0) {
+      m_own[s] = i;
+    } else {
+      int j = m_own[s];
+      while (m_same[j] >= 0)
+        j = m_same[j];
+      m_same[j] = i;
+    }
+  }
+
+  // Turn it into the automaton, breadth first: a missing edge goes where
+  // the same edge goes from the state of the longest proper suffix, and
+  // a state outputs whatever its suffix state does.
+  int32_t *fail = (int32_t *) ats_malloc(m_nstates * sizeof(int32_t));
+  int32_t *queue = (int32_t *) ats_malloc(m_nstates * sizeof(int32_t));
+  int head = 0, tail = 0;
+
+  for (int c = 0; c < m_nclasses; c++) {
+    int32_t *t = &m_next[c];
+    if (*t < 0) {
+      *t = 0;
+    } else {
+      fail[*t] = 0;
+      queue[tail++] = *t;
+    }
+  }
+  while (head < tail) {
+    int s = queue[head++];
+    if (m_output[s] < 0)
+      m_output[s] = m_output[fail[s]];
+    m_dict[s] = m_own[fail[s]] >= 0 ? fail[s] : m_dict[fail[s]];
+    for (int c = 0; c < m_nclasses; c++) {
+      int32_t *t = &m_next[s * m_nclasses + c];
+      int32_t f = m_next[fail[s] * m_nclasses + c];
+      if (*t < 0) {
+        *t = f;
+      } else {
+        fail[*t] = f;
+        queue[tail++] = *t;
+      }
+    }
+  }
+  ats_free(fail);
+  ats_free(queue);
+
+  if (m_nstates < max_states) {
+    m_next = (int32_t *) ats_realloc(m_next, m_nstates * m_nclasses * sizeof(int32_t));
+    m_output = (int32_t *) ats_realloc(m_output, m_nstates * sizeof(int32_t));
+    m_own = (int32_t *) ats_realloc(m_own, m_nstates * sizeof(int32_t));
+    m_dict = (int32_t *) ats_realloc(m_dict, m_nstates * sizeof(int32_t));
+  }
+}
+
+int
+AhoCorasick::match(const char *str, int len) const
+{
+  if (!m_next)
+    return -1;
+  if (m_output[0] >= 0)
+    return m_output[0];
+
+  const int32_t *next = m_next;
+  const int32_t *output = m_output;
+  int nclasses = m_nclasses;
+  int32_t s = 0;
+
+  for (const unsigned char *p = (const unsigned char *) str; len > 0 && *p; p++, len--) {
+    s = next[s * nclasses + m_class[*p]];
+    if (output[s] >= 0)
+      return output[s];
+  }
+  return -1;
+}
+
+int
+AhoCorasick::match_all(const char *str, int len, uint8_t *found) const
+{
+  if (!m_next)
+    return 0;
+
+  const int32_t *next = m_next;
+  const int32_t *output = m_output;
+  int nclasses = m_nclasses;
+  int32_t s = 0;
+  int count = 0;
+
+  // the empty pattern
+  for (int i = m_own[0]; i >= 0; i = m_same[i], count++)
+    found[i] = 1;
+
+  for (const unsigned char *p = (const unsigned char *) str; len > 0 && *p; p++, len--) {
+    s = next[s * nclasses + m_class[*p]];
+    if (output[s] < 0)
+      continue;
+    for (int32_t d = m_own[s] >= 0 ? s : m_dict[s]; d > 0; d = m_dict[d]) {
+      for (int i = m_own[d]; i >= 0; i = m_same[i], count++)
+        found[i] = 1;
+    }
+  }
+  return count;
+}
@@ -0,0 +1,86 @@
+/** @file
+
+  Aho-Corasick automaton to find any of a set of strings in a text in
+  a single pass.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _AhoCorasick_h_
+#define _AhoCorasick_h_
+
+#include "ink_platform.h"
+
+/**
+  Matches a text against a set of patterns at a fixed cost per byte of
+  text, however many patterns there are.
+
+  The automaton is compiled into a full transition table. To keep it
+  small, bytes are first mapped to classes: one class per distinct byte
+  (or, without case, per letter) used by the patterns, and class 0 for
+  all the others. The table then has a row of that many entries per
+  trie node.
+*/
+class AhoCorasick
+{
+public:
+  AhoCorasick();
+  ~AhoCorasick();
+
+  /// Compile @a n NUL terminated patterns, dropping any previous ones.
+  void compile(const char *const *patterns, int n, bool case_insensitive = false);
+
+  bool compiled() const { return m_next != NULL; }
+
+  /**
+    Look for the patterns in @a str, stopping at a NUL or after @a len
+    bytes. Returns the index of a pattern that occurs (not necessarily
+    the first one to), or -1 if none does. An empty pattern occurs in
+    every string.
+  */
+  int match(const char *str, int len) const;
+  int match(const char *str) const { return match(str, INT_MAX); }
+
+  /**
+    Look for all the patterns in @a str, like match(), and set
+    @a found[i] to 1 for every pattern i that occurs. Returns how many
+    times a pattern was found.
+  */
+  int match_all(const char *str, int len, uint8_t *found) const;
+
+  int states() const { return m_nstates; }
+
+private:
+  uint8_t m_class[256];         // byte -> input class
+  int m_nclasses;
+  int m_nstates;
+  int32_t *m_next;              // m_next[state * m_nclasses + class]
+  int32_t *m_output;            // pattern found on reaching a state, or -1
+  int32_t *m_own;               // pattern that ends exactly at a state, or -1
+  int32_t *m_dict;              // next state on the suffix chain with an m_own, or -1
+  int32_t *m_same;              // next pattern equal to a pattern, or -1
+
+  void clear();
+
+  // -- member functions not allowed --
+  AhoCorasick(const AhoCorasick &);
+  AhoCorasick & operator=(const AhoCorasick &);
+};
+
+#endif
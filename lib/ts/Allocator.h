@@ -92,9 +92,12 @@ public:
   /** Re-initialize the parameters of the allocator. */
   void
   re_init(const char *name, unsigned int element_size,
-          unsigned int chunk_size, unsigned int alignment)
+          unsigned int chunk_size, unsigned int alignment, bool use_hugepages = false)
   {
-    ink_freelist_init(&this->fl, name, element_size, chunk_size, alignment);
+    if (use_hugepages)
+      ink_freelist_hugepage_init(&this->fl, name, element_size, chunk_size, alignment);
+    else
+      ink_freelist_init(&this->fl, name, element_size, chunk_size, alignment);
   }
 
 protected:
@@ -1301,15 +1301,28 @@ HostLookup::AllocateSpace(int num_entries)
 
 // void HostLookup::NewEntry(const char* match_data, bool domain_record, void* opaque_data_in)
 //
-//   Insert a new element in to the table
+//   Insert a new element in to the table.  If the space was not
+//     allocated up front, or more entries are added than were allocated
+//     for, the leaf array is grown.  Leaves are referenced by index, so
+//     moving them is safe.
 //
 void
 HostLookup::NewEntry(const char *match_data, bool domain_record, void *opaque_data_in)
 {
 
-  // Make sure space has been allocated
-  ink_assert(num_el >= 0);
-  ink_assert(array_len >= 0);
+  if (array_len < 0) {
+    AllocateSpace(16);
+  } else if (num_el >= array_len) {
+    int grown_len = array_len < 8 ? 16 : array_len * 2;
+    HostLeaf *grown = NEW(new HostLeaf[grown_len]);
+
+    memset(grown, 0, sizeof(HostLeaf) * grown_len);
+    memcpy(grown, leaf_array, sizeof(HostLeaf) * num_el);
+    delete[]leaf_array;
+
+    leaf_array = grown;
+    array_len = grown_len;
+  }
 
   // Make sure we do not overrun the array;
   ink_assert(num_el < array_len);
@@ -145,3 +145,121 @@ DFA::match(const char *str, int length) const
   return -1;
 }
 
+/**
+ * Finds the longest run of plain characters outside of any group that
+ * every match of the pattern has to contain. Gives up (returns 0) on
+ * anything that could make that untrue: alternation, (?...) options or
+ * assertions.
+ */
+int
+regex_required_literal(const char *pattern, char *buf, int buf_size)
+{
+  char run[256];
+  int run_len = 0;
+  int best_len = 0;
+  int depth = 0;
+
+#define END_RUN() \
+  do { \
+    if (run_len > best_len) { \
+      best_len = run_len; \
+      memcpy(buf, run, run_len); \
+    } \
+    run_len = 0; \
+  } while (0)
+
+  if (strstr(pattern, "\\Q") != NULL)  // quoting turns the rules below inside out
+    return 0;
+
+  for (const char *p = pattern; *p; p++) {
+    if (*p == '[') {            // a class, skipped whole
+      p++;
+      if (*p == '^')
+        p++;
+      if (*p == ']')
+        p++;
+      for (; *p && *p != ']'; p++) {
+        if (*p == '\\' && p[1]) {
+          p++;
+        } else if (*p == '[' && p[1] == ':') {
+          const char *end = strstr(p, ":]");
+          if (end == NULL)
+            return 0;
+          p = end + 1;
+        }
+      }
+      if (*p == '\0')
+        return 0;
+      END_RUN();
+      continue;
+    }
+    if (*p == '(') {
+      if (p[1] == '?' || p[1] == '*')
+        return 0;
+      depth++;
+      END_RUN();
+      continue;
+    }
+    if (*p == ')') {
+      depth--;
+      continue;
+    }
+    if (*p == '\\' && p[1] == '\0')
+      return 0;
+    if (depth > 0) {            // groups may be optional or repeated
+      if (*p == '\\')
+        p++;
+      continue;
+    }
+    if (*p == '|')
+      return 0;
+
+    switch (*p) {
+    case '{':
+      // a {n,m} quantifier, anything else is too unusual to bother with
+      for (p++; ParseRules::is_digit(*p) || *p == ','; p++)
+        ;
+      if (*p != '}')
+        return 0;
+      // fall through, n may be 0
+    case '?':
+    case '*':
+      // the last character is optional
+      if (run_len > 0)
+        run_len--;
+      END_RUN();
+      break;
+    case '+':
+      END_RUN();
+      break;
+    case '.':
+    case '^':
+    case '$':
+      END_RUN();
+      break;
+    case '\\':
+      p++;
+      if (ParseRules::is_alnum(*p)) {
+        // a class or an assertion, the escapes with arguments aren't worth it
+        if (strchr("dDsSwWhHvVbBAzZG", *p) == NULL)
+          return 0;
+        END_RUN();
+      } else if (run_len < (int) sizeof(run) && run_len < buf_size - 1) {
+        run[run_len++] = *p;
+      }
+      break;
+    default:
+      if (run_len < (int) sizeof(run) && run_len < buf_size - 1)
+        run[run_len++] = *p;
+      break;
+    }
+  }
+  if (depth != 0)
+    return 0;
+  END_RUN();
+
+#undef END_RUN
+
+  buf[best_len] = '\0';
+  return best_len;
+}
@@ -63,5 +63,13 @@ private:
   dfa_pattern * _my_patterns;
 };
 
+/**
+  Put in @a buf the longest string that every match of the (case
+  sensitive) @a pattern contains, NUL terminated, and return its
+  length. Returns 0 when there is no such string, or the pattern uses
+  something that makes it hard to tell.
+*/
+int regex_required_literal(const char *pattern, char *buf, int buf_size);
+
 
 #endif /* __TS_REGEX_H__ */
@@ -28,9 +28,11 @@
 #include <string.h>
 
 #include "List.h"
+#include "Vec.h"
 
 // Note that you should provide the class to use here, but we'll store
-// pointers to such objects internally.
+// pointers to such objects internally. The trie doesn't own the objects,
+// so one object can be in more than one trie.
 template<typename T>
 class Trie
 {
@@ -49,7 +51,7 @@ public:
   void Clear();
   void Print();
 
-  bool Empty() const { return m_value_list.empty(); }
+  bool Empty() const { return m_value_list.n == 0; }
 
   virtual ~Trie() { Clear(); }
 
@@ -85,7 +87,7 @@ private:
   };
 
   Node m_root;
-  Queue<T> m_value_list;
+  Vec<T *> m_value_list;
 
   void _CheckArgs(const char *key, int &key_len) const;
   void _Clear(Node *node);
@@ -149,7 +151,7 @@ Trie<T>::Insert(const char *key, T* value, int rank, int key_len /* = -1 */)
   curr_node->occupied = true;
   curr_node->value = value;
   curr_node->rank = rank;
-  m_value_list.enqueue(curr_node->value);
+  m_value_list.add(curr_node->value);
   Debug("Trie::Insert", "inserted new element!");
   return true;
 }
@@ -209,8 +211,6 @@ template<typename T>
 void
 Trie<T>::Clear()
 {
-  forl_LL(T, iter, m_value_list)
-    delete iter;
   m_value_list.clear();
 
   _Clear(&m_root);
@@ -221,8 +221,8 @@ template<typename T>
 void
 Trie<T>::Print() {
   // The class we contain must provide a ::Print() method.
-  forl_LL(T, iter, m_value_list)
-    iter->Print();
+  for (int i = 0; i < m_value_list.n; ++i)
+    m_value_list[i]->Print();
 }
 
 template<typename T>
@@ -0,0 +1,149 @@
+/** @file
+
+  Huge page backed memory allocation.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "libts.h"
+#include "hugepages.h"
+#include <sys/mman.h>
+
+#define DEBUG_TAG "hugepages"
+#define MEMINFO_PATH "/proc/meminfo"
+#define HUGEPAGESIZE_TOKEN "Hugepagesize:"
+
+volatile int64_t ats_hugepage_allocated = 0;
+volatile int64_t ats_hugepage_fallback = 0;
+
+static size_t hugepage_size = 0;
+static bool hugepage_enabled = false;
+
+static size_t
+round_to_hugepage(size_t size)
+{
+  return (size + hugepage_size - 1) & ~(hugepage_size - 1);
+}
+
+static size_t
+hugepage_size_from_meminfo()
+{
+#if defined(linux)
+  char line[256];
+  size_t size = 0;
+  FILE *fp = fopen(MEMINFO_PATH, "r");
+
+  if (fp == NULL)
+    return 0;
+
+  while (fgets(line, sizeof(line), fp)) {
+    long kb;
+    if (strncmp(line, HUGEPAGESIZE_TOKEN, sizeof(HUGEPAGESIZE_TOKEN) - 1) == 0 &&
+        sscanf(line + sizeof(HUGEPAGESIZE_TOKEN) - 1, "%ld", &kb) == 1) {
+      size = (size_t)kb * 1024;
+      break;
+    }
+  }
+  fclose(fp);
+  return size;
+#else
+  return 0;
+#endif
+}
+
+void
+ats_hugepage_init(int enabled)
+{
+  hugepage_enabled = false;
+  if (!enabled)
+    return;
+
+  hugepage_size = hugepage_size_from_meminfo();
+  // must be a power of 2 for the rounding to work
+  if (hugepage_size == 0 || (hugepage_size & (hugepage_size - 1))) {
+    Warning("huge pages are not supported on this system, not using them");
+    hugepage_size = 0;
+    return;
+  }
+
+  Debug(DEBUG_TAG, "huge page size is %zu bytes", hugepage_size);
+  hugepage_enabled = true;
+}
+
+bool
+ats_hugepage_enabled()
+{
+  return hugepage_enabled;
+}
+
+size_t
+ats_hugepage_size()
+{
+  return hugepage_enabled ? hugepage_size : 0;
+}
+
+void *
+ats_alloc_hugepage(size_t size)
+{
+#if defined(MAP_HUGETLB)
+  if (!hugepage_enabled)
+    return NULL;
+
+  size = round_to_hugepage(size);
+  void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (mem == MAP_FAILED) {
+    Debug(DEBUG_TAG, "could not map %zu bytes of huge pages: %s", size, strerror(errno));
+    return NULL;
+  }
+
+  ink_atomic_increment64(&ats_hugepage_allocated, (int64_t)size);
+  return mem;
+#else
+  NOWARN_UNUSED(size);
+  return NULL;
+#endif
+}
+
+void *
+ats_alloc_hugepage_fallback(size_t size)
+{
+  size_t alignment = hugepage_enabled ? hugepage_size : (size_t)sysconf(_SC_PAGESIZE);
+  void *mem = ats_memalign(alignment, size);
+
+#if defined(MADV_HUGEPAGE)
+  if (hugepage_enabled)
+    madvise(mem, size, MADV_HUGEPAGE);
+#endif
+  ink_atomic_increment64(&ats_hugepage_fallback, (int64_t)size);
+  return mem;
+}
+
+bool
+ats_free_hugepage(void *ptr, size_t size)
+{
+  if (!hugepage_enabled || ptr == NULL)
+    return false;
+
+  size = round_to_hugepage(size);
+  if (munmap(ptr, size) != 0)
+    return false;
+
+  ink_atomic_increment64(&ats_hugepage_allocated, -(int64_t)size);
+  return true;
+}
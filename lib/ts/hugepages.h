@@ -0,0 +1,59 @@
+/** @file
+
+  Huge page backed memory allocation.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _hugepages_h_
+#define _hugepages_h_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// Bytes currently mapped from explicit (hugetlbfs) huge pages.
+extern volatile int64_t ats_hugepage_allocated;
+/// Bytes requested from huge pages that had to fall back to normal pages.
+extern volatile int64_t ats_hugepage_fallback;
+
+/** Enable or disable huge page allocations. When @a enabled the size of a
+    huge page is looked up, if that fails huge pages stay disabled.
+ */
+void ats_hugepage_init(int enabled);
+bool ats_hugepage_enabled();
+/// Size of a huge page in bytes, 0 if huge pages are not enabled.
+size_t ats_hugepage_size();
+
+/** Allocate @a size bytes (rounded up to a whole number of huge pages)
+    from the explicit huge page pool (MAP_HUGETLB).
+    @return the memory, or NULL if no huge pages are available. The caller
+    is expected to fall back to ats_alloc_hugepage_fallback() then.
+ */
+void *ats_alloc_hugepage(size_t size);
+
+/** Allocate @a size bytes aligned to a huge page from normal memory,
+    advising the kernel to back it with transparent huge pages.
+    Free it with ats_memalign_free().
+ */
+void *ats_alloc_hugepage_fallback(size_t size);
+
+/** Free memory from ats_alloc_hugepage(), @a size as passed to it. */
+bool ats_free_hugepage(void *ptr, size_t size);
+
+#endif
@@ -0,0 +1,199 @@
+/** @file
+
+  CPU and NUMA memory affinity for threads.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+ */
+
+#include "libts.h"
+#include "ink_affinity.h"
+
+#if TS_USE_HWLOC
+
+static pthread_once_t affinity_once = PTHREAD_ONCE_INIT;
+static hwloc_cpuset_t affinity_default_cpuset;
+
+// The CPUs of the thread that first uses affinity, before anything is bound
+static void
+affinity_save_default()
+{
+  affinity_default_cpuset = hwloc_bitmap_alloc();
+  if (hwloc_get_cpubind(ink_get_topology(), affinity_default_cpuset, HWLOC_CPUBIND_THREAD) < 0)
+    hwloc_bitmap_copy(affinity_default_cpuset, hwloc_topology_get_allowed_cpuset(ink_get_topology()));
+}
+
+static bool
+affinity_obj_type(int type, hwloc_obj_type_t *obj_type)
+{
+  switch (type) {
+  case INK_AFFINITY_NUMA_NODE:
+    *obj_type = HWLOC_OBJ_NODE;
+    return true;
+  case INK_AFFINITY_SOCKET:
+    *obj_type = HWLOC_OBJ_SOCKET;
+    return true;
+  case INK_AFFINITY_CORE:
+    *obj_type = HWLOC_OBJ_CORE;
+    return true;
+  case INK_AFFINITY_PU:
+    *obj_type = HWLOC_OBJ_PU;
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Bind both the CPUs and the memory policy of the calling thread to obj.
+static int
+affinity_bind_obj(hwloc_topology_t topology, hwloc_obj_t obj)
+{
+  if (!obj || !obj->cpuset || hwloc_bitmap_iszero(obj->cpuset))
+    return -1;
+
+  if (hwloc_set_cpubind(topology, obj->cpuset, HWLOC_CPUBIND_THREAD) < 0)
+    return -1;
+
+  // Not all systems support memory binding, the CPU binding alone still
+  // gets us first-touch placement on the local node.
+  hwloc_set_membind(topology, obj->cpuset, HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_THREAD);
+
+  return hwloc_bitmap_first(obj->cpuset);
+}
+
+int
+ink_affinity_count(int type)
+{
+  hwloc_obj_type_t obj_type;
+
+  pthread_once(&affinity_once, affinity_save_default);
+  if (!affinity_obj_type(type, &obj_type))
+    return 0;
+
+  int n = hwloc_get_nbobjs_by_type(ink_get_topology(), obj_type);
+  return n > 0 ? n : 0;
+}
+
+int
+ink_affinity_bind(int type, int index)
+{
+  hwloc_obj_type_t obj_type;
+  hwloc_topology_t topology = ink_get_topology();
+
+  pthread_once(&affinity_once, affinity_save_default);
+  if (!affinity_obj_type(type, &obj_type) || index < 0)
+    return -1;
+
+  int n = hwloc_get_nbobjs_by_type(topology, obj_type);
+  if (n <= 0)
+    return -1;
+
+  return affinity_bind_obj(topology, hwloc_get_obj_by_type(topology, obj_type, index % n));
+}
+
+int
+ink_affinity_bind_node(int node)
+{
+  hwloc_topology_t topology = ink_get_topology();
+  int n = hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_NODE);
+
+  pthread_once(&affinity_once, affinity_save_default);
+  for (int i = 0; i < n; ++i) {
+    hwloc_obj_t obj = hwloc_get_obj_by_type(topology, HWLOC_OBJ_NODE, i);
+    if (obj && (int)obj->os_index == node)
+      return affinity_bind_obj(topology, obj);
+  }
+  return -1;
+}
+
+void
+ink_affinity_unbind()
+{
+  hwloc_topology_t topology = ink_get_topology();
+
+  pthread_once(&affinity_once, affinity_save_default);
+  hwloc_set_cpubind(topology, affinity_default_cpuset, HWLOC_CPUBIND_THREAD);
+  hwloc_set_membind(topology, affinity_default_cpuset, HWLOC_MEMBIND_DEFAULT, HWLOC_MEMBIND_THREAD);
+}
+
+#else
+
+int
+ink_affinity_count(int type)
+{
+  NOWARN_UNUSED(type);
+  return 0;
+}
+
+int
+ink_affinity_bind(int type, int index)
+{
+  NOWARN_UNUSED(type);
+  NOWARN_UNUSED(index);
+  return -1;
+}
+
+int
+ink_affinity_bind_node(int node)
+{
+  NOWARN_UNUSED(node);
+  return -1;
+}
+
+void
+ink_affinity_unbind()
+{
+}
+
+#endif /* TS_USE_HWLOC */
+
+int
+ink_affinity_node_of_fd(int fd)
+{
+#if defined(linux)
+  struct stat st;
+  dev_t dev;
+  char path[PATH_NAME_MAX];
+  int node = -1;
+
+  if (fstat(fd, &st) < 0)
+    return -1;
+  dev = S_ISBLK(st.st_mode) ? st.st_rdev : st.st_dev;
+
+  // The device of a partition is its parent's, one level up in sysfs.
+  static const char *formats[] = {
+    "/sys/dev/block/%u:%u/device/numa_node",
+    "/sys/dev/block/%u:%u/../device/numa_node"
+  };
+
+  for (unsigned i = 0; i < SIZE(formats) && node < 0; ++i) {
+    snprintf(path, sizeof(path), formats[i], major(dev), minor(dev));
+    FILE *fp = fopen(path, "r");
+    if (fp) {
+      if (fscanf(fp, "%d", &node) != 1)
+        node = -1;
+      fclose(fp);
+    }
+  }
+  return node;
+#else
+  NOWARN_UNUSED(fd);
+  return -1;
+#endif
+}
@@ -0,0 +1,78 @@
+/** @file
+
+  CPU and NUMA memory affinity for threads.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+ */
+
+#if !defined (_ink_affinity_h_)
+#define _ink_affinity_h_
+
+/** Thread affinity levels, as used by the @c proxy.config.*.affinity
+    configuration variables. Threads are spread round robin over the
+    objects of the selected level of the hardware topology.
+ */
+enum InkAffinityType
+{
+  INK_AFFINITY_NONE = 0,        ///< Don't bind, leave placement to the OS.
+  INK_AFFINITY_NUMA_NODE = 1,   ///< Bind to a NUMA node.
+  INK_AFFINITY_SOCKET = 2,      ///< Bind to a socket (package).
+  INK_AFFINITY_CORE = 3,        ///< Bind to a physical core.
+  INK_AFFINITY_PU = 4           ///< Bind to a single processing unit (hyper thread).
+};
+
+/** Number of topology objects of affinity level @a type.
+    @return 0 if the level is unknown or affinity is not supported.
+ */
+extern int ink_affinity_count(int type);
+
+/** Bind the calling thread to topology object @a index (modulo the
+    number of objects) of affinity level @a type.
+
+    Both the CPU set and the memory policy of the thread are bound, so
+    memory first touched by the thread afterwards (freelist chunks,
+    IOBuffer data, etc.) is allocated on the node the thread runs on.
+
+    @return the OS index of the first processing unit bound to, or -1
+    if the thread was not bound.
+ */
+extern int ink_affinity_bind(int type, int index);
+
+/** Bind the calling thread to the NUMA node with OS index @a node.
+    @return as for ink_affinity_bind().
+ */
+extern int ink_affinity_bind_node(int node);
+
+/** Give the calling thread back the CPU set the process started with,
+    and the default memory policy. A new thread inherits the binding of
+    the thread that created it, so threads that are not to be bound call
+    this when they start.
+
+    The CPU set the process started with is taken the first time any of
+    these functions is called, which has to be before a thread is bound.
+ */
+extern void ink_affinity_unbind();
+
+/** Find the NUMA node that the device backing @a fd hangs off.
+    @return the OS index of the node, or -1 if it can't be determined.
+ */
+extern int ink_affinity_node_of_fd(int fd);
+
+#endif
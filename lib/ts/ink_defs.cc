@@ -44,7 +44,6 @@ int off = 0;
 int on = 1;
 
 #if TS_USE_HWLOC
-#include <hwloc.h>
 static hwloc_topology_t gTopology;
 static bool hwloc_setup = false;
 
@@ -60,6 +59,13 @@ setup_hwloc()
 
   hwloc_setup = true;
 }
+
+hwloc_topology_t
+ink_get_topology()
+{
+  setup_hwloc();
+  return gTopology;
+}
 #endif
 
 int
@@ -88,6 +88,12 @@ extern int on;
 int ink_sys_name_release(char *name, int namelen, char *release, int releaselen);
 int ink_number_of_processors();
 
+#if TS_USE_HWLOC
+#include <hwloc.h>
+// Get the hardware topology
+hwloc_topology_t ink_get_topology();
+#endif
+
 /** Constants.
  */
 namespace ts {
@@ -50,6 +50,7 @@
 #include "ink_assert.h"
 #include "ink_resource.h"
 #include "ink_queue_ext.h"
+#include "hugepages.h"
 
 
 inkcoreapi volatile int64_t fastalloc_mem_in_use = 0;
@@ -111,10 +112,21 @@ ink_freelist_init(InkFreeList **fl, const char *name, uint32_t type_size,
   f->allocated = 0;
   f->allocated_base = 0;
   f->used_base = 0;
+  f->use_hugepages = 0;
   *fl = f;
 #endif
 }
 
+void
+ink_freelist_hugepage_init(InkFreeList **fl, const char *name, uint32_t type_size,
+                           uint32_t chunk_size, uint32_t alignment)
+{
+  ink_freelist_init(fl, name, type_size, chunk_size, alignment);
+#if !TS_USE_RECLAIMABLE_FREELIST
+  (*fl)->use_hugepages = ats_hugepage_enabled();
+#endif
+}
+
 InkFreeList *
 ink_freelist_create(const char *name, uint32_t type_size, uint32_t chunk_size,
                     uint32_t alignment)
@@ -162,7 +174,11 @@ ink_freelist_new(InkFreeList * f)
 #ifdef DEBUG
       char *oldsbrk = (char *) sbrk(0), *newsbrk = NULL;
 #endif
-      if (f->alignment)
+      if (f->use_hugepages) {
+        // chunks are never returned, so they need not be tracked for freeing
+        if ((newp = ats_alloc_hugepage(f->chunk_size * type_size)) == NULL)
+          newp = ats_alloc_hugepage_fallback(f->chunk_size * type_size);
+      } else if (f->alignment)
         newp = ats_memalign(f->alignment, f->chunk_size * type_size);
       else
         newp = ats_malloc(f->chunk_size * type_size);
@@ -352,6 +368,10 @@ ink_freelists_dump(FILE * f)
             (uint64_t)fll->fl->used * (uint64_t)fll->fl->type_size, fll->fl->type_size, fll->fl->name ? fll->fl->name : "<unknown>");
     fll = fll->next;
   }
+  if (ats_hugepage_enabled()) {
+    fprintf(f, " %18" PRId64 " | huge pages mapped\n", (int64_t)ats_hugepage_allocated);
+    fprintf(f, " %18" PRId64 " | huge page requests that fell back to normal pages\n", (int64_t)ats_hugepage_fallback);
+  }
 #else // ! TS_USE_FREELIST
   // TODO?
 #endif
@@ -136,6 +136,7 @@ extern "C"
     const char *name;
     uint32_t type_size, chunk_size, used, allocated, alignment;
     uint32_t allocated_base, used_base;
+    int use_hugepages;
   };
 
   inkcoreapi extern volatile int64_t fastalloc_mem_in_use;
@@ -160,6 +161,13 @@ extern "C"
   inkcoreapi void ink_freelist_init(InkFreeList **fl, const char *name,
                                     uint32_t type_size, uint32_t chunk_size,
                                     uint32_t alignment);
+  /*
+   * same as ink_freelist_init(), but the chunks are allocated from
+   * huge pages, falling back to normal pages if none are available
+   */
+  inkcoreapi void ink_freelist_hugepage_init(InkFreeList **fl, const char *name,
+                                             uint32_t type_size, uint32_t chunk_size,
+                                             uint32_t alignment);
   inkcoreapi void *ink_freelist_new(InkFreeList * f);
   inkcoreapi void ink_freelist_free(InkFreeList * f, void *item);
   void ink_freelists_dump(FILE * f);
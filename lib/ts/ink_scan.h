@@ -0,0 +1,130 @@
+/** @file
+
+  Delimiter scanning for the header parsers
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/****************************************************************************
+
+  ink_scan.h
+
+  Find the first of a few delimiter characters in a buffer, like memchr()
+  for more than one character. The SIMD versions look at 32 (AVX2) or 16
+  (SSE2) bytes at a time and are picked at compile time, from the target
+  the compiler was given; the rest of the buffer, and every buffer on
+  other targets, goes through the scalar loop. They never read past the
+  end of the buffer, and all versions return the same pointer.
+
+ ****************************************************************************/
+
+#ifndef _ink_scan_h_
+#define _ink_scan_h_
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define INK_SCAN_AVX2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define INK_SCAN_SSE2 1
+#endif
+
+/**
+  First byte in [@a s, @a e) that is @a a or @a b, or @a e if there is
+  none, one byte at a time.
+*/
+static inline const char *
+ink_scan2_scalar(const char *s, const char *e, char a, char b)
+{
+  for (; s < e; s++) {
+    if (*s == a || *s == b)
+      return s;
+  }
+  return e;
+}
+
+/** The same for three bytes. */
+static inline const char *
+ink_scan3_scalar(const char *s, const char *e, char a, char b, char c)
+{
+  for (; s < e; s++) {
+    if (*s == a || *s == b || *s == c)
+      return s;
+  }
+  return e;
+}
+
+/** First byte in [@a s, @a e) that is @a a or @a b, or @a e. */
+static inline const char *
+ink_scan2(const char *s, const char *e, char a, char b)
+{
+#if defined(INK_SCAN_AVX2)
+  const __m256i va = _mm256_set1_epi8(a), vb = _mm256_set1_epi8(b);
+
+  for (; e - s >= 32; s += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) s);
+    unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+    if (mask)
+      return s + __builtin_ctz(mask);
+  }
+#endif
+#if defined(INK_SCAN_AVX2) || defined(INK_SCAN_SSE2)
+  const __m128i xa = _mm_set1_epi8(a), xb = _mm_set1_epi8(b);
+
+  for (; e - s >= 16; s += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) s);
+    unsigned int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, xa), _mm_cmpeq_epi8(v, xb)));
+    if (mask)
+      return s + __builtin_ctz(mask);
+  }
+#endif
+  return ink_scan2_scalar(s, e, a, b);
+}
+
+/** First byte in [@a s, @a e) that is @a a, @a b or @a c, or @a e. */
+static inline const char *
+ink_scan3(const char *s, const char *e, char a, char b, char c)
+{
+#if defined(INK_SCAN_AVX2)
+  const __m256i va = _mm256_set1_epi8(a), vb = _mm256_set1_epi8(b), vc = _mm256_set1_epi8(c);
+
+  for (; e - s >= 32; s += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) s);
+    __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)),
+                                  _mm256_cmpeq_epi8(v, vc));
+    unsigned int mask = _mm256_movemask_epi8(hit);
+    if (mask)
+      return s + __builtin_ctz(mask);
+  }
+#endif
+#if defined(INK_SCAN_AVX2) || defined(INK_SCAN_SSE2)
+  const __m128i xa = _mm_set1_epi8(a), xb = _mm_set1_epi8(b), xc = _mm_set1_epi8(c);
+
+  for (; e - s >= 16; s += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) s);
+    __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, xa), _mm_cmpeq_epi8(v, xb)), _mm_cmpeq_epi8(v, xc));
+    unsigned int mask = _mm_movemask_epi8(hit);
+    if (mask)
+      return s + __builtin_ctz(mask);
+  }
+#endif
+  return ink_scan3_scalar(s, e, a, b, c);
+}
+
+#endif /* _ink_scan_h_ */
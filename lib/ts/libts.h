@@ -44,6 +44,7 @@
 #include "ink_config.h"
 #include "ink_platform.h"
 #include "ink_port.h"
+#include "ink_affinity.h"
 #include "ink_aiocb.h"
 #include "ink_align.h"
 #include "ink_apidefs.h"
@@ -109,6 +110,7 @@
 #include "Diags.h"
 #include "Regression.h"
 #include "HostLookup.h"
+#include "hugepages.h"
 #include "InkErrno.h"
 #include "Vec.h"
 
@@ -0,0 +1,135 @@
+/** @file
+
+  Test code for the AhoCorasick matcher, against strstr().
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "libts.h"
+#include "AhoCorasick.h"
+
+static void
+upcase(char *s)
+{
+  for (; *s; s++)
+    *s = toupper(*s);
+}
+
+// 1 if any pattern is a substring of text, like LogFilterString used to
+static int
+brute_force(char **patterns, int n, const char *text, bool nocase)
+{
+  char t[256], p[256];
+
+  ink_strlcpy(t, text, sizeof(t));
+  if (nocase)
+    upcase(t);
+  for (int i = 0; i < n; i++) {
+    ink_strlcpy(p, patterns[i], sizeof(p));
+    if (nocase)
+      upcase(p);
+    if (strstr(t, p))
+      return 1;
+  }
+  return 0;
+}
+
+static void
+random_string(char *s, int len, const char *alphabet)
+{
+  int n = strlen(alphabet);
+  for (int i = 0; i < len; i++)
+    s[i] = alphabet[rand() % n];
+  s[len] = 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  int failures = 0;
+  AhoCorasick ac;
+
+  // the basics
+  const char *words[] = { "he", "she", "his", "hers" };
+  ac.compile(words, 4);
+  if (ac.match("ushers") < 0 || ac.match("ahishe") < 0 || ac.match("hxexs") >= 0 || ac.match("") >= 0) {
+    printf("basic match failed\n");
+    failures++;
+  }
+  if (ac.match("xhers", 2) >= 0 || ac.match("xhers", 3) != 0) {
+    printf("length limit failed\n");
+    failures++;
+  }
+  const char *upper[] = { "GET", "/Images/" };
+  ac.compile(upper, 2, true);
+  if (ac.match("http://a.test/images/x.png") != 1 || ac.match("get") != 0 || ac.match("POST") >= 0) {
+    printf("case insensitive match failed\n");
+    failures++;
+  }
+  const char *empty[] = { "" };
+  ac.compile(empty, 1);
+  if (ac.match("anything") != 0) {
+    printf("empty pattern failed\n");
+    failures++;
+  }
+
+  // random sets over small alphabets, so that patterns overlap a lot
+  srand(1);
+  for (int round = 0; round < 2000; round++) {
+    char *patterns[16];
+    char text[64];
+    int n = 1 + rand() % 16;
+    bool nocase = (round & 1) != 0;
+    const char *alphabet = nocase ? "abAB-c" : "abc-";
+
+    for (int i = 0; i < n; i++) {
+      patterns[i] = (char *) malloc(8);
+      random_string(patterns[i], 1 + rand() % 6, alphabet);
+    }
+    ac.compile(patterns, n, nocase);
+    for (int k = 0; k < 20; k++) {
+      random_string(text, rand() % 40, alphabet);
+      int r = ac.match(text);
+      int expect = brute_force(patterns, n, text, nocase);
+      if ((r >= 0) != expect || (r >= 0 && !brute_force(&patterns[r], 1, text, nocase))) {
+        printf("round %d: \"%s\" gave %d, expected %s\n", round, text, r, expect ? "a match" : "none");
+        failures++;
+      }
+
+      uint8_t found[16];
+      memset(found, 0, sizeof(found));
+      ac.match_all(text, INT_MAX, found);
+      for (int i = 0; i < n; i++) {
+        if (found[i] != brute_force(&patterns[i], 1, text, nocase)) {
+          printf("round %d: \"%s\" match_all gave %d for \"%s\"\n", round, text, found[i], patterns[i]);
+          failures++;
+        }
+      }
+    }
+    for (int i = 0; i < n; i++)
+      free(patterns[i]);
+  }
+
+  printf("test_AhoCorasick %s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,125 @@
+/** @file
+
+  Test code for regex_required_literal(), the literal the regex remap
+  rules are prefiltered with.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libts.h"
+#include "Regex.h"
+
+// The literal expected for each pattern ("" for none), and a string the
+// pattern matches, which has to contain the literal.
+static const struct
+{
+  const char *pattern;
+  const char *literal;
+  const char *subject;
+} cases[] = {
+  { "abc", "abc", "xabcx" },
+  { "", "", "" },
+  { ".*", "", "anything" },
+
+  // quantifiers make the character before them optional or repeated
+  { "abc?d", "ab", "abd" },
+  { "abc??d", "ab", "abd" },
+  { "ab*cde", "cde", "acde" },
+  { "abc*?def", "def", "abdef" },
+  { "a.b+cd", "cd", "axbbbcd" },
+  { "abcd+?e", "abcd", "abcde" },
+  { "abcd{0,2}ef", "abc", "abcef" },
+  { "abc{2}", "ab", "abcc" },
+  { "abc{1,3}?de", "ab", "abcde" },
+  { "a{x}", "", "a{x}" },
+
+  // escapes
+  { "www\\.example\\.com", "www.example.com", "http://www.example.com/" },
+  { "a\\*b", "a*b", "a*b" },
+  { "ab\\[c]d", "ab[c]d", "ab[c]d" },
+  { "\\d+foo", "foo", "42foo" },
+  { "abc\\", "", NULL },
+
+  // classes, which may contain a ]
+  { "ab[]x]cdef", "cdef", "ab]cdef" },
+  { "abc[^]]de", "abc", "abcxde" },
+  { "[[:alpha:]]+xyz", "xyz", "qxyz" },
+  { "ab[cd", "", NULL },
+
+  // groups may be optional or repeated, so only what is outside counts
+  { "(foo)?barbaz", "barbaz", "barbaz" },
+  { "(a|b)xyz", "xyz", "bxyz" },
+  { "x(yz)*", "x", "x" },
+  { "((ab)c)+defg", "defg", "abcdefg" },
+  { "(abc", "", NULL },
+  { "^/images/.*\\.png$", "/images/", "/images/logo.png" },
+
+  // too hard to tell
+  { "abc|def", "", "def" },
+  { "(?i)abc", "", "ABC" },
+  { "abc(?=d)", "", "abcd" },
+  { "(?:ab)cd", "", "abcd" },
+  { "\\Qa.b\\E", "", "a.b" },
+  { "(a)\\1bcd", "", "aabcd" },
+  { "(ab)\\d\\1", "", "ab1ab" },
+};
+
+int
+main(int argc, char **argv)
+{
+  int failures = 0;
+  char buf[256];
+
+  for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    int len = regex_required_literal(cases[i].pattern, buf, sizeof(buf));
+
+    if (len != (int) strlen(cases[i].literal) || (len > 0 && strcmp(buf, cases[i].literal))) {
+      printf("\"%s\" gave \"%s\", expected \"%s\"\n", cases[i].pattern, len > 0 ? buf : "", cases[i].literal);
+      failures++;
+    }
+
+    // the pattern is valid and the literal really is required
+    if (cases[i].subject) {
+      const char *error;
+      int error_offset;
+      pcre *re = pcre_compile(cases[i].pattern, 0, &error, &error_offset, NULL);
+
+      if (re == NULL || pcre_exec(re, NULL, cases[i].subject, strlen(cases[i].subject), 0, 0, NULL, 0) < 0 ||
+          strstr(cases[i].subject, cases[i].literal) == NULL) {
+        printf("\"%s\" does not match \"%s\" with \"%s\" in it\n", cases[i].pattern, cases[i].subject,
+               cases[i].literal);
+        failures++;
+      }
+      if (re)
+        pcre_free(re);
+    }
+  }
+
+  // the literal is cut short to fit the buffer
+  if (regex_required_literal("abcdef", buf, 4) != 3 || strcmp(buf, "abc")) {
+    printf("the literal does not fit a 4 byte buffer\n");
+    failures++;
+  }
+
+  printf("test_Regex %s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}
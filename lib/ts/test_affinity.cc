@@ -0,0 +1,170 @@
+/** @file
+
+  Test code for the thread affinity functions: the CPU set each kind of
+  thread ends up with.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libts.h"
+#include "ink_affinity.h"
+
+#if TS_USE_HWLOC
+
+#define MAX_BOUND_THREADS 4
+
+static hwloc_cpuset_t default_cpuset;
+
+// What a thread does when it starts: bind to a PU, unbind, or nothing
+enum
+{
+  START_BIND,
+  START_UNBIND,
+  START_INHERIT
+};
+
+struct thread_info
+{
+  int start;
+  int index;
+  int cpu;
+  hwloc_cpuset_t cpuset;
+};
+
+static void *
+thread_main(void *arg)
+{
+  thread_info *info = (thread_info *) arg;
+
+  if (info->start == START_BIND)
+    info->cpu = ink_affinity_bind(INK_AFFINITY_PU, info->index);
+  else if (info->start == START_UNBIND)
+    ink_affinity_unbind();
+  hwloc_get_cpubind(ink_get_topology(), info->cpuset, HWLOC_CPUBIND_THREAD);
+  return NULL;
+}
+
+static void
+run_thread(thread_info *info, int start, int index)
+{
+  ink_thread tid;
+
+  info->start = start;
+  info->index = index;
+  info->cpu = -1;
+  info->cpuset = hwloc_bitmap_alloc();
+  tid = ink_thread_create(thread_main, info);
+  ink_thread_join(tid);
+}
+
+static int
+check_cpuset(const char *what, hwloc_const_cpuset_t got, hwloc_const_cpuset_t expect)
+{
+  char got_s[256], expect_s[256];
+
+  if (hwloc_bitmap_isequal(got, expect))
+    return 0;
+  hwloc_bitmap_snprintf(got_s, sizeof(got_s), got);
+  hwloc_bitmap_snprintf(expect_s, sizeof(expect_s), expect);
+  printf("FAILED: %s is bound to %s, expected %s\n", what, got_s, expect_s);
+  return 1;
+}
+
+int
+main(int argc, const char *argv[])
+{
+  NOWARN_UNUSED(argc);
+  NOWARN_UNUSED(argv);
+
+  hwloc_topology_t topology = ink_get_topology();
+  thread_info bound[MAX_BOUND_THREADS], unbound, inherited;
+  int failures = 0, n;
+  char what[64];
+
+  // the main thread is not bound yet, as when the thread groups start
+  default_cpuset = hwloc_bitmap_alloc();
+  hwloc_get_cpubind(topology, default_cpuset, HWLOC_CPUBIND_THREAD);
+
+  n = ink_affinity_count(INK_AFFINITY_PU);
+  if (n <= 0) {
+    printf("test_affinity: no processing units to bind to, skipped\n");
+    return 0;
+  }
+  if (n > MAX_BOUND_THREADS)
+    n = MAX_BOUND_THREADS;
+
+  // a bound group: each thread on its own PU
+  for (int i = 0; i < n; ++i) {
+    hwloc_obj_t pu = hwloc_get_obj_by_type(topology, HWLOC_OBJ_PU, i);
+
+    run_thread(&bound[i], START_BIND, i);
+    if (bound[i].cpu < 0) {
+      printf("test_affinity: threads can't be bound here, skipped\n");
+      return 0;
+    }
+    snprintf(what, sizeof(what), "bound thread %d", i);
+    failures += check_cpuset(what, bound[i].cpuset, pu->cpuset);
+  }
+
+  // the main thread is bound, threads it starts after that inherit its
+  // binding unless they unbind
+  if (ink_affinity_bind(INK_AFFINITY_PU, 0) < 0) {
+    printf("FAILED: the main thread can't be bound\n");
+    ++failures;
+  } else {
+    run_thread(&inherited, START_INHERIT, 0);
+    failures += check_cpuset("inheriting thread", inherited.cpuset, bound[0].cpuset);
+    run_thread(&unbound, START_UNBIND, 0);
+    failures += check_cpuset("unbound thread", unbound.cpuset, default_cpuset);
+
+    // and the main thread can be unbound again
+    ink_affinity_unbind();
+    hwloc_get_cpubind(topology, unbound.cpuset, HWLOC_CPUBIND_THREAD);
+    failures += check_cpuset("unbound main thread", unbound.cpuset, default_cpuset);
+  }
+
+  if (failures)
+    printf("test_affinity: %d failures\n", failures);
+  else
+    printf("test_affinity: passed\n");
+  return failures ? 1 : 0;
+}
+
+#else
+
+int
+main(int argc, const char *argv[])
+{
+  NOWARN_UNUSED(argc);
+  NOWARN_UNUSED(argv);
+
+  // without hwloc nothing is bound
+  if (ink_affinity_count(INK_AFFINITY_PU) != 0 || ink_affinity_bind(INK_AFFINITY_PU, 0) != -1) {
+    printf("FAILED: affinity without hwloc\n");
+    return 1;
+  }
+  ink_affinity_unbind();
+  printf("test_affinity: passed\n");
+  return 0;
+}
+
+#endif
@@ -0,0 +1,173 @@
+/** @file
+
+  Test code for the delimiter scanners in ink_scan.h, against the scalar
+  loops. "test_ink_scan -b" also times them on a set of request and
+  response headers.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libts.h"
+#include "ink_scan.h"
+
+static const char *corpus[] = {
+  "GET /search?q=traffic+server&hl=en&source=hp&ei=x3k2UPz8Hc6Oiq&oq=traffic+server&aq=f HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_7_4) AppleWebKit/537.1 (KHTML, like Gecko) "
+    "Chrome/21.0.1180.82 Safari/537.1\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip,deflate,sdch\r\n"
+    "Accept-Language: en-US,en;q=0.8\r\n"
+    "Accept-Charset: ISO-8859-1,utf-8;q=0.7,*;q=0.3\r\n"
+    "Referer: http://www.example.com/\r\n"
+    "Cookie: PREF=ID=5a2b1f0e8c3d4e6f:U=0d9c8b7a6f5e4d3c:FF=0:TM=1345623001:LM=1345623002:S=AbCdEfGhIjKlMnOp; "
+    "NID=63=Zx9Yw8Xv7Wu6Vt5Us4Tr3Sq2Rp1Qo0Pn9Om8Nl7Mk6Lj5Ki4Jh3Ig2Hf1Ge0Fd9Ec8Db7Ca6Bz5Ay4Zx3Yw2Xv1Wu0Vt9Us8Tr7Sq6Rp5Qo4"
+    "Pn3Om2Nl1Mk0Lj9Ki8Jh7Ig6Hf5Ge4Fd3Ec2Db1Ca0; SID=DQAAAMcAAACx8tT3nE1cVjq9k0sXfY2rGhW7uLpZ4aBcDeFgHiJkLmNoPqRsTuVwXyZ; "
+    "HSID=AbCdEfGhIjKlMnOpQ; SSID=ArStUvWxYz0123456; APISID=aBcDeFgHiJkLmNoP/QrStUvWxYz012345; "
+    "SAPISID=0123456789abcdef/ABCDEFGHIJKLMNOPQ; __utma=173272373.1804582377.1345623001.1345623001.1345623001.1; "
+    "__utmb=173272373.1.10.1345623001; __utmc=173272373; "
+    "__utmz=173272373.1345623001.1.1.utmcsr=(direct)|utmccn=(direct)|utmcmd=(none)\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n",
+  "HTTP/1.1 200 OK\r\n"
+    "Date: Wed, 22 Aug 2012 08:10:02 GMT\r\n"
+    "Expires: -1\r\n"
+    "Cache-Control: private, max-age=0\r\n"
+    "Content-Type: text/html; charset=UTF-8\r\n"
+    "Set-Cookie: PREF=ID=5a2b1f0e8c3d4e6f:FF=0:TM=1345623002:LM=1345623002:S=QrStUvWxYz012345; "
+    "expires=Fri, 22-Aug-2014 08:10:02 GMT; path=/; domain=.example.com\r\n"
+    "Set-Cookie: NID=63=Aa1Bb2Cc3Dd4Ee5Ff6Gg7Hh8Ii9Jj0Kk1Ll2Mm3Nn4Oo5Pp6Qq7Rr8Ss9Tt0Uu1Vv2Ww3Xx4Yy5Zz6; "
+    "expires=Thu, 21-Feb-2013 08:10:02 GMT; path=/; domain=.example.com; HttpOnly\r\n"
+    "P3P: CP=\"This is not a P3P policy! See http://www.example.com/support/accounts/bin/answer.py?answer=151657\"\r\n"
+    "Content-Encoding: gzip\r\n"
+    "Server: ATS/3.2.0\r\n"
+    "Content-Length: 35021\r\n"
+    "X-XSS-Protection: 1; mode=block\r\n"
+    "X-Frame-Options: SAMEORIGIN\r\n"
+    "\r\n",
+  "GET /img/logo.png HTTP/1.1\r\n"
+    "Host: static.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 6.1; WOW64; rv:14.0) Gecko/20100101 Firefox/14.0.1\r\n"
+    "Accept: image/png,image/*;q=0.8,*/*;q=0.5\r\n"
+    "If-Modified-Since: Tue, 21 Aug 2012 19:05:31 GMT\r\n"
+    "If-None-Match: \"4f3a-4c7c9e4ec52c0\"\r\n"
+    "\r\n"
+};
+
+static int
+check(const char *buf, int len)
+{
+  int failures = 0;
+
+  for (int start = 0; start <= len; start++) {
+    for (int end = start; end <= len; end++) {
+      const char *s = buf + start, *e = buf + end;
+      if (ink_scan2(s, e, '\n', ':') != ink_scan2_scalar(s, e, '\n', ':') ||
+          ink_scan3(s, e, ';', '?', '#') != ink_scan3_scalar(s, e, ';', '?', '#')) {
+        printf("mismatch scanning [%d, %d)\n", start, end);
+        failures++;
+      }
+    }
+  }
+  return failures;
+}
+
+// Walk a header like the MIME scanner does: for each line, the colon and the LF.
+template <class Scan> static int
+walk(const char *s, const char *e, Scan scan)
+{
+  int n = 0;
+
+  while (s < e) {
+    s = scan(s, e, '\n', ':');
+    if (s < e && *s == ':')
+      s = scan(s + 1, e, '\n', '\n');
+    n++;
+    s++;
+  }
+  return n;
+}
+
+static void
+bench(int rounds)
+{
+  int64_t bytes = 0;
+  int lines = 0;
+
+  for (unsigned i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++)
+    bytes += strlen(corpus[i]);
+  bytes *= rounds;
+
+  for (int pass = 0; pass < 2; pass++) {
+    ink_hrtime start = ink_get_hrtime_internal();
+    for (int r = 0; r < rounds; r++) {
+      for (unsigned i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++) {
+        const char *s = corpus[i], *e = s + strlen(s);
+        lines += pass ? walk(s, e, ink_scan2) : walk(s, e, ink_scan2_scalar);
+      }
+    }
+    ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+    printf("%-8s %" PRId64 " bytes in %" PRId64 " us, %.1f MB/s\n", pass ? "ink_scan" : "scalar", bytes,
+           (int64_t) ink_hrtime_to_usec(elapsed), (double) bytes / ink_hrtime_to_usec(elapsed));
+  }
+  printf("(%d lines)\n", lines);
+}
+
+int
+main(int argc, char **argv)
+{
+  int failures = 0;
+  char buf[256];
+
+  // every start and end alignment, with the delimiters in every position
+  for (int pos = 0; pos < 80; pos++) {
+    memset(buf, 'a', 80);
+    buf[pos] = ':';
+    failures += check(buf, 80);
+    buf[pos] = '#';
+    failures += check(buf, 80);
+  }
+
+  // random buffers, including bytes above 0x7f
+  srand(42);
+  for (int i = 0; i < 50; i++) {
+    for (int j = 0; j < 100; j++) {
+      int r = rand() % 64;
+      buf[j] = r == 0 ? '\n' : r == 1 ? ':' : r == 2 ? '?' : r == 3 ? ';' : (char) (rand() % 256);
+    }
+    failures += check(buf, 100);
+  }
+
+  for (unsigned i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++) {
+    const char *s = corpus[i], *e = s + strlen(s);
+    if (walk(s, e, ink_scan2) != walk(s, e, ink_scan2_scalar)) {
+      printf("line counts differ for corpus %u\n", i);
+      failures++;
+    }
+  }
+
+  if (argc > 1 && !strcmp(argv[1], "-b"))
+    bench(argc > 2 ? atoi(argv[2]) : 100000);
+
+  printf("test_ink_scan: %d failures\n", failures);
+  return failures ? 1 : 0;
+}
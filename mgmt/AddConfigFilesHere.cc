@@ -86,6 +86,7 @@ initializeRegistry()
   configFiles->addFile("plugin.config", false);
   configFiles->addFile("splitdns.config", false);
   configFiles->addFile("ssl_multicert.config", false);
+  configFiles->addFile("ssl_ticket_key.config", false);
   configFiles->addFile("stats.config.xml", false);
   configFiles->addFile("health_check.config", false);
   configFiles->registerCallback(testcall);
@@ -1115,6 +1115,9 @@ fileUpdated(char *fname, bool incVersion)
   } else if (strcmp(fname, "ssl_multicert.config") == 0) {
     lmgmt->signalFileChange("proxy.config.ssl.server.multicert.filename");
 
+  } else if (strcmp(fname, "ssl_ticket_key.config") == 0) {
+    lmgmt->signalFileChange("proxy.config.ssl.server.ticket_key.filename");
+
   } else if (strcmp(fname, "proxy.config.body_factory.template_sets_dir") == 0) {
     lmgmt->signalFileChange("proxy.config.body_factory.template_sets_dir");
 
@@ -0,0 +1,616 @@
+/** @file
+
+  Compress responses with gzip or deflate, and cache the compressed
+  variant next to the uncompressed one
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/* gzip.c: compress origin responses for the clients that accept it.
+ *
+ * The client's Accept-Encoding is cut down to "gzip", "deflate" or
+ * nothing, so there are at most three kinds of request to tell apart.
+ * A compressible origin response to a client that takes gzip or deflate
+ * goes through a transform, and it is the transformed response that is
+ * cached, as an alternate of its own. The alternate selection matches
+ * the Accept-Encoding of later requests against the cached request's,
+ * and the Content-Encoding of the cached response, so they get the
+ * compressed alternate from the cache, and clients that do not accept
+ * it get (and cache) the uncompressed one from the origin. Each version
+ * of an object is compressed once, not once per response.
+ *
+ *	Usage:
+ *	  gzip.so [--level=<1-9>] [--min-size=<bytes>] [--types=<type>,<type>,...]
+ *
+ * --types replaces the default list of content types to compress. A
+ * subtype of "*" matches all the subtypes of its type.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+#include <ts/ts.h>
+#include "gzip_rules.h"
+
+#define PLUGIN_NAME "gzip"
+
+#define MAX_TYPES 64
+
+static const char *default_types[] = {
+  "text/html",
+  "text/plain",
+  "text/css",
+  "text/xml",
+  "text/javascript",
+  "application/javascript",
+  "application/x-javascript",
+  "application/json",
+  "application/xml",
+  "application/xhtml+xml",
+  "image/svg+xml"
+};
+
+static int compression_level = Z_DEFAULT_COMPRESSION;
+static int64_t min_size = 1024;
+static char *types[MAX_TYPES];
+static int num_types = 0;
+
+typedef struct
+{
+  TSHttpTxn txn;
+  Encoding encoding;
+  TSVIO output_vio;
+  TSIOBuffer output_buffer;
+  TSIOBufferReader output_reader;
+  z_stream zstrm;
+  int finished;
+} GzipData;
+
+static GzipData *
+gzip_data_alloc(TSHttpTxn txnp, Encoding encoding)
+{
+  GzipData *data;
+
+  data = (GzipData *) TSmalloc(sizeof(GzipData));
+  memset(data, 0, sizeof(GzipData));
+  data->txn = txnp;
+  data->encoding = encoding;
+
+  /* 31 is a 32K window with the gzip wrapper, 15 the same with the zlib one */
+  if (deflateInit2(&data->zstrm, compression_level, Z_DEFLATED, encoding == ENCODING_GZIP ? 31 : 15, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    TSError("[%s] deflateInit2 failed\n", PLUGIN_NAME);
+    TSfree(data);
+    return NULL;
+  }
+  return data;
+}
+
+static void
+gzip_data_destroy(GzipData * data)
+{
+  if (data) {
+    if (data->output_buffer)
+      TSIOBufferDestroy(data->output_buffer);
+    deflateEnd(&data->zstrm);
+    TSfree(data);
+  }
+}
+
+/* The transformed response is a copy of the origin's, without its
+ * Content-Length. Mark it as encoded, and make a strong ETag weak: the
+ * bytes differ from the origin's, but a conditional request made with it
+ * still matches the origin's object when the cached one is revalidated.
+ */
+static void
+gzip_response_headers(GzipData * data)
+{
+  TSMBuffer bufp;
+  TSMLoc hdr_loc, field_loc;
+  const char *value;
+  int len;
+
+  if (TSHttpTxnTransformRespGet(data->txn, &bufp, &hdr_loc) != TS_SUCCESS) {
+    TSError("[%s] unable to get the transform response\n", PLUGIN_NAME);
+    return;
+  }
+
+  if (TSMimeHdrFieldCreateNamed(bufp, hdr_loc, TS_MIME_FIELD_CONTENT_ENCODING, TS_MIME_LEN_CONTENT_ENCODING,
+                                &field_loc) == TS_SUCCESS) {
+    if (data->encoding == ENCODING_GZIP)
+      TSMimeHdrFieldValueStringInsert(bufp, hdr_loc, field_loc, -1, "gzip", 4);
+    else
+      TSMimeHdrFieldValueStringInsert(bufp, hdr_loc, field_loc, -1, "deflate", 7);
+    TSMimeHdrFieldAppend(bufp, hdr_loc, field_loc);
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+  }
+
+  field_loc = TSMimeHdrFieldFind(bufp, hdr_loc, TS_MIME_FIELD_ETAG, TS_MIME_LEN_ETAG);
+  if (field_loc) {
+    value = TSMimeHdrFieldValueStringGet(bufp, hdr_loc, field_loc, -1, &len);
+    if (value && len > 0) {
+      char *weak = (char *) TSmalloc(len + 2);
+      int weak_len = gzip_weak_etag(value, len, weak);
+
+      if (weak_len > 0)
+        TSMimeHdrFieldValueStringSet(bufp, hdr_loc, field_loc, -1, weak, weak_len);
+      TSfree(weak);
+    }
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+  }
+
+  TSHandleMLocRelease(bufp, TS_NULL_MLOC, hdr_loc);
+}
+
+/* Run len bytes at buf through deflate, into the output buffer. */
+static void
+gzip_deflate(GzipData * data, const char *buf, int64_t len, int flush)
+{
+  TSIOBufferBlock block;
+  char *out;
+  int64_t avail;
+  int err;
+
+  data->zstrm.next_in = (Bytef *) buf;
+  data->zstrm.avail_in = len;
+
+  do {
+    block = TSIOBufferStart(data->output_buffer);
+    out = TSIOBufferBlockWriteStart(block, &avail);
+    data->zstrm.next_out = (Bytef *) out;
+    data->zstrm.avail_out = avail;
+
+    err = deflate(&data->zstrm, flush);
+    if (err == Z_STREAM_ERROR) {
+      TSError("[%s] deflate failed\n", PLUGIN_NAME);
+      return;
+    }
+    if (avail > (int64_t) data->zstrm.avail_out)
+      TSIOBufferProduce(data->output_buffer, avail - data->zstrm.avail_out);
+  } while (data->zstrm.avail_in > 0 || (flush == Z_FINISH ? err != Z_STREAM_END : data->zstrm.avail_out == 0));
+}
+
+/* Compress towrite bytes from the input, a block at a time. */
+static void
+gzip_input(GzipData * data, TSIOBufferReader reader, int64_t towrite)
+{
+  TSIOBufferBlock block;
+  const char *buf;
+  int64_t avail, left = towrite;
+
+  for (block = TSIOBufferReaderStart(reader); block && left > 0; block = TSIOBufferBlockNext(block)) {
+    buf = TSIOBufferBlockReadStart(block, reader, &avail);
+    if (avail > left)
+      avail = left;
+    gzip_deflate(data, buf, avail, Z_NO_FLUSH);
+    left -= avail;
+  }
+  TSIOBufferReaderConsume(reader, towrite);
+}
+
+static void
+gzip_finish(GzipData * data)
+{
+  if (!data->finished) {
+    gzip_deflate(data, NULL, 0, Z_FINISH);
+    data->finished = 1;
+    TSDebug(PLUGIN_NAME, "%lu bytes in, %lu bytes out", data->zstrm.total_in, data->zstrm.total_out);
+  }
+  TSVIONBytesSet(data->output_vio, data->zstrm.total_out);
+  TSVIOReenable(data->output_vio);
+}
+
+static void
+handle_transform(TSCont contp)
+{
+  TSVIO input_vio;
+  GzipData *data;
+  int64_t towrite, avail;
+
+  input_vio = TSVConnWriteVIOGet(contp);
+  data = TSContDataGet(contp);
+
+  /* The first time through, before anything is written, set up the
+   * output and the headers that go with it.
+   */
+  if (!data->output_vio) {
+    gzip_response_headers(data);
+    data->output_buffer = TSIOBufferCreate();
+    data->output_reader = TSIOBufferReaderAlloc(data->output_buffer);
+    data->output_vio = TSVConnWrite(TSTransformOutputVConnGet(contp), contp, data->output_reader, INT64_MAX);
+  }
+
+  /* A NULL buffer means the write was shut down: end the stream with
+   * what we have.
+   */
+  if (!TSVIOBufferGet(input_vio)) {
+    gzip_finish(data);
+    return;
+  }
+
+  towrite = TSVIONTodoGet(input_vio);
+  if (towrite > 0) {
+    avail = TSIOBufferReaderAvail(TSVIOReaderGet(input_vio));
+    if (towrite > avail)
+      towrite = avail;
+    if (towrite > 0) {
+      gzip_input(data, TSVIOReaderGet(input_vio), towrite);
+      TSVIONDoneSet(input_vio, TSVIONDoneGet(input_vio) + towrite);
+    }
+  }
+
+  if (TSVIONTodoGet(input_vio) > 0) {
+    if (towrite > 0) {
+      TSVIOReenable(data->output_vio);
+      TSContCall(TSVIOContGet(input_vio), TS_EVENT_VCONN_WRITE_READY, input_vio);
+    }
+  } else {
+    gzip_finish(data);
+    TSContCall(TSVIOContGet(input_vio), TS_EVENT_VCONN_WRITE_COMPLETE, input_vio);
+  }
+}
+
+static int
+gzip_transform(TSCont contp, TSEvent event, void *edata)
+{
+  if (TSVConnClosedGet(contp)) {
+    gzip_data_destroy(TSContDataGet(contp));
+    TSContDestroy(contp);
+    return 0;
+  }
+
+  switch (event) {
+  case TS_EVENT_ERROR:
+    {
+      TSVIO input_vio = TSVConnWriteVIOGet(contp);
+      TSContCall(TSVIOContGet(input_vio), TS_EVENT_ERROR, input_vio);
+    }
+    break;
+  case TS_EVENT_VCONN_WRITE_COMPLETE:
+    TSVConnShutdown(TSTransformOutputVConnGet(contp), 0, 1);
+    break;
+  case TS_EVENT_VCONN_WRITE_READY:
+  default:
+    handle_transform(contp);
+    break;
+  }
+
+  return 0;
+}
+
+/* The encoding a request's Accept-Encoding asks for, gzip first. A
+ * coding with q=0 is not accepted.
+ */
+static Encoding
+accepted_encoding(TSMBuffer bufp, TSMLoc hdr_loc, TSMLoc field_loc)
+{
+  int gzip = 0, deflate = 0;
+  int count = TSMimeHdrFieldValuesCount(bufp, hdr_loc, field_loc);
+  int i;
+
+  for (i = 0; i < count; i++) {
+    const char *value;
+    int len;
+
+    value = TSMimeHdrFieldValueStringGet(bufp, hdr_loc, field_loc, i, &len);
+    if (!value)
+      continue;
+    switch (gzip_value_encoding(value, len)) {
+    case ENCODING_GZIP:
+      gzip = 1;
+      break;
+    case ENCODING_DEFLATE:
+      deflate = 1;
+      break;
+    default:
+      break;
+    }
+  }
+
+  return gzip ? ENCODING_GZIP : deflate ? ENCODING_DEFLATE : ENCODING_NONE;
+}
+
+/* Cut the client's Accept-Encoding down to the one coding we would use,
+ * so that the cached requests, which the alternates are selected on,
+ * only come in three kinds.
+ */
+static void
+normalize_accept_encoding(TSHttpTxn txnp)
+{
+  TSMBuffer bufp;
+  TSMLoc hdr_loc, field_loc, next;
+  Encoding encoding;
+
+  if (TSHttpTxnClientReqGet(txnp, &bufp, &hdr_loc) != TS_SUCCESS)
+    return;
+
+  field_loc = TSMimeHdrFieldFind(bufp, hdr_loc, TS_MIME_FIELD_ACCEPT_ENCODING, TS_MIME_LEN_ACCEPT_ENCODING);
+  if (field_loc) {
+    encoding = ENCODING_NONE;
+    while (field_loc) {
+      Encoding e = accepted_encoding(bufp, hdr_loc, field_loc);
+
+      if (e != ENCODING_NONE && (encoding == ENCODING_NONE || e == ENCODING_GZIP))
+        encoding = e;
+      next = TSMimeHdrFieldNextDup(bufp, hdr_loc, field_loc);
+      TSMimeHdrFieldDestroy(bufp, hdr_loc, field_loc);
+      TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+      field_loc = next;
+    }
+
+    if (encoding != ENCODING_NONE &&
+        TSMimeHdrFieldCreateNamed(bufp, hdr_loc, TS_MIME_FIELD_ACCEPT_ENCODING, TS_MIME_LEN_ACCEPT_ENCODING,
+                                  &field_loc) == TS_SUCCESS) {
+      if (encoding == ENCODING_GZIP)
+        TSMimeHdrFieldValueStringInsert(bufp, hdr_loc, field_loc, -1, "gzip", 4);
+      else
+        TSMimeHdrFieldValueStringInsert(bufp, hdr_loc, field_loc, -1, "deflate", 7);
+      TSMimeHdrFieldAppend(bufp, hdr_loc, field_loc);
+      TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+    }
+  }
+
+  TSHandleMLocRelease(bufp, TS_NULL_MLOC, hdr_loc);
+}
+
+static int
+is_no_transform(const char *value, int len)
+{
+  return len == TS_HTTP_LEN_NO_TRANSFORM && !strncasecmp(value, TS_HTTP_VALUE_NO_TRANSFORM, len);
+}
+
+/* Whether any value of the name fields is one match takes */
+static int
+has_value(TSMBuffer bufp, TSMLoc hdr_loc, const char *name, int name_len, int (*match) (const char *, int))
+{
+  TSMLoc field_loc = TSMimeHdrFieldFind(bufp, hdr_loc, name, name_len);
+  int found = 0;
+
+  while (field_loc && !found) {
+    int count = TSMimeHdrFieldValuesCount(bufp, hdr_loc, field_loc);
+    TSMLoc next;
+    int i;
+
+    for (i = 0; i < count && !found; i++) {
+      int len;
+      const char *value = TSMimeHdrFieldValueStringGet(bufp, hdr_loc, field_loc, i, &len);
+
+      found = (value && match(value, len));
+    }
+    next = TSMimeHdrFieldNextDup(bufp, hdr_loc, field_loc);
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+    field_loc = next;
+  }
+  if (field_loc)
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+  return found;
+}
+
+/* Whether the origin response is one we compress, whatever the client
+ * takes: a 200 with a body of an allowed type, not encoded already.
+ */
+static int
+compressible(TSMBuffer bufp, TSMLoc hdr_loc)
+{
+  TSMLoc field_loc;
+  const char *value;
+  int len, ok;
+
+  if (TSHttpHdrStatusGet(bufp, hdr_loc) != TS_HTTP_STATUS_OK)
+    return 0;
+
+  field_loc = TSMimeHdrFieldFind(bufp, hdr_loc, TS_MIME_FIELD_CONTENT_ENCODING, TS_MIME_LEN_CONTENT_ENCODING);
+  if (field_loc) {
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+    return 0;
+  }
+
+  field_loc = TSMimeHdrFieldFind(bufp, hdr_loc, TS_MIME_FIELD_CONTENT_TYPE, TS_MIME_LEN_CONTENT_TYPE);
+  if (!field_loc)
+    return 0;
+  value = TSMimeHdrFieldValueStringGet(bufp, hdr_loc, field_loc, -1, &len);
+  ok = value && gzip_type_allowed(value, len, types, num_types);
+  TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+  if (!ok)
+    return 0;
+
+  field_loc = TSMimeHdrFieldFind(bufp, hdr_loc, TS_MIME_FIELD_CONTENT_LENGTH, TS_MIME_LEN_CONTENT_LENGTH);
+  if (field_loc) {
+    ok = TSMimeHdrFieldValueInt64Get(bufp, hdr_loc, field_loc, -1) >= min_size;
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+    if (!ok)
+      return 0;
+  }
+
+  return !has_value(bufp, hdr_loc, TS_MIME_FIELD_CACHE_CONTROL, TS_MIME_LEN_CACHE_CONTROL, is_no_transform);
+}
+
+/* Both variants vary on Accept-Encoding, for the caches downstream. */
+static void
+vary_header(TSMBuffer bufp, TSMLoc hdr_loc)
+{
+  TSMLoc field_loc;
+
+  if (has_value(bufp, hdr_loc, TS_MIME_FIELD_VARY, TS_MIME_LEN_VARY, gzip_vary_covers))
+    return;
+
+  field_loc = TSMimeHdrFieldFind(bufp, hdr_loc, TS_MIME_FIELD_VARY, TS_MIME_LEN_VARY);
+  if (field_loc) {
+    TSMimeHdrFieldValueStringInsert(bufp, hdr_loc, field_loc, -1, TS_MIME_FIELD_ACCEPT_ENCODING,
+                                    TS_MIME_LEN_ACCEPT_ENCODING);
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+  } else if (TSMimeHdrFieldCreateNamed(bufp, hdr_loc, TS_MIME_FIELD_VARY, TS_MIME_LEN_VARY, &field_loc) == TS_SUCCESS) {
+    TSMimeHdrFieldValueStringInsert(bufp, hdr_loc, field_loc, -1, TS_MIME_FIELD_ACCEPT_ENCODING,
+                                    TS_MIME_LEN_ACCEPT_ENCODING);
+    TSMimeHdrFieldAppend(bufp, hdr_loc, field_loc);
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+  }
+}
+
+/* The encoding the (normalized) client request asks for, none for HEAD */
+static Encoding
+client_encoding(TSHttpTxn txnp)
+{
+  TSMBuffer bufp;
+  TSMLoc hdr_loc, field_loc;
+  Encoding encoding = ENCODING_NONE;
+  const char *method;
+  int len;
+
+  if (TSHttpTxnClientReqGet(txnp, &bufp, &hdr_loc) != TS_SUCCESS)
+    return ENCODING_NONE;
+
+  method = TSHttpHdrMethodGet(bufp, hdr_loc, &len);
+  if (method != TS_HTTP_METHOD_HEAD) {
+    field_loc = TSMimeHdrFieldFind(bufp, hdr_loc, TS_MIME_FIELD_ACCEPT_ENCODING, TS_MIME_LEN_ACCEPT_ENCODING);
+    if (field_loc) {
+      encoding = accepted_encoding(bufp, hdr_loc, field_loc);
+      TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+    }
+  }
+
+  TSHandleMLocRelease(bufp, TS_NULL_MLOC, hdr_loc);
+  return encoding;
+}
+
+static void
+handle_response(TSHttpTxn txnp)
+{
+  TSMBuffer bufp;
+  TSMLoc hdr_loc;
+  Encoding encoding;
+  GzipData *data;
+  TSVConn connp;
+
+  if (TSHttpTxnServerRespGet(txnp, &bufp, &hdr_loc) != TS_SUCCESS)
+    return;
+
+  if (!compressible(bufp, hdr_loc)) {
+    TSHandleMLocRelease(bufp, TS_NULL_MLOC, hdr_loc);
+    return;
+  }
+  vary_header(bufp, hdr_loc);
+  TSHandleMLocRelease(bufp, TS_NULL_MLOC, hdr_loc);
+
+  encoding = client_encoding(txnp);
+  if (encoding == ENCODING_NONE)
+    return;
+  if ((data = gzip_data_alloc(txnp, encoding)) == NULL)
+    return;
+
+  TSDebug(PLUGIN_NAME, "compressing with %s", encoding == ENCODING_GZIP ? "gzip" : "deflate");
+  connp = TSTransformCreate(gzip_transform, txnp);
+  TSContDataSet(connp, data);
+  TSHttpTxnHookAdd(txnp, TS_HTTP_RESPONSE_TRANSFORM_HOOK, connp);
+
+  /* cache the compressed variant, the other one is fetched when a
+   * client asks for it
+   */
+  TSHttpTxnUntransformedRespCache(txnp, 0);
+  TSHttpTxnTransformedRespCache(txnp, 1);
+}
+
+static int
+gzip_plugin(TSCont contp, TSEvent event, void *edata)
+{
+  TSHttpTxn txnp = (TSHttpTxn) edata;
+
+  switch (event) {
+  case TS_EVENT_HTTP_READ_REQUEST_HDR:
+    normalize_accept_encoding(txnp);
+    break;
+  case TS_EVENT_HTTP_READ_RESPONSE_HDR:
+    handle_response(txnp);
+    break;
+  default:
+    break;
+  }
+
+  TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
+  return 0;
+}
+
+static void
+add_type(const char *type, int len)
+{
+  while (len > 0 && *type == ' ') {
+    type++;
+    len--;
+  }
+  while (len > 0 && type[len - 1] == ' ')
+    len--;
+  if (len == 0)
+    return;
+  if (num_types == MAX_TYPES) {
+    TSError("[%s] too many content types, %.*s is ignored\n", PLUGIN_NAME, len, type);
+    return;
+  }
+  types[num_types++] = TSstrndup(type, len);
+}
+
+void
+TSPluginInit(int argc, const char *argv[])
+{
+  TSPluginRegistrationInfo info;
+  TSCont contp;
+  int i;
+
+  info.plugin_name = PLUGIN_NAME;
+  info.vendor_name = "Apache Software Foundation";
+  info.support_email = "dev@trafficserver.apache.org";
+
+  if (TSPluginRegister(TS_SDK_VERSION_3_0, &info) != TS_SUCCESS) {
+    TSError("[%s] Plugin registration failed.\n", PLUGIN_NAME);
+    return;
+  }
+
+  for (i = 1; i < argc; i++) {
+    if (!strncmp(argv[i], "--level=", 8)) {
+      compression_level = atoi(argv[i] + 8);
+      if (compression_level < 1 || compression_level > 9) {
+        TSError("[%s] level must be 1 to 9, using the default\n", PLUGIN_NAME);
+        compression_level = Z_DEFAULT_COMPRESSION;
+      }
+    } else if (!strncmp(argv[i], "--min-size=", 11)) {
+      min_size = strtoll(argv[i] + 11, NULL, 10);
+    } else if (!strncmp(argv[i], "--types=", 8)) {
+      const char *p = argv[i] + 8, *comma;
+
+      while ((comma = strchr(p, ',')) != NULL) {
+        add_type(p, comma - p);
+        p = comma + 1;
+      }
+      add_type(p, strlen(p));
+    } else {
+      TSError("[%s] unknown argument %s\n", PLUGIN_NAME, argv[i]);
+    }
+  }
+  if (num_types == 0) {
+    for (i = 0; i < (int) (sizeof(default_types) / sizeof(default_types[0])); i++)
+      add_type(default_types[i], strlen(default_types[i]));
+  }
+
+  contp = TSContCreate(gzip_plugin, NULL);
+  TSHttpHookAdd(TS_HTTP_READ_REQUEST_HDR_HOOK, contp);
+  TSHttpHookAdd(TS_HTTP_READ_RESPONSE_HDR_HOOK, contp);
+  TSDebug(PLUGIN_NAME, "level %d, %d content types, min size %" PRId64, compression_level, num_types, min_size);
+}
@@ -0,0 +1,88 @@
+/** @file
+
+  The header rules of the gzip plugin, on plain header values
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/* gzip_rules.c: what the plugin decides from header values, apart from
+ * the API calls that get the values, so that test_gzip can check it.
+ */
+
+#include <string.h>
+#include <strings.h>
+#include "gzip_rules.h"
+
+Encoding
+gzip_value_encoding(const char *value, int len)
+{
+  int name_len, p;
+
+  for (name_len = 0; name_len < len && value[name_len] != ';' && value[name_len] != ' '; name_len++);
+  for (p = name_len; p + 2 < len && !(value[p] == 'q' && value[p + 1] == '='); p++);
+  if (p + 2 < len && value[p + 2] == '0') {
+    /* q=0, q=0.0 or q=0.000, but not q=0.5 */
+    for (p += 3; p < len && (value[p] == '.' || value[p] == '0'); p++);
+    if (p == len || value[p] == ' ' || value[p] == ';')
+      return ENCODING_NONE;
+  }
+  if ((name_len == 4 && !strncasecmp(value, "gzip", 4)) || (name_len == 6 && !strncasecmp(value, "x-gzip", 6)))
+    return ENCODING_GZIP;
+  if (name_len == 7 && !strncasecmp(value, "deflate", 7))
+    return ENCODING_DEFLATE;
+  return ENCODING_NONE;
+}
+
+int
+gzip_vary_covers(const char *value, int len)
+{
+  return (len == 15 && !strncasecmp(value, "Accept-Encoding", 15)) || (len == 1 && value[0] == '*');
+}
+
+int
+gzip_type_allowed(const char *value, int len, char *const *types, int num_types)
+{
+  int type_len, i;
+
+  /* just the media type, without its parameters */
+  for (type_len = 0; type_len < len && value[type_len] != ';' && value[type_len] != ' '; type_len++);
+
+  for (i = 0; i < num_types; i++) {
+    int n = strlen(types[i]);
+
+    if (n >= 2 && types[i][n - 1] == '*' && types[i][n - 2] == '/') {
+      if (type_len >= n - 1 && !strncasecmp(value, types[i], n - 1))
+        return 1;
+    } else if (type_len == n && !strncasecmp(value, types[i], n)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int
+gzip_weak_etag(const char *value, int len, char *weak)
+{
+  if (len <= 0 || value[0] != '"')
+    return 0;
+  weak[0] = 'W';
+  weak[1] = '/';
+  memcpy(weak + 2, value, len);
+  return len + 2;
+}
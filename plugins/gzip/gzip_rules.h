@@ -0,0 +1,55 @@
+/** @file
+
+  The header rules of the gzip plugin, on plain header values
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _GZIP_RULES_H_
+#define _GZIP_RULES_H_
+
+typedef enum
+{
+  ENCODING_NONE,
+  ENCODING_GZIP,
+  ENCODING_DEFLATE
+} Encoding;
+
+/* The coding one Accept-Encoding value accepts: gzip (or x-gzip),
+ * deflate, or none for any other coding and for q=0.
+ */
+Encoding gzip_value_encoding(const char *value, int len);
+
+/* Whether a Vary value already covers Accept-Encoding: it names it, or
+ * it is "*".
+ */
+int gzip_vary_covers(const char *value, int len);
+
+/* Whether a Content-Type value is one of types, ignoring parameters. A
+ * subtype of "*" matches all the subtypes of its type.
+ */
+int gzip_type_allowed(const char *value, int len, char *const *types, int num_types);
+
+/* The ETag of the compressed response: a strong ETag made weak, written
+ * to weak, which has room for len + 2 bytes. Returns the length written,
+ * or 0 when the ETag is weak already (or not an ETag) and stays as it is.
+ */
+int gzip_weak_etag(const char *value, int len, char *weak);
+
+#endif /* _GZIP_RULES_H_ */
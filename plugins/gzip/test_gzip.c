@@ -0,0 +1,134 @@
+/** @file
+
+  Test code for the header rules of the gzip plugin: which coding an
+  Accept-Encoding asks for, when Vary is left alone, which content types
+  are compressed and how the ETag changes.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "gzip_rules.h"
+
+static int failures = 0;
+
+static void
+check(int ok, const char *what, const char *value)
+{
+  if (!ok) {
+    printf("FAILED: %s: '%s'\n", what, value);
+    ++failures;
+  }
+}
+
+static void
+test_accept_encoding(void)
+{
+  static const struct
+  {
+    const char *value;
+    Encoding encoding;
+  } cases[] = {
+    { "gzip", ENCODING_GZIP },
+    { "GZip", ENCODING_GZIP },
+    { "x-gzip", ENCODING_GZIP },
+    { "gzip;q=0.5", ENCODING_GZIP },
+    { "gzip; q=1", ENCODING_GZIP },
+    { "gzip;q=0.01", ENCODING_GZIP },
+    { "gzip;q=0", ENCODING_NONE },
+    { "gzip; q=0.0", ENCODING_NONE },
+    { "gzip;q=0.000", ENCODING_NONE },
+    { "x-gzip;q=0 ", ENCODING_NONE },
+    { "deflate", ENCODING_DEFLATE },
+    { "deflate;q=0.1", ENCODING_DEFLATE },
+    { "deflate;q=0", ENCODING_NONE },
+    { "gzipped", ENCODING_NONE },
+    { "gzi", ENCODING_NONE },
+    { "identity", ENCODING_NONE },
+    { "br", ENCODING_NONE },
+    { "*", ENCODING_NONE },
+    { "", ENCODING_NONE }
+  };
+  int i;
+
+  for (i = 0; i < (int) (sizeof(cases) / sizeof(cases[0])); i++)
+    check(gzip_value_encoding(cases[i].value, strlen(cases[i].value)) == cases[i].encoding, "Accept-Encoding",
+          cases[i].value);
+}
+
+static void
+test_vary(void)
+{
+  static const char *covered[] = { "Accept-Encoding", "accept-encoding", "*" };
+  static const char *not_covered[] = { "Accept", "Accept-Language", "Cookie", "Accept-Encodings", "**", "" };
+  int i;
+
+  for (i = 0; i < (int) (sizeof(covered) / sizeof(covered[0])); i++)
+    check(gzip_vary_covers(covered[i], strlen(covered[i])), "Vary should be left alone", covered[i]);
+  for (i = 0; i < (int) (sizeof(not_covered) / sizeof(not_covered[0])); i++)
+    check(!gzip_vary_covers(not_covered[i], strlen(not_covered[i])), "Vary needs Accept-Encoding", not_covered[i]);
+}
+
+static void
+test_content_type(void)
+{
+  static char *types[] = { "text/html", "application/json", "image/*" };
+  static const char *allowed[] = { "text/html", "TEXT/HTML", "text/html; charset=utf-8", "text/html;charset=utf-8",
+    "application/json", "image/svg+xml", "image/png"
+  };
+  static const char *refused[] = { "text/htm", "text/htmlx", "text/plain", "application/jsonp", "imagex/png",
+    "image", ""
+  };
+  int i;
+
+  for (i = 0; i < (int) (sizeof(allowed) / sizeof(allowed[0])); i++)
+    check(gzip_type_allowed(allowed[i], strlen(allowed[i]), types, 3), "type should be compressed", allowed[i]);
+  for (i = 0; i < (int) (sizeof(refused) / sizeof(refused[0])); i++)
+    check(!gzip_type_allowed(refused[i], strlen(refused[i]), types, 3), "type should not be compressed", refused[i]);
+}
+
+static void
+test_etag(void)
+{
+  static const char *strong = "\"abc-123\"";
+  static const char *unchanged[] = { "W/\"abc-123\"", "abc", "" };
+  char weak[32];
+  int len, i;
+
+  len = gzip_weak_etag(strong, strlen(strong), weak);
+  check(len == (int) strlen(strong) + 2 && !memcmp(weak, "W/\"abc-123\"", len), "strong ETag not made weak", strong);
+  for (i = 0; i < (int) (sizeof(unchanged) / sizeof(unchanged[0])); i++)
+    check(gzip_weak_etag(unchanged[i], strlen(unchanged[i]), weak) == 0, "ETag should be left alone", unchanged[i]);
+}
+
+int
+main(void)
+{
+  test_accept_encoding();
+  test_vary();
+  test_content_type();
+  test_etag();
+
+  if (failures)
+    printf("test_gzip: %d failures\n", failures);
+  else
+    printf("test_gzip: passed\n");
+  return failures ? 1 : 0;
+}
@@ -50,6 +50,8 @@ static char UNUSED rcsId__regex_remap_cc[] = "@(#) $Id$ built on " __DATE__ " "
 #include "ink_platform.h"
 #include "ink_atomic.h"
 #include "ink_time.h"
+#include "Regex.h"
+#include "AhoCorasick.h"
 
 static const char* PLUGIN_NAME = "regex_remap";
 
@@ -122,7 +124,7 @@ class RemapRegex
 {
  public:
   RemapRegex(const std::string& reg, const std::string& sub, const std::string& opt) :
-    _num_subs(-1), _rex(NULL), _extra(NULL), _order(-1), _simple(false),
+    _num_subs(-1), _rex(NULL), _extra(NULL), _literal(NULL), _literal_id(-1), _order(-1), _simple(false),
     _active_timeout(-1), _no_activity_timeout(-1), _connect_timeout(-1), _dns_timeout(-1)
   {
     TSDebug(PLUGIN_NAME, "Calling constructor");
@@ -196,10 +198,18 @@ class RemapRegex
     if (_subst)
       TSfree(_subst);
 
+    if (_literal)
+      TSfree(_literal);
+
     if (_rex)
       pcre_free(_rex);
-    if (_extra)
+    if (_extra) {
+#ifdef PCRE_STUDY_JIT_COMPILE
+      pcre_free_study(_extra);
+#else
       pcre_free(_extra);
+#endif
+    }
   };
 
   // For profiling information
@@ -215,12 +225,13 @@ class RemapRegex
     ink_atomic_increment(&(_hits), 1);
   }
 
-  // Compile and study the regular expression.
+  // Compile and study the regular expression, with the JIT if pcre has one.
   int
   compile(const char** error, int* erroffset)
   {
     char* str;
     int ccount;
+    char literal[256];
 
     _rex = pcre_compile(_rex_string,          // the pattern
                         0,                    // default options
@@ -231,10 +242,20 @@ class RemapRegex
     if (NULL == _rex)
       return -1;
 
+#ifdef PCRE_STUDY_JIT_COMPILE
+    _extra = pcre_study(_rex, PCRE_STUDY_JIT_COMPILE, error);
+#else
     _extra = pcre_study(_rex, 0, error);
+#endif
     if ((_extra == NULL) && (*error != 0))
       return -1;
 
+    // A string that every match contains, for the prefilter
+    if (!_simple && (regex_required_literal(_rex_string, literal, sizeof(literal)) > 0)) {
+      _literal = TSstrdup(literal);
+      TSDebug(PLUGIN_NAME, "Regex %s requires `%s'", _rex_string, _literal);
+    }
+
     if (pcre_fullinfo(_rex, _extra, PCRE_INFO_CAPTURECOUNT, &ccount) != 0)
       return -1;
 
@@ -302,6 +323,13 @@ class RemapRegex
     return 0;
   };
 
+  // Can this rule match, given the literals the prefilter found in the string?
+  inline bool
+  candidate(const uint8_t found[]) const
+  {
+    return (_literal_id < 0) || found[_literal_id];
+  }
+
   // Perform the regular expression matching against a string.
   int
   match(const char* str, int len, int ovector[])
@@ -464,9 +492,14 @@ class RemapRegex
   inline void set_order(int order) { _order = order; };
   inline int order() { return _order; };
 
+  // setter / getters for the index of the literal in the prefilter
+  inline void set_literal_id(int id) { _literal_id = id; };
+  inline int literal_id() const { return _literal_id; };
+
   // Various getters
   inline const char* regex() const { return _rex_string;  };
   inline const char* substitution() const { return _subst;  };
+  inline const char* literal() const { return _literal;  };
   inline int substitutions_used() const { return _num_subs; }
 
   inline bool is_simple() const { return _simple; }
@@ -486,6 +519,8 @@ class RemapRegex
 
   pcre* _rex;
   pcre_extra* _extra;
+  char* _literal;
+  int _literal_id;
   int _sub_pos[MAX_SUBS];
   int _sub_ix[MAX_SUBS];
   RemapRegex* _next;
@@ -502,10 +537,33 @@ struct RemapInstance
 {
   RemapInstance() :
     first(NULL), last(NULL), profile(false), method(false), query_string(true),
-    matrix_params(false), hits(0), misses(0),
+    matrix_params(false), hits(0), misses(0), num_literals(0),
     filename("unknown")
   { };
 
+  // Compile the literals of all the rules into the prefilter
+  void
+  build_prefilter()
+  {
+    int count = 0;
+    const char** patterns;
+
+    for (RemapRegex* re = first; re; re = re->next())
+      ++count;
+    patterns = static_cast<const char**>(TSmalloc(count * sizeof(const char*)));
+
+    num_literals = 0;
+    for (RemapRegex* re = first; re; re = re->next()) {
+      if (re->literal()) {
+        re->set_literal_id(num_literals);
+        patterns[num_literals++] = re->literal();
+      }
+    }
+    literals.compile(patterns, num_literals);
+    TSDebug(PLUGIN_NAME, "Prefilter for %d rules has %d literals", count, num_literals);
+    TSfree(patterns);
+  }
+
   RemapRegex* first;
   RemapRegex* last;
   bool profile;
@@ -514,6 +572,8 @@ struct RemapInstance
   bool matrix_params;
   int hits;
   int misses;
+  AhoCorasick literals;
+  int num_literals;
   std::string filename;
 };
 
@@ -691,6 +751,8 @@ TSRemapNewInstance(int argc, char* argv[], void** ih, char* errbuf, int errbuf_s
     return TS_ERROR;
   }
 
+  ri->build_prefilter();
+
   return TS_SUCCESS;
 }
 
@@ -763,6 +825,7 @@ TSRemapDoRemap(void* ih, TSHttpTxn txnp, TSRemapRequestInfo *rri)
   RemapRegex* re = ri->first;
   int match_len = 0;
   char *match_buf;
+  uint8_t *found = NULL;
 
   match_buf = (char*)alloca(req_url.url_len + 32);
 
@@ -802,10 +865,18 @@ TSRemapDoRemap(void* ih, TSHttpTxn txnp, TSRemapRequestInfo *rri)
   match_buf[match_len] = '\0'; // NULL terminate the match string
   TSDebug(PLUGIN_NAME, "Target match string is `%s'", match_buf);
 
+  // Find the literals of all rules in one pass, rules missing theirs are skipped below
+  if (ri->num_literals > 0) {
+    found = (uint8_t*)alloca(ri->num_literals);
+    memset(found, 0, ri->num_literals);
+    ri->literals.match_all(match_buf, match_len, found);
+  }
+
   // Apply the regular expressions, in order. First one wins.
   while (re) {
     // Since we check substitutions on parse time, we don't need to reset ovector
-    if (re->is_simple() || (re->match(match_buf, match_len, ovector) != -1)) {
+    if (re->is_simple() ||
+        ((!found || re->candidate(found)) && (re->match(match_buf, match_len, ovector) != -1))) {
       int new_len = re->get_lengths(ovector, lengths, rri, &req_url);
 
       // Set timeouts
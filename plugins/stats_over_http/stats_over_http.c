@@ -45,8 +45,51 @@ typedef struct stats_state_t
 
   int output_bytes;
   int body_written;
+
+  int export_request;           /* _stats/export rather than _stats */
+  char *prefix;                 /* only records starting with this */
+  int64_t since;                /* only records changed after this generation */
 } stats_state;
 
+/* One record as of a snapshot */
+typedef struct stat_value_t
+{
+  char *name;
+  TSRecordDataType data_type;
+  TSRecordData datum;           /* rec_string is our own copy */
+  int64_t changed;              /* generation it last changed in */
+} stat_value;
+
+typedef struct stat_histogram_t
+{
+  char *name;
+  int64_t *buckets;
+  int nbuckets;
+  int64_t changed;
+} stat_histogram;
+
+/* All the PROCESS records and histograms, taken once per stats sync and
+   shared by every scrape until the next one. Both arrays are sorted by
+   name, so prefixes are a binary search away and the changes since the
+   previous snapshot come from a merge of the two. */
+typedef struct stats_snapshot_t
+{
+  int refcount;                 /* protected by snapshot_mutex */
+  int64_t generation;
+
+  stat_value *values;
+  int nvalues;
+  int max_values;
+
+  stat_histogram *histograms;
+  int nhistograms;
+  int max_histograms;
+} stats_snapshot;
+
+static TSMutex snapshot_mutex;
+static stats_snapshot *current_snapshot;
+static int64_t next_generation = 1;
+
 static void
 stats_cleanup(TSCont contp, stats_state * my_state)
 {
@@ -59,6 +102,8 @@ stats_cleanup(TSCont contp, stats_state * my_state)
     TSIOBufferDestroy(my_state->resp_buffer);
     my_state->resp_buffer = NULL;
   }
+  if (my_state->prefix)
+    TSfree(my_state->prefix);
   TSVConnClose(my_state->net_vc);
   TSfree(my_state);
   TSContDestroy(contp);
@@ -88,8 +133,9 @@ static int
 stats_add_resp_header(stats_state * my_state)
 {
   char resp[] = "HTTP/1.0 200 Ok\r\nContent-Type: text/javascript\r\nCache-Control: no-cache\r\n\r\n";
+  char export_resp[] = "HTTP/1.0 200 Ok\r\nContent-Type: text/plain\r\nCache-Control: no-cache\r\n\r\n";
 
-  return stats_add_data_to_resp_buffer(resp, my_state);
+  return stats_add_data_to_resp_buffer(my_state->export_request ? export_resp : resp, my_state);
 }
 
 static void
@@ -113,6 +159,195 @@ stats_process_read(TSCont contp, TSEvent event, stats_state * my_state)
   }
 }
 
+static stats_snapshot *
+snapshot_acquire(void)
+{
+  stats_snapshot *snap;
+
+  TSMutexLock(snapshot_mutex);
+  snap = current_snapshot;
+  if (snap)
+    snap->refcount++;
+  TSMutexUnlock(snapshot_mutex);
+  return snap;
+}
+
+static void
+snapshot_release(stats_snapshot * snap)
+{
+  int i, refcount;
+
+  TSMutexLock(snapshot_mutex);
+  refcount = --snap->refcount;
+  TSMutexUnlock(snapshot_mutex);
+  if (refcount > 0)
+    return;
+
+  for (i = 0; i < snap->nvalues; i++) {
+    TSfree(snap->values[i].name);
+    if (snap->values[i].data_type == TS_RECORDDATATYPE_STRING && snap->values[i].datum.rec_string)
+      TSfree(snap->values[i].datum.rec_string);
+  }
+  for (i = 0; i < snap->nhistograms; i++) {
+    TSfree(snap->histograms[i].name);
+    TSfree(snap->histograms[i].buckets);
+  }
+  if (snap->values)
+    TSfree(snap->values);
+  if (snap->histograms)
+    TSfree(snap->histograms);
+  TSfree(snap);
+}
+
+static void
+snapshot_add_value(TSRecordType rec_type, void *edata, int registered,
+                   const char *name, TSRecordDataType data_type, TSRecordData * datum)
+{
+  stats_snapshot *snap = edata;
+  stat_value *v;
+
+  if (snap->nvalues == snap->max_values) {
+    snap->max_values = snap->max_values ? snap->max_values * 2 : 1024;
+    snap->values = TSrealloc(snap->values, snap->max_values * sizeof(stat_value));
+  }
+  v = &snap->values[snap->nvalues++];
+  v->name = TSstrdup(name);
+  v->data_type = data_type;
+  v->datum = *datum;
+  if (data_type == TS_RECORDDATATYPE_STRING && datum->rec_string)
+    v->datum.rec_string = TSstrdup(datum->rec_string);
+  v->changed = 0;
+}
+
+static void
+snapshot_add_histogram(void *edata, const char *name, const int64_t * buckets, int nbuckets)
+{
+  stats_snapshot *snap = edata;
+  stat_histogram *h;
+
+  if (snap->nhistograms == snap->max_histograms) {
+    snap->max_histograms = snap->max_histograms ? snap->max_histograms * 2 : 32;
+    snap->histograms = TSrealloc(snap->histograms, snap->max_histograms * sizeof(stat_histogram));
+  }
+  h = &snap->histograms[snap->nhistograms++];
+  h->name = TSstrdup(name);
+  h->buckets = TSmalloc(nbuckets * sizeof(int64_t));
+  memcpy(h->buckets, buckets, nbuckets * sizeof(int64_t));
+  h->nbuckets = nbuckets;
+  h->changed = 0;
+}
+
+static int
+stat_value_cmp(const void *a, const void *b)
+{
+  return strcmp(((const stat_value *) a)->name, ((const stat_value *) b)->name);
+}
+
+static int
+stat_histogram_cmp(const void *a, const void *b)
+{
+  return strcmp(((const stat_histogram *) a)->name, ((const stat_histogram *) b)->name);
+}
+
+static int
+stat_value_equal(const stat_value * a, const stat_value * b)
+{
+  if (a->data_type != b->data_type)
+    return 0;
+
+  switch (a->data_type) {
+  case TS_RECORDDATATYPE_COUNTER:
+    return a->datum.rec_counter == b->datum.rec_counter;
+  case TS_RECORDDATATYPE_INT:
+    return a->datum.rec_int == b->datum.rec_int;
+  case TS_RECORDDATATYPE_FLOAT:
+    return a->datum.rec_float == b->datum.rec_float;
+  case TS_RECORDDATATYPE_STRING:
+    if (!a->datum.rec_string || !b->datum.rec_string)
+      return a->datum.rec_string == b->datum.rec_string;
+    return !strcmp(a->datum.rec_string, b->datum.rec_string);
+  default:
+    return 1;
+  }
+}
+
+/* Carry over the generation each value last changed in from the previous
+   snapshot, both are sorted by name */
+static void
+snapshot_mark_changes(stats_snapshot * snap, stats_snapshot * prev)
+{
+  int i, j;
+
+  for (i = 0, j = 0; i < snap->nvalues; i++) {
+    stat_value *v = &snap->values[i];
+
+    while (prev && j < prev->nvalues && strcmp(prev->values[j].name, v->name) < 0)
+      j++;
+    if (prev && j < prev->nvalues && !strcmp(prev->values[j].name, v->name) && stat_value_equal(v, &prev->values[j]))
+      v->changed = prev->values[j].changed;
+    else
+      v->changed = snap->generation;
+  }
+
+  for (i = 0, j = 0; i < snap->nhistograms; i++) {
+    stat_histogram *h = &snap->histograms[i];
+
+    while (prev && j < prev->nhistograms && strcmp(prev->histograms[j].name, h->name) < 0)
+      j++;
+    if (prev && j < prev->nhistograms && !strcmp(prev->histograms[j].name, h->name) &&
+        prev->histograms[j].nbuckets == h->nbuckets &&
+        !memcmp(prev->histograms[j].buckets, h->buckets, h->nbuckets * sizeof(int64_t)))
+      h->changed = prev->histograms[j].changed;
+    else
+      h->changed = snap->generation;
+  }
+}
+
+static int
+stats_snapshot_take(TSCont contp, TSEvent event, void *edata)
+{
+  stats_snapshot *snap, *prev;
+
+  snap = (stats_snapshot *) TSmalloc(sizeof(*snap));
+  memset(snap, 0, sizeof(*snap));
+  snap->refcount = 1;           /* current_snapshot's */
+  snap->generation = next_generation++;
+
+  TSRecordDump(TS_RECORDTYPE_PROCESS, snapshot_add_value, snap);
+  TSRecordHistogramDump(snapshot_add_histogram, snap);
+  qsort(snap->values, snap->nvalues, sizeof(stat_value), stat_value_cmp);
+  qsort(snap->histograms, snap->nhistograms, sizeof(stat_histogram), stat_histogram_cmp);
+
+  /* this continuation is the only writer, so prev stays the current one */
+  prev = snapshot_acquire();
+  snapshot_mark_changes(snap, prev);
+
+  TSMutexLock(snapshot_mutex);
+  current_snapshot = snap;
+  TSMutexUnlock(snapshot_mutex);
+
+  if (prev) {
+    snapshot_release(prev);     /* ours */
+    snapshot_release(prev);     /* current_snapshot's */
+  }
+  TSDebug("istats", "snapshot %" PRId64 ": %d records, %d histograms",
+          snap->generation, snap->nvalues, snap->nhistograms);
+  return 0;
+}
+
+/* Index of the first name >= prefix */
+#define LOWER_BOUND(array, n, prefix, result) do { \
+  int lo = 0, hi = (n); \
+  while (lo < hi) { \
+    int mid = (lo + hi) / 2; \
+    if (strcmp((array)[mid].name, (prefix)) < 0) \
+      lo = mid + 1; \
+    else \
+      hi = mid; \
+  } \
+  (result) = lo; \
+} while(0)
+
 #define APPEND(a) my_state->output_bytes += stats_add_data_to_resp_buffer(a, my_state)
 #define APPEND_STAT(a, fmt, v) do { \
   char b[256]; \
@@ -144,9 +379,17 @@ static void
 json_out_stats(stats_state * my_state)
 {
   const char *version;
+  stats_snapshot *snap;
+  int i;
+
   APPEND("{ \"global\": {\n");
 
-  TSRecordDump(TS_RECORDTYPE_PROCESS, json_out_stat, my_state);
+  if ((snap = snapshot_acquire()) != NULL) {
+    for (i = 0; i < snap->nvalues; i++)
+      json_out_stat(TS_RECORDTYPE_PROCESS, my_state, 1, snap->values[i].name,
+                    snap->values[i].data_type, &snap->values[i].datum);
+    snapshot_release(snap);
+  }
   version = TSTrafficServerVersionGet();
   APPEND("\"server\": \"");
   APPEND(version);
@@ -154,6 +397,77 @@ json_out_stats(stats_state * my_state)
   APPEND("  }\n}\n");
 }
 
+/* Text export, one line per value:
+     # generation <N>
+     <name> <value>
+     <histogram name>.bucket <low> <high> <count>   (non empty buckets only)
+   limited to the names starting with prefix, and to what changed after
+   generation since. */
+static void
+export_out_stats(stats_state * my_state)
+{
+  stats_snapshot *snap;
+  const char *prefix = my_state->prefix ? my_state->prefix : "";
+  int prefix_len = strlen(prefix);
+  int64_t since = my_state->since;
+  char b[1024];
+  int i, j;
+
+  if ((snap = snapshot_acquire()) == NULL) {
+    APPEND("# generation 0\n");
+    return;
+  }
+  /* a generation from before a restart, or made up: send everything */
+  if (since > snap->generation || since < 0)
+    since = 0;
+
+  snprintf(b, sizeof(b), "# generation %" PRId64 "\n", snap->generation);
+  APPEND(b);
+
+  LOWER_BOUND(snap->values, snap->nvalues, prefix, i);
+  for (; i < snap->nvalues && !strncmp(snap->values[i].name, prefix, prefix_len); i++) {
+    stat_value *v = &snap->values[i];
+
+    if (v->changed <= since)
+      continue;
+    switch (v->data_type) {
+    case TS_RECORDDATATYPE_COUNTER:
+      snprintf(b, sizeof(b), "%s %" PRId64 "\n", v->name, v->datum.rec_counter);
+      break;
+    case TS_RECORDDATATYPE_INT:
+      snprintf(b, sizeof(b), "%s %" PRId64 "\n", v->name, v->datum.rec_int);
+      break;
+    case TS_RECORDDATATYPE_FLOAT:
+      snprintf(b, sizeof(b), "%s %f\n", v->name, v->datum.rec_float);
+      break;
+    case TS_RECORDDATATYPE_STRING:
+      snprintf(b, sizeof(b), "%s %s\n", v->name, v->datum.rec_string ? v->datum.rec_string : "");
+      break;
+    default:
+      continue;
+    }
+    APPEND(b);
+  }
+
+  /* a histogram that changed is sent whole */
+  LOWER_BOUND(snap->histograms, snap->nhistograms, prefix, i);
+  for (; i < snap->nhistograms && !strncmp(snap->histograms[i].name, prefix, prefix_len); i++) {
+    stat_histogram *h = &snap->histograms[i];
+
+    if (h->changed <= since)
+      continue;
+    for (j = 0; j < h->nbuckets; j++) {
+      if (h->buckets[j] == 0)
+        continue;
+      snprintf(b, sizeof(b), "%s.bucket %" PRId64 " %" PRId64 " %" PRId64 "\n", h->name,
+               TSRecordHistogramBucketLow(j), TSRecordHistogramBucketHigh(j), h->buckets[j]);
+      APPEND(b);
+    }
+  }
+
+  snapshot_release(snap);
+}
+
 static void
 stats_process_write(TSCont contp, TSEvent event, stats_state * my_state)
 {
@@ -161,7 +475,10 @@ stats_process_write(TSCont contp, TSEvent event, stats_state * my_state)
     if (my_state->body_written == 0) {
       TSDebug("istats", "plugin adding response body");
       my_state->body_written = 1;
-      json_out_stats(my_state);
+      if (my_state->export_request)
+        export_out_stats(my_state);
+      else
+        json_out_stats(my_state);
       TSVIONBytesSet(my_state->write_vio, my_state->output_bytes);
     }
     TSVIOReenable(my_state->write_vio);
@@ -191,6 +508,36 @@ stats_dostuff(TSCont contp, TSEvent event, void *edata)
   return 0;
 }
 
+/* prefix=<name prefix>&since=<generation>, no escapes */
+static void
+stats_parse_query(stats_state * my_state, const char *query, int query_len)
+{
+  const char *p = query, *end = query + query_len;
+
+  while (p < end) {
+    const char *next = memchr(p, '&', end - p);
+    int len;
+
+    if (next == NULL)
+      next = end;
+    len = next - p;
+    if (len > 7 && !strncmp(p, "prefix=", 7)) {
+      if (my_state->prefix)
+        TSfree(my_state->prefix);
+      my_state->prefix = TSstrndup(p + 7, len - 7);
+    } else if (len > 6 && !strncmp(p, "since=", 6)) {
+      char since[32];
+
+      if (len - 6 < (int) sizeof(since)) {
+        memcpy(since, p + 6, len - 6);
+        since[len - 6] = '\0';
+        my_state->since = strtoll(since, NULL, 10);
+      }
+    }
+    p = next + 1;
+  }
+}
+
 static int
 stats_origin(TSCont contp, TSEvent event, void *edata)
 {
@@ -213,7 +560,9 @@ stats_origin(TSCont contp, TSEvent event, void *edata)
   const char* path = TSUrlPathGet(reqp,url_loc,&path_len);
   TSDebug("istats","Path: %.*s",path_len,path);
   
-  if (! (path_len != 0 && path_len == 6 && !memcmp(path,"_stats",6)) ) {
+  int export_request = (path_len == 13 && !memcmp(path, "_stats/export", 13));
+
+  if (! (path_len != 0 && path_len == 6 && !memcmp(path,"_stats",6)) && !export_request) {
     goto notforme;
   }
   
@@ -225,6 +574,14 @@ stats_origin(TSCont contp, TSEvent event, void *edata)
   icontp = TSContCreate(stats_dostuff, TSMutexCreate());
   my_state = (stats_state *) TSmalloc(sizeof(*my_state));
   memset(my_state, 0, sizeof(*my_state));
+  if (export_request) {
+    int query_len = 0;
+    const char *query = TSUrlHttpQueryGet(reqp, url_loc, &query_len);
+
+    my_state->export_request = 1;
+    if (query && query_len > 0)
+      stats_parse_query(my_state, query, query_len);
+  }
   TSContDataSet(icontp, my_state);
   TSHttpTxnIntercept(icontp, txnp);
   goto cleanup;
@@ -284,6 +641,17 @@ TSPluginInit(int argc, const char *argv[])
     return;
   }
 
+  /* Snapshot the stats as often as they are synced, for every scrape to share */
+  TSMgmtInt interval = 0;
+  TSCont snapshot_contp;
+
+  if (TSMgmtIntGet("proxy.config.raw_stat_sync_interval_ms", &interval) != TS_SUCCESS || interval <= 0)
+    interval = 5000;
+  snapshot_mutex = TSMutexCreate();
+  snapshot_contp = TSContCreate(stats_snapshot_take, TSMutexCreate());
+  TSContSchedule(snapshot_contp, 0, TS_THREAD_POOL_TASK);
+  TSContScheduleEvery(snapshot_contp, interval, TS_THREAD_POOL_TASK);
+
   /* Create a continuation with a mutex as there is a shared global structure
      containing the headers to add */
   TSHttpHookAdd(TS_HTTP_READ_REQUEST_HDR_HOOK, TSContCreate(stats_origin, NULL));
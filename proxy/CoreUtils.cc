@@ -885,6 +885,7 @@ CoreUtils::load_http_hdr(HTTPHdr * core_hdr, HTTPHdr * live_hdr)
         goto Failed;
       }
       break;
+    case HDR_HEAP_OBJ_FIELD_INDEX:
     case HDR_HEAP_OBJ_EMPTY:
       break;
     case HDR_HEAP_OBJ_RAW:
@@ -2733,7 +2733,7 @@ TSMimeHdrFieldFind(TSMBuffer bufp, TSMLoc hdr_obj, const char *name, int length)
     length = strlen(name);
 
   MIMEHdrImpl *mh = _hdr_mloc_to_mime_hdr_impl(hdr_obj);
-  MIMEField *f = mime_hdr_field_find(mh, name, length);
+  MIMEField *f = mime_hdr_field_find(mh, name, length, ((HdrHeapSDKHandle *) bufp)->m_heap);
 
   if (f == NULL)
     return TS_NULL_MLOC;
@@ -7797,6 +7797,26 @@ TSRecordDump(TSRecordType rec_type, TSRecordDumpCb callback, void *edata)
   RecDumpRecords((RecT)rec_type, (RecDumpEntryCb)callback, edata);
 }
 
+void
+TSRecordHistogramDump(TSRecordHistogramDumpCb callback, void *edata)
+{
+  RecDumpRawStatHistograms((RecDumpHistogramCb)callback, edata);
+}
+
+int64_t
+TSRecordHistogramBucketLow(int bucket)
+{
+  sdk_assert(bucket >= 0 && bucket < REC_HISTOGRAM_BUCKETS);
+  return RecHistogramBucketLow(bucket);
+}
+
+int64_t
+TSRecordHistogramBucketHigh(int bucket)
+{
+  sdk_assert(bucket >= 0 && bucket < REC_HISTOGRAM_BUCKETS);
+  return RecHistogramBucketHigh(bucket);
+}
+
 /* ability to skip the remap phase of the State Machine 
    this only really makes sense in TS_HTTP_READ_REQUEST_HDR_HOOK
 */
@@ -8072,6 +8092,24 @@ _conf_to_memberp(TSOverridableConfigKey conf,
     typ = OVERRIDABLE_TYPE_INT;
     ret = &overridableHttpConfig->max_cache_open_read_retries;
     break;
+  case TS_CONFIG_HTTP_CACHE_COLLAPSED_FORWARDING:
+    ret = &overridableHttpConfig->cache_collapsed_forwarding;
+    break;
+  case TS_CONFIG_HTTP_CACHE_COLLAPSED_FORWARDING_TIMEOUT:
+    typ = OVERRIDABLE_TYPE_INT;
+    ret = &overridableHttpConfig->cache_collapsed_forwarding_timeout;
+    break;
+  case TS_CONFIG_HTTP_CACHE_STALE_WHILE_REVALIDATE:
+    typ = OVERRIDABLE_TYPE_INT;
+    ret = &overridableHttpConfig->cache_stale_while_revalidate;
+    break;
+  case TS_CONFIG_HTTP_CACHE_STALE_IF_ERROR:
+    typ = OVERRIDABLE_TYPE_INT;
+    ret = &overridableHttpConfig->cache_stale_if_error;
+    break;
+  case TS_CONFIG_HTTP_CACHE_RANGE_MISS_FILL:
+    ret = &overridableHttpConfig->cache_range_miss_fill;
+    break;
 
     // This helps avoiding compiler warnings, yet detect unhandled enum members.
   case TS_CONFIG_NULL:
@@ -8370,6 +8408,10 @@ TSHttpTxnConfigFind(const char* name, int length, TSOverridableConfigKey *conf,
       if (!strncmp(name, "proxy.config.http.send_http11_requests", length))
         cnf = TS_CONFIG_HTTP_SEND_HTTP11_REQUESTS;
       break;
+    case 'r':
+      if (!strncmp(name, "proxy.config.http.cache.stale_if_error", length))
+        cnf = TS_CONFIG_HTTP_CACHE_STALE_IF_ERROR;
+      break;
     case 't':
       if (!strncmp(name, "proxy.config.net.sock_flow_control_out", length))
         cnf = TS_CONFIG_NET_SOCK_FLOW_CTL_OUT;
@@ -8379,6 +8421,10 @@ TSHttpTxnConfigFind(const char* name, int length, TSOverridableConfigKey *conf,
 
   case 39:
     switch (name[length-1]) {
+    case 'l':
+      if (!strncmp(name, "proxy.config.http.cache.range_miss_fill", length))
+        cnf = TS_CONFIG_HTTP_CACHE_RANGE_MISS_FILL;
+      break;
     case 'm':
       if (!strncmp(name, "proxy.config.http.anonymize_remove_from", length))
         cnf = TS_CONFIG_HTTP_ANONYMIZE_REMOVE_FROM;
@@ -8500,6 +8546,10 @@ TSHttpTxnConfigFind(const char* name, int length, TSOverridableConfigKey *conf,
       if (!strncmp(name, "proxy.config.http.cache.open_read_retry_time", length))
         cnf = TS_CONFIG_HTTP_CACHE_OPEN_READ_RETRY_TIME;
       break;
+    case 'g':
+      if (!strncmp(name, "proxy.config.http.cache.collapsed_forwarding", length))
+        cnf = TS_CONFIG_HTTP_CACHE_COLLAPSED_FORWARDING;
+      break;
     }
     break;
 
@@ -8539,6 +8589,8 @@ TSHttpTxnConfigFind(const char* name, int length, TSOverridableConfigKey *conf,
         cnf = TS_CONFIG_HTTP_CACHE_HEURISTIC_MIN_LIFETIME;
       else if (!strncmp(name, "proxy.config.http.cache.heuristic_max_lifetime", length))
         cnf = TS_CONFIG_HTTP_CACHE_HEURISTIC_MAX_LIFETIME;
+      else if (!strncmp(name, "proxy.config.http.cache.stale_while_revalidate", length))
+        cnf = TS_CONFIG_HTTP_CACHE_STALE_WHILE_REVALIDATE;
       break;
     case 'r':
       if (!strncmp(name, "proxy.config.http.insert_squid_x_forwarded_for", length))
@@ -8614,6 +8666,8 @@ TSHttpTxnConfigFind(const char* name, int length, TSOverridableConfigKey *conf,
     case 't':
       if (!strncmp(name, "proxy.config.http.keep_alive_no_activity_timeout_out", length))
         cnf = TS_CONFIG_HTTP_KEEP_ALIVE_NO_ACTIVITY_TIMEOUT_OUT;
+      else if (!strncmp(name, "proxy.config.http.cache.collapsed_forwarding_timeout", length))
+        cnf = TS_CONFIG_HTTP_CACHE_COLLAPSED_FORWARDING_TIMEOUT;
       break;
     }
     break;
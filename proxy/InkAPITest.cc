@@ -6469,6 +6469,614 @@ EXCLUSIVE_REGRESSION_TEST(SDK_API_HttpTxnCache) (RegressionTest * test, int atyp
   return;
 }
 
+///////////////////////////////////////////////////////
+//       SDK_API_HttpCollapsedForwarding
+//
+// Unit Test for: proxy.config.http.cache.collapsed_forwarding
+//
+// Sends concurrent requests for the same uncached URL and
+// checks that only one of them is forwarded to the origin
+// server, the others are served the response it wrote to
+// the cache.
+///////////////////////////////////////////////////////
+
+#define COLLAPSED_TEST_ID       11
+#define COLLAPSED_CLIENTS       8
+#define COLLAPSED_ORIGIN_DELAY  200     // msecs the origin request is held back
+
+#define HTTP_REQUEST_COLLAPSED_FORMAT "GET http://127.0.0.1:%d/collapsed-%" PRId64 ".html HTTP/1.0\r\n" \
+                                      "X-Request-ID: %d\r\n" \
+                                      "\r\n"
+
+typedef struct
+{
+  RegressionTest *test;
+  int *pstatus;
+  SocketServer *os;
+  ClientTxn *browser[COLLAPSED_CLIENTS];
+  char *request;
+  int origin_requests;
+  int magic;
+} CollapsedTestData;
+
+static int
+collapsed_release_handler(TSCont contp, TSEvent event, void *edata)
+{
+  NOWARN_UNUSED(event);
+  NOWARN_UNUSED(edata);
+
+  TSHttpTxnReenable((TSHttpTxn) TSContDataGet(contp), TS_EVENT_HTTP_CONTINUE);
+  TSContDestroy(contp);
+  return 0;
+}
+
+static int
+collapsed_hook_handler(TSCont contp, TSEvent event, void *edata)
+{
+  TSHttpTxn txnp = (TSHttpTxn) edata;
+  CollapsedTestData *data = (CollapsedTestData *) TSContDataGet(contp);
+
+  if (data == NULL) {
+    switch (event) {
+    case TS_EVENT_IMMEDIATE:
+    case TS_EVENT_TIMEOUT:
+      break;
+    default:
+      TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
+      break;
+    }
+    return 0;
+  }
+
+  switch (event) {
+  case TS_EVENT_HTTP_READ_REQUEST_HDR:
+    if (get_request_id(txnp) == COLLAPSED_TEST_ID) {
+      TSSkipRemappingSet(txnp, 1);
+      TSHttpTxnConfigIntSet(txnp, TS_CONFIG_HTTP_CACHE_COLLAPSED_FORWARDING, 1);
+    }
+    TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
+    break;
+
+  case TS_EVENT_HTTP_SEND_REQUEST_HDR:
+    if (get_request_id(txnp) == COLLAPSED_TEST_ID) {
+      // Hold the origin request back for a while, so that all the
+      // clients are in by the time its response gets to the cache.
+      if (++data->origin_requests == 1) {
+        TSCont release = TSContCreate(collapsed_release_handler, TSMutexCreate());
+
+        TSContDataSet(release, txnp);
+        TSContSchedule(release, COLLAPSED_ORIGIN_DELAY, TS_THREAD_POOL_DEFAULT);
+        break;
+      }
+    }
+    TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
+    break;
+
+  case TS_EVENT_IMMEDIATE:
+  case TS_EVENT_TIMEOUT:
+    for (int i = 0; i < COLLAPSED_CLIENTS; ++i) {
+      if (data->browser[i]->status == REQUEST_INPROGRESS) {
+        TSContSchedule(contp, 25, TS_THREAD_POOL_DEFAULT);
+        return 0;
+      }
+    }
+
+    {
+      bool success = true;
+
+      for (int i = 0; i < COLLAPSED_CLIENTS; ++i) {
+        if (data->browser[i]->status != REQUEST_SUCCESS || !strstr(data->browser[i]->response, "Default body")) {
+          SDK_RPRINT(data->test, "HttpCollapsedForwarding", "TestCase1", TC_FAIL, "Client %d did not get the response", i);
+          success = false;
+        }
+      }
+
+      if (data->origin_requests == 1) {
+        SDK_RPRINT(data->test, "HttpCollapsedForwarding", "TestCase2", TC_PASS, "ok");
+      } else {
+        SDK_RPRINT(data->test, "HttpCollapsedForwarding", "TestCase2", TC_FAIL,
+                   "%d requests for the same URL went to the origin server, expected 1", data->origin_requests);
+        success = false;
+      }
+
+      *(data->pstatus) = success ? REGRESSION_TEST_PASSED : REGRESSION_TEST_FAILED;
+
+      // transaction is over. clean up.
+      synserver_delete(data->os);
+      for (int i = 0; i < COLLAPSED_CLIENTS; ++i)
+        synclient_txn_delete(data->browser[i]);
+
+      data->magic = MAGIC_DEAD;
+      TSfree(data->request);
+      TSfree(data);
+      TSContDataSet(contp, NULL);
+    }
+    break;
+
+  default:
+    *(data->pstatus) = REGRESSION_TEST_FAILED;
+    SDK_RPRINT(data->test, "HttpCollapsedForwarding", "TestCase1", TC_FAIL, "Unexpected event %d", event);
+    break;
+  }
+  return 0;
+}
+
+
+EXCLUSIVE_REGRESSION_TEST(SDK_API_HttpCollapsedForwarding) (RegressionTest * test, int atype, int *pstatus)
+{
+  NOWARN_UNUSED(atype);
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+
+  TSCont cont = TSContCreate(collapsed_hook_handler, TSMutexCreate());
+
+  if (cont == NULL) {
+    SDK_RPRINT(test, "HttpCollapsedForwarding", "TestCase1", TC_FAIL, "Unable to create Continuation.");
+    *pstatus = REGRESSION_TEST_FAILED;
+    return;
+  }
+
+  CollapsedTestData *data = (CollapsedTestData *) TSmalloc(sizeof(CollapsedTestData));
+  data->test = test;
+  data->pstatus = pstatus;
+  data->origin_requests = 0;
+  data->magic = MAGIC_ALIVE;
+  TSContDataSet(cont, data);
+
+  TSHttpHookAdd(TS_HTTP_READ_REQUEST_HDR_HOOK, cont);
+  TSHttpHookAdd(TS_HTTP_SEND_REQUEST_HDR_HOOK, cont);
+
+  /* Create a new synthetic server */
+  data->os = synserver_create(SYNSERVER_LISTEN_PORT);
+  synserver_start(data->os);
+
+  /* A URL that can't be in the cache yet, requested by all the clients at once */
+  data->request = (char *) TSmalloc(REQUEST_MAX_SIZE + 1);
+  snprintf(data->request, REQUEST_MAX_SIZE + 1, HTTP_REQUEST_COLLAPSED_FORMAT, SYNSERVER_LISTEN_PORT,
+           (int64_t) ink_get_hrtime(), COLLAPSED_TEST_ID);
+
+  for (int i = 0; i < COLLAPSED_CLIENTS; ++i) {
+    data->browser[i] = synclient_txn_create();
+    synclient_txn_send_request(data->browser[i], data->request);
+  }
+
+  /* Wait until the transactions are done */
+  TSContSchedule(cont, 25, TS_THREAD_POOL_DEFAULT);
+
+  return;
+}
+
+///////////////////////////////////////////////////////
+//       SDK_API_HttpStaleWhileRevalidate
+//
+// Unit Test for: RFC 5861 stale-while-revalidate
+//
+// Caches a response that goes stale after a second but may
+// be served stale for a minute while it is revalidated.
+// Once stale, a request must be served from the cache right
+// away, with a 110 Warning, while the revalidation is still
+// held at the origin server. After the revalidation the
+// cached copy must be fresh again.
+///////////////////////////////////////////////////////
+
+#define SWR_TEST_ID          12
+#define SWR_STALE_WAIT       2500       // msecs for the cached response to go stale
+#define SWR_ORIGIN_DELAY     500        // msecs the background revalidation is held back
+#define SWR_FILL_WAIT        200        // msecs for the revalidated copy to be written
+
+#define HTTP_REQUEST_SWR_FORMAT "GET http://127.0.0.1:%d/swr-%" PRId64 ".html HTTP/1.0\r\n" \
+                                "X-Request-ID: %d\r\n" \
+                                "\r\n"
+
+typedef struct
+{
+  RegressionTest *test;
+  int *pstatus;
+  SocketServer *os;
+  ClientTxn *browser[3];
+  char *request;
+  int step;
+  int origin_requests;
+  TSHttpTxn held_txn;
+  bool released;
+  bool success;
+  int magic;
+} SWRTestData;
+
+static int
+swr_release_handler(TSCont contp, TSEvent event, void *edata)
+{
+  NOWARN_UNUSED(event);
+  NOWARN_UNUSED(edata);
+
+  SWRTestData *data = (SWRTestData *) TSContDataGet(contp);
+
+  data->released = true;
+  TSHttpTxnReenable(data->held_txn, TS_EVENT_HTTP_CONTINUE);
+  TSContDestroy(contp);
+  return 0;
+}
+
+static void
+swr_check_response(SWRTestData *data, int i, bool stale)
+{
+  ClientTxn *browser = data->browser[i];
+
+  if (browser->status != REQUEST_SUCCESS || !strstr(browser->response, "Body for response 12")) {
+    SDK_RPRINT(data->test, "HttpStaleWhileRevalidate", "TestCase1", TC_FAIL, "Request %d did not get the response", i);
+    data->success = false;
+  } else if ((strstr(browser->response, "Warning: 110") != NULL) != stale) {
+    SDK_RPRINT(data->test, "HttpStaleWhileRevalidate", "TestCase2", TC_FAIL,
+               "Request %d was %sserved stale", i, stale ? "not " : "");
+    data->success = false;
+  }
+}
+
+static int
+swr_hook_handler(TSCont contp, TSEvent event, void *edata)
+{
+  TSHttpTxn txnp = (TSHttpTxn) edata;
+  SWRTestData *data = (SWRTestData *) TSContDataGet(contp);
+
+  if (data == NULL) {
+    switch (event) {
+    case TS_EVENT_IMMEDIATE:
+    case TS_EVENT_TIMEOUT:
+      break;
+    default:
+      TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
+      break;
+    }
+    return 0;
+  }
+
+  switch (event) {
+  case TS_EVENT_HTTP_READ_REQUEST_HDR:
+    if (get_request_id(txnp) == SWR_TEST_ID)
+      TSSkipRemappingSet(txnp, 1);
+    TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
+    break;
+
+  case TS_EVENT_HTTP_SEND_REQUEST_HDR:
+    if (get_request_id(txnp) == SWR_TEST_ID) {
+      // Hold the revalidation back, the stale copy must not wait for it
+      if (++data->origin_requests == 2) {
+        TSCont release = TSContCreate(swr_release_handler, TSContMutexGet(contp));
+
+        data->held_txn = txnp;
+        TSContDataSet(release, data);
+        TSContSchedule(release, SWR_ORIGIN_DELAY, TS_THREAD_POOL_DEFAULT);
+        break;
+      }
+    }
+    TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
+    break;
+
+  case TS_EVENT_IMMEDIATE:
+  case TS_EVENT_TIMEOUT:
+    switch (data->step) {
+    case 0:                    // fill the cache
+    case 2:                    // stale hit
+    case 5:                    // fresh hit, after the revalidation
+      if (data->browser[data->step / 2]->status == REQUEST_INPROGRESS) {
+        TSContSchedule(contp, 25, TS_THREAD_POOL_DEFAULT);
+        return 0;
+      }
+      break;
+    case 3:
+      if (!data->released) {
+        TSContSchedule(contp, 25, TS_THREAD_POOL_DEFAULT);
+        return 0;
+      }
+      break;
+    }
+
+    switch (data->step++) {
+    case 0:
+      swr_check_response(data, 0, false);
+      TSContSchedule(contp, SWR_STALE_WAIT, TS_THREAD_POOL_DEFAULT);
+      return 0;
+    case 1:
+      synclient_txn_send_request(data->browser[1], data->request);
+      TSContSchedule(contp, 25, TS_THREAD_POOL_DEFAULT);
+      return 0;
+    case 2:
+      swr_check_response(data, 1, true);
+      if (data->released) {
+        SDK_RPRINT(data->test, "HttpStaleWhileRevalidate", "TestCase3", TC_FAIL,
+                   "The stale response waited for the revalidation");
+        data->success = false;
+      }
+      if (data->origin_requests < 2 && !data->success)
+        break;                  // no revalidation to wait for
+      TSContSchedule(contp, 25, TS_THREAD_POOL_DEFAULT);
+      return 0;
+    case 3:
+      TSContSchedule(contp, SWR_FILL_WAIT, TS_THREAD_POOL_DEFAULT);
+      return 0;
+    case 4:
+      synclient_txn_send_request(data->browser[2], data->request);
+      TSContSchedule(contp, 25, TS_THREAD_POOL_DEFAULT);
+      return 0;
+    default:
+      break;
+    }
+
+    if (data->step > 5)
+      swr_check_response(data, 2, false);
+    if (data->origin_requests == 2) {
+      SDK_RPRINT(data->test, "HttpStaleWhileRevalidate", "TestCase4", TC_PASS, "ok");
+    } else {
+      SDK_RPRINT(data->test, "HttpStaleWhileRevalidate", "TestCase4", TC_FAIL,
+                 "%d requests went to the origin server, expected 2", data->origin_requests);
+      data->success = false;
+    }
+
+    *(data->pstatus) = data->success ? REGRESSION_TEST_PASSED : REGRESSION_TEST_FAILED;
+
+    // transaction is over. clean up.
+    synserver_delete(data->os);
+    for (int i = 0; i < 3; ++i)
+      synclient_txn_delete(data->browser[i]);
+
+    data->magic = MAGIC_DEAD;
+    TSfree(data->request);
+    TSfree(data);
+    TSContDataSet(contp, NULL);
+    break;
+
+  default:
+    *(data->pstatus) = REGRESSION_TEST_FAILED;
+    SDK_RPRINT(data->test, "HttpStaleWhileRevalidate", "TestCase1", TC_FAIL, "Unexpected event %d", event);
+    break;
+  }
+  return 0;
+}
+
+
+EXCLUSIVE_REGRESSION_TEST(SDK_API_HttpStaleWhileRevalidate) (RegressionTest * test, int atype, int *pstatus)
+{
+  NOWARN_UNUSED(atype);
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+
+  TSCont cont = TSContCreate(swr_hook_handler, TSMutexCreate());
+
+  if (cont == NULL) {
+    SDK_RPRINT(test, "HttpStaleWhileRevalidate", "TestCase1", TC_FAIL, "Unable to create Continuation.");
+    *pstatus = REGRESSION_TEST_FAILED;
+    return;
+  }
+
+  SWRTestData *data = (SWRTestData *) TSmalloc(sizeof(SWRTestData));
+  data->test = test;
+  data->pstatus = pstatus;
+  data->step = 0;
+  data->origin_requests = 0;
+  data->held_txn = NULL;
+  data->released = false;
+  data->success = true;
+  data->magic = MAGIC_ALIVE;
+  TSContDataSet(cont, data);
+
+  TSHttpHookAdd(TS_HTTP_READ_REQUEST_HDR_HOOK, cont);
+  TSHttpHookAdd(TS_HTTP_SEND_REQUEST_HDR_HOOK, cont);
+
+  /* Create a new synthetic server */
+  data->os = synserver_create(SYNSERVER_LISTEN_PORT);
+  synserver_start(data->os);
+
+  /* A URL that can't be in the cache yet */
+  data->request = (char *) TSmalloc(REQUEST_MAX_SIZE + 1);
+  snprintf(data->request, REQUEST_MAX_SIZE + 1, HTTP_REQUEST_SWR_FORMAT, SYNSERVER_LISTEN_PORT,
+           (int64_t) ink_get_hrtime(), SWR_TEST_ID);
+
+  for (int i = 0; i < 3; ++i)
+    data->browser[i] = synclient_txn_create();
+  synclient_txn_send_request(data->browser[0], data->request);
+
+  /* Wait until the transaction is done */
+  TSContSchedule(cont, 25, TS_THREAD_POOL_DEFAULT);
+
+  return;
+}
+
+///////////////////////////////////////////////////////
+//       SDK_API_HttpRangeMissFill
+//
+// Unit Test for: proxy.config.http.cache.range_miss_fill
+//
+// A Range request for an uncached URL must fetch the whole
+// object from the origin server, get only its range back and
+// leave the whole object in the cache, so that a second Range
+// request is served from the cache.
+///////////////////////////////////////////////////////
+
+#define RANGE_FILL_TEST_ID    13
+#define RANGE_FILL_WAIT       100       // msecs for the rest of the object to be written
+
+#define HTTP_REQUEST_RANGE_FILL_FORMAT "GET http://127.0.0.1:%d/range-fill-%" PRId64 ".html HTTP/1.1\r\n" \
+                                       "X-Request-ID: %d\r\n" \
+                                       "Range: bytes=9-16\r\n" \
+                                       "Connection: close\r\n" \
+                                       "\r\n"
+
+typedef struct
+{
+  RegressionTest *test;
+  int *pstatus;
+  SocketServer *os;
+  ClientTxn *browser[2];
+  char *request;
+  int step;
+  int origin_requests;
+  bool success;
+  int magic;
+} RangeFillTestData;
+
+static void
+range_fill_check_response(RangeFillTestData *data, int i)
+{
+  ClientTxn *browser = data->browser[i];
+
+  if (browser->status != REQUEST_SUCCESS || !strstr(browser->response, "HTTP/1.1 206") ||
+      !strstr(browser->response, "Content-Range: bytes 9-16/20")) {
+    SDK_RPRINT(data->test, "HttpRangeMissFill", "TestCase1", TC_FAIL, "Request %d did not get a partial response", i);
+    data->success = false;
+  } else if (strstr(browser->response, "Body for") || !strstr(browser->response, "\r\n\r\nresponse")) {
+    SDK_RPRINT(data->test, "HttpRangeMissFill", "TestCase2", TC_FAIL, "Request %d did not get the range", i);
+    data->success = false;
+  }
+}
+
+static int
+range_fill_hook_handler(TSCont contp, TSEvent event, void *edata)
+{
+  TSHttpTxn txnp = (TSHttpTxn) edata;
+  RangeFillTestData *data = (RangeFillTestData *) TSContDataGet(contp);
+
+  if (data == NULL) {
+    switch (event) {
+    case TS_EVENT_IMMEDIATE:
+    case TS_EVENT_TIMEOUT:
+      break;
+    default:
+      TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
+      break;
+    }
+    return 0;
+  }
+
+  switch (event) {
+  case TS_EVENT_HTTP_READ_REQUEST_HDR:
+    if (get_request_id(txnp) == RANGE_FILL_TEST_ID) {
+      TSSkipRemappingSet(txnp, 1);
+      if (TSHttpTxnConfigIntSet(txnp, TS_CONFIG_HTTP_CACHE_RANGE_MISS_FILL, 1) != TS_SUCCESS) {
+        SDK_RPRINT(data->test, "HttpRangeMissFill", "TestCase3", TC_FAIL, "Unable to enable range_miss_fill");
+        data->success = false;
+      }
+    }
+    TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
+    break;
+
+  case TS_EVENT_HTTP_SEND_REQUEST_HDR:
+    if (get_request_id(txnp) == RANGE_FILL_TEST_ID) {
+      TSMBuffer bufp;
+      TSMLoc hdr_loc;
+
+      data->origin_requests++;
+      if (TSHttpTxnServerReqGet(txnp, &bufp, &hdr_loc) == TS_SUCCESS) {
+        TSMLoc field_loc = TSMimeHdrFieldFind(bufp, hdr_loc, TS_MIME_FIELD_RANGE, TS_MIME_LEN_RANGE);
+
+        if (field_loc != TS_NULL_MLOC) {
+          SDK_RPRINT(data->test, "HttpRangeMissFill", "TestCase4", TC_FAIL, "The range was forwarded to the origin");
+          data->success = false;
+          TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+        }
+        TSHandleMLocRelease(bufp, TS_NULL_MLOC, hdr_loc);
+      }
+    }
+    TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
+    break;
+
+  case TS_EVENT_IMMEDIATE:
+  case TS_EVENT_TIMEOUT:
+    switch (data->step) {
+    case 0:                    // range miss
+    case 2:                    // range hit
+      if (data->browser[data->step / 2]->status == REQUEST_INPROGRESS) {
+        TSContSchedule(contp, 25, TS_THREAD_POOL_DEFAULT);
+        return 0;
+      }
+      break;
+    }
+
+    switch (data->step++) {
+    case 0:
+      range_fill_check_response(data, 0);
+      TSContSchedule(contp, RANGE_FILL_WAIT, TS_THREAD_POOL_DEFAULT);
+      return 0;
+    case 1:
+      synclient_txn_send_request(data->browser[1], data->request);
+      TSContSchedule(contp, 25, TS_THREAD_POOL_DEFAULT);
+      return 0;
+    default:
+      break;
+    }
+
+    range_fill_check_response(data, 1);
+    if (data->origin_requests == 1) {
+      SDK_RPRINT(data->test, "HttpRangeMissFill", "TestCase5", TC_PASS, "ok");
+    } else {
+      SDK_RPRINT(data->test, "HttpRangeMissFill", "TestCase5", TC_FAIL,
+                 "%d requests went to the origin server, expected 1", data->origin_requests);
+      data->success = false;
+    }
+
+    *(data->pstatus) = data->success ? REGRESSION_TEST_PASSED : REGRESSION_TEST_FAILED;
+
+    // transaction is over. clean up.
+    synserver_delete(data->os);
+    for (int i = 0; i < 2; ++i)
+      synclient_txn_delete(data->browser[i]);
+
+    data->magic = MAGIC_DEAD;
+    TSfree(data->request);
+    TSfree(data);
+    TSContDataSet(contp, NULL);
+    break;
+
+  default:
+    *(data->pstatus) = REGRESSION_TEST_FAILED;
+    SDK_RPRINT(data->test, "HttpRangeMissFill", "TestCase1", TC_FAIL, "Unexpected event %d", event);
+    break;
+  }
+  return 0;
+}
+
+
+EXCLUSIVE_REGRESSION_TEST(SDK_API_HttpRangeMissFill) (RegressionTest * test, int atype, int *pstatus)
+{
+  NOWARN_UNUSED(atype);
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+
+  TSCont cont = TSContCreate(range_fill_hook_handler, TSMutexCreate());
+
+  if (cont == NULL) {
+    SDK_RPRINT(test, "HttpRangeMissFill", "TestCase1", TC_FAIL, "Unable to create Continuation.");
+    *pstatus = REGRESSION_TEST_FAILED;
+    return;
+  }
+
+  RangeFillTestData *data = (RangeFillTestData *) TSmalloc(sizeof(RangeFillTestData));
+  data->test = test;
+  data->pstatus = pstatus;
+  data->step = 0;
+  data->origin_requests = 0;
+  data->success = true;
+  data->magic = MAGIC_ALIVE;
+  TSContDataSet(cont, data);
+
+  TSHttpHookAdd(TS_HTTP_READ_REQUEST_HDR_HOOK, cont);
+  TSHttpHookAdd(TS_HTTP_SEND_REQUEST_HDR_HOOK, cont);
+
+  /* Create a new synthetic server */
+  data->os = synserver_create(SYNSERVER_LISTEN_PORT);
+  synserver_start(data->os);
+
+  /* A URL that can't be in the cache yet */
+  data->request = (char *) TSmalloc(REQUEST_MAX_SIZE + 1);
+  snprintf(data->request, REQUEST_MAX_SIZE + 1, HTTP_REQUEST_RANGE_FILL_FORMAT, SYNSERVER_LISTEN_PORT,
+           (int64_t) ink_get_hrtime(), RANGE_FILL_TEST_ID);
+
+  for (int i = 0; i < 2; ++i)
+    data->browser[i] = synclient_txn_create();
+  synclient_txn_send_request(data->browser[0], data->request);
+
+  /* Wait until the transaction is done */
+  TSContSchedule(cont, 25, TS_THREAD_POOL_DEFAULT);
+
+  return;
+}
+
 ///////////////////////////////////////////////////////
 //       SDK_API_TSHttpTxnTransform
 //
@@ -7593,6 +8201,11 @@ const char *SDK_Overridable_Configs[] = {
   "proxy.config.net.sock_packet_tos_out",
   "proxy.config.http.cache.open_read_retry_time",
   "proxy.config.http.cache.max_open_read_retries",
+  "proxy.config.http.cache.collapsed_forwarding",
+  "proxy.config.http.cache.collapsed_forwarding_timeout",
+  "proxy.config.http.cache.stale_while_revalidate",
+  "proxy.config.http.cache.stale_if_error",
+  "proxy.config.http.cache.range_miss_fill",
 
   NULL
 };
@@ -343,6 +343,19 @@ generate_response(const char *request)
                               "\r\n" \
                               "Body for response 10"
 
+#define HTTP_RESPONSE_FORMAT12 "HTTP/1.0 200 OK\r\n" \
+                              "Cache-Control: max-age=1, stale-while-revalidate=60\r\n" \
+			      "X-Response-ID: %d\r\n" \
+                              "\r\n" \
+                              "Body for response 12"
+
+#define HTTP_RESPONSE_FORMAT13 "HTTP/1.0 200 OK\r\n" \
+                              "Cache-Control: max-age=300\r\n" \
+                              "Content-Length: 20\r\n" \
+			      "X-Response-ID: %d\r\n" \
+                              "\r\n" \
+                              "Body for response 13"
+
 
   int test_case, match, http_version;
 
@@ -380,6 +393,12 @@ generate_response(const char *request)
     case 10:
       snprintf(response, RESPONSE_MAX_SIZE + 1, HTTP_RESPONSE_FORMAT10, test_case);
       break;
+    case 12:
+      snprintf(response, RESPONSE_MAX_SIZE + 1, HTTP_RESPONSE_FORMAT12, test_case);
+      break;
+    case 13:
+      snprintf(response, RESPONSE_MAX_SIZE + 1, HTTP_RESPONSE_FORMAT13, test_case);
+      break;
     default:
       snprintf(response, RESPONSE_MAX_SIZE + 1, HTTP_RESPONSE_DEFAULT_FORMAT, test_case);
       break;
@@ -1839,6 +1839,9 @@ main(int argc, char **argv)
 
   hotUrlProcessor.init();
 
+  // Last, so the threads started above don't inherit its binding
+  eventProcessor.bind_main_thread();
+
   this_thread()->execute();
 }
 
@@ -177,16 +177,17 @@ struct UR_FreerContinuation: public Continuation
 /**
   Called when the remap.config file changes. Since it called infrequently,
   we do the load of new file as blocking I/O and lock aquire is also
-  blocking.
+  blocking. An incremental reload shares the rules that didn't change
+  with the current table, see proxy.config.url_remap.incremental_reload.
 
 */
 void
-reloadUrlRewrite()
+reloadUrlRewrite(bool incremental)
 {
   UrlRewrite *newTable;
 
   Debug("url_rewrite", "remap.config updated, reloading...");
-  newTable = new UrlRewrite("proxy.config.url_remap.filename");
+  newTable = new UrlRewrite("proxy.config.url_remap.filename", incremental ? rewrite_table : NULL);
   if (newTable->is_valid()) {
     eventProcessor.schedule_in(new UR_FreerContinuation(rewrite_table), URL_REWRITE_TIMEOUT, ET_TASK);
     Debug("url_rewrite", "remap.config done reloading!");
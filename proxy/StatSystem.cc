@@ -809,7 +809,7 @@ http_trans_stats_time_useconds_cb(void *data, void *res)
 TransactionMilestones::TransactionMilestones()
 :
 ua_begin(0), ua_read_header_done(0), ua_begin_write(0), ua_close(0), server_first_connect(0), server_connect(0),
-  // server_connect_end(0),
+  server_connect_end(0),
   // server_begin_write(0),
   server_first_read(0), server_read_header_done(0), server_close(0), cache_open_read_begin(0), cache_open_read_end(0),
   // cache_read_begin(0),
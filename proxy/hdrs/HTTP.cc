@@ -23,6 +23,7 @@
 
 #include "ink_port.h"
 #include "libts.h"
+#include "ink_scan.h"
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
@@ -980,13 +981,10 @@ http_parser_parse_req(HTTPParser *parser, HdrHeap *heap, HTTPHdrImpl *hh, const
     }
     method_start = cur;
     GETNEXT(done);
-  parse_method2:
-    if (ParseRules::is_ws(*cur)) {
-      method_end = cur;
-      goto parse_version1;
-    }
-    GETNEXT(done);
-    goto parse_method2;
+    cur = ink_scan2(cur, end, ParseRules::CHAR_SP, ParseRules::CHAR_HT);
+    if (cur >= end)
+      goto done;
+    method_end = cur;
 
   parse_version1:
     cur = end - 1;
@@ -1949,3 +1947,667 @@ HTTPInfo::get_handle(char *buf, int len)
   clear();
   return -1;
 }
+
+/***********************************************************************
+ *                                                                     *
+ *                   C O M P A C T   E N C O D I N G                   *
+ *                                                                     *
+ ***********************************************************************/
+
+// The marshaled form of an alternate is its heaps as they are in memory:
+// field blocks with a mostly empty tail, and every name and value as a
+// string. The compact form, written to disk, is a byte stream instead:
+//
+//   uint32 magic, uint32 length, uint8 version, the alternate's ids, keys
+//   and times, then the request and the response header.
+//
+// A header is its polarity and version, the method and the URL parts or
+// the status and reason, then its live fields in slot order. Names that
+// are well-known strings are written as their hdrtoken index, values as
+// an integer, a date, an entry of the dictionary below, or a string.
+// Numbers are LEB128 varints, strings a varint length and the bytes.
+// A field that prints raw, as it was parsed, also keeps the bytes between
+// its name and value and after the value (since version 2), so it is
+// decoded raw again and prints the same.
+//
+// The hdrtoken indexes are already part of the marshaled heaps on disk.
+// The dictionary is part of the encoding: changing it, other than adding
+// entries at the end, needs a new CACHE_ALT_COMPACT_VERSION.
+
+static const char *compact_values[] = {
+  "text/html",
+  "text/html; charset=utf-8",
+  "text/html; charset=UTF-8",
+  "text/html;charset=utf-8",
+  "text/html; charset=iso-8859-1",
+  "text/plain",
+  "text/plain; charset=utf-8",
+  "text/plain; charset=UTF-8",
+  "text/css",
+  "text/xml",
+  "text/javascript",
+  "application/javascript",
+  "application/x-javascript",
+  "application/json",
+  "application/json; charset=utf-8",
+  "application/xml",
+  "application/octet-stream",
+  "application/x-shockwave-flash",
+  "image/gif",
+  "image/jpeg",
+  "image/png",
+  "image/webp",
+  "image/x-icon",
+  "image/vnd.microsoft.icon",
+  "gzip",
+  "deflate",
+  "identity",
+  "chunked",
+  "keep-alive",
+  "close",
+  "bytes",
+  "none",
+  "*",
+  "Accept-Encoding",
+  "Accept-Encoding, User-Agent",
+  "Accept-Encoding,User-Agent",
+  "User-Agent",
+  "Cookie",
+  "no-cache",
+  "no-store",
+  "no-transform",
+  "private",
+  "public",
+  "must-revalidate",
+  "proxy-revalidate",
+  "max-age=0",
+  "max-age=60",
+  "max-age=300",
+  "max-age=600",
+  "max-age=3600",
+  "max-age=86400",
+  "max-age=604800",
+  "max-age=2592000",
+  "max-age=31536000",
+  "public, max-age=3600",
+  "public, max-age=86400",
+  "public, max-age=31536000",
+  "private, max-age=0",
+  "no-cache, no-store, must-revalidate",
+  "no-store, no-cache, must-revalidate, post-check=0, pre-check=0",
+  "Apache",
+  "nginx",
+  "Microsoft-IIS/7.5",
+  "Microsoft-IIS/8.5",
+  "ATS",
+  "SAMEORIGIN",
+  "DENY",
+  "nosniff",
+  "1; mode=block",
+  "Thu, 01 Jan 1970 00:00:00 GMT",
+  "Thu, 19 Nov 1981 08:52:00 GMT",
+  "Mon, 26 Jul 1997 05:00:00 GMT",
+  "en-US,en;q=0.8",
+  "en-us",
+  "en",
+  "gzip, deflate",
+  "gzip,deflate",
+  "gzip,deflate,sdch",
+  "ISO-8859-1,utf-8;q=0.7,*;q=0.3",
+  "*/*",
+  "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8",
+  "image/png,image/*;q=0.8,*/*;q=0.5",
+  "XMLHttpRequest",
+  "HIT",
+  "MISS"
+};
+
+#define COMPACT_NUM_VALUES	((int) (sizeof(compact_values) / sizeof(compact_values[0])))
+
+// value tags, the dictionary entries follow
+enum
+{
+  COMPACT_VALUE_STRING,
+  COMPACT_VALUE_INT,
+  COMPACT_VALUE_DATE,
+  COMPACT_VALUE_DICT
+};
+
+// name tags, then (wks index << 1 | lower case) + COMPACT_NAME_WKS
+enum
+{
+  COMPACT_NAME_STRING,
+  COMPACT_NAME_WKS
+};
+
+// raw tags: not raw, raw as "name: value\r\n", or raw with the two strings
+enum
+{
+  COMPACT_RAW_NONE,
+  COMPACT_RAW_DEFAULT,
+  COMPACT_RAW_STRING
+};
+
+// The fixed part of an alternate
+struct CompactAltHdr
+{
+  uint32_t m_magic;
+  uint32_t m_length;            // all of it, rounded up to HDR_PTR_SIZE
+};
+
+// Writes the stream to buf, or only counts its bytes if buf is NULL
+class CompactWriter
+{
+public:
+  CompactWriter(char *buf, int len)
+    : m_buf(buf), m_len(len), m_pos(0)
+  { }
+
+  void byte(uint8_t c)
+  {
+    if (m_buf && m_pos < m_len)
+      m_buf[m_pos] = c;
+    m_pos++;
+  }
+
+  void bytes(const void *p, int n)
+  {
+    if (m_buf && m_pos + n <= m_len)
+      memcpy(m_buf + m_pos, p, n);
+    m_pos += n;
+  }
+
+  void varint(uint64_t v)
+  {
+    while (v >= 0x80) {
+      byte((uint8_t) (v | 0x80));
+      v >>= 7;
+    }
+    byte((uint8_t) v);
+  }
+
+  void str(const char *s, int n)
+  {
+    varint(n);
+    if (n > 0)
+      bytes(s, n);
+  }
+
+  char *m_buf;
+  int m_len;
+  int m_pos;
+};
+
+// Reads the stream, m_error is set on anything out of bounds
+class CompactReader
+{
+public:
+  CompactReader(const char *buf, int len)
+    : m_pos(buf), m_end(buf + len), m_error(false)
+  { }
+
+  uint8_t byte()
+  {
+    if (m_pos >= m_end) {
+      m_error = true;
+      return 0;
+    }
+    return (uint8_t) * m_pos++;
+  }
+
+  void bytes(void *p, int n)
+  {
+    if (m_end - m_pos < n) {
+      m_error = true;
+      memset(p, 0, n);
+      return;
+    }
+    memcpy(p, m_pos, n);
+    m_pos += n;
+  }
+
+  uint64_t varint()
+  {
+    uint64_t v = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t c = byte();
+      v |= (uint64_t) (c & 0x7f) << shift;
+      if (!(c & 0x80))
+        return v;
+    }
+    m_error = true;
+    return 0;
+  }
+
+  // Strings are left in the stream, they are copied into the heap when set
+  const char *str(int *n)
+  {
+    uint64_t len = varint();
+    const char *s = m_pos;
+
+    if (len > 0xFFFF || (uint64_t) (m_end - m_pos) < len) {
+      m_error = true;
+      *n = 0;
+      return NULL;
+    }
+    m_pos += len;
+    *n = (int) len;
+    return len ? s : NULL;
+  }
+
+  const char *m_pos;
+  const char *m_end;
+  bool m_error;
+};
+
+// A token for a string that is spelled exactly as the well-known one, or -1
+static inline int
+compact_wks_idx(int wks_idx, const char *s, int len)
+{
+  if (wks_idx < 0 || len != hdrtoken_index_to_length(wks_idx) || memcmp(s, hdrtoken_index_to_wks(wks_idx), len) != 0)
+    return -1;
+  return wks_idx;
+}
+
+static void
+compact_encode_name(CompactWriter &w, MIMEField *field)
+{
+  int wks_idx = field->m_wks_idx;
+  int len = field->m_len_name;
+
+  if (wks_idx >= 0 && len == hdrtoken_index_to_length(wks_idx)) {
+    const char *wks = hdrtoken_index_to_wks(wks_idx);
+    bool lower = true;
+
+    if (memcmp(field->m_ptr_name, wks, len) == 0) {
+      w.varint(COMPACT_NAME_WKS + (wks_idx << 1));
+      return;
+    }
+    for (int i = 0; i < len && lower; i++)
+      lower = (field->m_ptr_name[i] == ParseRules::ink_tolower(wks[i]));
+    if (lower) {
+      w.varint(COMPACT_NAME_WKS + ((wks_idx << 1) | 1));
+      return;
+    }
+  }
+  w.varint(COMPACT_NAME_STRING);
+  w.str(field->m_ptr_name, len);
+}
+
+static void
+compact_encode_value(CompactWriter &w, const char *value, int len)
+{
+  // an integer that prints back the same
+  if (len > 0 && len <= 18 && (value[0] != '0' || len == 1)) {
+    int64_t v = 0;
+    int i;
+
+    for (i = 0; i < len && ParseRules::is_digit(value[i]); i++)
+      v = v * 10 + (value[i] - '0');
+    if (i == len) {
+      w.varint(COMPACT_VALUE_INT);
+      w.varint(v);
+      return;
+    }
+  }
+
+  // a date, as mime_format_date() would print it
+  if (len == 29 && value[3] == ',' && memcmp(value + 26, "GMT", 3) == 0) {
+    char buf[33];
+    time_t t = mime_parse_date(value, value + len);
+
+    if (t > 0 && mime_format_date(buf, t) == len && memcmp(buf, value, len) == 0) {
+      w.varint(COMPACT_VALUE_DATE);
+      w.varint(t);
+      return;
+    }
+  }
+
+  for (int i = 0; i < COMPACT_NUM_VALUES; i++) {
+    if ((int) strlen(compact_values[i]) == len && memcmp(compact_values[i], value, len) == 0) {
+      w.varint(COMPACT_VALUE_DICT + i);
+      return;
+    }
+  }
+
+  w.varint(COMPACT_VALUE_STRING);
+  w.str(value, len);
+}
+
+static void
+compact_encode_raw(CompactWriter &w, MIMEField *field)
+{
+  const char *name_end = field->m_ptr_name + field->m_len_name;
+  const char *value_end = field->m_ptr_value + field->m_len_value;
+  int total = field->m_len_name + field->m_len_value + field->m_n_v_raw_printable_pad;
+  int sep, trail;
+
+  if (!field->m_n_v_raw_printable || field->m_ptr_value < name_end || value_end > field->m_ptr_name + total) {
+    w.varint(COMPACT_RAW_NONE);
+    return;
+  }
+  sep = field->m_ptr_value - name_end;
+  trail = field->m_ptr_name + total - value_end;
+  if (sep == 2 && trail == 2 && memcmp(name_end, ": ", 2) == 0 && memcmp(value_end, "\r\n", 2) == 0) {
+    w.varint(COMPACT_RAW_DEFAULT);
+    return;
+  }
+  w.varint(COMPACT_RAW_STRING);
+  w.str(name_end, sep);
+  w.str(value_end, trail);
+}
+
+static void
+compact_encode_hdr(CompactWriter &w, HTTPHdr *hdr)
+{
+  HTTPHdrImpl *hh = hdr->m_http;
+  MIMEHdrImpl *mh;
+  MIMEFieldBlockImpl *fblock;
+  int count = 0;
+
+  if (!hdr->valid()) {
+    w.byte(HTTP_TYPE_UNKNOWN);
+    return;
+  }
+
+  w.byte(hh->m_polarity);
+  w.varint(hh->m_version);
+
+  if (hh->m_polarity == HTTP_TYPE_REQUEST) {
+    URLImpl *url = hh->u.req.m_url_impl;
+    int idx = compact_wks_idx(hh->u.req.m_method_wks_idx, hh->u.req.m_ptr_method, hh->u.req.m_len_method);
+
+    w.varint(idx + 1);
+    if (idx < 0)
+      w.str(hh->u.req.m_ptr_method, hh->u.req.m_len_method);
+
+    idx = compact_wks_idx(url->m_scheme_wks_idx, url->m_ptr_scheme, url->m_len_scheme);
+    w.varint(idx + 1);
+    if (idx < 0)
+      w.str(url->m_ptr_scheme, url->m_len_scheme);
+    w.str(url->m_ptr_user, url->m_len_user);
+    w.str(url->m_ptr_password, url->m_len_password);
+    w.str(url->m_ptr_host, url->m_len_host);
+    w.str(url->m_ptr_port, url->m_len_port);
+    w.str(url->m_ptr_path, url->m_len_path);
+    w.str(url->m_ptr_params, url->m_len_params);
+    w.str(url->m_ptr_query, url->m_len_query);
+    w.str(url->m_ptr_fragment, url->m_len_fragment);
+    w.byte(url->m_url_type);
+    w.byte(url->m_type_code);
+  } else {
+    const char *reason = http_hdr_reason_lookup(hh->u.resp.m_status);
+
+    w.varint(hh->u.resp.m_status);
+    if (reason && (int) strlen(reason) == hh->u.resp.m_len_reason &&
+        memcmp(reason, hh->u.resp.m_ptr_reason, hh->u.resp.m_len_reason) == 0) {
+      w.byte(1);
+    } else {
+      w.byte(0);
+      w.str(hh->u.resp.m_ptr_reason, hh->u.resp.m_len_reason);
+    }
+  }
+
+  mh = hh->m_fields_impl;
+  for (fblock = &(mh->m_first_fblock); fblock != NULL; fblock = fblock->m_next) {
+    for (unsigned int i = 0; i < fblock->m_freetop; i++)
+      count += fblock->m_field_slots[i].is_live();
+  }
+  w.varint(count);
+  for (fblock = &(mh->m_first_fblock); fblock != NULL; fblock = fblock->m_next) {
+    for (unsigned int i = 0; i < fblock->m_freetop; i++) {
+      MIMEField *field = &(fblock->m_field_slots[i]);
+      if (field->is_live()) {
+        compact_encode_name(w, field);
+        compact_encode_value(w, field->m_ptr_value, field->m_len_value);
+        compact_encode_raw(w, field);
+      }
+    }
+  }
+}
+
+static bool
+compact_decode_hdr(CompactReader &r, HTTPHdr *hdr, int version)
+{
+  HTTPHdrImpl *hh;
+  HdrHeap *heap;
+  int polarity = r.byte();
+  const char *s;
+  int len, count;
+  uint64_t v;
+
+  if (polarity == HTTP_TYPE_UNKNOWN)
+    return !r.m_error;
+  if (polarity != HTTP_TYPE_REQUEST && polarity != HTTP_TYPE_RESPONSE)
+    return false;
+
+  hdr->create((HTTPType) polarity);
+  hh = hdr->m_http;
+  heap = hdr->m_heap;
+  http_hdr_version_set(hh, (int32_t) r.varint());
+
+  if (polarity == HTTP_TYPE_REQUEST) {
+    URLImpl *url = hh->u.req.m_url_impl;
+
+    v = r.varint();
+    if (v == 0) {
+      s = r.str(&len);
+      http_hdr_method_set(heap, hh, s, s ? hdrtoken_tokenize(s, len) : -1, len, true);
+    } else if (v <= (uint64_t) hdrtoken_num_wks) {
+      http_hdr_method_set(heap, hh, hdrtoken_index_to_wks(v - 1), v - 1, hdrtoken_index_to_length(v - 1), true);
+    } else {
+      return false;
+    }
+
+    v = r.varint();
+    if (v == 0) {
+      s = r.str(&len);
+      url_scheme_set(heap, url, s, s ? hdrtoken_tokenize(s, len) : -1, len, true);
+    } else if (v <= (uint64_t) hdrtoken_num_wks) {
+      url_scheme_set(heap, url, hdrtoken_index_to_wks(v - 1), v - 1, hdrtoken_index_to_length(v - 1), true);
+    } else {
+      return false;
+    }
+    s = r.str(&len);
+    url_user_set(heap, url, s, len, true);
+    s = r.str(&len);
+    url_password_set(heap, url, s, len, true);
+    s = r.str(&len);
+    url_host_set(heap, url, s, len, true);
+    s = r.str(&len);
+    url_port_set(heap, url, s, len, true);
+    s = r.str(&len);
+    url_path_set(heap, url, s, len, true);
+    s = r.str(&len);
+    url_params_set(heap, url, s, len, true);
+    s = r.str(&len);
+    url_query_set(heap, url, s, len, true);
+    s = r.str(&len);
+    url_fragment_set(heap, url, s, len, true);
+    url->m_url_type = r.byte();
+    url_type_set(url, r.byte());
+  } else {
+    http_hdr_status_set(hh, (HTTPStatus) r.varint());
+    if (r.byte()) {
+      s = http_hdr_reason_lookup(hh->u.resp.m_status);
+      http_hdr_reason_set(heap, hh, s, s ? strlen(s) : 0, true);
+    } else {
+      s = r.str(&len);
+      http_hdr_reason_set(heap, hh, s, len, true);
+    }
+  }
+
+  count = (int) r.varint();
+  for (int i = 0; i < count && !r.m_error; i++) {
+    char name_buf[256], value_buf[33];
+    const char *value, *sep = NULL, *trail = NULL;
+    int name_len, value_len, sep_len = 0, trail_len = 0;
+    const char *name;
+    MIMEField *field;
+
+    v = r.varint();
+    if (v == COMPACT_NAME_STRING) {
+      name = r.str(&name_len);
+      if (name_len == 0)
+        return false;
+    } else if (((v - COMPACT_NAME_WKS) >> 1) < (uint64_t) hdrtoken_num_wks) {
+      int idx = (int) ((v - COMPACT_NAME_WKS) >> 1);
+
+      name = hdrtoken_index_to_wks(idx);
+      name_len = hdrtoken_index_to_length(idx);
+      if (((v - COMPACT_NAME_WKS) & 1) && name_len <= (int) sizeof(name_buf)) {
+        for (int j = 0; j < name_len; j++)
+          name_buf[j] = ParseRules::ink_tolower(name[j]);
+        name = name_buf;
+      }
+    } else {
+      return false;
+    }
+
+    v = r.varint();
+    if (v == COMPACT_VALUE_STRING) {
+      value = r.str(&value_len);
+    } else if (v == COMPACT_VALUE_INT) {
+      value_len = ink_fast_ltoa((int64_t) r.varint(), value_buf, sizeof(value_buf));
+      value = value_buf;
+    } else if (v == COMPACT_VALUE_DATE) {
+      value_len = mime_format_date(value_buf, (time_t) r.varint());
+      value = value_buf;
+    } else if (v - COMPACT_VALUE_DICT < (uint64_t) COMPACT_NUM_VALUES) {
+      value = compact_values[v - COMPACT_VALUE_DICT];
+      value_len = strlen(value);
+    } else {
+      return false;
+    }
+
+    v = version >= 2 ? r.varint() : COMPACT_RAW_NONE;
+    if (v == COMPACT_RAW_DEFAULT) {
+      sep = ": ";
+      sep_len = 2;
+      trail = "\r\n";
+      trail_len = 2;
+    } else if (v == COMPACT_RAW_STRING) {
+      sep = r.str(&sep_len);
+      trail = r.str(&trail_len);
+    } else if (v != COMPACT_RAW_NONE) {
+      return false;
+    }
+    if (r.m_error)
+      return false;
+
+    if (v == COMPACT_RAW_NONE) {
+      field = mime_field_create_named(heap, hh->m_fields_impl, name, name_len);
+      mime_field_value_set(heap, hh->m_fields_impl, field, value, value_len, true);
+    } else {
+      // name, value and the bytes around it in one string, as the parser leaves them
+      int line_len = name_len + sep_len + value_len + trail_len;
+      char *line = heap->allocate_str(line_len);
+
+      memcpy(line, name, name_len);
+      if (sep_len)
+        memcpy(line + name_len, sep, sep_len);
+      if (value_len)
+        memcpy(line + name_len + sep_len, value, value_len);
+      if (trail_len)
+        memcpy(line + name_len + sep_len + value_len, trail, trail_len);
+      field = mime_field_create(heap, hh->m_fields_impl);
+      mime_field_name_value_set(heap, hh->m_fields_impl, field, hdrtoken_tokenize(line, name_len), line, name_len,
+                                line + name_len + sep_len, value_len, true, line_len, false);
+    }
+    mime_hdr_field_attach(hh->m_fields_impl, field, 1, NULL);
+  }
+
+  return !r.m_error;
+}
+
+static int
+compact_encode(CompactWriter &w, HTTPCacheAlt *alt)
+{
+  CompactAltHdr h;
+
+  w.bytes(&h, sizeof(h));       // filled in below
+  w.byte(CACHE_ALT_COMPACT_VERSION);
+  w.bytes(&alt->m_id, sizeof(alt->m_id));
+  w.bytes(&alt->m_rid, sizeof(alt->m_rid));
+  w.bytes(alt->m_object_key, sizeof(alt->m_object_key));
+  w.bytes(alt->m_object_size, sizeof(alt->m_object_size));
+  w.varint(alt->m_request_sent_time);
+  w.varint(alt->m_response_received_time);
+  compact_encode_hdr(w, &alt->m_request_hdr);
+  compact_encode_hdr(w, &alt->m_response_hdr);
+  while (w.m_pos % HDR_PTR_SIZE)
+    w.byte(0);
+
+  if (w.m_buf && w.m_pos <= w.m_len) {
+    h.m_magic = CACHE_ALT_MAGIC_COMPACT;
+    h.m_length = w.m_pos;
+    memcpy(w.m_buf, &h, sizeof(h));
+  }
+  return w.m_pos;
+}
+
+int
+HTTPInfo::marshal_compact_length()
+{
+  CompactWriter w(NULL, 0);
+
+  return compact_encode(w, m_alt);
+}
+
+int
+HTTPInfo::marshal_compact(char *buf, int len)
+{
+  CompactWriter w(buf, len);
+  int used = compact_encode(w, m_alt);
+
+  ink_release_assert(used <= len);
+  return used;
+}
+
+bool
+HTTPInfo::is_compact(const char *buf, int len)
+{
+  CompactAltHdr h;
+
+  if (len < (int) sizeof(h))
+    return false;
+  memcpy(&h, buf, sizeof(h));
+  return h.m_magic == CACHE_ALT_MAGIC_COMPACT;
+}
+
+// Decodes the alternate at buf into a new, writeable info. Returns the
+// length of the encoded alternate, or -1 if it does not decode.
+int
+HTTPInfo::unmarshal_compact(const char *buf, int len, HTTPInfo *info)
+{
+  CompactAltHdr h;
+  HTTPCacheAlt *alt;
+
+  if (!is_compact(buf, len))
+    return -1;
+  memcpy(&h, buf, sizeof(h));
+  if (h.m_length > (uint32_t) len || h.m_length < sizeof(h))
+    return -1;
+
+  CompactReader r(buf + sizeof(h), h.m_length - sizeof(h));
+  int version = r.byte();
+
+  if (version < 1 || version > CACHE_ALT_COMPACT_VERSION)
+    return -1;
+
+  info->create();
+  alt = info->m_alt;
+  r.bytes(&alt->m_id, sizeof(alt->m_id));
+  r.bytes(&alt->m_rid, sizeof(alt->m_rid));
+  r.bytes(alt->m_object_key, sizeof(alt->m_object_key));
+  r.bytes(alt->m_object_size, sizeof(alt->m_object_size));
+  alt->m_request_sent_time = (time_t) r.varint();
+  alt->m_response_received_time = (time_t) r.varint();
+  if (r.m_error || !compact_decode_hdr(r, &alt->m_request_hdr, version) ||
+      !compact_decode_hdr(r, &alt->m_response_hdr, version)) {
+    info->destroy();
+    return -1;
+  }
+  return h.m_length;
+}
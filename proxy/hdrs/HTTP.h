@@ -1244,9 +1244,15 @@ enum
 {
   CACHE_ALT_MAGIC_ALIVE = 0xabcddeed,
   CACHE_ALT_MAGIC_MARSHALED = 0xdcbadeed,
-  CACHE_ALT_MAGIC_DEAD = 0xdeadeed
+  CACHE_ALT_MAGIC_DEAD = 0xdeadeed,
+  CACHE_ALT_MAGIC_COMPACT = 0xdcbac0de
 };
 
+// Version of the compact encoding, see HTTPInfo::marshal_compact.
+// Bump it when the encoding or the value dictionary changes; older
+// versions are still decoded.
+#define CACHE_ALT_COMPACT_VERSION	2
+
 // struct HTTPCacheAlt
 struct HTTPCacheAlt
 {
@@ -1316,6 +1322,13 @@ public:
   void set_buffer_reference(RefCountObj *block_ref);
   int get_handle(char *buf, int len);
 
+  // The compact encoding written to disk: the headers as a stream of
+  // tokens and strings, which has to be decoded into new heaps to be used.
+  int marshal_compact_length();
+  int marshal_compact(char *buf, int len);
+  static int unmarshal_compact(const char *buf, int len, HTTPInfo *info);
+  static bool is_compact(const char *buf, int len);
+
   int32_t id_get() const { return m_alt->m_id; }
   int32_t rid_get() { return m_alt->m_rid; }
 
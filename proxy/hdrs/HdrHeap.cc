@@ -50,7 +50,8 @@ static HdrStrHeap str_proto_heap;
 void
 obj_describe(HdrHeapObjImpl * obj, bool recurse)
 {
-  static const char *obj_names[] = { "EMPTY", "RAW", "URL", "HTTP_HEADER", "MIME_HEADER", "FIELD_BLOCK" };
+  static const char *obj_names[] = { "EMPTY", "RAW", "URL", "HTTP_HEADER", "MIME_HEADER", "FIELD_BLOCK",
+                                     "FIELD_STANDALONE", "FIELD_SDK_HANDLE", "FIELD_INDEX" };
 
   Debug("http", "%s %p: [T: %d, L: %4d, OBJFLAGS: %X]  ",
         obj_names[obj->m_type], obj, obj->m_type, obj->m_length, obj->m_obj_flags);
@@ -431,6 +432,7 @@ HdrHeap::evacuate_from_str_heaps(HdrStrHeap * new_heap)
       case HDR_HEAP_OBJ_FIELD_BLOCK:
         ((MIMEFieldBlockImpl *) obj)->move_strings(new_heap);
         break;
+      case HDR_HEAP_OBJ_FIELD_INDEX:
       case HDR_HEAP_OBJ_EMPTY:
       case HDR_HEAP_OBJ_RAW:
         // Nothing to do
@@ -495,6 +497,7 @@ HdrHeap::sanity_check_strs()
       case HDR_HEAP_OBJ_FIELD_BLOCK:
         ((MIMEFieldBlockImpl *) obj)->check_strings(heaps, num_heaps);
         break;
+      case HDR_HEAP_OBJ_FIELD_INDEX:
       case HDR_HEAP_OBJ_EMPTY:
       case HDR_HEAP_OBJ_RAW:
         // Nothing to do
@@ -748,6 +751,12 @@ HdrHeap::marshal(char *buf, int len)
           goto Failed;
         }
         break;
+      case HDR_HEAP_OBJ_FIELD_INDEX:
+        // not marshalled, the MIMEHdrImpl drops its flag for it. A read
+        // only heap can't hold a new index, so a cache hit rebuilds it in
+        // the writeable copy on the first lookup by name.
+        obj->m_type = HDR_HEAP_OBJ_EMPTY;
+        break;
       case HDR_HEAP_OBJ_EMPTY:
       case HDR_HEAP_OBJ_RAW:
         // Check to make sure we aren't stuck
@@ -77,6 +77,9 @@ HdrTest::go(RegressionTest * t, int atype)
   status = status & test_arena();
   status = status & test_regex();
   status = status & test_http_parser_eos_boundary_cases();
+  status = status & test_http_parser_split_input();
+  status = status & test_mime_field_index();
+  status = status & test_http_info_compact();
   status = status & test_http_mutation();
   status = status & test_mime();
   status = status & test_http();
@@ -706,6 +709,293 @@ HdrTest::test_http_parser_eos_boundary_cases()
   return (failures_to_status("test_http_parser_eos_boundary_cases", failures));
 }
 
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+// The parser must give the same header whichever way the input is split
+// up, in particular when a field's name, colon or continuation lines come
+// in different reads.
+int
+HdrTest::test_http_parser_split_input()
+{
+  static const char request[] =
+    "GET /a/b;p=1?q=2#f HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "Cookie: a=1; b=2; c=3; d=4; e=5; f=6; g=7; h=8; i=9; j=10; k=11; l=12; m=13\r\n"
+    "X-Folded: part1\r\n"
+    " part2: still the value\r\n"
+    "\tpart3\r\n"
+    "Name-Without-Colon\r\n"
+    "X-Spaces  :   value  \r\n"
+    ":no name\r\n"
+    "X-Empty:\r\n"
+    "\r\n";
+  char full[2048], split[2048];
+  int full_len = 0, split_len, skip;
+  int failures = 0;
+  HTTPParser parser;
+
+  bri_box("test_http_parser_split_input");
+
+  http_parser_init(&parser);
+
+  for (int chunk = 0; chunk <= 19; chunk++) {
+    HTTPHdr hdr;
+    const char *start = request;
+    const char *end = request + strlen(request);
+    int err;
+
+    hdr.create(HTTP_TYPE_REQUEST);
+    http_parser_clear(&parser);
+    if (chunk == 0) {
+      err = hdr.parse_req(&parser, &start, end, true);
+    } else {
+      do {
+        const char *chunk_end = (end - start > chunk) ? start + chunk : end;
+        err = hdr.parse_req(&parser, &start, chunk_end, chunk_end == end);
+      } while (err == PARSE_CONT && start < end);
+    }
+
+    split_len = 0;
+    skip = 0;
+    if (err != PARSE_DONE || !hdr.print(chunk == 0 ? full : split, sizeof(full), &split_len, &skip)) {
+      printf("FAILED: parse of %d byte chunks returned %d\n", chunk, err);
+      ++failures;
+    } else if (chunk == 0) {
+      full_len = split_len;
+    } else if (split_len != full_len || memcmp(full, split, full_len) != 0) {
+      printf("FAILED: parse of %d byte chunks gave\n[%.*s]\n", chunk, split_len, split);
+      ++failures;
+    }
+
+    hdr.destroy();
+  }
+
+  http_parser_clear(&parser);
+
+  return (failures_to_status("test_http_parser_split_input", failures));
+}
+
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+// Every lookup through the name index has to find what the list walk does.
+// 32 bit builds never have an index.
+static int
+check_field_index(MIMEHdrImpl *mh, const char *what, bool expect_index = true)
+{
+  char name[32];
+  int failures = 0;
+  bool has_index = (mh->m_obj_flags & MIME_HDR_OBJ_FLAG_FIELD_INDEX) != 0;
+
+#if SIZEOF_VOID_POINTER != 8
+  expect_index = false;
+#endif
+  if (has_index != expect_index) {
+    printf("FAILED: %s: %s name index\n", what, has_index ? "unexpected" : "no");
+    ++failures;
+  }
+  for (int i = 0; i < 50; i++) {
+    int len = snprintf(name, sizeof(name), (i & 1) ? "X-FIELD-%d" : "x-field-%d", i);
+    if (mime_hdr_field_find(mh, name, len) != _mime_hdr_field_list_search_by_string(mh, name, len)) {
+      printf("FAILED: %s: lookup of %s\n", what, name);
+      ++failures;
+    }
+  }
+  // a copy of a well-known name, as plugins look them up
+  strcpy(name, "content-type");
+  if (mime_hdr_field_find(mh, name, 12) != _mime_hdr_field_list_search_by_string(mh, name, 12)) {
+    printf("FAILED: %s: lookup of %s\n", what, name);
+    ++failures;
+  }
+  return failures;
+}
+
+int
+HdrTest::test_mime_field_index()
+{
+  char name[32], *marshal_buf;
+  int len, marshal_len;
+  int failures = 0;
+  HTTPHdr hdr, marshal_hdr, copy_hdr;
+  RefCountObj ref;
+  MIMEField *field;
+
+  bri_box("test_mime_field_index");
+
+  hdr.create(HTTP_TYPE_REQUEST);
+  hdr.value_set(MIME_FIELD_CONTENT_TYPE, MIME_LEN_CONTENT_TYPE, "text/plain", 10);
+  for (int i = 0; i < 40; i++) {
+    len = snprintf(name, sizeof(name), "X-Field-%d", i);
+    hdr.value_set(name, len, name, len);
+  }
+  // a dup, which takes over when the first one goes
+  field = hdr.field_create("x-field-6", 9);
+  field->value_set(hdr.m_heap, hdr.m_mime, "dup", 3);
+  hdr.field_attach(field);
+  failures += check_field_index(hdr.m_mime, "after adding fields");
+
+  for (int i = 0; i < 40; i += 3) {
+    len = snprintf(name, sizeof(name), "X-Field-%d", i);
+    field = hdr.field_find(name, len);
+    hdr.field_delete(field, false);
+  }
+  failures += check_field_index(hdr.m_mime, "after deleting fields");
+
+  for (int i = 40; i < 48; i++) {
+    len = snprintf(name, sizeof(name), "X-Field-%d", i);
+    hdr.value_set(name, len, name, len);
+  }
+  failures += check_field_index(hdr.m_mime, "after adding more fields");
+
+  // the index stays out of the cache, a writeable copy builds its own
+  marshal_buf = (char *)ats_malloc(8192);
+  marshal_len = hdr.m_heap->marshal(marshal_buf, 8192);
+  if (marshal_len <= 0) {
+    printf("FAILED: marshal returned %d\n", marshal_len);
+    ++failures;
+  } else {
+    ref.m_refcount = 100;
+    marshal_hdr.create(HTTP_TYPE_REQUEST);
+    marshal_hdr.unmarshal(marshal_buf, marshal_len, &ref);
+    failures += check_field_index(hdr.m_mime, "after marshal");
+    failures += check_field_index(marshal_hdr.m_mime, "after unmarshal", false);
+    copy_hdr.create(HTTP_TYPE_REQUEST);
+    copy_hdr.copy(&marshal_hdr);
+    failures += check_field_index(copy_hdr.m_mime, "after copy of an unmarshalled header", false);
+    copy_hdr.field_find("X-Field-1", 9);
+    failures += check_field_index(copy_hdr.m_mime, "after a lookup in the copy");
+    copy_hdr.destroy();
+
+    copy_hdr.create(HTTP_TYPE_REQUEST);
+    copy_hdr.copy(&hdr);
+    failures += check_field_index(copy_hdr.m_mime, "after copy");
+    copy_hdr.destroy();
+  }
+  ats_free(marshal_buf);
+
+  hdr.destroy();
+
+  return (failures_to_status("test_mime_field_index", failures));
+}
+
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+static bool
+compact_hdr_equal(HTTPHdr *a, HTTPHdr *b, const char *what)
+{
+  char abuf[4096], bbuf[4096];
+  int alen = 0, blen = 0, offset;
+
+  offset = 0;
+  a->print(abuf, sizeof(abuf), &alen, &offset);
+  offset = 0;
+  b->print(bbuf, sizeof(bbuf), &blen, &offset);
+  if (alen != blen || memcmp(abuf, bbuf, alen) != 0) {
+    printf("FAILED: %s differs after the compact round trip\n[%.*s]\n[%.*s]\n", what, alen, abuf, blen, bbuf);
+    return false;
+  }
+  return true;
+}
+
+int
+HdrTest::test_http_info_compact()
+{
+  static const char *request =
+    "GET http://www.example.com:8080/a/b;p?q=1&r=2#f HTTP/1.1\r\n"
+    "Host: www.example.com:8080\r\n"
+    "accept-encoding: gzip, deflate\r\n"
+    "X-Odd-Name: 007\r\n"
+    "If-Modified-Since: Tue, 21 Aug 2012 19:05:31 GMT\r\n"
+    "If-Modified-Since: Tue, 21 Aug 2012 19:05:31 gmt\r\n"
+    "CONTENT-TYPE: text/html\r\n"
+    "Cookie: a=b\r\n" "\r\n";
+  static const char *response =
+    "HTTP/1.1 200 Fine Thanks\r\n"
+    "Date: Wed, 22 Aug 2012 08:10:02 GMT\r\n"
+    "Content-Type: text/html; charset=UTF-8\r\n"
+    "Content-Length: 35021\r\n"
+    "Cache-Control: public, max-age=3600\r\n"
+    "X-Empty: \r\n"
+    "X-Spaced:\t odd \r\n"
+    "X-Tight:200\r\n"
+    "X-Big: 18446744073709551615\r\n" "\r\n";
+
+  int failures = 0, len, used;
+  const char *start, *end;
+  char *buf;
+  HTTPParser parser;
+  HTTPHdr req_hdr, rsp_hdr;
+  HTTPInfo info, copy;
+
+  bri_box("test_http_info_compact");
+
+  http_parser_init(&parser);
+  req_hdr.create(HTTP_TYPE_REQUEST);
+  start = request;
+  end = start + strlen(start);
+  while (req_hdr.parse_req(&parser, &start, end, true) == PARSE_CONT);
+  http_parser_clear(&parser);
+  http_parser_init(&parser);
+  rsp_hdr.create(HTTP_TYPE_RESPONSE);
+  start = response;
+  end = start + strlen(start);
+  while (rsp_hdr.parse_resp(&parser, &start, end, true) == PARSE_CONT);
+  http_parser_clear(&parser);
+
+  info.create();
+  info.request_set(&req_hdr);
+  info.response_set(&rsp_hdr);
+  info.request_sent_time_set(1345623001);
+  info.response_received_time_set(1345623002);
+
+  len = info.marshal_compact_length();
+  buf = (char *)ats_malloc(len);
+  used = info.marshal_compact(buf, len);
+  if (used != len || !HTTPInfo::is_compact(buf, len)) {
+    printf("FAILED: marshal_compact wrote %d of %d bytes\n", used, len);
+    ++failures;
+  } else if (HTTPInfo::unmarshal_compact(buf, len, &copy) != len) {
+    printf("FAILED: unmarshal_compact\n");
+    ++failures;
+  } else {
+    if (!compact_hdr_equal(info.request_get(), copy.request_get(), "request"))
+      ++failures;
+    if (!compact_hdr_equal(info.response_get(), copy.response_get(), "response"))
+      ++failures;
+    if (copy.request_sent_time_get() != 1345623001 || copy.response_received_time_get() != 1345623002) {
+      printf("FAILED: times differ after the compact round trip\n");
+      ++failures;
+    }
+    // fields are decoded raw printable, with their whitespace
+    MIMEField *field = copy.response_get()->field_find("X-Spaced", 8);
+    if (!field || !field->m_n_v_raw_printable) {
+      printf("FAILED: X-Spaced is not raw printable after the compact round trip\n");
+      ++failures;
+    }
+    field = copy.request_get()->field_find(MIME_FIELD_HOST, MIME_LEN_HOST);
+    if (!field || !field->m_n_v_raw_printable) {
+      printf("FAILED: Host is not raw printable after the compact round trip\n");
+      ++failures;
+    }
+    copy.destroy();
+  }
+
+  // a truncated alternate does not decode
+  if (used == len && HTTPInfo::unmarshal_compact(buf, len - HDR_PTR_SIZE, &copy) >= 0) {
+    printf("FAILED: unmarshal_compact decoded a truncated alternate\n");
+    ++failures;
+  }
+
+  ats_free(buf);
+  info.destroy();
+  req_hdr.destroy();
+  rsp_hdr.destroy();
+
+  return (failures_to_status("test_http_info_compact", failures));
+}
+
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 
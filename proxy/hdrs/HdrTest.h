@@ -57,6 +57,9 @@ private:
   int test_format_date();
   int test_url();
   int test_http_parser_eos_boundary_cases();
+  int test_http_parser_split_input();
+  int test_mime_field_index();
+  int test_http_info_compact();
   int test_arena();
   int test_regex();
   int test_accept_language_match();
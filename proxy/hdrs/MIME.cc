@@ -23,6 +23,7 @@
 
 #include "ink_port.h"
 #include "libts.h"
+#include "ink_scan.h"
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
@@ -488,6 +489,211 @@ mime_hdr_unset_accelerators_and_presence_bits(MIMEHdrImpl *mh, MIMEField *field)
     mime_hdr_set_accelerator_slotnum(mh, slot_id, MIME_FIELD_SLOTNUM_MAX);
 }
 
+/***********************************************************************
+ *                                                                     *
+ *                        N A M E    I N D E X                         *
+ *                                                                     *
+ ***********************************************************************/
+
+// A name's probe sequence starts at its 16 bit hash, which is kept in the
+// bucket, so entries can be shifted back on delete without rehashing.
+#define MIME_FIELD_INDEX_HASH(v)	((v) >> 16)
+#define MIME_FIELD_INDEX_SLOTNUM(v)	((int) ((v) & 0xFFFF) - 1)
+#define MIME_FIELD_INDEX_BUCKET(h, s)	(((uint32_t) (h) << 16) | (uint32_t) ((s) + 1))
+
+// The index is a heap object of its own. MIMEHdrImpl has no pointer to
+// it, so as not to change the header layout the cache stores: a flag in
+// the object flags says there is one, and the padding after the object
+// header has its offset from the header. 32 bit builds have no padding
+// there, and no index.
+static inline MIMEFieldIndexImpl *
+_mime_hdr_field_index(MIMEHdrImpl *mh)
+{
+#if SIZEOF_VOID_POINTER == 8
+  if (mh->m_obj_flags & MIME_HDR_OBJ_FLAG_FIELD_INDEX)
+    return (MIMEFieldIndexImpl *) ((char *) mh + mh->m_field_index_offset);
+#endif
+  return NULL;
+}
+
+// Returns false if index is too far from the header to point at
+static inline bool
+_mime_hdr_field_index_set(MIMEHdrImpl *mh, MIMEFieldIndexImpl *index)
+{
+  mh->m_obj_flags &= ~MIME_HDR_OBJ_FLAG_FIELD_INDEX;
+#if SIZEOF_VOID_POINTER == 8
+  if (index) {
+    intptr_t offset = (char *) index - (char *) mh;
+
+    if (offset != (int32_t) offset)
+      return false;
+    mh->m_field_index_offset = (int32_t) offset;
+    mh->m_obj_flags |= MIME_HDR_OBJ_FLAG_FIELD_INDEX;
+  }
+  return true;
+#else
+  return (index == NULL);
+#endif
+}
+
+static inline uint32_t
+mime_field_index_hash(const char *name, int length)
+{
+  // FNV-1a on the lower cased name, folded to 16 bits
+  uint32_t h = 2166136261U;
+
+  for (int i = 0; i < length; i++) {
+    h ^= (unsigned char) ParseRules::ink_tolower(name[i]);
+    h *= 16777619U;
+  }
+  return (h >> 16) ^ (h & 0xFFFF);
+}
+
+// Bucket holding the name, or -1 with *empty set to the bucket it would go in
+static int
+_mime_hdr_field_index_probe(MIMEHdrImpl *mh, const char *name, int length, uint32_t hash, int *empty)
+{
+  MIMEFieldIndexImpl *index = _mime_hdr_field_index(mh);
+  uint32_t mask = index->m_size - 1;
+  uint32_t i, v;
+
+  for (i = hash & mask; (v = index->m_buckets[i]) != 0; i = (i + 1) & mask) {
+    if (MIME_FIELD_INDEX_HASH(v) == hash) {
+      MIMEField *field = _mime_hdr_field_list_search_by_slotnum(mh, MIME_FIELD_INDEX_SLOTNUM(v));
+      if (field && (field->m_len_name == length) && (strncasecmp(field->m_ptr_name, name, length) == 0))
+        return i;
+    }
+  }
+  if (empty)
+    *empty = i;
+  return -1;
+}
+
+static MIMEField *
+_mime_hdr_field_index_find(MIMEHdrImpl *mh, const char *name, int length)
+{
+  int i = _mime_hdr_field_index_probe(mh, name, length, mime_field_index_hash(name, length), NULL);
+
+  if (i < 0)
+    return NULL;
+  return _mime_hdr_field_list_search_by_slotnum(mh, MIME_FIELD_INDEX_SLOTNUM(_mime_hdr_field_index(mh)->m_buckets[i]));
+}
+
+static void
+_mime_hdr_field_index_destroy(HdrHeap *heap, MIMEHdrImpl *mh)
+{
+  MIMEFieldIndexImpl *index = _mime_hdr_field_index(mh);
+
+  if (index) {
+    heap->deallocate_obj(index);
+    _mime_hdr_field_index_set(mh, NULL);
+  }
+}
+
+// Called when field becomes the first live field with its name
+static void
+_mime_hdr_field_index_insert(MIMEHdrImpl *mh, MIMEField *field, int slotnum)
+{
+  MIMEFieldIndexImpl *index = _mime_hdr_field_index(mh);
+  uint32_t hash = mime_field_index_hash(field->m_ptr_name, field->m_len_name);
+  int empty;
+  int i = _mime_hdr_field_index_probe(mh, field->m_ptr_name, field->m_len_name, hash, &empty);
+
+  if (i >= 0) {
+    if (MIME_FIELD_INDEX_SLOTNUM(index->m_buckets[i]) > slotnum)
+      index->m_buckets[i] = MIME_FIELD_INDEX_BUCKET(hash, slotnum);
+  } else if ((index->m_count + 1) * 2 > index->m_size || slotnum >= 0xFFFE) {
+    // Full. Without a heap to grow into, drop the index for the next
+    // lookup to build a bigger one.
+    index->m_type = HDR_HEAP_OBJ_EMPTY;
+    _mime_hdr_field_index_set(mh, NULL);
+  } else {
+    index->m_buckets[empty] = MIME_FIELD_INDEX_BUCKET(hash, slotnum);
+    ++index->m_count;
+  }
+}
+
+// Called when field, the first live field with its name, is detached.
+// next_dup is the next one, if any.
+static void
+_mime_hdr_field_index_remove(MIMEHdrImpl *mh, MIMEField *field, MIMEField *next_dup)
+{
+  MIMEFieldIndexImpl *index = _mime_hdr_field_index(mh);
+  uint32_t hash = mime_field_index_hash(field->m_ptr_name, field->m_len_name);
+  uint32_t mask = index->m_size - 1;
+  uint32_t i, j, home, v;
+  int found = _mime_hdr_field_index_probe(mh, field->m_ptr_name, field->m_len_name, hash, NULL);
+
+  if (found < 0 || MIME_FIELD_INDEX_SLOTNUM(index->m_buckets[found]) != mime_hdr_field_slotnum(mh, field))
+    return;
+
+  if (next_dup) {
+    index->m_buckets[found] = MIME_FIELD_INDEX_BUCKET(hash, mime_hdr_field_slotnum(mh, next_dup));
+    return;
+  }
+
+  // shift back the entries that probed past the freed bucket
+  i = found;
+  index->m_buckets[i] = 0;
+  --index->m_count;
+  for (j = (i + 1) & mask; (v = index->m_buckets[j]) != 0; j = (j + 1) & mask) {
+    home = MIME_FIELD_INDEX_HASH(v) & mask;
+    if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j))
+      continue;
+    index->m_buckets[i] = v;
+    index->m_buckets[j] = 0;
+    i = j;
+  }
+}
+
+static int
+_mime_hdr_slots_used(MIMEHdrImpl *mh)
+{
+  int slots = 0;
+
+  for (MIMEFieldBlockImpl *fblock = &(mh->m_first_fblock); fblock != NULL; fblock = fblock->m_next)
+    slots += fblock->m_freetop;
+  return slots;
+}
+
+static void
+_mime_hdr_field_index_build(HdrHeap *heap, MIMEHdrImpl *mh, int slots)
+{
+  MIMEFieldIndexImpl *index;
+  MIMEFieldBlockImpl *fblock;
+  int size, slotnum;
+
+#if SIZEOF_VOID_POINTER != 8
+  // no room in MIMEHdrImpl to find it by
+  return;
+#endif
+
+  for (size = 16; size < slots * 2; size <<= 1);
+  index = (MIMEFieldIndexImpl *)
+    heap->allocate_obj(sizeof(MIMEFieldIndexImpl) + (size - 1) * sizeof(uint32_t), HDR_HEAP_OBJ_FIELD_INDEX);
+  if (index == NULL)
+    return;
+  index->m_size = size;
+  index->m_count = 0;
+  memset(index->m_buckets, 0, size * sizeof(uint32_t));
+  if (!_mime_hdr_field_index_set(mh, index)) {
+    // too far from the header, don't try again for this one
+    heap->deallocate_obj(index);
+    mh->m_obj_flags |= MIME_HDR_OBJ_FLAG_NO_FIELD_INDEX;
+    return;
+  }
+
+  // in slot order, so each name gets the first of its fields
+  slotnum = 0;
+  for (fblock = &(mh->m_first_fblock); fblock != NULL; fblock = fblock->m_next) {
+    for (unsigned int i = 0; i < fblock->m_freetop; i++) {
+      if (fblock->m_field_slots[i].is_live())
+        _mime_hdr_field_index_insert(mh, &(fblock->m_field_slots[i]), slotnum + i);
+    }
+    slotnum += MIME_FIELD_BLOCK_SLOTS;
+  }
+}
+
 int
 checksum_block(const char *s, int len)
 {
@@ -590,6 +796,11 @@ mime_hdr_sanity_check(MIMEHdrImpl *mh)
 
   ink_release_assert(last_fblock == mh->m_fblock_list_tail);
   ink_release_assert(masksum == mh->m_presence_bits);
+  MIMEFieldIndexImpl *index = _mime_hdr_field_index(mh);
+  if (index) {
+    ink_release_assert(index->m_type == HDR_HEAP_OBJ_FIELD_INDEX);
+    ink_release_assert(index->m_count * 2 <= index->m_size);
+  }
 }
 #endif
 
@@ -985,6 +1196,8 @@ mime_hdr_init(MIMEHdrImpl *mh)
 
   mime_hdr_cooked_stuff_init(mh, NULL);
 
+  mh->m_obj_flags &= ~(MIME_HDR_OBJ_FLAG_FIELD_INDEX | MIME_HDR_OBJ_FLAG_NO_FIELD_INDEX);
+
   // first header is inline: fake an object header for uniformity
   obj_init_header((HdrHeapObjImpl *) & (mh->m_first_fblock), HDR_HEAP_OBJ_FIELD_BLOCK, sizeof(MIMEFieldBlockImpl), 0);
 
@@ -1028,6 +1241,7 @@ void
 mime_hdr_destroy(HdrHeap *heap, MIMEHdrImpl *mh)
 {
   mime_hdr_destroy_field_block_list(heap, mh->m_first_fblock.m_next);
+  _mime_hdr_field_index_destroy(heap, mh);
 
   // INKqa11458: if we deallocate mh here and call TSMLocRelease
   // again, the plugin fails in assert. We leave deallocating to
@@ -1041,6 +1255,7 @@ mime_hdr_copy_onto(MIMEHdrImpl *s_mh, HdrHeap *s_heap, MIMEHdrImpl *d_mh, HdrHea
 {
   int block_count;
   MIMEFieldBlockImpl *s_fblock, *d_fblock, *prev_d_fblock;
+  MIMEFieldIndexImpl *s_index, *d_index;
 
   // If there are chained field blocks beyond the first one, we're just going to
   //   destroy them.  Ideally, we'd use them if the copied in header needed
@@ -1049,6 +1264,7 @@ mime_hdr_copy_onto(MIMEHdrImpl *s_mh, HdrHeap *s_heap, MIMEHdrImpl *d_mh, HdrHea
   if (d_mh->m_first_fblock.m_next) {
     mime_hdr_destroy_field_block_list(d_heap, d_mh->m_first_fblock.m_next);
   }
+  _mime_hdr_field_index_destroy(d_heap, d_mh);
 
   ink_debug_assert(((char *) &(s_mh->m_first_fblock.m_field_slots[MIME_FIELD_BLOCK_SLOTS]) - (char *) s_mh) ==
                    sizeof(struct MIMEHdrImpl));
@@ -1077,6 +1293,17 @@ mime_hdr_copy_onto(MIMEHdrImpl *s_mh, HdrHeap *s_heap, MIMEHdrImpl *d_mh, HdrHea
     d_mh->m_fblock_list_tail = prev_d_fblock;
   }
 
+  // the slots keep their numbers, so the index only needs copying. The
+  // memcpy above copied the flag and the offset from the source header.
+  s_index = _mime_hdr_field_index(s_mh);
+  _mime_hdr_field_index_set(d_mh, NULL);
+  if (s_index) {
+    d_index = (MIMEFieldIndexImpl *) d_heap->allocate_obj(s_index->m_length, HDR_HEAP_OBJ_FIELD_INDEX);
+    obj_copy_data(s_index, d_index);
+    if (!_mime_hdr_field_index_set(d_mh, d_index))
+      d_heap->deallocate_obj(d_index);
+  }
+
   if (inherit_strs)
     d_heap->inherit_string_heaps(s_heap);
 
@@ -1155,6 +1382,7 @@ void
 mime_hdr_fields_clear(HdrHeap *heap, MIMEHdrImpl *mh)
 {
   mime_hdr_destroy_field_block_list(heap, mh->m_first_fblock.m_next);
+  _mime_hdr_field_index_destroy(heap, mh);
   mime_hdr_init(mh);
 }
 
@@ -1233,7 +1461,7 @@ _mime_hdr_field_list_search_by_slotnum(MIMEHdrImpl *mh, int slotnum)
 }
 
 MIMEField *
-mime_hdr_field_find(MIMEHdrImpl *mh, const char *field_name_str, int field_name_len)
+mime_hdr_field_find(MIMEHdrImpl *mh, const char *field_name_str, int field_name_len, HdrHeap *index_heap)
 {
   int is_wks;
   HdrTokenHeapPrefix *token_info;
@@ -1293,13 +1521,34 @@ mime_hdr_field_find(MIMEHdrImpl *mh, const char *field_name_str, int field_name_
 #endif
     return f;
   } else {
-    MIMEField *f = _mime_hdr_field_list_search_by_string(mh, field_name_str, field_name_len);
+    MIMEField *f;
+
+    // Long headers get a name index, built by the first lookup that can
+    // write to the heap. Names that are well-known strings are in it too,
+    // plugins look them up by copies that are not hdrtoken pointers.
+    if ((_mime_hdr_field_index(mh) == NULL) && index_heap && index_heap->m_writeable &&
+        !(mh->m_obj_flags & MIME_HDR_OBJ_FLAG_NO_FIELD_INDEX)) {
+      int slots = _mime_hdr_slots_used(mh);
+      if ((slots >= MIME_FIELD_INDEX_THRESHOLD) && (slots <= MIME_FIELD_INDEX_MAX_BUCKETS / 2))
+        _mime_hdr_field_index_build(index_heap, mh, slots);
+    }
 
-    ink_debug_assert((f == NULL) || f->is_live());
+    if (_mime_hdr_field_index(mh)) {
+      f = _mime_hdr_field_index_find(mh, field_name_str, field_name_len);
+      ink_debug_assert(f == _mime_hdr_field_list_search_by_string(mh, field_name_str, field_name_len));
 #if TRACK_FIELD_FIND_CALLS
-    Debug("http", "mime_hdr_field_find(hdr 0x%X, field %.*s): %s (due to strcmp list walk)\n",
-          mh, field_name_len, field_name_str, (f ? "HIT" : "MISS"));
+      Debug("http", "mime_hdr_field_find(hdr 0x%X, field %.*s): %s (due to name index)\n",
+            mh, field_name_len, field_name_str, (f ? "HIT" : "MISS"));
+#endif
+    } else {
+      f = _mime_hdr_field_list_search_by_string(mh, field_name_str, field_name_len);
+#if TRACK_FIELD_FIND_CALLS
+      Debug("http", "mime_hdr_field_find(hdr 0x%X, field %.*s): %s (due to strcmp list walk)\n",
+            mh, field_name_len, field_name_str, (f ? "HIT" : "MISS"));
 #endif
+    }
+
+    ink_debug_assert((f == NULL) || f->is_live());
     return f;
   }
 }
@@ -1486,6 +1735,9 @@ mime_hdr_field_attach(MIMEHdrImpl *mh, MIMEField *field, int check_for_dups, MIM
     mime_hdr_set_accelerators_and_presence_bits(mh, field);
   }
 
+  if (field->is_dup_head() && _mime_hdr_field_index(mh))
+    _mime_hdr_field_index_insert(mh, field, mime_hdr_field_slotnum(mh, field));
+
   // Now keep the cooked cache consistent
   ink_debug_assert(field->is_live());
   if (field->m_ptr_value && field->is_cooked())
@@ -1511,6 +1763,9 @@ mime_hdr_field_detach(MIMEHdrImpl *mh, MIMEField *field, bool detach_all_dups)
 
   if (field->m_flags & MIME_FIELD_SLOT_FLAGS_DUP_HEAD)  // head of list?
   {
+    if (_mime_hdr_field_index(mh))
+      _mime_hdr_field_index_remove(mh, field, next_dup);
+
     if (!next_dup)              // only child
     {
       mime_hdr_unset_accelerators_and_presence_bits(mh, field);
@@ -2177,7 +2432,7 @@ _mime_scanner_init(MIMEScanner *scanner)
   scanner->m_line_size = 0;
   scanner->m_line_length = 0;
   scanner->m_state = MIME_PARSE_BEFORE;
-
+  scanner->m_colon = -1;
 }
 
 //////////////////////////////////////////////////////
@@ -2253,6 +2508,7 @@ mime_scanner_get(MIMEScanner *S,
     ptrdiff_t runway = raw_input_e - raw_input_c; // remaining input.
     switch (S->m_state) {
     case MIME_PARSE_BEFORE: // waiting to find a field.
+      S->m_colon = -1;
       if (ParseRules::is_cr(*raw_input_c)) {
         ++raw_input_c;
         if (runway >= 2 && ParseRules::is_lf(*raw_input_c)) {
@@ -2286,7 +2542,21 @@ mime_scanner_get(MIMEScanner *S,
       }
       break;
     case MIME_PARSE_INSIDE:
-      lf_ptr = static_cast<char const*>(memchr(raw_input_c, ParseRules::CHAR_LF, runway));
+      if (MIME_SCANNER_TYPE_FIELD == raw_input_scan_type && S->m_colon < 0) {
+        // Look for the colon after the name on the same pass, so the
+        // parser does not have to go over the name again.
+        lf_ptr = ink_scan2(raw_input_c, raw_input_e, ParseRules::CHAR_LF, ':');
+        if (lf_ptr < raw_input_e && ':' == *lf_ptr) {
+          // the line is the buffered data, if any, then the input from *raw_input_s
+          S->m_colon = S->m_line_length + static_cast<int>(lf_ptr - *raw_input_s);
+          raw_input_c = lf_ptr + 1;
+          break;
+        }
+        if (lf_ptr == raw_input_e)
+          lf_ptr = NULL;
+      } else {
+        lf_ptr = static_cast<char const*>(memchr(raw_input_c, ParseRules::CHAR_LF, runway));
+      }
       if (lf_ptr) {
         raw_input_c = lf_ptr + 1;
         if (MIME_SCANNER_TYPE_LINE == raw_input_scan_type) {
@@ -2454,7 +2724,8 @@ mime_parser_parse(MIMEParser *parser, HdrHeap *heap, MIMEHdrImpl *mh, const char
       continue;                 // toss away garbage line
 
     // find name last
-    colon = (char *) memchr(line_c, ':', (line_e - line_c));
+    colon = (scanner->m_colon >= 0) ? line_c + scanner->m_colon : NULL;
+    ink_debug_assert(colon == memchr(line_c, ':', (line_e - line_c)));
     if (!colon)
       continue;                 // toss away garbage line
     field_name_last = colon - 1;
@@ -3584,6 +3855,8 @@ MIMEHdrImpl::marshal(MarshalXlate *ptr_xlate, int num_ptr, MarshalXlate *str_xla
 {
   // printf("MIMEHdrImpl:marshal  num_ptr = %d  num_str = %d\n", num_ptr, num_str);
   HDR_MARSHAL_PTR(m_fblock_list_tail, MIMEFieldBlockImpl, ptr_xlate, num_ptr);
+  // the name index is left out, see MIMEFieldIndexImpl
+  m_obj_flags &= ~(MIME_HDR_OBJ_FLAG_FIELD_INDEX | MIME_HDR_OBJ_FLAG_NO_FIELD_INDEX);
   return m_first_fblock.marshal(ptr_xlate, num_ptr, str_xlate, num_str);
 }
 
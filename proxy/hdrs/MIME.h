@@ -26,6 +26,7 @@
 
 #include <sys/time.h>
 
+#include "ink_config.h"
 #include "ink_assert.h"
 #include "ink_bool.h"
 #include "ink_apidefs.h"
@@ -90,6 +91,15 @@ enum MimeParseState {
 #define	MIME_FIELD_SLOTNUM_MAX			(MIME_FIELD_SLOTNUM_MASK - 1)
 #define MIME_FIELD_SLOTNUM_UNKNOWN		MIME_FIELD_SLOTNUM_MAX
 
+// a header with this many field slots gets a name index on its first
+// lookup by string, as long as the index stays under the bucket limit
+#define MIME_FIELD_INDEX_THRESHOLD		12
+#define MIME_FIELD_INDEX_MAX_BUCKETS		256
+
+// m_obj_flags of a MIMEHdrImpl that has a name index, or can't have one
+#define MIME_HDR_OBJ_FLAG_FIELD_INDEX		0x1
+#define MIME_HDR_OBJ_FLAG_NO_FIELD_INDEX	0x2
+
 /***********************************************************************
  *                                                                     *
  *                    MIMEField & MIMEFieldBlockImpl                   *
@@ -173,6 +183,28 @@ struct MIMEFieldBlockImpl:public HdrHeapObjImpl
   void check_strings(HeapCheck * heaps, int num_heaps);
 };
 
+/***********************************************************************
+ *                                                                     *
+ *                          MIMEFieldIndexImpl                         *
+ *                                                                     *
+ ***********************************************************************/
+
+/**
+  Hash index from field name, case insensitive, to the slot number of the
+  first live field with that name. Built lazily for headers with many
+  fields, and kept up to date as fields are attached and detached. It
+  holds slot numbers rather than pointers, so a copy of the header copies
+  it as is. It is not marshalled: headers read from the cache don't have
+  one, and the cache format doesn't change.
+*/
+struct MIMEFieldIndexImpl:public HdrHeapObjImpl
+{
+  // HdrHeapObjImpl is 4 bytes
+  uint16_t m_size;              // buckets, a power of 2
+  uint16_t m_count;             // buckets in use, at most half
+  uint32_t m_buckets[1];        // (name hash << 16) | (slotnum + 1), 0 if empty
+};
+
 /***********************************************************************
  *                                                                     *
  *                              MIMECooked                             *
@@ -225,7 +257,11 @@ struct MIMECooked
 
 struct MIMEHdrImpl:public HdrHeapObjImpl
 {
-  // HdrHeapObjImpl is 4 bytes, so this will result in 4 bytes padding
+  // HdrHeapObjImpl is 4 bytes, so this will result in 4 bytes padding.
+  // 64 bit builds keep the offset of the name index there.
+#if SIZEOF_VOID_POINTER == 8
+  int32_t m_field_index_offset;         // from this header, if MIME_HDR_OBJ_FLAG_FIELD_INDEX
+#endif
   uint64_t m_presence_bits;
   uint32_t m_slot_accelerators[4];
 
@@ -262,6 +298,7 @@ struct MIMEScanner
   int m_line_size;              // total allocated size of buffer
 //  int m_state;                  // state of scanning state machine
   MimeParseState m_state; ///< Parsing machine state.
+  int m_colon; ///< Offset of the first ':' in the field, -1 if none yet.
 };
 
 
@@ -604,7 +641,8 @@ void mime_hdr_fields_clear(HdrHeap * heap, MIMEHdrImpl * mh);
 MIMEField *_mime_hdr_field_list_search_by_wks(MIMEHdrImpl * mh, int wks_idx);
 MIMEField *_mime_hdr_field_list_search_by_string(MIMEHdrImpl * mh, const char *field_name_str, int field_name_len);
 MIMEField *_mime_hdr_field_list_search_by_slotnum(MIMEHdrImpl * mh, int slotnum);
-inkcoreapi MIMEField *mime_hdr_field_find(MIMEHdrImpl * mh, const char *field_name_str, int field_name_len);
+inkcoreapi MIMEField *mime_hdr_field_find(MIMEHdrImpl * mh, const char *field_name_str, int field_name_len,
+                                          HdrHeap * index_heap = NULL);
 
 MIMEField *mime_hdr_field_get(MIMEHdrImpl * mh, int idx);
 MIMEField *mime_hdr_field_get_slotnum(MIMEHdrImpl * mh, int slotnum);
@@ -1070,7 +1108,7 @@ inline MIMEField *
 MIMEHdr::field_find(const char *name, int length)
 {
 //    ink_assert(valid());
-  return mime_hdr_field_find(m_mime, name, length);
+  return mime_hdr_field_find(m_mime, name, length, m_heap);
 }
 
 /*-------------------------------------------------------------------------
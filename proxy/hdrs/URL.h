@@ -186,6 +186,7 @@ const char *url_scheme_set(HdrHeap *heap, URLImpl *url,
 void url_user_set(HdrHeap *heap, URLImpl *url, const char *value, int length, bool copy_string);
 void url_password_set(HdrHeap *heap, URLImpl *url, const char *value, int length, bool copy_string);
 void url_host_set(HdrHeap *heap, URLImpl *url, const char *value, int length, bool copy_string);
+void url_port_set(HdrHeap *heap, URLImpl *url, const char *value, int length, bool copy_string);
 void url_port_set(HdrHeap *heap, URLImpl *url, unsigned int port);
 
 /* HTTP specific */
@@ -184,6 +184,9 @@ loop_over_heap_objs(HdrHeap * hdr_heap, int offset)
       printf("  HDR_HEAP_OBJ_MIME_HEADER %d bytes\n", obj->m_length);
       process_mime_hdr_impl(obj, offset);
       break;
+    case HDR_HEAP_OBJ_FIELD_INDEX:
+      printf("  HDR_HEAP_OBJ_FIELD_INDEX %d bytes\n", obj->m_length);
+      break;
     case HDR_HEAP_OBJ_EMPTY:
       printf("  HDR_HEAP_OBJ_EMPTY       %d bytes\n", obj->m_length);
       break;
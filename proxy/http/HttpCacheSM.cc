@@ -71,6 +71,7 @@ HttpCacheSM::HttpCacheSM():
   open_read_cb(false), open_write_cb(false), open_read_tries(0),
   read_request_hdr(NULL), read_config(NULL),
   read_pin_in_cache(0), retry_write(true), open_write_tries(0),
+  write_info(NULL), write_pin_in_cache(0), collapse_deadline(0),
   lookup_url(NULL), lookup_max_recursive(0), current_lookup_level(0)
 {
 }
@@ -181,6 +182,20 @@ HttpCacheSM::state_cache_open_write(int event, void *data)
     break;
 
   case CACHE_EVENT_OPEN_WRITE_FAILED:
+    if (data == (void *) -ECACHE_DOC_BUSY && collapse_open_write()) {
+      // Somebody else is fetching the document. Rather than going
+      // to the origin server as well, wait for that writer and
+      // read the document from it.
+      Debug("http_cache", "[%" PRId64 "] [state_cache_open_write] write lock miss, "
+            "collapsing onto the writer", master_sm->sm_id);
+      open_write_cb = false;
+      open_read_cb = false;
+      SET_HANDLER(&HttpCacheSM::state_cache_collapsed_read);
+      do_schedule_in();
+      break;
+    }
+    if (collapse_deadline)
+      HTTP_INCREMENT_DYN_STAT(http_cache_collapsed_fallback_stat);
     // The cache is hosed or full or something.
     // Forward the failure to the main sm
     open_write_cb = true;
@@ -194,6 +209,112 @@ HttpCacheSM::state_cache_open_write(int event, void *data)
   return VC_EVENT_CONT;
 }
 
+//////////////////////////////////////////////////////////////////////////
+//
+//  HttpCacheSM::state_cache_collapsed_read()
+//
+//  We lost the write lock on a cache miss and are waiting for the
+//  writer (the transaction that holds the lock) instead of fetching
+//  the document from the origin server ourselves. The HttpSM is still
+//  waiting for the result of the open_write, so we finish with either
+//  - CACHE_EVENT_OPEN_READ
+//    - we attached to the writer (read while writer), or the writer
+//      finished and we read the document it wrote
+//  - CACHE_EVENT_OPEN_WRITE
+//    - the writer gave up without writing anything, and we took
+//      over the write lock
+//  - CACHE_EVENT_OPEN_WRITE_FAILED
+//    - we waited for longer than collapsed_forwarding_timeout,
+//      the HttpSM proxies the request without the cache
+//
+//////////////////////////////////////////////////////////////////////////
+int
+HttpCacheSM::state_cache_collapsed_read(int event, void *data)
+{
+  STATE_ENTER(&HttpCacheSM::state_cache_collapsed_read, event);
+  ink_assert(captive_action.cancelled == 0);
+  pending_action = NULL;
+
+  switch (event) {
+  case CACHE_EVENT_OPEN_READ:
+    HTTP_INCREMENT_DYN_STAT(http_current_cache_connections_stat);
+    HTTP_INCREMENT_DYN_STAT(http_cache_collapsed_hit_stat);
+    ink_assert(cache_read_vc == NULL);
+    open_read_cb = true;
+    collapse_deadline = 0;
+    cache_read_vc = (CacheVConnection *) data;
+    if (cache_read_vc->is_read_from_writer())
+      set_readwhilewrite_inprogress(true);
+
+    master_sm->handleEvent(event, data);
+    break;
+
+  case CACHE_EVENT_OPEN_READ_FAILED:
+    open_read_cb = true;
+    if (data == (void *) -ECACHE_DOC_BUSY) {
+      // The writer has not sent us anything to read yet.
+      if (ink_get_hrtime() < collapse_deadline) {
+        open_read_cb = false;
+        do_schedule_in();
+      } else {
+        collapse_fallback();
+      }
+    } else if (0 < (intptr_t) data) {
+      // special case: remote side pre_open_write, the write lock is ours
+      SET_HANDLER(&HttpCacheSM::state_cache_open_write);
+      handleEvent(CACHE_EVENT_OPEN_WRITE, data);
+    } else {
+      // The writer went away without leaving a document behind, try
+      // to take over the write lock. If somebody beat us to it we
+      // go back to waiting, for what is left of our time.
+      Debug("http_cache", "[%" PRId64 "] [state_cache_collapsed_read] writer is gone, "
+            "retrying cache open write", master_sm->sm_id);
+      SET_HANDLER(&HttpCacheSM::state_cache_open_write);
+      do_cache_open_write();
+    }
+    break;
+
+  case EVENT_INTERVAL:
+    open_read_cb = false;
+    do_cache_open_read();
+    break;
+
+  default:
+    ink_release_assert(0);
+  }
+
+  return VC_EVENT_CONT;
+}
+
+// Decide whether a write lock miss should wait for the writer rather
+// than go to the origin server, and start the clock if so.
+bool
+HttpCacheSM::collapse_open_write()
+{
+  // Only for plain cache misses: updates and writes of transformed or
+  // secondary copies keep the old behavior.
+  if (!retry_write || write_info != NULL || read_config == NULL ||
+      !master_sm->t_state.txn_conf->cache_collapsed_forwarding)
+    return false;
+
+  ink_hrtime now = ink_get_hrtime();
+
+  if (!collapse_deadline)
+    collapse_deadline = now + HRTIME_MSECONDS(master_sm->t_state.txn_conf->cache_collapsed_forwarding_timeout);
+  return now < collapse_deadline;
+}
+
+void
+HttpCacheSM::collapse_fallback()
+{
+  Debug("http_cache", "[%" PRId64 "] collapsed forwarding timed out, going to the origin server",
+        master_sm->sm_id);
+  HTTP_INCREMENT_DYN_STAT(http_cache_collapsed_fallback_stat);
+  SET_HANDLER(&HttpCacheSM::state_cache_open_write);
+  open_write_cb = true;
+  master_sm->handleEvent(CACHE_EVENT_OPEN_WRITE_FAILED, (void *) -ECACHE_DOC_BUSY);
+}
+
 void
 HttpCacheSM::do_schedule_in()
 {
@@ -311,6 +432,9 @@ HttpCacheSM::open_write(URL * url, HTTPHdr * request, CacheHTTPInfo * old_info,
   ink_assert(request == read_request_hdr || read_request_hdr == NULL);
   this->lookup_url = url;
   this->read_request_hdr = request;
+  // INKqa11166
+  this->write_info = allow_multiple ? (CacheHTTPInfo *) CACHE_ALLOW_MULTIPLE_WRITES : old_info;
+  this->write_pin_in_cache = pin_in_cache;
 
   // Make sure we are not stuck in a loop where the write
   //  fails but the retry read succeeds causing to issue
@@ -323,16 +447,23 @@ HttpCacheSM::open_write(URL * url, HTTPHdr * request, CacheHTTPInfo * old_info,
     return ACTION_RESULT_DONE;
   }
 
+  return do_cache_open_write();
+}
+
+Action *
+HttpCacheSM::do_cache_open_write()
+{
+  ink_assert(pending_action == NULL);
+  open_write_cb = false;
+
   Action *action_handle = cacheProcessor.open_write(this,
                                                     0,
-                                                    url,
+                                                    lookup_url,
                                                     master_sm->t_state.cache_control.cluster_cache_local ||
                                                     master_sm->t_state.cop_test_page,
-                                                    request,
-                                                    // INKqa11166
-                                                    allow_multiple ? (CacheHTTPInfo *) CACHE_ALLOW_MULTIPLE_WRITES :
-                                                    old_info,
-                                                    pin_in_cache);
+                                                    read_request_hdr,
+                                                    write_info,
+                                                    write_pin_in_cache);
 
   if (action_handle != ACTION_RESULT_DONE) {
     pending_action = action_handle;
@@ -153,9 +153,13 @@ private:
 
   void do_schedule_in();
   Action *do_cache_open_read();
+  Action *do_cache_open_write();
+  bool collapse_open_write();
+  void collapse_fallback();
 
   int state_cache_open_read(int event, void *data);
   int state_cache_open_write(int event, void *data);
+  int state_cache_collapsed_read(int event, void *data);
 
   HttpCacheAction captive_action;
   bool open_read_cb;
@@ -170,6 +174,12 @@ private:
   // Open write parameters
   bool retry_write;
   int open_write_tries;
+  CacheHTTPInfo *write_info;
+  time_t write_pin_in_cache;
+
+  // Collapsed forwarding: when we lose the write lock, we wait (until
+  // this deadline) for the writer and read the document from it.
+  ink_hrtime collapse_deadline;
 
   // Common parameters
   URL *lookup_url;
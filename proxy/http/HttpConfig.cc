@@ -34,6 +34,7 @@
 #include <records/I_RecHttp.h>
 #include "api/ts/ts.h"
 #include "ReverseProxy.h"
+#include "HttpTrafficStats.h"
 
 #ifndef min
 #define         min(a,b)        ((a) < (b) ? (a) : (b))
@@ -60,6 +61,7 @@
 
 
 RecRawStatBlock *http_rsb;
+RecRawStatHistogramBlock *http_rsh;
 #define HTTP_CLEAR_DYN_STAT(x) \
 do { \
 	RecSetRawStatSum(http_rsb, x, 0); \
@@ -105,7 +107,8 @@ HttpConfigCont::handle_event(int event, void *edata)
   if (ink_atomic_increment((int *) &http_config_changes, -1) == 1) {
     HttpConfig::reconfigure();
     if (reload_remap_config) {
-      reloadUrlRewrite();
+      // the rules have copies of the overridable configs, rebuild them all
+      reloadUrlRewrite(false);
       reload_remap_config = false;
     }
   }
@@ -145,6 +148,19 @@ void
 register_stat_callbacks()
 {
 
+  // Latency histograms, each gives <name>.count, <name>.p50, .p90, .p99 and .p999
+
+  RecRegisterRawStatHistogram(http_rsh, RECT_PROCESS, "proxy.process.http.latency.dns_lookup_us",
+                              RECP_NON_PERSISTENT, (int) http_dns_lookup_histogram);
+  RecRegisterRawStatHistogram(http_rsh, RECT_PROCESS, "proxy.process.http.latency.origin_connect_us",
+                              RECP_NON_PERSISTENT, (int) http_origin_connect_histogram);
+  RecRegisterRawStatHistogram(http_rsh, RECT_PROCESS, "proxy.process.http.latency.first_byte_us",
+                              RECP_NON_PERSISTENT, (int) http_first_byte_histogram);
+  RecRegisterRawStatHistogram(http_rsh, RECT_PROCESS, "proxy.process.http.latency.cache_open_read_us",
+                              RECP_NON_PERSISTENT, (int) http_cache_open_read_histogram);
+  RecRegisterRawStatHistogram(http_rsh, RECT_PROCESS, "proxy.process.http.latency.total_us",
+                              RECP_NON_PERSISTENT, (int) http_total_histogram);
+
   // Dynamic stats
 
   RecRegisterRawStat(http_rsb, RECT_PROCESS,
@@ -232,6 +248,27 @@ register_stat_callbacks()
                      "proxy.process.http.total_parent_proxy_connections",
                      RECD_COUNTER, RECP_NULL, (int) http_total_parent_proxy_connections_stat, RecRawStatSyncCount);
 
+  // Server session pool and prewarming stats
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_pool_hits",
+                     RECD_COUNTER, RECP_NULL, (int) http_server_session_pool_hit_stat, RecRawStatSyncCount);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_pool_misses",
+                     RECD_COUNTER, RECP_NULL, (int) http_server_session_pool_miss_stat, RecRawStatSyncCount);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_pool_evictions",
+                     RECD_COUNTER, RECP_NULL, (int) http_server_session_pool_evicted_stat, RecRawStatSyncCount);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_prewarm_opened",
+                     RECD_COUNTER, RECP_NULL, (int) http_server_session_prewarm_opened_stat, RecRawStatSyncCount);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_prewarm_expired",
+                     RECD_COUNTER, RECP_NULL, (int) http_server_session_prewarm_expired_stat, RecRawStatSyncCount);
+
   // Upstream current connections stats
   RecRegisterRawStat(http_rsb, RECT_PROCESS,
                      "proxy.process.http.current_parent_proxy_connections",
@@ -694,6 +731,22 @@ register_stat_callbacks()
                      "proxy.process.http.cache_read_error",
                      RECD_COUNTER, RECP_NULL, (int) http_cache_read_error_stat, RecRawStatSyncCount);
 
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.cache_collapsed_hit",
+                     RECD_COUNTER, RECP_NULL, (int) http_cache_collapsed_hit_stat, RecRawStatSyncCount);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.cache_collapsed_fallback",
+                     RECD_COUNTER, RECP_NULL, (int) http_cache_collapsed_fallback_stat, RecRawStatSyncCount);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.cache_stale_while_revalidate",
+                     RECD_COUNTER, RECP_NULL, (int) http_cache_stale_while_revalidate_stat, RecRawStatSyncCount);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.cache_stale_if_error",
+                     RECD_COUNTER, RECP_NULL, (int) http_cache_stale_if_error_stat, RecRawStatSyncCount);
+
   /////////////////////////////////////////
   // Bandwidth Savings Transaction Stats //
   /////////////////////////////////////////
@@ -1154,9 +1207,19 @@ HttpConfig::startup()
 {
 
   http_rsb = RecAllocateRawStatBlock((int) http_stat_count);
+  http_rsh = RecAllocateRawStatHistogramBlock((int) http_histogram_count);
   register_configs();
   register_stat_callbacks();
 
+  // Per remap rule and per origin stats need their thread local memory
+  // before the event threads start, so these can't change on the fly
+  int traffic_stats_keys = 0;
+  REC_ReadConfigInteger(traffic_stats_keys, "proxy.config.http.traffic_stats.max_remap_rules");
+  http_remap_traffic_stats.init(traffic_stats_keys);
+  traffic_stats_keys = 0;
+  REC_ReadConfigInteger(traffic_stats_keys, "proxy.config.http.traffic_stats.max_origins");
+  http_origin_traffic_stats.init(traffic_stats_keys);
+
   HttpConfigParams &c = m_master;
 
   http_config_cont = NEW(new HttpConfigCont);
@@ -1184,6 +1247,9 @@ HttpConfig::startup()
   HttpEstablishStaticConfigLongLong(c.oride.server_tcp_init_cwnd, "proxy.config.http.server_tcp_init_cwnd");
   HttpEstablishStaticConfigLongLong(c.oride.origin_max_connections, "proxy.config.http.origin_max_connections");
   HttpEstablishStaticConfigLongLong(c.origin_min_keep_alive_connections, "proxy.config.http.origin_min_keep_alive_connections");
+  HttpEstablishStaticConfigLongLong(c.server_session_pool_max_idle, "proxy.config.http.server_session_pool.max_idle");
+  HttpEstablishStaticConfigLongLong(c.server_session_pool_max_idle_per_origin,
+                                    "proxy.config.http.server_session_pool.max_idle_per_origin");
 
   HttpEstablishStaticConfigByte(c.parent_proxy_routing_enable, "proxy.config.http.parent_proxy_routing_enable");
 
@@ -1316,6 +1382,17 @@ HttpConfig::startup()
   HttpEstablishStaticConfigLongLong(c.oride.max_cache_open_read_retries, "proxy.config.http.cache.max_open_read_retries");
   HttpEstablishStaticConfigLongLong(c.oride.cache_open_read_retry_time, "proxy.config.http.cache.open_read_retry_time");
 
+  // collapsed forwarding of concurrent misses
+  HttpEstablishStaticConfigByte(c.oride.cache_collapsed_forwarding, "proxy.config.http.cache.collapsed_forwarding");
+  HttpEstablishStaticConfigLongLong(c.oride.cache_collapsed_forwarding_timeout,
+                                    "proxy.config.http.cache.collapsed_forwarding_timeout");
+
+  // RFC 5861 stale content extensions
+  HttpEstablishStaticConfigLongLong(c.oride.cache_stale_while_revalidate, "proxy.config.http.cache.stale_while_revalidate");
+  HttpEstablishStaticConfigLongLong(c.oride.cache_stale_if_error, "proxy.config.http.cache.stale_if_error");
+
+  HttpEstablishStaticConfigByte(c.oride.cache_range_miss_fill, "proxy.config.http.cache.range_miss_fill");
+
   // open write failure retries
   HttpEstablishStaticConfigLongLong(c.max_cache_open_write_retries, "proxy.config.http.cache.max_open_write_retries");
 
@@ -1393,6 +1470,8 @@ HttpConfig::startup()
   // Stat Page Info
   HttpEstablishStaticConfigByte(c.enable_http_info, "proxy.config.http.enable_http_info");
 
+  HttpEstablishStaticConfigByte(c.splice_tunnel, "proxy.config.http.splice_tunnel");
+
   // Support SRV records
   HttpEstablishStaticConfigLongLong(c.srv_enabled, "proxy.config.srv_enabled");
 
@@ -1483,6 +1562,8 @@ HttpConfig::reconfigure()
     Warning("origin_max_connections < origin_min_keep_alive_connections, setting min=max , please correct your records.config");
     params->origin_min_keep_alive_connections = params->oride.origin_max_connections;
   }
+  params->server_session_pool_max_idle = m_master.server_session_pool_max_idle;
+  params->server_session_pool_max_idle_per_origin = m_master.server_session_pool_max_idle_per_origin;
 
   params->parent_proxy_routing_enable = INT_TO_BOOL(m_master.parent_proxy_routing_enable);
   params->enable_url_expandomatic = INT_TO_BOOL(m_master.enable_url_expandomatic);
@@ -1589,6 +1670,16 @@ HttpConfig::reconfigure()
   params->oride.max_cache_open_read_retries = m_master.oride.max_cache_open_read_retries;
   params->oride.cache_open_read_retry_time = m_master.oride.cache_open_read_retry_time;
 
+  // collapsed forwarding of concurrent misses
+  params->oride.cache_collapsed_forwarding = INT_TO_BOOL(m_master.oride.cache_collapsed_forwarding);
+  params->oride.cache_collapsed_forwarding_timeout = m_master.oride.cache_collapsed_forwarding_timeout;
+
+  // RFC 5861 stale content extensions
+  params->oride.cache_stale_while_revalidate = m_master.oride.cache_stale_while_revalidate;
+  params->oride.cache_stale_if_error = m_master.oride.cache_stale_if_error;
+
+  params->oride.cache_range_miss_fill = INT_TO_BOOL(m_master.oride.cache_range_miss_fill);
+
   // open write failure retries
   params->max_cache_open_write_retries = m_master.max_cache_open_write_retries;
 
@@ -1632,6 +1723,7 @@ HttpConfig::reconfigure()
   params->default_buffer_size_index = m_master.default_buffer_size_index;
   params->default_buffer_water_mark = m_master.default_buffer_water_mark;
   params->enable_http_info = INT_TO_BOOL(m_master.enable_http_info);
+  params->splice_tunnel = INT_TO_BOOL(m_master.splice_tunnel);
   params->reverse_proxy_no_host_redirect = ats_strdup(m_master.reverse_proxy_no_host_redirect);
   params->reverse_proxy_no_host_redirect_len =
     params->reverse_proxy_no_host_redirect ? strlen(params->reverse_proxy_no_host_redirect) : 0;
@@ -93,6 +93,11 @@ enum
   http_total_client_connections_ipv6_stat,
   http_total_server_connections_stat,
   http_total_parent_proxy_connections_stat,
+  http_server_session_pool_hit_stat,
+  http_server_session_pool_miss_stat,
+  http_server_session_pool_evicted_stat,
+  http_server_session_prewarm_opened_stat,
+  http_server_session_prewarm_expired_stat,
   http_current_parent_proxy_connections_stat,
   http_current_server_connections_stat,
   http_current_cache_connections_stat,
@@ -224,6 +229,10 @@ enum
   http_cache_miss_uncacheable_stat,
   http_cache_miss_ims_stat,
   http_cache_read_error_stat,
+  http_cache_collapsed_hit_stat,
+  http_cache_collapsed_fallback_stat,
+  http_cache_stale_while_revalidate_stat,
+  http_cache_stale_if_error_stat,
 
   // bandwidth savings stats
   http_tcp_hit_count_stat,
@@ -351,13 +360,28 @@ enum
   http_stat_count
 };
 
+// Latency histograms, in microseconds
+enum
+{
+  http_dns_lookup_histogram,
+  http_origin_connect_histogram,
+  http_first_byte_histogram,
+  http_cache_open_read_histogram,
+  http_total_histogram,
+
+  http_histogram_count
+};
+
 extern RecRawStatBlock *http_rsb;
+extern RecRawStatHistogramBlock *http_rsh;
 extern volatile int g_current_active_client_connections;
 
 /* Stats should only be accessed using these macros */
 #define HTTP_INCREMENT_DYN_STAT(x) RecIncrRawStat(http_rsb, mutex->thread_holding, (int) x, 1)
 #define HTTP_DECREMENT_DYN_STAT(x) RecIncrRawStat(http_rsb, mutex->thread_holding, (int) x, -1)
 #define HTTP_SUM_DYN_STAT(x, y) RecIncrRawStat(http_rsb, mutex->thread_holding, (int) x, (int64_t) y)
+#define HTTP_HISTOGRAM_DYN_STAT(x, t) \
+  RecIncrRawStatHistogram(http_rsh, mutex->thread_holding, (int) x, ink_hrtime_to_usec(t))
 #define HTTP_SUM_GLOBAL_DYN_STAT(x, y) RecIncrGlobalRawStatSum(http_rsb, x, y)
 
 #define HTTP_CLEAR_DYN_STAT(x) \
@@ -418,7 +442,7 @@ struct OverridableHttpConfigParams {
        cache_ims_on_client_no_cache(0), cache_ignore_server_no_cache(0), cache_responses_to_cookies(0),
        cache_ignore_auth(0), cache_urls_that_look_dynamic(0), cache_required_headers(0), // CACHE_REQUIRED_HEADERS_NONE
        insert_request_via_string(0), insert_response_via_string(0), range_elimination_enabled(0), doc_in_cache_skip_dns(1),
-       anonymize_insert_client_ip(1),
+       cache_collapsed_forwarding(0), cache_range_miss_fill(0), anonymize_insert_client_ip(1),
        negative_caching_lifetime(0),
        sock_recv_buffer_size_out(0), sock_send_buffer_size_out(0), sock_option_flag_out(0),
        sock_packet_mark_out(0), sock_packet_tos_out(0),
@@ -438,6 +462,8 @@ struct OverridableHttpConfigParams {
        down_server_timeout(0), client_abort_threshold(0),
        freshness_fuzz_time(0), freshness_fuzz_min_time(0),
        max_cache_open_read_retries(0), cache_open_read_retry_time(0),
+       cache_collapsed_forwarding_timeout(0),
+       cache_stale_while_revalidate(0), cache_stale_if_error(0),
        sock_flow_control_in(0), sock_flow_control_out(0),
 
        // Strings / floats must come last
@@ -523,6 +549,16 @@ struct OverridableHttpConfigParams {
   //////////////////////
   MgmtByte doc_in_cache_skip_dns;
 
+  ////////////////////////////////////////////////////////
+  // Wait for the writer on a cache write lock miss     //
+  ////////////////////////////////////////////////////////
+  MgmtByte cache_collapsed_forwarding;
+
+  ////////////////////////////////////////////////////////
+  // Fill the whole object into cache on a Range miss   //
+  ////////////////////////////////////////////////////////
+  MgmtByte cache_range_miss_fill;
+
   MgmtInt anonymize_insert_client_ip;
   MgmtInt negative_caching_lifetime;
 
@@ -585,6 +621,14 @@ struct OverridableHttpConfigParams {
   MgmtInt max_cache_open_read_retries;
   MgmtInt cache_open_read_retry_time;   // time is in mseconds
 
+  // longest time to wait for the writer when collapsing, in mseconds
+  MgmtInt cache_collapsed_forwarding_timeout;
+
+  // RFC 5861 windows (seconds) used when the cached response does not
+  // carry stale-while-revalidate / stale-if-error itself
+  MgmtInt cache_stale_while_revalidate;
+  MgmtInt cache_stale_if_error;
+
   MgmtInt sock_flow_control_in;
   MgmtInt sock_flow_control_out;
 
@@ -639,6 +683,8 @@ public:
   MgmtInt max_active_client_connections;
   MgmtInt server_max_connections;
   MgmtInt origin_min_keep_alive_connections; // TODO: This one really ought to be overridable, but difficult right now.
+  MgmtInt server_session_pool_max_idle;
+  MgmtInt server_session_pool_max_idle_per_origin;
 
   MgmtByte parent_proxy_routing_enable;
   MgmtByte disable_ssl_parenting;
@@ -795,6 +841,9 @@ public:
   MgmtInt default_buffer_water_mark;
   MgmtByte enable_http_info;
 
+  // Splice plain server to user agent transfers in the kernel
+  MgmtByte splice_tunnel;
+
   // Cluster time delta is not a config variable,
   //  rather it is the time skew which the manager observes
   int32_t cluster_time_delta;
@@ -929,6 +978,8 @@ HttpConfigParams::HttpConfigParams()
     max_active_client_connections(0),
     server_max_connections(0),
     origin_min_keep_alive_connections(0),
+    server_session_pool_max_idle(0),
+    server_session_pool_max_idle_per_origin(0),
     parent_proxy_routing_enable(0),
     disable_ssl_parenting(0),
     enable_url_expandomatic(0),
@@ -994,6 +1045,7 @@ HttpConfigParams::HttpConfigParams()
     default_buffer_size_index(0),
     default_buffer_water_mark(0),
     enable_http_info(0),
+    splice_tunnel(0),
     cluster_time_delta(0),
     srv_enabled(0),
     redirection_enabled(1),
@@ -241,6 +241,9 @@ start_HttpProxyServer(int accept_threads)
 
   SSLConfig::release(sslParam);
 
+  // Start opening sessions to the origins the pools are kept warm for
+  httpSessionManager.start_prewarm();
+
 #ifdef DEBUG
   if (diags->on("http_dump")) {
 //      HttpStateMachine::dump_state_machines();
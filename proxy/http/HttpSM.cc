@@ -28,6 +28,7 @@
 #include "HttpServerSession.h"
 #include "HttpDebugNames.h"
 #include "HttpSessionManager.h"
+#include "HttpUpdateSM.h"
 #include "P_Cache.h"
 #include "P_Net.h"
 #include "StatPages.h"
@@ -48,6 +49,7 @@
 #include "HCSM.h"
 #include "HotUrlStats.h"
 #include "HttpConnectionCount.h"
+#include "HttpTrafficStats.h"
 
 #define DEFAULT_RESPONSE_BUFFER_SIZE_INDEX    6 // 8K
 #define DEFAULT_REQUEST_BUFFER_SIZE_INDEX    6  // 8K
@@ -1078,12 +1080,12 @@ HttpSM::state_raw_http_server_open(int event, void *data)
 {
   STATE_ENTER(&HttpSM::state_raw_http_server_open, event);
   ink_assert(server_entry == NULL);
-  // milestones.server_connect_end = ink_get_hrtime();
   NetVConnection *netvc = NULL;
 
   pending_action = NULL;
   switch (event) {
   case NET_EVENT_OPEN:
+    milestones.server_connect_end = ink_get_hrtime();
 
     if (t_state.pCongestionEntry != NULL) {
       t_state.pCongestionEntry->connection_opened();
@@ -1631,11 +1633,11 @@ HttpSM::state_http_server_open(int event, void *data)
   // TODO decide whether to uncomment after finish testing redirect
   // ink_assert(server_entry == NULL);
   pending_action = NULL;
-  // milestones.server_connect_end = ink_get_hrtime();
   HttpServerSession *session;
 
   switch (event) {
   case NET_EVENT_OPEN:
+    milestones.server_connect_end = ink_get_hrtime();
     session = (2 == t_state.txn_conf->share_server_sessions) ? 
       THREAD_ALLOC_INIT(httpServerSessionAllocator, mutex->thread_holding) :
       httpServerSessionAllocator.alloc();
@@ -3044,6 +3046,13 @@ HttpSM::is_bg_fill_necessary(HttpTunnelConsumer * c)
 {
   ink_assert(c->vc_type == HT_HTTP_CLIENT);
 
+  // The whole object is being filled for a range the user
+  //  agent asked for, fill it no matter how much of the range
+  //  has been sent
+  if (is_range_miss_fill(c->producer)) {
+    return true;
+  }
+
   // There must be another consumer for it to worthwhile to
   //  set up a background fill
   if ((c->producer->vc_type == HT_HTTP_SERVER  || c->producer->vc_type == HT_TRANSFORM) &&
@@ -3076,6 +3085,43 @@ HttpSM::is_bg_fill_necessary(HttpTunnelConsumer * c)
   return false;
 }
 
+// Is p the range transform of a range miss that fills the whole object
+//  into the cache, with the server still writing to the cache
+bool
+HttpSM::is_range_miss_fill(HttpTunnelProducer * p)
+{
+  if (p->vc_type != HT_TRANSFORM || t_state.range_setup != HttpTransact::RANGE_TRANSFORM ||
+      !t_state.range_elimination || !t_state.txn_conf->cache_range_miss_fill) {
+    return false;
+  }
+
+  HttpTunnelProducer *server = p->self_consumer ? p->self_consumer->producer : NULL;
+
+  if (server == NULL || server->vc_type != HT_HTTP_SERVER || server->alive == false) {
+    return false;
+  }
+
+  forl_LL(HttpTunnelConsumer, c, server->consumer_list) {
+    if (c->vc_type == HT_CACHE_WRITE && c->alive)
+      return true;
+  }
+  return false;
+}
+
+// Account for the server to cache transfer going on without a user
+//  agent, and bound how long it may take
+void
+HttpSM::start_background_fill()
+{
+  DebugSM("http", "[%" PRId64 "] Initiating background fill", sm_id);
+  background_fill = BACKGROUND_FILL_STARTED;
+  HTTP_INCREMENT_DYN_STAT(http_background_fill_current_count_stat);
+
+  if (server_session && server_session->get_netvc())
+    server_session->get_netvc()->
+      set_active_timeout(HRTIME_SECONDS(t_state.http_config_param->background_fill_active_timeout));
+}
+
 int
 HttpSM::tunnel_handler_ua(int event, HttpTunnelConsumer * c)
 {
@@ -3100,17 +3146,17 @@ HttpSM::tunnel_handler_ua(int event, HttpTunnelConsumer * c)
     set_ua_abort(HttpTransact::ABORTED, event);
 
     if (is_bg_fill_necessary(c)) {
-      DebugSM("http", "[%" PRId64 "] Initiating background fill", sm_id);
-      background_fill = BACKGROUND_FILL_STARTED;
-      HTTP_INCREMENT_DYN_STAT(http_background_fill_current_count_stat);
-
       // There is another consumer (cache write) so
       //  detach the user agent
-      ink_assert(server_entry->vc == c->producer->vc);
-      ink_assert(server_session == c->producer->vc);
-      if (server_session && server_session->get_netvc())
-        server_session->get_netvc()->
-          set_active_timeout(HRTIME_SECONDS(t_state.http_config_param->background_fill_active_timeout));
+      if (is_range_miss_fill(c->producer)) {
+        // Only the range transform was for the user agent,
+        //  the server goes on writing to the cache
+        tunnel.chain_abort_transform(c->producer);
+      } else {
+        ink_assert(server_entry->vc == c->producer->vc);
+        ink_assert(server_session == c->producer->vc);
+      }
+      start_background_fill();
     } else {
       // No bakground fill
       p = c->producer;
@@ -3133,6 +3179,11 @@ HttpSM::tunnel_handler_ua(int event, HttpTunnelConsumer * c)
   case VC_EVENT_WRITE_COMPLETE:
     c->write_success = true;
     t_state.client_info.abort = HttpTransact::DIDNOT_ABORT;
+    // The range is sent but the rest of the object is still
+    //  on its way to the cache
+    if (is_range_miss_fill(c->producer)) {
+      start_background_fill();
+    }
     if (t_state.client_info.keep_alive == HTTP_KEEPALIVE || t_state.client_info.keep_alive == HTTP_PIPELINE) {
       if (t_state.www_auth_content != HttpTransact::CACHE_AUTH_SERVE || ua_session->get_bound_ss()) {
         // successful keep-alive
@@ -4155,7 +4206,7 @@ HttpSM::setup_range_elimination(HTTPHdr* outgoing_request)
       t_state.method == HTTP_WKSIDX_GET &&
       t_state.cache_info.action != HttpTransact::CACHE_DO_NO_ACTION &&
       outgoing_request->presence(MIME_PRESENCE_RANGE) &&
-      t_state.txn_conf->range_elimination_enabled &&
+      (t_state.txn_conf->range_elimination_enabled || t_state.txn_conf->cache_range_miss_fill) &&
       t_state.hdr_info.client_request.version_get() == HTTPVersion(1, 1) &&
       api_hooks.get(TS_HTTP_SEND_REQUEST_HDR_HOOK) == NULL &&
       api_hooks.get(TS_HTTP_READ_RESPONSE_HDR_HOOK) == NULL &&
@@ -6151,6 +6202,9 @@ HttpSM::setup_server_transfer()
      }
    */
   tunnel.set_producer_chunking_action(p, client_response_hdr_bytes, action);
+
+  if (t_state.http_config_param->splice_tunnel && server_session && ua_session)
+    tunnel.set_producer_splice(p, server_session->get_netvc(), ua_session->get_netvc());
 }
 
 void
@@ -6412,6 +6466,55 @@ HttpSM::kill_this()
   }
 }
 
+void
+HttpSM::update_traffic_stats(ink_hrtime total_time)
+{
+  HttpTrafficStats::Sample sample;
+  EThread *ethread = this_ethread();
+
+  sample.bytes_in = server_response_hdr_bytes + server_response_body_bytes;
+  sample.bytes_out = client_response_hdr_bytes + client_response_body_bytes;
+  sample.total_time = total_time;
+  sample.status = t_state.hdr_info.client_response.valid() ? t_state.hdr_info.client_response.status_get() : 0;
+  sample.abort = (t_state.client_info.abort == HttpTransact::ABORTED);
+
+  switch (t_state.squid_codes.log_code) {
+  case SQUID_LOG_TCP_HIT:
+  case SQUID_LOG_TCP_MEM_HIT:
+  case SQUID_LOG_TCP_REFRESH_HIT:
+  case SQUID_LOG_TCP_IMS_HIT:
+  case SQUID_LOG_TCP_REF_FAIL_HIT:
+    sample.hit = true;
+    sample.miss = false;
+    break;
+  case SQUID_LOG_TCP_MISS:
+  case SQUID_LOG_TCP_REFRESH_MISS:
+  case SQUID_LOG_TCP_CLIENT_REFRESH:
+  case SQUID_LOG_TCP_IMS_MISS:
+    sample.hit = false;
+    sample.miss = true;
+    break;
+  default:
+    sample.hit = false;
+    sample.miss = false;
+    break;
+  }
+  sample.connect_error = (t_state.squid_codes.log_code == SQUID_LOG_ERR_CONNECT_FAIL);
+
+  url_mapping *map = t_state.url_map.getMapping();
+  if (map != NULL && http_remap_traffic_stats.enabled()) {
+    http_remap_traffic_stats.record(ethread, map->traffic_stats_slot, sample);
+  }
+
+  // only transactions that went to an origin count for it
+  if (milestones.server_connect != 0 && t_state.server_info.name != NULL && http_origin_traffic_stats.enabled()) {
+    const char *host = t_state.server_info.name;
+    int slot = http_origin_traffic_stats.lookup(ethread, host, strlen(host));
+
+    http_origin_traffic_stats.record(ethread, slot, sample);
+  }
+}
+
 void
 HttpSM::update_stats()
 {
@@ -6500,6 +6603,25 @@ HttpSM::update_stats()
     cache_lookup_time = -1;
   }
 
+  // Latency histograms of the milestone intervals, for the tail latencies
+  if (milestones.dns_lookup_end != 0 && milestones.dns_lookup_begin != 0) {
+    HTTP_HISTOGRAM_DYN_STAT(http_dns_lookup_histogram, milestones.dns_lookup_end - milestones.dns_lookup_begin);
+  }
+  if (milestones.server_connect_end != 0 && milestones.server_connect != 0) {
+    HTTP_HISTOGRAM_DYN_STAT(http_origin_connect_histogram, milestones.server_connect_end - milestones.server_connect);
+  }
+  if (milestones.ua_begin_write != 0 && milestones.ua_begin != 0) {
+    HTTP_HISTOGRAM_DYN_STAT(http_first_byte_histogram, milestones.ua_begin_write - milestones.ua_begin);
+  }
+  if (cache_lookup_time >= 0) {
+    HTTP_HISTOGRAM_DYN_STAT(http_cache_open_read_histogram, cache_lookup_time);
+  }
+  HTTP_HISTOGRAM_DYN_STAT(http_total_histogram, total_time);
+
+  if (http_remap_traffic_stats.enabled() || http_origin_traffic_stats.enabled()) {
+    update_traffic_stats(total_time);
+  }
+
   HttpTransact::update_size_and_time_stats(&t_state,
                                            total_time,
                                            ua_write_time,
@@ -6959,6 +7081,11 @@ HttpSM::set_next_state()
       release_server_session(true);
       t_state.source = HttpTransact::SOURCE_CACHE;
 
+      // We're serving a stale copy, have it revalidated behind our back
+      if (t_state.stale_while_revalidate) {
+        HttpUpdateSM::start_background_revalidation(&t_state);
+      }
+
       if (transform_info.vc) {
         ink_assert(t_state.hdr_info.client_response.valid() == 0);
         ink_assert((t_state.hdr_info.transform_response.valid()? true : false) == true);
@@ -7449,7 +7576,9 @@ HttpSM::set_server_session_private(bool private_session)
 bool
 HttpSM::is_private()
 {
-   HttpServerSession * ss = server_session ? server_session : ua_session->get_server_session();
+   HttpServerSession * ss = server_session;
+   if (ss == NULL && ua_session)
+     ss = ua_session->get_server_session();
    return ss ? ss->private_session : false;
 }
 
@@ -472,6 +472,8 @@ protected:
 
   bool is_http_server_eos_truncation(HttpTunnelProducer *);
   bool is_bg_fill_necessary(HttpTunnelConsumer * c);
+  bool is_range_miss_fill(HttpTunnelProducer * p);
+  void start_background_fill();
   int find_server_buffer_size();
   int find_http_resp_buffer_size(int64_t cl);
   int64_t server_transfer_init(MIOBuffer * buf, int hdr_size);
@@ -521,6 +523,7 @@ protected:
   virtual int kill_this_async_hook(int event, void *data);
   void kill_this();
   void update_stats();
+  void update_traffic_stats(ink_hrtime total_time);
   void transform_cleanup(TSHttpHookID hook, HttpTransformInfo * info);
 
 public:
@@ -147,6 +147,9 @@ HttpServerSession::do_io_close(int alerrno)
   if (to_parent_proxy) {
     HTTP_DECREMENT_DYN_STAT(http_current_parent_proxy_connections_stat);
   }
+  if (prewarmed) {
+    HTTP_INCREMENT_DYN_STAT(http_server_session_prewarm_expired_stat);
+  }
   destroy();
 }
 
@@ -51,6 +51,7 @@
 class HttpSM;
 class MIOBuffer;
 class IOBufferReader;
+struct SessionOrigin;
 
 enum HSS_State {
   HSS_INIT,
@@ -72,8 +73,8 @@ public:
       hostname_hash(),
       host_hash_computed(false), con_id(0), transact_count(0),
       state(HSS_INIT), to_parent_proxy(false), server_trans_stat(0),
-      private_session(false), share_session(0),
-      enable_origin_connection_limiting(false), read_buffer(NULL),
+      private_session(false), share_session(0), prewarmed(false),
+      idle_origin(NULL), enable_origin_connection_limiting(false), read_buffer(NULL),
       server_vc(NULL), magic(HTTP_SS_MAGIC_DEAD), buf_reader(NULL)
     {
       hostname = NULL;
@@ -158,8 +159,15 @@ public:
   // Copy of the owning SM's share_server_session setting
   int share_session;
 
+  // Opened ahead of demand by the session manager and not used yet
+  bool prewarmed;
+
   LINK(HttpServerSession, lru_link);
   LINK(HttpServerSession, hash_link);
+  LINK(HttpServerSession, origin_link);
+
+  // The origin's idle sessions in the pool bucket, while we are one of them
+  SessionOrigin *idle_origin;
 
   // Keep track of connection limiting and a pointer to the
   bool enable_origin_connection_limiting;
@@ -37,19 +37,31 @@
 #include "HttpDebugNames.h"
 
 #include "HCSM.h"
+#include "Tokenizer.h"
+#include "ts/TestBox.h"
 
 #define FIRST_LEVEL_HASH(x)   ats_ip_hash(x) % HSM_LEVEL1_BUCKETS
 #define SECOND_LEVEL_HASH(x)  ats_ip_hash(x) % HSM_LEVEL2_BUCKETS
 
+// The session manager is not a continuation, count against the calling thread
+#define HSM_INCREMENT_DYN_STAT(x) RecIncrRawStat(http_rsb, this_ethread(), (int) x, 1)
+
+// Round robin members of a prewarm origin we keep sessions open to
+#define HSM_PREWARM_MAX_ADDRS 8
+
 // Initialize a thread to handle HTTP session management
 void
 initialize_thread_for_http_sessions(EThread *thread, int thread_index)
 {
   NOWARN_UNUSED(thread_index);
+  vint32 *pool_idle = (vint32 *)ats_malloc(sizeof(vint32));
 
+  *pool_idle = 0;
   thread->l1_hash = NEW(new SessionBucket[HSM_LEVEL1_BUCKETS]);
-  for (int i = 0; i < HSM_LEVEL1_BUCKETS; ++i)
+  for (int i = 0; i < HSM_LEVEL1_BUCKETS; ++i) {
     thread->l1_hash[i].mutex = new_ProxyMutex();
+    thread->l1_hash[i].pool_idle = pool_idle;
+  }
   //thread->l1_hash[i].mutex = thread->mutex;
 }
 
@@ -57,11 +69,106 @@ initialize_thread_for_http_sessions(EThread *thread, int thread_index)
 HttpSessionManager httpSessionManager;
 
 SessionBucket::SessionBucket()
-  : Continuation(NULL)
+  : Continuation(NULL), idle_count(0), pool_idle(NULL)
 {
   SET_HANDLER(&SessionBucket::session_handler);
 }
 
+SessionOrigin *
+SessionBucket::find_origin(sockaddr const* ip, INK_MD5 &hostname_hash)
+{
+  for (SessionOrigin *o = origin_hash[SECOND_LEVEL_HASH(ip)].head; o != NULL; o = o->link.next) {
+    if (ats_ip_addr_eq(&o->ip.sa, ip) &&
+        ats_ip_port_cast(&o->ip) == ats_ip_port_cast(ip) &&
+        hostname_hash == o->hostname_hash)
+      return o;
+  }
+
+  return NULL;
+}
+
+void
+SessionBucket::add_session(HttpServerSession *s)
+{
+  int l2_index = SECOND_LEVEL_HASH(&s->server_ip.sa);
+  SessionOrigin *o = find_origin(&s->server_ip.sa, s->hostname_hash);
+
+  ink_assert(l2_index < HSM_LEVEL2_BUCKETS);
+  lru_list.enqueue(s);
+  l2_hash[l2_index].push(s);
+  ++idle_count;
+  if (pool_idle)
+    ink_atomic_increment(pool_idle, 1);
+
+  if (o == NULL) {
+    o = NEW(new SessionOrigin);
+    ats_ip_copy(&o->ip, &s->server_ip);
+    o->hostname_hash = s->hostname_hash;
+    o->count = 0;
+    origin_hash[l2_index].push(o);
+  }
+  o->sessions.enqueue(s);
+  ++o->count;
+  s->idle_origin = o;
+}
+
+void
+SessionBucket::remove_session(HttpServerSession *s)
+{
+  SessionOrigin *o = s->idle_origin;
+
+  lru_list.remove(s);
+  l2_hash[SECOND_LEVEL_HASH(&s->server_ip.sa)].remove(s);
+  --idle_count;
+  if (pool_idle)
+    ink_atomic_increment(pool_idle, -1);
+
+  ink_assert(o != NULL);
+  o->sessions.remove(s);
+  s->idle_origin = NULL;
+  if (--o->count == 0) {
+    origin_hash[SECOND_LEVEL_HASH(&o->ip.sa)].remove(o);
+    delete o;
+  }
+}
+
+// int SessionBucket::origin_idle_count(...)
+//
+//   The number of idle sessions to an origin, ip + port + hostname,
+//    and the one that has been idle the longest
+//
+int
+SessionBucket::origin_idle_count(sockaddr const* ip, INK_MD5 &hostname_hash, HttpServerSession **oldest)
+{
+  SessionOrigin *o = find_origin(ip, hostname_hash);
+
+  if (oldest)
+    *oldest = o ? o->sessions.head : NULL;
+  return o ? o->count : 0;
+}
+
+// int SessionBucket::largest_origin(HttpServerSession** oldest)
+//
+//   Finds the origin with the most idle sessions in this bucket
+//
+int
+SessionBucket::largest_origin(HttpServerSession **oldest)
+{
+  int largest = 0;
+
+  for (int i = 0; i < HSM_LEVEL2_BUCKETS; ++i) {
+    for (SessionOrigin *o = origin_hash[i].head; o != NULL; o = o->link.next) {
+      if (o->count > largest) {
+        largest = o->count;
+        if (oldest)
+          *oldest = o->sessions.head;
+      }
+    }
+  }
+
+  return largest;
+}
+
 // int SessionBucket::session_handler(int event, void* data)
 //
 //   Called from the NetProcessor to left us know that a
@@ -126,8 +233,7 @@ SessionBucket::session_handler(int event, void *data)
       Debug("http_ss", "[%" PRId64 "] [session_bucket] session received io notice [%s]",
             s->con_id, HttpDebugNames::get_event_name(event));
       ink_assert(s->state == HSS_KA_SHARED);
-      lru_list.remove(s);
-      l2_hash[l2_index].remove(s);
+      remove_session(s);
       s->do_io_close();
       found = true;
       break;
@@ -176,9 +282,9 @@ HttpSessionManager::acquire_session_hc(sockaddr const* ip, const char *hostname,
   HttpServerSession *b = bucket->l2_hash[l2_index].head;
   while (b != NULL) {
     if (memcmp(&b->server_ip.sa, ip, sizeof(sockaddr)) && hostname_hash == b->hostname_hash) {
-      bucket->lru_list.remove(b);
-      bucket->l2_hash[l2_index].remove(b);
+      bucket->remove_session(b);
       b->state = HSS_ACTIVE;
+      b->prewarmed = false;
       Debug("http_ss", "[%" PRId64 "] [acquire session] " "return session from shared pool", b->con_id);
       return b;
     }
@@ -194,6 +300,7 @@ HttpSessionManager::init()
   // Initialize our internal (global) hash table
   for (int i = 0; i < HSM_LEVEL1_BUCKETS; i++) {
     g_l1_hash[i].mutex = new_ProxyMutex();
+    g_l1_hash[i].pool_idle = &g_idle_count;
   }
 }
 
@@ -209,9 +316,7 @@ HttpSessionManager::purge_keepalives()
     if (lock) {
       while (b->lru_list.head) {
         HttpServerSession *sess = b->lru_list.head;
-        b->lru_list.remove(sess);
-        int l2_index = SECOND_LEVEL_HASH(&sess->server_ip.sa);
-        b->l2_hash[l2_index].remove(sess);
+        b->remove_session(sess);
         sess->do_io_close();
       }
     } else {
@@ -237,11 +342,12 @@ _acquire_session(SessionBucket *bucket, sockaddr const* ip, INK_MD5 &hostname_ha
       ats_ip_port_cast(ip) == ats_ip_port_cast(&b->server_ip)
     ) {
       if (hostname_hash == b->hostname_hash) {
-        bucket->lru_list.remove(b);
-        bucket->l2_hash[l2_index].remove(b);
+        bucket->remove_session(b);
         b->state = HSS_ACTIVE;
+        b->prewarmed = false;
         to_return = b;
         Debug("http_ss", "[%" PRId64 "] [acquire session] " "return session from shared pool", to_return->con_id);
+        HSM_INCREMENT_DYN_STAT(http_server_session_pool_hit_stat);
         sm->attach_server_session(to_return);
         return HSM_DONE;
       }
@@ -250,6 +356,7 @@ _acquire_session(SessionBucket *bucket, sockaddr const* ip, INK_MD5 &hostname_ha
     b = b->hash_link.next;
   }
 
+  HSM_INCREMENT_DYN_STAT(http_server_session_pool_miss_stat);
   return HSM_NOT_FOUND;
 }
 
@@ -329,30 +436,130 @@ HttpSessionManager::acquire_session(Continuation *cont, sockaddr const* ip,
   return HSM_RETRY;
 }
 
+// Total number of idle sessions in a pool
+static int
+pool_idle_count(SessionBucket *pool)
+{
+  return pool[0].pool_idle ? *pool[0].pool_idle : 0;
+}
+
+int
+HttpSessionManager::origin_max_idle(HttpServerSession *s, HttpConfigParams *params)
+{
+  for (int i = 0; i < n_prewarm_origins; ++i) {
+    PrewarmOrigin *o = prewarm_origins + i;
+
+    if (o->max_idle > 0 && htons(o->port) == ats_ip_port_cast(&s->server_ip) && o->hostname_hash == s->hostname_hash)
+      return o->max_idle;
+  }
+
+  return params->server_session_pool_max_idle_per_origin;
+}
+
+// HttpServerSession* HttpSessionManager::take_fair_victim(...)
+//
+//   The pool is full.  Take the longest idle session of the origin
+//    holding the most idle sessions out of its bucket, so a busy origin
+//    gives way before a quiet one loses its last warm session.  Buckets
+//    we can not lock right away are passed over; if nothing else can go,
+//    the oldest session of the bucket we are releasing into is taken.
+//
+HttpServerSession *
+HttpSessionManager::take_fair_victim(SessionBucket *pool, SessionBucket *bucket, EThread *ethread)
+{
+  SessionBucket *victim_bucket = NULL;
+  int largest = 0;
+
+  for (int i = 0; i < HSM_LEVEL1_BUCKETS; ++i) {
+    SessionBucket *b = pool + i;
+    MUTEX_TRY_LOCK(lock, b->mutex, ethread);
+
+    // A bucket can't hold an origin with more sessions than it has
+    if (lock && b->idle_count > largest) {
+      int count = b->largest_origin(NULL);
+
+      if (count > largest) {
+        largest = count;
+        victim_bucket = b;
+      }
+    }
+  }
+
+  if (victim_bucket) {
+    MUTEX_TRY_LOCK(lock, victim_bucket->mutex, ethread);
+    HttpServerSession *victim = NULL;
+
+    if (lock && victim_bucket->largest_origin(&victim) > 0) {
+      victim_bucket->remove_session(victim);
+      return victim;
+    }
+  }
+
+  HttpServerSession *victim = bucket->lru_list.head;
+
+  if (victim)
+    bucket->remove_session(victim);
+  return victim;
+}
+
+// HttpServerSession* HttpSessionManager::make_room(...)
+//
+//   Called with the bucket lock held, before s goes into the bucket.
+//    If s's origin is at max_idle, its own oldest idle session is taken
+//    out; if the pool is at pool_max_idle, the fair victim is.  Returns
+//    the session taken out of the pool, for the caller to close, or NULL
+//    if there is room.  A limit of 0 is no limit.
+//
+HttpServerSession *
+HttpSessionManager::make_room(SessionBucket *pool, SessionBucket *bucket, HttpServerSession *s,
+                              int max_idle, int pool_max_idle, EThread *ethread)
+{
+  HttpServerSession *oldest = NULL;
+
+  if (max_idle > 0 && bucket->origin_idle_count(&s->server_ip.sa, s->hostname_hash, &oldest) >= max_idle) {
+    bucket->remove_session(oldest);
+    return oldest;
+  }
+  if (pool_max_idle > 0 && pool_idle_count(pool) >= pool_max_idle)
+    return take_fair_victim(pool, bucket, ethread);
+
+  return NULL;
+}
+
 HSMresult_t
 HttpSessionManager::release_session(HttpServerSession *to_release)
 {
   EThread *ethread = this_ethread();
   int l1_index = FIRST_LEVEL_HASH(&to_release->server_ip.sa);
+  SessionBucket *pool;
   SessionBucket *bucket;
 
   ink_assert(l1_index < HSM_LEVEL1_BUCKETS);
 
   if (2 == to_release->share_session) {
-    bucket = ethread->l1_hash + l1_index;
+    pool = ethread->l1_hash;
   } else {
-    bucket = g_l1_hash + l1_index;
+    pool = g_l1_hash;
   }
+  bucket = pool + l1_index;
 
   MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
   if (lock) {
-    int l2_index = SECOND_LEVEL_HASH(&to_release->server_ip.sa);
+    HttpConfigParams *params = HttpConfig::acquire();
+    // Make room if the origin, or the pool as a whole, is at its idle limit
+    HttpServerSession *victim = make_room(pool, bucket, to_release, origin_max_idle(to_release, params),
+                                          params->server_session_pool_max_idle, ethread);
 
-    ink_assert(l2_index < HSM_LEVEL2_BUCKETS);
+    HttpConfig::release(params);
+    if (victim) {
+      Debug("http_ss", "[%" PRId64 "] [release session] evicting idle session to %.*s",
+            victim->con_id, victim->host_len, victim->hostname);
+      HSM_INCREMENT_DYN_STAT(http_server_session_pool_evicted_stat);
+      victim->do_io_close();
+    }
 
     // First insert the session on to our lists
-    bucket->lru_list.enqueue(to_release);
-    bucket->l2_hash[l2_index].push(to_release);
+    bucket->add_session(to_release);
     to_release->state = HSS_KA_SHARED;
 
     // Now we need to issue a read on the connection to detect
@@ -376,3 +583,640 @@ HttpSessionManager::release_session(HttpServerSession *to_release)
 
   return HSM_RETRY;
 }
+
+// int parse_prewarm_origins(const char* spec, PrewarmOrigin** origins)
+//
+//   Parses proxy.config.http.server_session_prewarm.origins, a space
+//    separated list of [http://|https://]host[:port][,min=N][,max=M].
+//    min defaults to 1 and max to the pool's max_idle_per_origin.
+//    Entries that don't parse are skipped with a warning.  Returns
+//    the number of origins placed in *origins.
+//
+int
+parse_prewarm_origins(const char *spec, PrewarmOrigin **origins)
+{
+  Tokenizer tok(" \t");
+  int n = spec ? tok.Initialize(spec) : 0;
+  int count = 0;
+
+  *origins = NULL;
+  if (n <= 0)
+    return 0;
+
+  *origins = (PrewarmOrigin *)ats_malloc(n * sizeof(PrewarmOrigin));
+  for (int i = 0; i < n; ++i) {
+    const char *entry = tok[i];
+    PrewarmOrigin *o = *origins + count;
+
+    o->https = false;
+    if (strncasecmp(entry, "https://", 8) == 0) {
+      o->https = true;
+      entry += 8;
+    } else if (strncasecmp(entry, "http://", 7) == 0) {
+      entry += 7;
+    }
+
+    const char *opts = strchr(entry, ',');
+    const char *host_end = opts ? opts : entry + strlen(entry);
+    const char *colon = (const char *) memchr(entry, ':', host_end - entry);
+
+    o->port = o->https ? 443 : 80;
+    if (colon) {
+      char *port_end;
+
+      o->port = strtol(colon + 1, &port_end, 10);
+      if (port_end != host_end || o->port <= 0 || o->port > 65535) {
+        Warning("invalid port in server session prewarm origin '%s', skipping", tok[i]);
+        continue;
+      }
+      host_end = colon;
+    }
+
+    o->host_len = host_end - entry;
+    if (o->host_len <= 0) {
+      Warning("missing host in server session prewarm origin '%s', skipping", tok[i]);
+      continue;
+    }
+
+    bool valid = true;
+
+    o->min_idle = 1;
+    o->max_idle = 0;
+    for (; opts && valid; opts = strchr(opts + 1, ',')) {
+      if (strncasecmp(opts + 1, "min=", 4) == 0)
+        o->min_idle = atoi(opts + 5);
+      else if (strncasecmp(opts + 1, "max=", 4) == 0)
+        o->max_idle = atoi(opts + 5);
+      else
+        valid = false;
+    }
+    if (!valid || o->min_idle < 0 || o->max_idle < 0) {
+      Warning("invalid option in server session prewarm origin '%s', skipping", tok[i]);
+      continue;
+    }
+    if (o->max_idle > 0 && o->min_idle > o->max_idle) {
+      Warning("server session prewarm origin '%s' has min > max, setting min=max", tok[i]);
+      o->min_idle = o->max_idle;
+    }
+
+    o->host = ats_strndup(entry, o->host_len);
+    ink_code_MMH((unsigned char *) o->host, o->host_len, (unsigned char *) &o->hostname_hash);
+    ++count;
+  }
+
+  return count;
+}
+
+// int prewarm_connects_needed(...)
+//
+//   The sessions to open to one of the n_addrs addresses of a prewarm
+//    origin: its share of the origin's minimum, capped at max_idle, less
+//    what is idle there already or being opened, within the room left
+//    in the pool and under the origin's connection limit.
+//
+int
+prewarm_connects_needed(int min_idle, int max_idle, int n_addrs, int idle, int pending, int room)
+{
+  if (n_addrs <= 0)
+    return 0;
+  // Never open more than release_session() would keep
+  if (max_idle > 0 && min_idle > max_idle)
+    min_idle = max_idle;
+
+  int needed = (min_idle + n_addrs - 1) / n_addrs - idle - pending;
+
+  if (needed > room)
+    needed = room;
+  return needed > 0 ? needed : 0;
+}
+
+class SessionPrewarm;
+
+// One outstanding connect to a prewarm origin
+class PrewarmConnect: public Continuation
+{
+public:
+  PrewarmConnect(SessionPrewarm *p, ProxyMutex *amutex, int o, int s)
+    : Continuation(amutex), prewarm(p), origin(o), slot(s)
+  {
+    SET_HANDLER(&PrewarmConnect::connect_handler);
+  }
+
+  int connect_handler(int event, void *data);
+
+private:
+  SessionPrewarm *prewarm;
+  int origin;
+  int slot;
+};
+
+// class SessionPrewarm
+//
+//   One per ET_NET thread.  Every interval it resolves the prewarm
+//    origins and opens sessions to them until the connection pool
+//    holds each origin's minimum number of idle sessions.  With a
+//    single global pool (share_server_sessions 1) only the first
+//    thread's instance does the work.
+//
+class SessionPrewarm: public Continuation
+{
+public:
+  SessionPrewarm(int thread_index);
+  int main_handler(int event, void *data);
+  void connect_done(int origin, int slot, NetVConnection *vc);
+
+private:
+  struct OriginState
+  {
+    IpEndpoint addrs[HSM_PREWARM_MAX_ADDRS];
+    int n_addrs;
+    int pending[HSM_PREWARM_MAX_ADDRS];
+  };
+
+  void lookup_next();
+  void resolved(int origin, HostDBInfo *r);
+  void top_up(int origin);
+  void set_addr(OriginState *st, int slot, sockaddr const* ip, int port);
+  void connect(int origin, int slot, HttpConfigParams *params);
+
+  OriginState *state;
+  int thread_index;
+  int share;
+  int current;
+  bool lookup_sync;
+  Action *pending_action;
+};
+
+SessionPrewarm::SessionPrewarm(int index)
+  : Continuation(new_ProxyMutex()), thread_index(index), share(0), current(0), lookup_sync(false),
+    pending_action(NULL)
+{
+  state = (OriginState *)ats_malloc(httpSessionManager.n_prewarm_origins * sizeof(OriginState));
+  memset(state, 0, httpSessionManager.n_prewarm_origins * sizeof(OriginState));
+  SET_HANDLER(&SessionPrewarm::main_handler);
+}
+
+int
+SessionPrewarm::main_handler(int event, void *data)
+{
+  switch (event) {
+  case EVENT_INTERVAL:
+    if (pending_action == NULL) {
+      HttpConfigParams *params = HttpConfig::acquire();
+
+      share = params->oride.share_server_sessions;
+      HttpConfig::release(params);
+      if (2 == share || (1 == share && 0 == thread_index)) {
+        current = 0;
+        lookup_next();
+      }
+    }
+    break;
+
+  case EVENT_HOST_DB_LOOKUP:
+    pending_action = NULL;
+    resolved(current, (HostDBInfo *) data);
+    ++current;
+    // A lookup answered from the cache returns to the loop in lookup_next()
+    if (!lookup_sync)
+      lookup_next();
+    break;
+
+  default:
+    ink_assert(!"unexpected event");
+    break;
+  }
+
+  return EVENT_CONT;
+}
+
+void
+SessionPrewarm::lookup_next()
+{
+  while (current < httpSessionManager.n_prewarm_origins) {
+    PrewarmOrigin *o = httpSessionManager.prewarm_origins + current;
+    IpEndpoint ip;
+
+    // Addresses need no lookup, just as with an HttpSM
+    if (0 == ats_ip_pton(o->host, &ip.sa)) {
+      set_addr(state + current, 0, &ip.sa, o->port);
+      state[current].n_addrs = 1;
+      top_up(current);
+      ++current;
+      continue;
+    }
+
+    lookup_sync = true;
+    Action *action = hostDBProcessor.getbyname_re(this, o->host, o->host_len, o->port);
+    lookup_sync = false;
+
+    if (action != ACTION_RESULT_DONE) {
+      pending_action = action;
+      return;
+    }
+  }
+}
+
+void
+SessionPrewarm::set_addr(OriginState *st, int slot, sockaddr const* ip, int port)
+{
+  // Connects in flight only count towards the address they went to
+  if (!ats_ip_addr_eq(&st->addrs[slot].sa, ip))
+    st->pending[slot] = 0;
+  ats_ip_copy(&st->addrs[slot], ip);
+  ats_ip_port_cast(&st->addrs[slot]) = htons(port);
+}
+
+void
+SessionPrewarm::resolved(int origin, HostDBInfo *r)
+{
+  PrewarmOrigin *o = httpSessionManager.prewarm_origins + origin;
+  OriginState *st = state + origin;
+
+  if (r == NULL || r->failed()) {
+    Debug("http_ss", "[prewarm] could not resolve %.*s", o->host_len, o->host);
+    return;
+  }
+
+  // Spread the minimum over the round robin members, a transaction may
+  //  go to any of them
+  HostDBRoundRobin *rr = r->round_robin ? r->rr() : NULL;
+  int n = 0;
+
+  if (rr) {
+    for (int i = 0; i < rr->good && n < HSM_PREWARM_MAX_ADDRS; ++i)
+      set_addr(st, n++, rr->info[i].ip(), o->port);
+  } else {
+    set_addr(st, n++, r->ip(), o->port);
+  }
+  st->n_addrs = n;
+  top_up(origin);
+}
+
+void
+SessionPrewarm::top_up(int origin)
+{
+  PrewarmOrigin *o = httpSessionManager.prewarm_origins + origin;
+  OriginState *st = state + origin;
+  int n = st->n_addrs;
+  SessionBucket *pool = (2 == share) ? this_ethread()->l1_hash : httpSessionManager.g_l1_hash;
+  HttpConfigParams *params = HttpConfig::acquire();
+  // Never open more than release_session() would keep
+  int max_idle = o->max_idle > 0 ? o->max_idle : params->server_session_pool_max_idle_per_origin;
+
+  for (int slot = 0; slot < n; ++slot) {
+    SessionBucket *bucket = pool + FIRST_LEVEL_HASH(&st->addrs[slot].sa);
+    int idle, room = INT_MAX;
+
+    {
+      MUTEX_TRY_LOCK(lock, bucket->mutex, this_ethread());
+      // Try again next interval
+      if (!lock)
+        continue;
+      idle = bucket->origin_idle_count(&st->addrs[slot].sa, o->hostname_hash, NULL);
+    }
+
+    // A full pool would only evict another origin's session to make room
+    if (params->server_session_pool_max_idle > 0)
+      room = params->server_session_pool_max_idle - pool_idle_count(pool);
+    if (params->oride.origin_max_connections > 0)
+      room = min(room, (int) (params->oride.origin_max_connections -
+                              ConnectionCount::getInstance()->getCount(o->host, o->host_len)));
+
+    for (int missing = prewarm_connects_needed(o->min_idle, max_idle, n, idle, st->pending[slot], room);
+         missing > 0; --missing)
+      connect(origin, slot, params);
+  }
+
+  HttpConfig::release(params);
+}
+
+void
+SessionPrewarm::connect(int origin, int slot, HttpConfigParams *params)
+{
+  PrewarmOrigin *o = httpSessionManager.prewarm_origins + origin;
+  OriginState *st = state + origin;
+  NetVCOptions opt;
+
+  opt.f_blocking_connect = false;
+  opt.set_sock_param(params->oride.sock_recv_buffer_size_out,
+                     params->oride.sock_send_buffer_size_out,
+                     params->oride.sock_option_flag_out,
+                     params->oride.sock_packet_mark_out,
+                     params->oride.sock_packet_tos_out);
+  opt.ip_family = st->addrs[slot].sa.sa_family;
+
+  IpAddr& outbound_ip = AF_INET6 == opt.ip_family ? params->outbound_ip6 : params->outbound_ip4;
+  if (outbound_ip.isValid()) {
+    opt.addr_binding = NetVCOptions::INTF_ADDR;
+    opt.local_ip = outbound_ip;
+  }
+
+  // The connect may call back before returning
+  ++st->pending[slot];
+  PrewarmConnect *c = NEW(new PrewarmConnect(this, mutex, origin, slot));
+
+  if (o->https)
+    sslNetProcessor.connect_re(c, &st->addrs[slot].sa, &opt);
+  else
+    netProcessor.connect_re(c, &st->addrs[slot].sa, &opt);
+}
+
+int
+PrewarmConnect::connect_handler(int event, void *data)
+{
+  prewarm->connect_done(origin, slot, event == NET_EVENT_OPEN ? (NetVConnection *) data : NULL);
+  delete this;
+  return EVENT_DONE;
+}
+
+void
+SessionPrewarm::connect_done(int origin, int slot, NetVConnection *vc)
+{
+  PrewarmOrigin *o = httpSessionManager.prewarm_origins + origin;
+  OriginState *st = state + origin;
+
+  if (st->pending[slot] > 0)
+    --st->pending[slot];
+
+  if (vc == NULL) {
+    Debug("http_ss", "[prewarm] connect to %.*s:%d failed", o->host_len, o->host, o->port);
+    return;
+  }
+
+  if (0 == share) {
+    vc->do_io_close();
+    return;
+  }
+
+  // Build the session the way HttpSM does for a new origin connection,
+  //  then hand it to the pool.  It gets no inactivity timeout of its own,
+  //  the origin decides how long it stays open.
+  HttpConfigParams *params = HttpConfig::acquire();
+  HttpServerSession *session = (2 == share) ?
+    THREAD_ALLOC_INIT(httpServerSessionAllocator, mutex->thread_holding) :
+    httpServerSessionAllocator.alloc();
+
+  session->share_session = share;
+  if (params->oride.origin_max_connections > 0 || params->origin_min_keep_alive_connections > 0)
+    session->enable_origin_connection_limiting = true;
+  HttpConfig::release(params);
+
+  ats_ip_copy(&session->server_ip, &st->addrs[slot]);
+  session->set_hostname(o->host);
+  session->new_connection(vc);
+  session->attach_hostname(o->host);
+  session->prewarmed = true;
+  HTTP_INCREMENT_DYN_STAT(http_server_session_prewarm_opened_stat);
+  Debug("http_ss", "[%" PRId64 "] [prewarm] session opened to %.*s:%d", session->con_id, o->host_len, o->host, o->port);
+
+  session->release();
+}
+
+void
+HttpSessionManager::start_prewarm()
+{
+  char *spec = NULL;
+  int interval = 5;
+  PrewarmOrigin *origins = NULL;
+
+  REC_ReadConfigStringAlloc(spec, "proxy.config.http.server_session_prewarm.origins");
+  REC_ReadConfigInteger(interval, "proxy.config.http.server_session_prewarm.interval");
+
+  int n = parse_prewarm_origins(spec, &origins);
+
+  ats_free(spec);
+  if (n == 0)
+    return;
+
+  prewarm_origins = origins;
+  n_prewarm_origins = n;
+  if (interval < 1)
+    interval = 1;
+
+  for (int i = 0; i < eventProcessor.n_threads_for_type[ET_NET]; ++i) {
+    eventProcessor.eventthread[ET_NET][i]->schedule_every(NEW(new SessionPrewarm(i)), HRTIME_SECONDS(interval));
+  }
+  Debug("http_ss", "[prewarm] keeping idle sessions open to %d origins", n);
+}
+
+#if TS_HAS_TESTS
+
+REGRESSION_TEST(HttpSessionManager_PrewarmOrigins)(RegressionTest * t, int atype, int * pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  PrewarmOrigin *origins;
+
+  box = REGRESSION_TEST_PASSED;
+
+  int n = parse_prewarm_origins("a.example.com https://b.example.com:8443,min=4,max=8  http://c.example.com,max=2,min=3"
+                                " :80 d.example.com:0 e.example.com,foo=1", &origins);
+
+  if (box.check(n == 3, "expected 3 origins, parsed %d", n)) {
+    box.check(origins[0].host_len == 13 && 0 == strcmp(origins[0].host, "a.example.com"), "wrong host '%s'", origins[0].host);
+    box.check(!origins[0].https && origins[0].port == 80, "wrong scheme or port for a.example.com");
+    box.check(origins[0].min_idle == 1 && origins[0].max_idle == 0, "wrong defaults for a.example.com");
+
+    box.check(0 == strcmp(origins[1].host, "b.example.com"), "wrong host '%s'", origins[1].host);
+    box.check(origins[1].https && origins[1].port == 8443, "wrong scheme or port for b.example.com");
+    box.check(origins[1].min_idle == 4 && origins[1].max_idle == 8, "wrong limits for b.example.com");
+
+    box.check(origins[2].min_idle == 2 && origins[2].max_idle == 2, "min not clamped to max for c.example.com");
+
+    INK_MD5 hash;
+    ink_code_MMH((unsigned char *) "a.example.com", 13, (unsigned char *) &hash);
+    box.check(hash == origins[0].hostname_hash, "hostname hash does not match a session's");
+  }
+
+  for (int i = 0; i < n; ++i)
+    ats_free(origins[i].host);
+  ats_free(origins);
+
+  box.check(parse_prewarm_origins(NULL, &origins) == 0 && origins == NULL, "empty list parsed");
+}
+
+// An idle session that is never connected, for the pool tests
+static HttpServerSession *
+test_session(const char *ip, int port, const char *host)
+{
+  HttpServerSession *s = NEW(new HttpServerSession);
+
+  ats_ip_pton(ip, &s->server_ip.sa);
+  ats_ip_port_cast(&s->server_ip) = htons(port);
+  s->set_hostname(host);
+  s->attach_hostname(host);
+  return s;
+}
+
+static SessionBucket *
+test_pool(vint32 *pool_idle)
+{
+  SessionBucket *pool = NEW(new SessionBucket[HSM_LEVEL1_BUCKETS]);
+
+  *pool_idle = 0;
+  for (int i = 0; i < HSM_LEVEL1_BUCKETS; ++i) {
+    pool[i].mutex = new_ProxyMutex();
+    pool[i].pool_idle = pool_idle;
+  }
+  return pool;
+}
+
+static void
+test_pool_add(SessionBucket *pool, HttpServerSession *s)
+{
+  pool[FIRST_LEVEL_HASH(&s->server_ip.sa)].add_session(s);
+}
+
+static void
+test_pool_free(SessionBucket *pool)
+{
+  for (int i = 0; i < HSM_LEVEL1_BUCKETS; ++i) {
+    while (pool[i].lru_list.head) {
+      HttpServerSession *s = pool[i].lru_list.head;
+      pool[i].remove_session(s);
+      delete s;
+    }
+  }
+  delete[] pool;
+}
+
+REGRESSION_TEST(HttpSessionManager_OriginCap)(RegressionTest * t, int atype, int * pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  EThread *ethread = this_ethread();
+  vint32 pool_idle;
+  SessionBucket *pool = test_pool(&pool_idle);
+  HttpServerSession *a[4], *other;
+
+  box = REGRESSION_TEST_PASSED;
+
+  for (int i = 0; i < 3; ++i) {
+    a[i] = test_session("10.0.0.1", 80, "a.example.com");
+    test_pool_add(pool, a[i]);
+  }
+  // Same address, other host and other port: other origins
+  test_pool_add(pool, test_session("10.0.0.1", 80, "b.example.com"));
+  test_pool_add(pool, test_session("10.0.0.1", 8080, "a.example.com"));
+
+  SessionBucket *bucket = pool + FIRST_LEVEL_HASH(&a[0]->server_ip.sa);
+  HttpServerSession *oldest = NULL;
+
+  box.check(bucket->origin_idle_count(&a[0]->server_ip.sa, a[0]->hostname_hash, &oldest) == 3 && oldest == a[0],
+            "expected 3 idle sessions to a.example.com, a[0] the oldest");
+  box.check(pool_idle == 5, "expected 5 idle sessions in the pool, have %d", (int) pool_idle);
+
+  // At the cap, the origin's own oldest session goes
+  a[3] = test_session("10.0.0.1", 80, "a.example.com");
+  other = HttpSessionManager::make_room(pool, bucket, a[3], 3, 0, ethread);
+  box.check(other == a[0], "expected the oldest session of the origin to be evicted");
+  box.check(bucket->origin_idle_count(&a[0]->server_ip.sa, a[0]->hostname_hash, &oldest) == 2 && oldest == a[1],
+            "expected 2 idle sessions to a.example.com after the eviction, a[1] the oldest");
+  delete other;
+  bucket->add_session(a[3]);
+
+  // Under the cap, nothing goes
+  other = test_session("10.0.0.1", 80, "b.example.com");
+  box.check(HttpSessionManager::make_room(pool, bucket, other, 3, 0, ethread) == NULL, "evicted below the cap");
+  bucket->add_session(other);
+  box.check(pool_idle == 6, "expected 6 idle sessions in the pool, have %d", (int) pool_idle);
+
+  // An origin's count goes when its last session does
+  test_pool_free(pool);
+  box.check(pool_idle == 0, "expected an empty pool, have %d", (int) pool_idle);
+}
+
+REGRESSION_TEST(HttpSessionManager_FairEviction)(RegressionTest * t, int atype, int * pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  EThread *ethread = this_ethread();
+  vint32 pool_idle;
+  SessionBucket *pool = test_pool(&pool_idle);
+  HttpServerSession *hot[50], *quiet, *next;
+
+  box = REGRESSION_TEST_PASSED;
+
+  // One hot origin and a quiet one, released into different buckets
+  quiet = test_session("10.0.0.2", 80, "quiet.example.com");
+  test_pool_add(pool, quiet);
+  for (int i = 0; i < 50; ++i) {
+    hot[i] = test_session("10.0.0.1", 80, "hot.example.com");
+    test_pool_add(pool, hot[i]);
+  }
+
+  // The quiet origin's session is the oldest in the pool, but the hot
+  //  origin gives way, oldest first
+  next = test_session("10.0.0.3", 80, "new.example.com");
+  for (int i = 0; i < 10; ++i) {
+    HttpServerSession *victim = HttpSessionManager::make_room(pool, pool + FIRST_LEVEL_HASH(&next->server_ip.sa),
+                                                              next, 0, 51, ethread);
+
+    box.check(victim == hot[i], "expected hot[%d] to be evicted", i);
+    if (victim != hot[i])
+      break;
+    delete victim;
+    test_pool_add(pool, next);
+    next = test_session("10.0.0.3", 80, "new.example.com");
+  }
+  box.check(pool_idle == 51, "expected the pool to stay full, have %d", (int) pool_idle);
+
+  // With the pool below its limit, nothing goes
+  box.check(HttpSessionManager::make_room(pool, pool + FIRST_LEVEL_HASH(&next->server_ip.sa), next, 0, 100, ethread)
+            == NULL, "evicted below the pool limit");
+  delete next;
+
+  SessionBucket *bucket = pool + FIRST_LEVEL_HASH(&quiet->server_ip.sa);
+  box.check(bucket->origin_idle_count(&quiet->server_ip.sa, quiet->hostname_hash, NULL) == 1,
+            "the quiet origin lost its session");
+  bucket = pool + FIRST_LEVEL_HASH(&hot[0]->server_ip.sa);
+  box.check(bucket->largest_origin(NULL) == 40, "expected 40 idle sessions to the hot origin");
+
+  test_pool_free(pool);
+}
+
+REGRESSION_TEST(HttpSessionManager_PrewarmTopUp)(RegressionTest * t, int atype, int * pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  static const struct
+  {
+    int min_idle, max_idle, n_addrs, idle, pending, room;
+    int needed;
+  } cases[] = {
+    { 4, 0, 1, 0, 0, INT_MAX, 4 },    // an empty pool
+    { 4, 0, 1, 3, 0, INT_MAX, 1 },    // one missing
+    { 4, 0, 1, 3, 1, INT_MAX, 0 },    // in flight counts
+    { 4, 0, 1, 6, 0, INT_MAX, 0 },    // more than enough
+    { 5, 0, 2, 0, 0, INT_MAX, 3 },    // spread over two members, rounded up
+    { 5, 0, 2, 1, 1, INT_MAX, 1 },
+    { 8, 2, 1, 0, 0, INT_MAX, 2 },    // never more than max_idle keeps
+    { 8, 0, 1, 0, 0, 3, 3 },          // room left in the pool
+    { 8, 0, 1, 0, 0, -2, 0 },         // pool over its limit
+    { 0, 0, 1, 0, 0, INT_MAX, 0 },
+    { 4, 0, 0, 0, 0, INT_MAX, 0 },    // not resolved
+  };
+
+  box = REGRESSION_TEST_PASSED;
+
+  for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    int needed = prewarm_connects_needed(cases[i].min_idle, cases[i].max_idle, cases[i].n_addrs,
+                                         cases[i].idle, cases[i].pending, cases[i].room);
+
+    box.check(needed == cases[i].needed, "case %u: expected %d connects, got %d", i, cases[i].needed, needed);
+  }
+
+  // Idle sessions counted from the pool the way top_up() does
+  vint32 pool_idle;
+  SessionBucket *pool = test_pool(&pool_idle);
+  HttpServerSession *s = test_session("10.0.0.1", 443, "a.example.com");
+
+  test_pool_add(pool, s);
+  test_pool_add(pool, test_session("10.0.0.1", 443, "a.example.com"));
+  int idle = pool[FIRST_LEVEL_HASH(&s->server_ip.sa)].origin_idle_count(&s->server_ip.sa, s->hostname_hash, NULL);
+  box.check(prewarm_connects_needed(3, 0, 1, idle, 0, 10 - pool_idle) == 1, "expected one connect to top up");
+  test_pool_free(pool);
+}
+
+#endif // TS_HAS_TESTS
@@ -40,6 +40,7 @@
 class HttpClientSession;
 class HttpSM;
 class HCSM;
+struct HttpConfigParams;
 
 void
 initialize_thread_for_http_sessions(EThread *thread, int thread_index);
@@ -52,22 +53,62 @@ initialize_thread_for_http_sessions(EThread *thread, int thread_index);
 #define  HSM_LEVEL2_BUCKETS   3
 #endif
 
+// The idle sessions to one origin, ip + port + hostname, in a bucket
+struct SessionOrigin
+{
+  IpEndpoint ip;
+  INK_MD5 hostname_hash;
+  int count;
+  // Oldest first
+  Que(HttpServerSession, origin_link) sessions;
+  LINK(SessionOrigin, link);
+};
+
 class SessionBucket: public Continuation
 {
 public:
   SessionBucket();
   int session_handler(int event, void *data);
+  void add_session(HttpServerSession *s);
+  void remove_session(HttpServerSession *s);
+  SessionOrigin *find_origin(sockaddr const* ip, INK_MD5 &hostname_hash);
+  int origin_idle_count(sockaddr const* ip, INK_MD5 &hostname_hash, HttpServerSession **oldest);
+  int largest_origin(HttpServerSession **oldest);
+
   Que(HttpServerSession, lru_link) lru_list;
   DList(HttpServerSession, hash_link) l2_hash[HSM_LEVEL2_BUCKETS];
+  DList(SessionOrigin, link) origin_hash[HSM_LEVEL2_BUCKETS];
+  // Number of sessions on lru_list, only changed with the bucket lock held
+  int idle_count;
+  // Idle sessions in all the buckets of the pool, changed atomically
+  vint32 *pool_idle;
+};
+
+// An origin named in proxy.config.http.server_session_prewarm.origins
+struct PrewarmOrigin
+{
+  char *host;
+  int host_len;
+  int port;
+  bool https;
+  int min_idle;
+  int max_idle;
+  INK_MD5 hostname_hash;
 };
 
+int parse_prewarm_origins(const char *spec, PrewarmOrigin **origins);
+int prewarm_connects_needed(int min_idle, int max_idle, int n_addrs, int idle, int pending, int room);
+
 enum HSMresult_t
 { HSM_DONE, HSM_RETRY, HSM_NOT_FOUND };
 
 class HttpSessionManager
 {
+  friend class SessionPrewarm;
+
 public:
   HttpSessionManager()
+    : g_idle_count(0), prewarm_origins(NULL), n_prewarm_origins(0)
     { }
 
   ~HttpSessionManager()
@@ -80,11 +121,23 @@ public:
   HSMresult_t release_session(HttpServerSession *to_release);
   void purge_keepalives();
   void init();
+  void start_prewarm();
   int main_handler(int event, void *data);
 
+  static HttpServerSession *make_room(SessionBucket *pool, SessionBucket *bucket, HttpServerSession *s,
+                                      int max_idle, int pool_max_idle, EThread *ethread);
+
 private:
+  int origin_max_idle(HttpServerSession *s, HttpConfigParams *params);
+  static HttpServerSession *take_fair_victim(SessionBucket *pool, SessionBucket *bucket, EThread *ethread);
+
   //    Global l1 hash, used when there is no per-thread buckets
   SessionBucket g_l1_hash[HSM_LEVEL1_BUCKETS];
+  vint32 g_idle_count;
+
+  // Origins we keep idle sessions open to, read once at startup
+  PrewarmOrigin *prewarm_origins;
+  int n_prewarm_origins;
 };
 
 extern HttpSessionManager httpSessionManager;
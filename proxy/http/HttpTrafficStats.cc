@@ -0,0 +1,371 @@
+/** @file
+
+  Per remap rule and per origin traffic statistics
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "HttpTrafficStats.h"
+#include "I_RecCore.h"
+
+#define MAX_STAT_NAME_LENGTH  128
+
+static const char *stat_suffix[HttpTrafficStats::STAT_COUNT] = {
+  "requests",
+  "bytes_in",
+  "bytes_out",
+  "hits",
+  "misses",
+  "errors.4xx",
+  "errors.5xx",
+  "errors.connect_failed",
+  "errors.aborts"
+};
+
+HttpTrafficStats http_remap_traffic_stats("proxy.process.http.remap", false);
+HttpTrafficStats http_origin_traffic_stats("proxy.process.http.origin", true);
+
+static int
+power_of_two_above(int n)
+{
+  int size = 1;
+
+  while (size < n)
+    size <<= 1;
+  return size;
+}
+
+HttpTrafficStats::HttpTrafficStats(const char *prefix, bool lower_case)
+  : _prefix(prefix), _lower_case(lower_case), _max_keys(0),
+    _keys(NULL), _index(NULL), _index_mask(0), _num_keys(0), _full(0),
+    _cache_offset(0), _cache_mask(0), _rsb(NULL), _rsh(NULL)
+{
+  ink_mutex_init(&_mutex, prefix);
+}
+
+// The stat blocks and the thread local cache stay, the registered records
+// of the slots keep pointing at the blocks.
+HttpTrafficStats::~HttpTrafficStats()
+{
+  if (_keys) {
+    for (int i = 0; i < _num_keys; i++)
+      ats_free(_keys[i].name);
+  }
+  ats_free(_keys);
+  ats_free(_index);
+  ink_mutex_destroy(&_mutex);
+}
+
+bool
+HttpTrafficStats::init(int max_keys)
+{
+  if (max_keys <= 0)
+    return false;
+  if (max_keys > MAX_KEYS) {
+    Warning("%s: only %d distinct keys are supported, using %d", _prefix, MAX_KEYS, MAX_KEYS);
+    max_keys = MAX_KEYS;
+  }
+
+  // at most a quarter full, so probes stay short and always end
+  _cache_mask = power_of_two_above((max_keys + 1) * 4) - 1;
+  _cache_offset = eventProcessor.allocate((_cache_mask + 1) * sizeof(CacheEntry));
+  if (_cache_offset == -1) {
+    Warning("%s: not enough thread local memory for %d keys, disabled", _prefix, max_keys);
+    return false;
+  }
+  _rsb = RecAllocateRawStatBlock((max_keys + 1) * STAT_COUNT);
+  _rsh = RecAllocateRawStatHistogramBlock(max_keys + 1);
+  if (_rsb == NULL || _rsh == NULL) {
+    Warning("%s: not enough thread local memory for %d keys, disabled", _prefix, max_keys);
+    free_stats();
+    return false;
+  }
+
+  _keys = (Key *)ats_malloc((max_keys + 1) * sizeof(Key));
+  memset(_keys, 0, (max_keys + 1) * sizeof(Key));
+  _index_mask = power_of_two_above((max_keys + 1) * 2) - 1;
+  _index = (int *)ats_malloc((_index_mask + 1) * sizeof(int));
+  for (int i = 0; i <= _index_mask; i++)
+    _index[i] = -1;
+
+  if (!register_slot(OTHER_SLOT, "other")) {
+    Warning("%s: unable to register the stats, disabled", _prefix);
+    free_stats();
+    return false;
+  }
+  _keys[OTHER_SLOT].name = ats_strdup("other");
+  _num_keys = 1;
+  _max_keys = max_keys;
+  return true;
+}
+
+// Undo a failed init, no slot is in use yet. The thread local memory of the
+// cache and the stat blocks can not be given back.
+void
+HttpTrafficStats::free_stats()
+{
+  if (_rsb) {
+    RecFreeRawStatBlock(_rsb);
+    _rsb = NULL;
+  }
+  if (_rsh) {
+    RecFreeRawStatHistogramBlock(_rsh);
+    _rsh = NULL;
+  }
+  ats_free(_keys);
+  _keys = NULL;
+  ats_free(_index);
+  _index = NULL;
+  _index_mask = 0;
+}
+
+uint64_t
+HttpTrafficStats::hash(const char *key, int key_len) const
+{
+  // FNV-1a, 0 marks an empty cache entry
+  uint64_t h = 14695981039346656037ULL;
+
+  for (int i = 0; i < key_len; i++) {
+    h ^= (unsigned char) (_lower_case ? ParseRules::ink_tolower(key[i]) : key[i]);
+    h *= 1099511628211ULL;
+  }
+  return h == 0 ? 1 : h;
+}
+
+int
+HttpTrafficStats::find(uint64_t h) const
+{
+  for (int i = h & _index_mask; _index[i] >= 0; i = (i + 1) & _index_mask) {
+    if (_keys[_index[i]].hash == h)
+      return _index[i];
+  }
+  return -1;
+}
+
+// Called with _mutex held
+int
+HttpTrafficStats::add(uint64_t h, const char *key, int key_len)
+{
+  char name[MAX_STAT_NAME_LENGTH + 16];
+  const char *p = key, *end = key + key_len;
+  int len = 0, slot = _num_keys;
+
+  if (slot > _max_keys)
+    return -1;
+
+  // the record name part: drop the scheme, keep what is safe in a name
+  for (const char *s = key; s + 2 < end; s++) {
+    if (s[0] == ':' && s[1] == '/' && s[2] == '/') {
+      p = s + 3;
+      break;
+    }
+  }
+  for (; p < end && len < MAX_STAT_NAME_LENGTH; p++) {
+    char c = _lower_case ? ParseRules::ink_tolower(*p) : *p;
+    name[len++] = (ParseRules::is_alnum(c) || c == '.' || c == '-' || c == '_') ? c : '_';
+  }
+  if (len == 0)
+    name[len++] = '_';
+  name[len] = '\0';
+
+  if (name_taken(name)) {
+    // another key has this name, e.g. http:// and https:// rules
+    snprintf(name + len, sizeof(name) - len, "_%d", slot);
+  }
+  if (!register_slot(slot, name))
+    return -1;
+
+  _keys[slot].hash = h;
+  _keys[slot].name = ats_strdup(name);
+  int i = h & _index_mask;
+  while (_index[i] >= 0)
+    i = (i + 1) & _index_mask;
+  _index[i] = slot;
+  _num_keys = slot + 1;
+
+  Debug("http_traffic_stats", "%s.%s is slot %d", _prefix, name, slot);
+  return slot;
+}
+
+bool
+HttpTrafficStats::name_taken(const char *name) const
+{
+  char rec_name[256];
+  RecT rec_type;
+
+  snprintf(rec_name, sizeof(rec_name), "%s.%s.%s", _prefix, name, stat_suffix[REQUESTS]);
+  return RecGetRecordType(rec_name, &rec_type) == REC_ERR_OKAY;
+}
+
+bool
+HttpTrafficStats::register_slot(int slot, const char *name)
+{
+  char rec_name[256];
+
+  for (int i = 0; i < STAT_COUNT; i++) {
+    snprintf(rec_name, sizeof(rec_name), "%s.%s.%s", _prefix, name, stat_suffix[i]);
+    if (RecRegisterRawStat(_rsb, RECT_PROCESS, rec_name, RECD_COUNTER, RECP_NON_PERSISTENT,
+                           slot * STAT_COUNT + i, RecRawStatSyncCount) != REC_ERR_OKAY) {
+      Warning("unable to register %s", rec_name);
+      return false;
+    }
+  }
+  snprintf(rec_name, sizeof(rec_name), "%s.%s.latency.total_us", _prefix, name);
+  if (RecRegisterRawStatHistogram(_rsh, RECT_PROCESS, rec_name, RECP_NON_PERSISTENT, slot) != REC_ERR_OKAY) {
+    Warning("unable to register %s", rec_name);
+    return false;
+  }
+  return true;
+}
+
+int
+HttpTrafficStats::lookup(const char *key, int key_len)
+{
+  int slot;
+  uint64_t h;
+
+  if (!enabled())
+    return OTHER_SLOT;
+
+  h = hash(key, key_len);
+  ink_mutex_acquire(&_mutex);
+  if ((slot = find(h)) < 0 && (slot = add(h, key, key_len)) < 0) {
+    ink_atomic_swap((pvint32) &_full, 1);
+    slot = OTHER_SLOT;
+  }
+  ink_mutex_release(&_mutex);
+  return slot;
+}
+
+int
+HttpTrafficStats::lookup(EThread *ethread, const char *key, int key_len)
+{
+  CacheEntry *cache;
+  uint64_t h;
+  int i, slot;
+
+  if (!enabled() || key == NULL || key_len <= 0)
+    return OTHER_SLOT;
+
+  h = hash(key, key_len);
+  cache = (CacheEntry *) ((char *) ethread + _cache_offset);
+  for (i = h & _cache_mask; cache[i].hash != 0; i = (i + 1) & _cache_mask) {
+    if (cache[i].hash == h)
+      return cache[i].slot;
+  }
+
+  if (_full) {
+    // the table is frozen, no need for the lock
+    slot = find(h);
+  } else {
+    slot = lookup(key, key_len);
+  }
+  if (slot < 0 || slot == OTHER_SLOT)
+    return OTHER_SLOT;             // not cached, the cache only holds real keys
+
+  cache[i].hash = h;
+  cache[i].slot = slot;
+  return slot;
+}
+
+void
+HttpTrafficStats::record(EThread *ethread, int slot, const Sample &sample)
+{
+  int base = slot * STAT_COUNT;
+
+  if (!enabled())
+    return;
+
+  RecIncrRawStatCount(_rsb, ethread, base + REQUESTS, 1);
+  if (sample.bytes_in > 0)
+    RecIncrRawStatCount(_rsb, ethread, base + BYTES_IN, sample.bytes_in);
+  if (sample.bytes_out > 0)
+    RecIncrRawStatCount(_rsb, ethread, base + BYTES_OUT, sample.bytes_out);
+  if (sample.hit)
+    RecIncrRawStatCount(_rsb, ethread, base + HITS, 1);
+  else if (sample.miss)
+    RecIncrRawStatCount(_rsb, ethread, base + MISSES, 1);
+  if (sample.connect_error)
+    RecIncrRawStatCount(_rsb, ethread, base + ERRORS_CONNECT, 1);
+  if (sample.abort)
+    RecIncrRawStatCount(_rsb, ethread, base + ERRORS_ABORT, 1);
+  else if (sample.status >= 500)
+    RecIncrRawStatCount(_rsb, ethread, base + ERRORS_5XX, 1);
+  else if (sample.status >= 400)
+    RecIncrRawStatCount(_rsb, ethread, base + ERRORS_4XX, 1);
+  RecIncrRawStatHistogram(_rsh, ethread, slot, ink_hrtime_to_usec(sample.total_time));
+}
+
+
+#if TS_HAS_TESTS
+#include "ts/TestBox.h"
+
+REGRESSION_TEST(HttpTrafficStats_Slots)(RegressionTest *t, int atype, int *pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  // init() can't be undone: the records registered under this prefix stay,
+  // and so do the stat blocks and the thread local cache of every event
+  // thread. The destructor only frees the key table.
+  HttpTrafficStats stats("proxy.process.http.regression_traffic_stats", true);
+  static const char *keys[] = { "http://a.example.com", "http://b.example.com", "https://c.example.com" };
+  static const int n_keys = sizeof(keys) / sizeof(keys[0]);
+  EThread *ethread = this_ethread();
+  RecT rec_type;
+  int slots[n_keys];
+
+  box = REGRESSION_TEST_PASSED;
+
+  box.check(!stats.enabled(), "enabled before init");
+  if (!box.check(stats.init(n_keys) && stats.enabled(), "init of %d keys failed", n_keys))
+    return;
+
+  for (int i = 0; i < n_keys; i++) {
+    slots[i] = stats.lookup(keys[i], strlen(keys[i]));
+    box.check(slots[i] != HttpTrafficStats::OTHER_SLOT, "%s went to other", keys[i]);
+    for (int j = 0; j < i; j++)
+      box.check(slots[i] != slots[j], "%s and %s share slot %d", keys[i], keys[j], slots[i]);
+  }
+
+  // over the cap, with and without the thread cache
+  box.check(stats.lookup("http://d.example.com", 20) == HttpTrafficStats::OTHER_SLOT, "a key over the cap got a slot");
+  box.check(stats.lookup(ethread, "http://e.example.com", 20) == HttpTrafficStats::OTHER_SLOT,
+            "a key over the cap got a slot through the thread cache");
+  box.check(stats.lookup(ethread, "http://d.example.com", 20) == HttpTrafficStats::OTHER_SLOT,
+            "a key over the cap got a slot on its second lookup");
+
+  // the slots stay the same, through the lock, the cache and the frozen table
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < n_keys; i++) {
+      box.check(stats.lookup(keys[i], strlen(keys[i])) == slots[i], "%s moved from slot %d", keys[i], slots[i]);
+      box.check(stats.lookup(ethread, keys[i], strlen(keys[i])) == slots[i], "%s moved from slot %d on this thread",
+                keys[i], slots[i]);
+    }
+  }
+  box.check(stats.lookup(ethread, "HTTP://A.EXAMPLE.COM", 20) == slots[0], "the keys are not case insensitive");
+  box.check(stats.lookup(ethread, NULL, 0) == HttpTrafficStats::OTHER_SLOT, "no key did not go to other");
+
+  box.check(RecGetRecordType("proxy.process.http.regression_traffic_stats.other.requests", &rec_type) == REC_ERR_OKAY,
+            "the stats of other are not registered");
+  box.check(RecGetRecordType("proxy.process.http.regression_traffic_stats.a.example.com.requests", &rec_type) ==
+            REC_ERR_OKAY, "the stats of a key are not registered");
+  box.check(RecGetRecordType("proxy.process.http.regression_traffic_stats.d.example.com.requests", &rec_type) !=
+            REC_ERR_OKAY, "the stats of a key over the cap are registered");
+}
+#endif
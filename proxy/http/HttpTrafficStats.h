@@ -0,0 +1,147 @@
+/** @file
+
+  Per remap rule and per origin traffic statistics
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _HTTP_TRAFFIC_STATS_H_
+#define _HTTP_TRAFFIC_STATS_H_
+
+#include "libts.h"
+#include "P_EventSystem.h"
+#include "I_RecProcess.h"
+
+/**
+ * A set of stats per key (a remap rule or an origin host), with a cap on
+ * the number of keys. Each key gets a slot the first time it is seen and
+ * keeps it for the life of the process. Once all the slots are taken, new
+ * keys are counted in slot 0, "other".
+ *
+ * The counters and the latency histogram of every slot live in the event
+ * threads' private memory, like the other raw stats. Slot lookups go through
+ * a per thread cache of key hash to slot, so only the first lookup of a key
+ * on a thread takes the lock, and none do once the slots are all taken.
+ */
+class HttpTrafficStats
+{
+public:
+  enum Stat
+  {
+    REQUESTS,
+    BYTES_IN,                   // origin response header and body
+    BYTES_OUT,                  // client response header and body
+    HITS,
+    MISSES,
+    ERRORS_4XX,
+    ERRORS_5XX,
+    ERRORS_CONNECT,
+    ERRORS_ABORT,
+
+    STAT_COUNT
+  };
+
+  /** What one transaction adds to the stats of its slot. */
+  struct Sample
+  {
+    int64_t bytes_in;
+    int64_t bytes_out;
+    ink_hrtime total_time;
+    int status;
+    bool hit;
+    bool miss;
+    bool connect_error;
+    bool abort;
+  };
+
+  static const int OTHER_SLOT = 0;
+  // The most keys init() takes, the range of the max_remap_rules and
+  // max_origins records in RecordsConfig.cc has to match.
+  static const int MAX_KEYS = 64;
+
+  HttpTrafficStats(const char *prefix, bool lower_case);
+  ~HttpTrafficStats();
+
+  /**
+   * Allocate the thread local stats of max_keys keys plus "other", before
+   * the event threads start. Stats stay disabled when max_keys is 0.
+   * @return false if the stats are disabled
+   */
+  bool init(int max_keys);
+
+  inline bool enabled() const {
+    return _max_keys > 0;
+  }
+
+  /**
+   * Slot of a key, for callers off the hot path, e.g. while loading
+   * remap.config. Always takes the lock.
+   */
+  int lookup(const char *key, int key_len);
+
+  /**
+   * Slot of a key, from the calling event thread's cache when it is there.
+   */
+  int lookup(EThread *ethread, const char *key, int key_len);
+
+  /** Add one transaction to the stats of a slot. */
+  void record(EThread *ethread, int slot, const Sample &sample);
+
+private:
+  struct Key
+  {
+    uint64_t hash;
+    char *name;
+  };
+
+  struct CacheEntry
+  {
+    uint64_t hash;              // 0 if empty
+    int slot;
+  };
+
+  uint64_t hash(const char *key, int key_len) const;
+  int find(uint64_t hash) const;
+  int add(uint64_t hash, const char *key, int key_len);
+  bool name_taken(const char *name) const;
+  bool register_slot(int slot, const char *name);
+  void free_stats();
+
+  const char *_prefix;
+  bool _lower_case;
+  int _max_keys;
+
+  ink_mutex _mutex;
+  Key *_keys;                   // [0] is "other"
+  int *_index;                  // open addressing, hash to _keys index
+  int _index_mask;
+  volatile int _num_keys;
+  volatile int _full;           // _keys and _index no longer change
+
+  off_t _cache_offset;          // thread local CacheEntry table
+  int _cache_mask;
+
+  RecRawStatBlock *_rsb;
+  RecRawStatHistogramBlock *_rsh;
+};
+
+extern HttpTrafficStats http_remap_traffic_stats;
+extern HttpTrafficStats http_origin_traffic_stats;
+
+#endif
@@ -2449,6 +2449,14 @@ HttpTransact::need_to_revalidate(State* s)
   bool
     send_revalidate = ((needs_authenticate == true) ||
                        (needs_revalidate == true) || (is_cache_response_returnable(s) == false));
+
+  // Within its stale-while-revalidate window the stale copy is served
+  // as is, so there is no need to look up the server first.
+  if (send_revalidate && needs_revalidate && !needs_authenticate && !needs_cache_auth &&
+      is_cache_response_returnable(s) && is_stale_while_revalidate_returnable(s)) {
+    return false;
+  }
+
   if (needs_cache_auth == true) {
     s->www_auth_content = send_revalidate ? CACHE_AUTH_STALE : CACHE_AUTH_FRESH;
     send_revalidate = true;
@@ -2578,8 +2586,18 @@ HttpTransact::HandleCacheOpenReadHit(State* s)
 
     DebugTxn("http_seq", "[HttpTransact::HandleCacheOpenReadHit] " "Revalidate document with server");
 
+    // RFC 5861 stale-while-revalidate: hand back the stale copy now and
+    // leave the revalidation to a background transaction.
+    if (needs_revalidate && !needs_authenticate && !needs_cache_auth &&
+        response_returnable && is_stale_while_revalidate_returnable(s)) {
+      DebugTxn("http_trans", "CacheOpenReadHit - stale-while-revalidate, returning stale document");
+      s->stale_while_revalidate = true;
+      server_up = false;
+      HTTP_INCREMENT_TRANS_STAT(http_cache_stale_while_revalidate_stat);
+    }
+
 #ifndef INK_NO_ICP
-    if (s->http_config_param->icp_enabled && icp_dynamic_enabled && s->http_config_param->stale_icp_enabled &&
+    if (server_up && s->http_config_param->icp_enabled && icp_dynamic_enabled && s->http_config_param->stale_icp_enabled &&
         needs_authenticate == false && needs_cache_auth == false &&
         !s->hdr_info.client_request.is_pragma_no_cache_set() &&
         !s->hdr_info.client_request.is_cache_control_set(HTTP_VALUE_NO_CACHE)) {
@@ -2600,7 +2618,7 @@ HttpTransact::HandleCacheOpenReadHit(State* s)
     }
 #endif //INK_NO_ICP
 
-    if (s->stale_icp_lookup == false) {
+    if (server_up && s->stale_icp_lookup == false) {
       find_server_and_update_current_info(s);
 
       // We do not want to try to revalidate documents if we think
@@ -2703,7 +2721,8 @@ HttpTransact::HandleCacheOpenReadHit(State* s)
     build_response_from_cache(s, HTTP_WARNING_CODE_HERUISTIC_EXPIRATION);
   } else if (s->cache_lookup_result == CACHE_LOOKUP_HIT_STALE) {
     ink_debug_assert(server_up == false);
-    build_response_from_cache(s, HTTP_WARNING_CODE_REVALIDATION_FAILED);
+    build_response_from_cache(s, s->stale_while_revalidate ? HTTP_WARNING_CODE_RESPONSE_STALE :
+                              HTTP_WARNING_CODE_REVALIDATION_FAILED);
   } else {
     build_response_from_cache(s, HTTP_WARNING_CODE_NONE);
   }
@@ -3901,6 +3920,10 @@ HttpTransact::handle_server_connection_not_open(State* s)
   switch (s->cache_info.action) {
   case CACHE_DO_UPDATE:
     serve_from_cache = is_stale_cache_response_returnable(s);
+    if (!serve_from_cache && is_stale_if_error_returnable(s)) {
+      HTTP_INCREMENT_TRANS_STAT(http_cache_stale_if_error_stat);
+      serve_from_cache = true;
+    }
     break;
 
   case CACHE_PREPARE_TO_DELETE:
@@ -4401,6 +4424,19 @@ HttpTransact::handle_cache_operation_on_forward_server_response(State* s)
       return;
     }
 
+    // RFC 5861 stale-if-error: hand back the stale copy instead of the error.
+    if ((server_response_code == HTTP_STATUS_INTERNAL_SERVER_ERROR ||
+         server_response_code == HTTP_STATUS_GATEWAY_TIMEOUT ||
+         server_response_code == HTTP_STATUS_BAD_GATEWAY ||
+         server_response_code == HTTP_STATUS_SERVICE_UNAVAILABLE) &&
+        s->cache_info.action == CACHE_DO_UPDATE && is_stale_if_error_returnable(s)) {
+      DebugTxn("http_trans", "[hcoofsr] stale-if-error: serve stale object from cache");
+      HTTP_INCREMENT_TRANS_STAT(http_cache_stale_if_error_stat);
+      s->source = SOURCE_CACHE;
+      build_response_from_cache(s, HTTP_WARNING_CODE_REVALIDATION_FAILED);
+      return;
+    }
+
     s->next_action = SERVER_READ;
     client_response_code = server_response_code;
     base_response = &s->hdr_info.server_response;
@@ -5927,9 +5963,11 @@ HttpTransact::initialize_state_variables_from_request(State* s, HTTPHdr* obsolet
 
   // set the rww config
   s->cache_info.config.max_rww_delay = (int) s->txn_conf->cache_max_rww_delay;
-  // special case for flow control
-  s->state_machine->ua_session->get_netvc()->set_flow_ctl(VIO::READ, (uint64_t) s->txn_conf->sock_flow_control_in);
-  s->state_machine->ua_session->get_netvc()->set_flow_ctl(VIO::WRITE, (uint64_t) s->txn_conf->sock_flow_control_out);
+  // special case for flow control, there's no user agent for scheduled updates
+  if (s->state_machine->ua_session) {
+    s->state_machine->ua_session->get_netvc()->set_flow_ctl(VIO::READ, (uint64_t) s->txn_conf->sock_flow_control_in);
+    s->state_machine->ua_session->get_netvc()->set_flow_ctl(VIO::WRITE, (uint64_t) s->txn_conf->sock_flow_control_out);
+  }
 }
 
 void
@@ -6149,6 +6187,112 @@ HttpTransact::is_stale_cache_response_returnable(State* s)
   return true;
 }
 
+// Value of the delta-seconds Cache-Control extension directive (RFC 5861)
+// in hdr, or -1 if the response doesn't carry it.
+static int
+cache_control_delta_seconds(HTTPHdr* hdr, const char *directive, int directive_len)
+{
+  MIMEField *field = hdr->field_find(MIME_FIELD_CACHE_CONTROL, MIME_LEN_CACHE_CONTROL);
+
+  if (field) {
+    HdrCsvIter iter;
+    int len;
+    const char *val = iter.get_first(field, &len);
+
+    while (val) {
+      if (len > directive_len && val[directive_len] == '=' &&
+          ptr_len_ncasecmp(val, len, directive, directive_len) == 0) {
+        val += directive_len + 1;
+        len -= directive_len + 1;
+        if (len > 0 && *val == '"') {
+          ++val;
+          --len;
+        }
+        return (len > 0 && ParseRules::is_digit(*val)) ? ink_atoi(val, len) : -1;
+      }
+      val = iter.get_next(&len);
+    }
+  }
+  return -1;
+}
+
+// Common part of the RFC 5861 checks: may the stale cached response be
+// served at all, and is it no more than its window past its expiry? The
+// window comes from the response's own directive, or else the config.
+static bool
+is_stale_within_window(HttpTransact::State* s, const char *directive, int directive_len, MgmtInt default_window)
+{
+  CacheHTTPInfo *obj = s->cache_info.object_read;
+  HTTPHdr *cached_response = obj->response_get();
+  int window = cache_control_delta_seconds(cached_response, directive, directive_len);
+
+  if (window < 0)
+    window = default_window;
+  if (window <= 0)
+    return false;
+
+  if (!s->cache_info.directives.does_client_permit_lookup)
+    return false;
+
+  uint32_t cc_mask = (MIME_COOKED_MASK_CC_MUST_REVALIDATE |
+                      MIME_COOKED_MASK_CC_PROXY_REVALIDATE |
+                      MIME_COOKED_MASK_CC_NEED_REVALIDATE_ONCE |
+                      MIME_COOKED_MASK_CC_NO_CACHE | MIME_COOKED_MASK_CC_NO_STORE);
+  if ((cached_response->get_cooked_cc_mask() & cc_mask) || cached_response->is_pragma_no_cache_set())
+    return false;
+
+  if (HttpTransact::AuthenticationNeeded(s->txn_conf, &s->hdr_info.client_request, cached_response) !=
+      HttpTransact::AUTHENTICATION_SUCCESS)
+    return false;
+
+  bool heuristic;
+  time_t response_date = cached_response->get_date();
+  int fresh_limit = HttpTransact::calculate_document_freshness_limit(s, cached_response, response_date, &heuristic);
+  time_t current_age = HttpTransactHeaders::calculate_document_age(obj->request_sent_time_get(),
+                                                                   obj->response_received_time_get(),
+                                                                   cached_response, response_date, s->current.now);
+
+  DebugTxn("http_trans", "[is_stale_within_window] %.*s=%d fresh_limit=%d current_age=%" PRId64,
+           directive_len, directive, window, fresh_limit, (int64_t)current_age);
+
+  // Negative age is overflow
+  return current_age >= 0 && current_age - fresh_limit <= window;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Name       : is_stale_while_revalidate_returnable()
+// Description: check if a stale cached response can be served right away
+//              while it is revalidated in the background (RFC 5861)
+//
+// Input      : State
+// Output     : true or false
+//
+///////////////////////////////////////////////////////////////////////////////
+bool
+HttpTransact::is_stale_while_revalidate_returnable(State* s)
+{
+  // The background revalidation itself has to go to the server.
+  if (s->background_revalidate || s->method != HTTP_WKSIDX_GET)
+    return false;
+
+  return is_stale_within_window(s, "stale-while-revalidate", 22, s->txn_conf->cache_stale_while_revalidate);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Name       : is_stale_if_error_returnable()
+// Description: check if a stale cached response can be served in place of
+//              an origin server error (RFC 5861)
+//
+// Input      : State
+// Output     : true or false
+//
+///////////////////////////////////////////////////////////////////////////////
+bool
+HttpTransact::is_stale_if_error_returnable(State* s)
+{
+  return is_stale_within_window(s, "stale-if-error", 14, s->txn_conf->cache_stale_if_error);
+}
+
 
 bool
 HttpTransact::url_looks_dynamic(URL* url)
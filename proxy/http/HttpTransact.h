@@ -930,6 +930,8 @@ public:
     bool cdn_remap_complete;
     bool first_dns_lookup;
     bool backdoor_request;      // internal
+    bool stale_while_revalidate;        // stale copy served, revalidate in the background
+    bool background_revalidate; // internal, this is that background revalidation
     bool cop_test_page;         // internal
     bool icp_lookup_success;    // in
 
@@ -1102,6 +1104,8 @@ public:
         cdn_remap_complete(false),
         first_dns_lookup(true),
         backdoor_request(false),
+        stale_while_revalidate(false),
+        background_revalidate(false),
         cop_test_page(false),
         icp_lookup_success(false),
         updated_server_version(HostDBApplicationInfo::HTTP_VERSION_UNDEFINED),
@@ -1412,6 +1416,8 @@ public:
   static bool is_server_negative_cached(State* s);
   static bool is_cache_response_returnable(State* s);
   static bool is_stale_cache_response_returnable(State* s);
+  static bool is_stale_while_revalidate_returnable(State* s);
+  static bool is_stale_if_error_returnable(State* s);
   static bool need_to_revalidate(State* s);
   static bool url_looks_dynamic(URL* url);
   static bool is_request_cache_lookupable(State* s, HTTPHdr* incoming);
@@ -483,7 +483,7 @@ HttpTunnelProducer::HttpTunnelProducer()
     vc(NULL), vc_handler(NULL), read_vio(NULL), read_buffer(NULL),
     buffer_start(NULL), vc_type(HT_HTTP_SERVER), chunking_action(TCA_PASSTHRU_DECHUNKED_CONTENT),
     do_chunking(false), do_dechunking(false), do_chunked_passthru(false),
-    init_bytes_done(0), nbytes(0), ntodo(0), bytes_read(0), handler_state(0), num_consumers(0), alive(false),
+    splice_src(NULL), splice_dst(NULL), spliced(false), init_bytes_done(0), nbytes(0), ntodo(0), bytes_read(0), handler_state(0), num_consumers(0), alive(false),
     read_success(false), name(NULL)
 {
 }
@@ -612,6 +612,19 @@ HttpTunnel::set_producer_chunking_action(HttpTunnelProducer * p, int64_t skip_by
   };
 }
 
+// void HttpTunnel::set_producer_splice
+//
+//   Offers the producer's connection to be spliced into the
+//   consumer's.  Whether the splice happens is decided when the
+//   producer runs, once all the consumers are known
+//
+void
+HttpTunnel::set_producer_splice(HttpTunnelProducer * p, NetVConnection * src, NetVConnection * dst)
+{
+  p->splice_src = src;
+  p->splice_dst = dst;
+}
+
 // HttpTunnelProducer* HttpTunnel::add_producer
 //
 //   Adds a new producer to the tunnel
@@ -969,6 +982,16 @@ HttpTunnel::producer_run(HttpTunnelProducer * p)
             sm->t_state.single_range._start);
       } else
         p->read_vio = p->vc->do_io_read(this, producer_n, p->read_buffer);
+
+      // If the body goes untouched to a single consumer, the bytes
+      //   don't need to come through the buffer at all
+      c = p->consumer_list.head;
+      if (p->splice_src && p->read_vio && p->num_consumers == 1 && c->alive && c->write_vio &&
+          c->vc_type == HT_HTTP_CLIENT && !p->do_chunking && !p->do_dechunking && !p->do_chunked_passthru) {
+        p->spliced = p->splice_src->splice_to(p->splice_dst);
+        Debug("http_tunnel", "[%" PRId64 "] [tunnel_run] producer '%s' %s", sm->sm_id, p->name,
+              p->spliced ? "spliced" : "could not be spliced");
+      }
     }
 
     // Now that the tunnel has started, we must remove producer's reader so
@@ -1265,7 +1288,9 @@ bool HttpTunnel::consumer_handler(int event, HttpTunnelConsumer * c)
       }
       break;
     } else {
-      if (c->buffer_reader->read_avail())
+      // A spliced producer leaves its last bytes in the pipe rather
+      //   than the buffer, the vio tells how many are still to go
+      if (c->buffer_reader->read_avail() || (c->producer->spliced && c->write_vio->ntodo() > 0))
         break;
       else
         new_event = VC_EVENT_EOS;
@@ -1355,6 +1380,33 @@ HttpTunnel::chain_abort_all(HttpTunnelProducer * p)
   }
 }
 
+// void HttpTunnel::chain_abort_transform(HttpTunnelProducer* p)
+//
+//    Abort the transform producer p and everyone still alive
+//     downstream of it, while the producer that feeds the
+//     transform keeps going for its other consumers
+//
+void
+HttpTunnel::chain_abort_transform(HttpTunnelProducer * p)
+{
+  HttpTunnelConsumer *c = p->self_consumer;
+
+  ink_assert(p->vc_type == HT_TRANSFORM);
+  chain_abort_all(p);
+
+  // The transform no longer consumes its input so let go
+  //   of its reader, otherwise the data it leaves in the
+  //   buffer holds back the other consumers
+  if (c && c->buffer_reader) {
+    c->write_vio = NULL;
+    c->buffer_reader->mbuf->dealloc_reader(c->buffer_reader);
+    c->buffer_reader = NULL;
+
+    if (c->producer->alive && c->producer->read_vio)
+      c->producer->read_vio->reenable();
+  }
+}
+
 // void HttpTunnel::chain_finish_internal(HttpTunnelProducer* p)
 //
 //    Internal function for finishing all consumers.  Takes
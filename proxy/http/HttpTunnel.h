@@ -57,6 +57,7 @@
 #define WRITE_TO_BUF 2
 
 struct HttpTunnelProducer;
+class NetVConnection;
 class HttpSM;
 class HttpPagesHandler;
 typedef int (HttpSM::*HttpSMHandler) (int event, void *data);
@@ -189,6 +190,11 @@ struct HttpTunnelProducer
   bool do_dechunking;
   bool do_chunked_passthru;
 
+  // Connections to splice when the tunnel turns out to be a plain copy
+  NetVConnection *splice_src;
+  NetVConnection *splice_dst;
+  bool spliced;
+
   int64_t init_bytes_done;          // bytes passed in buffer
   int64_t nbytes;                   // total bytes (client's perspective)
   int64_t ntodo;                    // what this vc needs to do
@@ -244,6 +250,7 @@ public:
                                    HttpProducerHandler sm_handler, HttpTunnelType_t vc_type, const char *name);
 
   void set_producer_chunking_action(HttpTunnelProducer * p, int64_t skip_bytes, TunnelChunkingAction_t action);
+  void set_producer_splice(HttpTunnelProducer * p, NetVConnection * src, NetVConnection * dst);
 
   HttpTunnelConsumer *add_consumer(VConnection * vc,
                                    VConnection * producer,
@@ -265,6 +272,7 @@ public:
   void chain_finish_all(HttpTunnelProducer * p);
   void chain_abort_cache_write(HttpTunnelProducer * p);
   void chain_abort_all(HttpTunnelProducer * p);
+  void chain_abort_transform(HttpTunnelProducer * p);
   void abort_cache_write_finish_others(HttpTunnelProducer * p);
   void append_message_to_producer_buffer(HttpTunnelProducer * p, const char *msg, int64_t msg_len);
 
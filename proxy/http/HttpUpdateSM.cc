@@ -42,8 +42,36 @@ ClassAllocator<HttpUpdateSM> httpUpdateSMAllocator("httpUpdateSMAllocator");
         Debug("http", "[%" PRId64 "] [%s, %s]", sm_id, \
         #state_name, HttpDebugNames::get_event_name(event)); }
 
+// Cache lookup URLs with a background revalidation in flight
+static ProcessMutex revalidate_mutex = PTHREAD_MUTEX_INITIALIZER;
+static InkHashTable *revalidate_table = NULL;
+
+static bool
+revalidate_begin(const char *key)
+{
+  bool started = false;
+
+  ink_mutex_acquire(&revalidate_mutex);
+  if (revalidate_table == NULL)
+    revalidate_table = ink_hash_table_create(InkHashTableKeyType_String);
+  if (!ink_hash_table_isbound(revalidate_table, key)) {
+    ink_hash_table_insert(revalidate_table, key, NULL);
+    started = true;
+  }
+  ink_mutex_release(&revalidate_mutex);
+  return started;
+}
+
+static void
+revalidate_end(const char *key)
+{
+  ink_mutex_acquire(&revalidate_mutex);
+  ink_hash_table_delete(revalidate_table, key);
+  ink_mutex_release(&revalidate_mutex);
+}
+
 HttpUpdateSM::HttpUpdateSM():
-cb_occured(false), cb_cont(NULL), cb_action(), cb_event(HTTP_SCH_UPDATE_EVENT_ERROR)
+cb_occured(false), cb_cont(NULL), cb_action(), cb_event(HTTP_SCH_UPDATE_EVENT_ERROR), revalidate_key(NULL)
 {
 }
 
@@ -52,6 +80,11 @@ HttpUpdateSM::destroy()
 {
   cleanup();
   cb_action = NULL;
+  if (revalidate_key) {
+    revalidate_end(revalidate_key);
+    ats_free(revalidate_key);
+    revalidate_key = NULL;
+  }
   httpUpdateSMAllocator.free(this);
 }
 
@@ -98,6 +131,76 @@ HttpUpdateSM::start_scheduled_update(Continuation * cont, HTTPHdr * request)
   }
 }
 
+bool
+HttpUpdateSM::start_background_revalidation(HttpTransact::State * s)
+{
+  char *key = s->cache_info.lookup_url->string_get(NULL);
+
+  if (!revalidate_begin(key)) {
+    Debug("http", "[%" PRId64 "] [HttpUpdateSM] revalidation of %s already in progress", s->state_machine_id, key);
+    ats_free(key);
+    return false;
+  }
+
+  HttpUpdateSM *sm = HttpUpdateSM::allocate();
+  sm->init();
+  sm->revalidate_key = key;
+  Debug("http", "[%" PRId64 "] [HttpUpdateSM] background revalidation of %s for [%" PRId64 "]",
+        sm->sm_id, key, s->state_machine_id);
+
+  // Nobody to call back, the SM is on its own
+  sm->mutex = new_ProxyMutex();
+  MUTEX_LOCK(lock, sm->mutex, this_ethread());
+  sm->start_sub_sm();
+
+  // Ask again for what the client asked for, as it came in, but
+  //  unconditionally so that the whole response can be cached
+  HTTPHdr *req = &sm->t_state.hdr_info.client_request;
+  req->create(HTTP_TYPE_REQUEST);
+  req->copy(&s->hdr_info.client_request);
+  if (s->pristine_url.valid()) {
+    int host_len;
+    const char *host = s->pristine_url.host_get(&host_len);
+
+    req->url_set(&s->pristine_url);
+    if (host) {
+      char host_buf[MAXDNAME + 8];
+      int port = s->pristine_url.port_get_raw();
+      int len = port ? snprintf(host_buf, sizeof(host_buf), "%.*s:%d", host_len, host, port) :
+        snprintf(host_buf, sizeof(host_buf), "%.*s", host_len, host);
+      req->value_set(MIME_FIELD_HOST, MIME_LEN_HOST, host_buf, min(len, (int)sizeof(host_buf) - 1));
+    }
+  }
+  req->field_delete(MIME_FIELD_RANGE, MIME_LEN_RANGE);
+  req->field_delete(MIME_FIELD_IF_RANGE, MIME_LEN_IF_RANGE);
+  req->field_delete(MIME_FIELD_IF_MODIFIED_SINCE, MIME_LEN_IF_MODIFIED_SINCE);
+  req->field_delete(MIME_FIELD_IF_UNMODIFIED_SINCE, MIME_LEN_IF_UNMODIFIED_SINCE);
+  req->field_delete(MIME_FIELD_IF_NONE_MATCH, MIME_LEN_IF_NONE_MATCH);
+  req->field_delete(MIME_FIELD_IF_MATCH, MIME_LEN_IF_MATCH);
+
+  ats_ip_copy(&sm->t_state.client_info.addr, &s->client_info.addr);
+  sm->t_state.backdoor_request = 0;
+  sm->t_state.client_info.port_attribute = HttpProxyPort::TRANSPORT_DEFAULT;
+  sm->t_state.req_flavor = HttpTransact::REQ_FLAVOR_SCHEDULED_UPDATE;
+  sm->t_state.background_revalidate = true;
+
+  // Same remapping and plugin overrides as the transaction it's for,
+  //  and the global plugin hooks see the revalidation as well
+  sm->hooks_set = http_global_hooks->hooks_set;
+  sm->t_state.api_skip_all_remapping = s->api_skip_all_remapping;
+  if (s->my_txn_conf) {
+    sm->t_state.setup_per_txn_configs();
+    memcpy(sm->t_state.my_txn_conf, s->my_txn_conf, sizeof(OverridableHttpConfigParams));
+  }
+
+  http_parser_init(&sm->http_parser);
+
+  sm->default_handler = &HttpUpdateSM::state_add_to_list;
+  sm->handleEvent(EVENT_NONE, NULL);
+
+  return true;
+}
+
 void
 HttpUpdateSM::handle_api_return()
 {
@@ -155,11 +258,38 @@ HttpUpdateSM::handle_api_return()
       break;
     }
 #endif //TS_NO_TRANSFORM
-  case HttpTransact::PROXY_INTERNAL_CACHE_WRITE:
   case HttpTransact::SERVER_READ:
+    {
+      if (t_state.background_revalidate &&
+          (t_state.cache_info.action == HttpTransact::CACHE_DO_WRITE ||
+           t_state.cache_info.action == HttpTransact::CACHE_DO_REPLACE)) {
+        // The new copy goes to the cache only, which is a background
+        //  fill from the start
+        cache_sm.close_read();
+        t_state.cache_info.write_status = HttpTransact::CACHE_WRITE_IN_PROGRESS;
+        start_background_fill();
+        setup_server_transfer_to_cache_only();
+        tunnel.tunnel_run();
+        cb_event = HTTP_SCH_UPDATE_EVENT_WRITTEN;
+        return;
+      }
+    }
+    // FALLTHROUGH
+  case HttpTransact::SERVE_FROM_CACHE:
+    {
+      if (t_state.next_action == HttpTransact::SERVE_FROM_CACHE &&
+          t_state.cache_info.action == HttpTransact::CACHE_DO_SERVE_AND_UPDATE) {
+        // Revalidated, update the cached headers
+        perform_cache_write_action();
+        cb_event = HTTP_SCH_UPDATE_EVENT_UPDATED;
+        terminate_sm = true;
+        return;
+      }
+    }
+    // FALLTHROUGH
+  case HttpTransact::PROXY_INTERNAL_CACHE_WRITE:
   case HttpTransact::PROXY_INTERNAL_CACHE_NOOP:
   case HttpTransact::PROXY_SEND_ERROR_CACHE_NOOP:
-  case HttpTransact::SERVE_FROM_CACHE:
     {
       cb_event = HTTP_SCH_UPDATE_EVENT_NOT_CACHED;
       t_state.squid_codes.log_code = SQUID_LOG_TCP_MISS;
@@ -215,6 +345,12 @@ HttpUpdateSM::kill_this_async_hook(int event, void *data)
   NOWARN_UNUSED(data);
   STATE_ENTER(&HttpUpdateSM::user_cb_handler, event, data);
 
+  // A background revalidation has nobody to report to
+  if (cb_cont == NULL) {
+    cb_occured = true;
+    return HttpSM::kill_this_async_hook(EVENT_NONE, NULL);
+  }
+
   MUTEX_TRY_LOCK(lock, cb_action.mutex, this_ethread());
 
   if (!lock) {
@@ -58,11 +58,20 @@ public:
 
   Action *start_scheduled_update(Continuation * cont, HTTPHdr * req);
 
+  /** Revalidate the cached object that the transaction @a s is serving
+      stale (RFC 5861 stale-while-revalidate), without a client. Only one
+      background revalidation runs for a URL at a time.
+
+      @return @c false if one is already running for the URL.
+   */
+  static bool start_background_revalidation(HttpTransact::State * s);
+
 //  private:
   bool cb_occured;
   Continuation *cb_cont;
   Action cb_action;
   int cb_event;
+  char *revalidate_key;         // cache lookup URL of a background revalidation
 
 protected:
   void handle_api_return();
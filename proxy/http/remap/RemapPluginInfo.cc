@@ -41,6 +41,13 @@ remap_plugin_info::~remap_plugin_info()
 }
 
 
+remap_plugin_instance::~remap_plugin_instance()
+{
+  if (ih && plugin && plugin->fp_tsremap_delete_instance)
+    plugin->fp_tsremap_delete_instance(ih);
+}
+
+
 //
 // Find a plugin by path from our linked list
 //
@@ -83,6 +83,24 @@ public:
 };
 
 
+/**
+ * One instance of a remap plugin, created for a remap rule. A rule that
+ * is the same in two loads of remap.config keeps its instance, so the
+ * url_mappings of both loads share it, and the last one to go deletes it.
+**/
+class remap_plugin_instance: public RefCountObj
+{
+public:
+  remap_plugin_instance(remap_plugin_info *_plugin, void *_ih)
+    : plugin(_plugin), ih(_ih)
+  { }
+  ~remap_plugin_instance();
+
+  remap_plugin_info *plugin;
+  void *ih;
+};
+
+
 /**
  * struct host_hdr_info;
  * Used to store info about host header
@@ -62,6 +62,7 @@ url_mapping::url_mapping(int rank /* = 0 */)
     cache_url_convert_plugin_count(0),
     regex_type(REGEX_TYPE_NONE),
     overridableHttpConfig(NULL), cacheControlConfig(NULL),
+    traffic_stats_slot(0),
     _needCheckRefererHost(false),
     _aclMethodIpCheckListCount(0), _aclRefererCheckListCount(0),
     _rawFromUrlStr(NULL), _rawToUrlStr(NULL),
@@ -118,21 +119,40 @@ url_mapping::~url_mapping()
 **/
 bool
 url_mapping::add_plugin(remap_plugin_info* i, void* ih)
+{
+  return add_plugin(NEW(new remap_plugin_instance(i, ih)));
+}
+
+bool
+url_mapping::add_plugin(remap_plugin_instance *instance)
 {
   if (plugin_count >= MAX_REMAP_PLUGIN_CHAIN)
     return false;
 
-  _plugin_list[plugin_count] = i;
-  _instance_data[plugin_count] = ih;
+  _plugin_list[plugin_count] = instance->plugin;
+  _instance_data[plugin_count] = instance->ih;
+  _instances[plugin_count] = instance;
   ++plugin_count;
 
-  if (i->fp_tsremap_convert_cache_url != NULL) {
+  if (instance->plugin->fp_tsremap_convert_cache_url != NULL) {
     ++cache_url_convert_plugin_count;
   }
 
   return true;
 }
 
+/**
+  Use the plugin instances of a mapping of the same rule, from a previous
+  load of remap.config, instead of creating new ones.
+**/
+void
+url_mapping::share_plugins(const url_mapping *other)
+{
+  for (unsigned int i = 0; i < other->plugin_count; ++i) {
+    add_plugin(other->_instances[i]);
+  }
+}
+
 
 /**
  *
@@ -230,11 +250,9 @@ int url_mapping::setRefererCheckLists(ACLRefererCheckList **checkLists,
 void
 url_mapping::delete_instance(unsigned int index)
 {
-  void *ih = get_instance(index);
-  remap_plugin_info* p = get_plugin(index);
-
-  if (ih && p && p->fp_tsremap_delete_instance)
-    p->fp_tsremap_delete_instance(ih);
+  // deleted with the last mapping that has it
+  _instances[index] = NULL;
+  _instance_data[index] = NULL;
 }
 
 void
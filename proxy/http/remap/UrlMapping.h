@@ -141,14 +141,25 @@ extern int cluster_active_machine_count;
 
 /**
  * Used to store the mapping for class UrlRewrite
+ *
+ * A mapping is reference counted: the lookup structures of a UrlRewrite
+ * each hold a reference, and a rule that didn't change across a reload of
+ * remap.config is in the tables of both loads.
 **/
-class url_mapping
+class url_mapping: public RefCountObj
 {
 public:
   url_mapping(int rank = 0);
   ~url_mapping();
 
+  static inline void release(url_mapping *mapping) {
+    if (mapping->refcount_dec() == 0)
+      delete mapping;
+  }
+
   bool add_plugin(remap_plugin_info *i, void* ih);
+  bool add_plugin(remap_plugin_instance *instance);
+  void share_plugins(const url_mapping *other);
   remap_plugin_info *get_plugin(unsigned int) const;
 
   inline void* get_instance(unsigned int index) const { return _instance_data[index]; };
@@ -292,9 +303,9 @@ public:
   unsigned int cache_url_convert_plugin_count;
   int regex_type;
   ClientControlStat clientControlStat;
-  LINK(url_mapping, link); // For use with the main Queue linked list holding all the mapping
   OverridableHttpConfigParams *overridableHttpConfig;
   CacheControlConfig *cacheControlConfig;
+  int traffic_stats_slot;       // slot in http_remap_traffic_stats
 
 private:
   int urlWhack(char *toWhack, const int url_len);
@@ -307,6 +318,7 @@ private:
 
   remap_plugin_info* _plugin_list[MAX_REMAP_PLUGIN_CHAIN];
   void* _instance_data[MAX_REMAP_PLUGIN_CHAIN];
+  Ptr<remap_plugin_instance> _instances[MAX_REMAP_PLUGIN_CHAIN];
   char *_rawFromUrlStr;
   char *_rawToUrlStr;
   int _rawFromUrlLen;
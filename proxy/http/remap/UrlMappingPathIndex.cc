@@ -24,6 +24,8 @@
 
 UrlMappingPathIndex::~UrlMappingPathIndex()
 {
+  for (int i = 0; i < _mappings.n; ++i)
+    url_mapping::release(_mappings[i]);
 }
 
 bool
@@ -37,6 +39,8 @@ UrlMappingPathIndex::Insert(url_mapping *mapping)
     Error("Couldn't insert into trie!");
     return false;
   }
+  mapping->refcount_inc();
+  _mappings.add(mapping);
   Debug("UrlMappingPathIndex::Insert", "Inserted new element!");
   return true;
 }
@@ -49,6 +49,7 @@ public:
 
 private:
   Trie<url_mapping> _trie;
+  Vec<url_mapping *> _mappings; // a reference on each
 
   // make copy-constructor and assignment operator private
   // till we properly implement them
@@ -5,9 +5,12 @@
 #include "UrlMappingRegexMatcher.h"
 
 UrlMappingRegexMatcher::UrlMappingRegexMatcher(url_mapping *mapping) :
-  re(NULL), re_extra(NULL), to_template(NULL), to_template_len(0),
-  n_substitutions(0), url_map(mapping)
+  literal_id(-1), re(NULL), re_extra(NULL), to_template(NULL), to_template_len(0),
+  n_substitutions(0), literal(NULL), url_map(mapping)
 {
+  if (this->url_map != NULL) {
+    this->url_map->refcount_inc();
+  }
 }
 
 UrlMappingRegexMatcher::~UrlMappingRegexMatcher()
@@ -25,8 +28,12 @@ UrlMappingRegexMatcher::~UrlMappingRegexMatcher()
     this->to_template = NULL;
     this->to_template_len = 0;
   }
+  if (this->literal != NULL) {
+    ats_free(this->literal);
+    this->literal = NULL;
+  }
   if (this->url_map != NULL) {
-    delete this->url_map;
+    url_mapping::release(this->url_map);
     this->url_map = NULL;
   }
 }
@@ -108,11 +115,53 @@ UrlMappingRegexMatcher::init(const char *pattern, const char *to_str, const int
     this->to_template_len = to_len;
     this->to_template = static_cast<char *>(ats_malloc(this->to_template_len));
     memcpy(this->to_template, to_str, this->to_template_len);
+
+    char literal_buf[256];
+    if (regex_required_literal(pattern, literal_buf, sizeof(literal_buf)) > 0) {
+      this->literal = ats_strdup(literal_buf);
+      Debug("url_rewrite_regex", "Regex [%s] requires [%s]", pattern, this->literal);
+    }
   }
 
   return result;
 }
 
+void
+UrlMappingRegexPrefilter::build(UrlMappingRegexList &regex_list)
+{
+  int n = 0;
+
+  forl_LL(UrlMappingRegexMatcher, list_iter, regex_list) {
+    n++;
+  }
+
+  const char **host_patterns = static_cast<const char **>(ats_malloc((n + 1) * sizeof(char *)));
+  const char **url_patterns = static_cast<const char **>(ats_malloc((n + 1) * sizeof(char *)));
+
+  this->n_host_literals = this->n_url_literals = 0;
+  forl_LL(UrlMappingRegexMatcher, list_iter, regex_list) {
+    const char *literal = list_iter->getLiteral();
+
+    if (literal == NULL) {
+      list_iter->literal_id = -1;
+    } else if (list_iter->getMapping()->regex_type == REGEX_TYPE_HOST) {
+      list_iter->literal_id = this->n_host_literals;
+      host_patterns[this->n_host_literals++] = literal;
+    } else {
+      list_iter->literal_id = this->n_url_literals;
+      url_patterns[this->n_url_literals++] = literal;
+    }
+  }
+
+  this->host_literals.compile(host_patterns, this->n_host_literals);
+  this->url_literals.compile(url_patterns, this->n_url_literals);
+  Debug("url_rewrite_regex", "Prefilter for %d regexes: %d host literals, %d url literals",
+        n, this->n_host_literals, this->n_url_literals);
+
+  ats_free(host_patterns);
+  ats_free(url_patterns);
+}
+
 #define CHECK_BUFFER_SIZE(bytes) \
   do { \
     if ((cur_buf_size + bytes) > out_size) { \
@@ -3,6 +3,7 @@
 #define _URL_MAPPING_REGEX_MATCHER
 
 #include "UrlMapping.h"
+#include "AhoCorasick.h"
 
 class UrlMappingRegexMatcher
 {
@@ -21,6 +22,14 @@ class UrlMappingRegexMatcher
     int match(const char *input, const int input_len,
         char *output, const int out_size, int *out_len);
 
+    // a string every match contains, or NULL
+    inline const char *getLiteral() const {
+      return this->literal;
+    }
+
+    // the literal's index in UrlMappingRegexPrefilter, or -1
+    int literal_id;
+
     LINK(UrlMappingRegexMatcher, link);
 
   private:
@@ -45,10 +54,44 @@ class UrlMappingRegexMatcher
     int substitution_markers[MAX_REGEX_SUBS];
     int substitution_ids[MAX_REGEX_SUBS];
 
+    char *literal;
+
     url_mapping *url_map;
 };
 
 typedef Queue<UrlMappingRegexMatcher> UrlMappingRegexList;
 
+/**
+ * Looks for the literals of all the regexes of a list in one pass over
+ * the host or the url, before any of them are run. A regex whose literal
+ * is not there can't match, so the lookup only runs pcre_exec on the
+ * others, still in rule order.
+ */
+class UrlMappingRegexPrefilter
+{
+  public:
+    UrlMappingRegexPrefilter() : n_host_literals(0), n_url_literals(0) { }
+
+    // sets literal_id of the regexes in the list
+    void build(UrlMappingRegexList &regex_list);
+
+    // found[literal_id] is set to 1 for each literal in the input
+    inline void scanHost(const char *host, const int host_len, uint8_t *found) const {
+      memset(found, 0, this->n_host_literals);
+      this->host_literals.match_all(host, host_len, found);
+    }
+    inline void scanUrl(const char *url, const int url_len, uint8_t *found) const {
+      memset(found, 0, this->n_url_literals);
+      this->url_literals.match_all(url, url_len, found);
+    }
+
+    int n_host_literals;
+    int n_url_literals;
+
+  private:
+    AhoCorasick host_literals;
+    AhoCorasick url_literals;
+};
+
 #endif
 
@@ -39,6 +39,7 @@
 #include "ACLDefineManager.h"
 #include "ACLCheckList.h"
 #include "MappingManager.h"
+#include "HttpTrafficStats.h"
 
 #include "ink_string.h"
 
@@ -95,17 +96,99 @@ get_real_path(const char *lpath, char *buf, int bufsize)
   return rsize;
 }
 
+static bool
+append_key_part(StringBuffer *key, const char *str, const int len)
+{
+  if (key->checkSize(len + 1) != 0) {
+    return false;
+  }
+  memcpy(key->str + key->length, str, len);
+  key->length += len;
+  key->str[key->length++] = '\n';  // can't be in a config line
+  return true;
+}
+
+/**
+  Puts in key what a rule is made of: its type, flags, urls, plugins and
+  configs. Rules with the same key are built the same way, so a rule can
+  use the mapping of the same rule from the previous load of remap.config.
+  Returns false for a rule that can't.
+
+*/
+static bool
+get_mapping_key(const MappingEntry *entry, const int maptype,
+    const int incremental_reload, StringBuffer *key)
+{
+  char buf[64];
+  const DynamicArray<PluginInfo> *plugins = entry->getPlugins();
+  const DynamicArray<ConfigKeyValue> *configs = entry->getConfigs();
+
+  // The ACL check lists of a rule belong to the acl defines of one load
+  if (entry->getACLMethodIpCheckLists()->count > 0 ||
+      entry->getACLRefererCheckLists()->count > 0)
+  {
+    return false;
+  }
+  // A plugin instance only rereads its own config files when it is created
+  if (plugins->count > 0 && incremental_reload < 2) {
+    return false;
+  }
+
+  key->length = 0;
+  snprintf(buf, sizeof(buf), "%d %d", maptype, entry->getFlags());
+  if (!append_key_part(key, buf, strlen(buf)) ||
+      !append_key_part(key, entry->getFromUrl()->str, entry->getFromUrl()->length) ||
+      !append_key_part(key, entry->getToUrl()->str, entry->getToUrl()->length))
+  {
+    return false;
+  }
+
+  for (int i=0; i<plugins->count; i++) {
+    const PluginInfo *plugin = plugins->items + i;
+
+    snprintf(buf, sizeof(buf), "plugin %d", plugin->paramCount);
+    if (!append_key_part(key, buf, strlen(buf)) ||
+        !append_key_part(key, plugin->filename.str, plugin->filename.length))
+    {
+      return false;
+    }
+    for (int k=0; k<plugin->paramCount; k++) {
+      if (!append_key_part(key, plugin->params[k].str, plugin->params[k].length)) {
+        return false;
+      }
+    }
+  }
+
+  for (int i=0; i<CONFIG_TYPE_COUNT; i++) {
+    snprintf(buf, sizeof(buf), "config %d %d", i, configs[i].count);
+    if (!append_key_part(key, buf, strlen(buf))) {
+      return false;
+    }
+    for (int k=0; k<configs[i].count; k++) {
+      if (!append_key_part(key, configs[i].items[k].key.str, configs[i].items[k].key.length) ||
+          !append_key_part(key, configs[i].items[k].value.str, configs[i].items[k].value.length))
+      {
+        return false;
+      }
+    }
+  }
+
+  key->str[key->length - 1] = '\0';
+  return true;
+}
+
 //
 // CTOR / DTOR for the UrlRewrite class.
 //
-UrlRewrite::UrlRewrite(const char *file_var_in)
+UrlRewrite::UrlRewrite(const char *file_var_in, const UrlRewrite *previous, const char *test_path)
  : nohost_rules(0), reverse_proxy(0), backdoor_enabled(0),
    mgmt_autoconf_port(0), default_to_pac(0), default_to_pac_port(0),
+   incremental_reload(0),
    file_var(NULL), ts_name(NULL), http_default_redirect_url(NULL),
    num_rules_forward(0), num_rules_reverse(0),
    num_rules_redirect_permanent(0), num_rules_redirect_temporary(0),
    num_rules_forward_with_recv_port(0), _valid(false),
-   _oldDefineCheckers(NULL)
+   _oldDefineCheckers(NULL), _mapping_index(NULL), _previous(NULL)
 {
   char *config_file = NULL;
 
@@ -143,13 +226,27 @@ UrlRewrite::UrlRewrite(const char *file_var_in)
   REVERSE_ReadConfigInteger(default_to_pac_port, "proxy.config.url_remap.default_to_server_pac_port");
   REVERSE_ReadConfigInteger(url_remap_mode, "proxy.config.url_remap.url_remap_mode");
   REVERSE_ReadConfigInteger(backdoor_enabled, "proxy.config.url_remap.handle_backdoor_urls");
+  REVERSE_ReadConfigInteger(incremental_reload, "proxy.config.url_remap.incremental_reload");
+
+  if (incremental_reload > 0) {
+    _mapping_index = ink_hash_table_create(InkHashTableKeyType_String);
+    if (previous != NULL && previous->_mapping_index != NULL) {
+      _previous = previous;
+    }
+  }
 
-  ink_strlcpy(config_file_path, system_config_directory, sizeof(config_file_path));
-  ink_strlcat(config_file_path, "/", sizeof(config_file_path));
-  ink_strlcat(config_file_path, config_file, sizeof(config_file_path));
+  if (test_path != NULL) {
+    ink_strlcpy(config_file_path, test_path, sizeof(config_file_path));
+  } else {
+    ink_strlcpy(config_file_path, system_config_directory, sizeof(config_file_path));
+    ink_strlcat(config_file_path, "/", sizeof(config_file_path));
+    ink_strlcat(config_file_path, config_file, sizeof(config_file_path));
+  }
   ats_free(config_file);
 
-  if (0 == this->BuildTable()) {
+  int result = this->BuildTable();
+  _previous = NULL;  // only used while building
+  if (0 == result) {
     _valid = true;
     /*
     pcre_malloc = &ats_malloc;
@@ -180,6 +277,10 @@ UrlRewrite::~UrlRewrite()
 
   ACLDefineManager::freeDefineCheckers(_oldDefineCheckers);
 
+  if (_mapping_index != NULL) {
+    ink_hash_table_destroy(_mapping_index);
+  }
+
   _valid = false;
 }
 
@@ -932,8 +1033,13 @@ UrlRewrite::BuildTable()
   char *fromHost_lower_ptr = NULL;
   char fromHost_lower_buf[1024];
   url_mapping *new_mapping = NULL;
+  url_mapping *old_mapping;
   mapping_type maptype;
   bool add_result;
+  bool shared;
+  StringBuffer mapping_key;
+  int num_shared = 0;
+  int num_shared_plugins = 0;
 
   ink_assert(forward_mappings.empty());
   ink_assert(reverse_mappings.empty());
@@ -1032,7 +1138,39 @@ UrlRewrite::BuildTable()
       }
     }
 
+    // Look for the same rule in the previous load. Its mapping is used as
+    // is when it has the same rank and needs no per table setup, else we
+    // at least keep its plugin instances.
+    old_mapping = NULL;
+    mapping_key.length = 0;
+    if (_mapping_index != NULL) {
+      if (!get_mapping_key(mappingEntry, maptype, incremental_reload, &mapping_key)) {
+        mapping_key.length = 0;
+      } else if (ink_hash_table_isbound(_mapping_index, mapping_key.str)) {
+        mapping_key.length = 0;  // the same rule twice, the first one is indexed
+      } else if (_previous != NULL) {
+        ink_hash_table_lookup(_previous->_mapping_index, mapping_key.str, (void **) &old_mapping);
+      }
+    }
+
+    shared = (old_mapping != NULL && old_mapping->getRank() == mappingEntry->getRank() &&
+              old_mapping->regex_type == REGEX_TYPE_NONE);
+    if (shared) {
+      new_mapping = old_mapping;
+      new_mapping->refcount_inc();
+      ++num_shared;
+
+      fromScheme = new_mapping->fromURL.scheme_get(&fromSchemeLen);
+      fromHost = new_mapping->fromURL.host_get(&fromHostLen);
+      if (fromHost == NULL || fromHostLen <= 0) {
+        fromHost = "";
+        fromHostLen = 0;
+      }
+      goto MAP_SHARED;
+    }
+
     new_mapping = NEW(new url_mapping(mappingEntry->getRank()));  // use line # for rank for now
+    new_mapping->refcount_inc();  // ours until it is in the lookup tables
 
     new_mapping->regex_type = 0;
     if ((mappingFlags & MAPPING_FLAG_HOST_REGEX) != 0) {
@@ -1139,6 +1277,7 @@ UrlRewrite::BuildTable()
     // been removed.
 
 
+  MAP_SHARED:
     if (unlikely(fromHostLen >= (int) sizeof(fromHost_lower_buf))) {
       fromHost_lower = (fromHost_lower_ptr = (char *)ats_malloc(fromHostLen + 1));
     } else {
@@ -1150,7 +1289,9 @@ UrlRewrite::BuildTable()
     LowerCaseStr(fromHost_lower);
 
     // set the normalized string so nobody else has to normalize this
-    new_mapping->fromURL.host_set(fromHost_lower, fromHostLen);
+    if (!shared) {
+      new_mapping->fromURL.host_set(fromHost_lower, fromHostLen);
+    }
 
     // If a TS receives a request on a port which is set to tunnel mode
     // (ie, blind forwarding) and a client connects directly to the TS,
@@ -1192,7 +1333,10 @@ UrlRewrite::BuildTable()
       }
     }
 
-    if ((maptype == FORWARD_MAP || maptype == FORWARD_MAP_WITH_RECV_PORT)) {
+    if (!shared && old_mapping != NULL && old_mapping->plugin_count > 0) {
+      new_mapping->share_plugins(old_mapping);
+      ++num_shared_plugins;
+    } else if (!shared && (maptype == FORWARD_MAP || maptype == FORWARD_MAP_WITH_RECV_PORT)) {
       const DynamicArray<PluginInfo> *plugins = mappingEntry->getPlugins();
       for (int k=0; k<plugins->count; k++) {
         if (load_remap_plugin(plugins->items + k, mappingEntry,
@@ -1211,7 +1355,7 @@ UrlRewrite::BuildTable()
       case FORWARD_MAP:
       case FORWARD_MAP_REFERER:
         if ((add_result = _addToStore(forward_mappings, new_mapping, fromHost_lower,
-                num_rules_forward)) == true) {
+                num_rules_forward)) == true && !shared) {
           // @todo: is this applicable to regex mapping too?
           SetHomePageRedirectFlag(new_mapping, new_mapping->toUrl);
         }
@@ -1219,7 +1363,9 @@ UrlRewrite::BuildTable()
       case REVERSE_MAP:
         add_result = _addToStore(reverse_mappings, new_mapping, fromHost_lower,
             num_rules_reverse);
-        new_mapping->homePageRedirect = false;
+        if (!shared) {
+          new_mapping->homePageRedirect = false;
+        }
         break;
       case PERMANENT_REDIRECT:
         add_result = _addToStore(permanent_redirects, new_mapping, fromHost_lower,
@@ -1245,25 +1391,42 @@ UrlRewrite::BuildTable()
 
     fromHost_lower_ptr = (char *)ats_free_null(fromHost_lower_ptr);
 
-    if (!_getRecordsConfig(new_mapping, mappingEntry->getConfigs() +
-          CONFIG_TYPE_RECORDS_INDEX, httpConfig))
-    {
-      errStr = "Load records config fail";
-      goto MAP_ERROR;
-    }
+    if (!shared) {
+      if (!_getRecordsConfig(new_mapping, mappingEntry->getConfigs() +
+            CONFIG_TYPE_RECORDS_INDEX, httpConfig))
+      {
+        errStr = "Load records config fail";
+        goto MAP_ERROR;
+      }
 
-    if (!_getCacheConfig(new_mapping, mappingEntry->getConfigs() +
-          CONFIG_TYPE_CACHE_INDEX))
-    {
-      errStr = "Load cache config fail";
-      goto MAP_ERROR;
+      if (!_getCacheConfig(new_mapping, mappingEntry->getConfigs() +
+            CONFIG_TYPE_CACHE_INDEX))
+      {
+        errStr = "Load cache config fail";
+        goto MAP_ERROR;
+      }
+
+      // keyed on the rule's from url, so a rule keeps its stats across reloads
+      if (maptype == FORWARD_MAP || maptype == FORWARD_MAP_REFERER ||
+          maptype == FORWARD_MAP_WITH_RECV_PORT)
+      {
+        new_mapping->traffic_stats_slot = http_remap_traffic_stats.lookup(
+            mappingEntry->getFromUrl()->str, mappingEntry->getFromUrl()->length);
+      }
     }
 
+    // for the next load to find
+    if (mapping_key.length > 0) {
+      ink_hash_table_insert(_mapping_index, mapping_key.str, new_mapping);
+    }
+    url_mapping::release(new_mapping);  // the lookup tables have it now
     continue;
 
     // Deal with error / warning scenarios
   MAP_ERROR:
     HttpConfig::release(httpConfig);
+    url_mapping::release(new_mapping);
+    free(mapping_key.str);
     Warning("Could not add rule at config file %s line #%d; Aborting!",
         mappingEntry->getFilename(), mappingEntry->getLineNo());
     snprintf(errBuf, sizeof(errBuf), "%s %s at config file %s line #%d",
@@ -1274,6 +1437,18 @@ UrlRewrite::BuildTable()
   }
 
   HttpConfig::release(httpConfig);
+  free(mapping_key.str);
+
+  if (_previous != NULL) {
+    Debug("url_rewrite", "[BuildTable] %d rules shared with the previous load, %d more share its plugin instances",
+          num_shared, num_shared_plugins);
+  }
+
+  forward_mappings.regex_prefilter.build(forward_mappings.regex_list);
+  reverse_mappings.regex_prefilter.build(reverse_mappings.regex_list);
+  permanent_redirects.regex_prefilter.build(permanent_redirects.regex_list);
+  temporary_redirects.regex_prefilter.build(temporary_redirects.regex_list);
+  forward_mappings_with_recv_port.regex_prefilter.build(forward_mappings_with_recv_port.regex_list);
 
   // Add the mapping for backdoor urls if enabled.
   // This needs to be before the default PAC mapping for ""
@@ -1564,7 +1739,7 @@ UrlRewrite::_mappingLookup(MappingsStore &mappings, URL *request_url,
 
   if (!mappings.regex_list.empty() && (rank_ceiling < 0 ||
         rank_ceiling > mappings.regex_list_min_rank) &&
-      _regexMappingLookup(mappings.regex_list, request_url, request_port,
+      _regexMappingLookup(mappings.regex_list, mappings.regex_prefilter, request_url, request_port,
         request_host_lower, request_host_len, rank_ceiling,
         mapping_container))
   {
@@ -1667,7 +1842,8 @@ UrlRewrite::_suffixMappingLookup(HostnameTrie<SuffixMappings> *suffix_trie,
 }
 
 bool
-UrlRewrite::_regexMappingLookup(UrlMappingRegexList &regex_mappings, URL *request_url, int request_port,
+UrlRewrite::_regexMappingLookup(UrlMappingRegexList &regex_mappings, const UrlMappingRegexPrefilter &prefilter,
+                                URL *request_url, int request_port,
                                 const char *request_host, int request_host_len, int rank_ceiling,
                                 UrlMappingContainer &mapping_container)
 {
@@ -1702,6 +1878,10 @@ UrlRewrite::_regexMappingLookup(UrlMappingRegexList &regex_mappings, URL *reques
   int new_url_len;
   int match_result;
   int query_len = -1;
+  // the literals the regexes need, found in one pass per input on first use
+  uint8_t *host_literals_found = NULL;
+  uint8_t *url_without_port_literals_found = NULL;
+  uint8_t *url_with_port_literals_found = NULL;
 
   // Loop over the entire linked list, or until we're satisfied
   forl_LL(UrlMappingRegexMatcher, list_iter, regex_mappings) {
@@ -1742,6 +1922,16 @@ UrlRewrite::_regexMappingLookup(UrlMappingRegexList &regex_mappings, URL *reques
         continue;
       }
 
+      if (list_iter->literal_id >= 0) {
+        if (host_literals_found == NULL) {
+          host_literals_found = (uint8_t *)alloca(prefilter.n_host_literals);
+          prefilter.scanHost(request_host, request_host_len, host_literals_found);
+        }
+        if (!host_literals_found[list_iter->literal_id]) {
+          continue;
+        }
+      }
+
       if ((match_result=list_iter->match(request_host, request_host_len, new_host,
               sizeof(new_host), &new_host_len)) > 0)
       {
@@ -1782,6 +1972,16 @@ UrlRewrite::_regexMappingLookup(UrlMappingRegexList &regex_mappings, URL *reques
 
         req_url_str = req_url_without_port;
         input_url_len = req_url_without_port_len;
+
+        if (list_iter->literal_id >= 0) {
+          if (url_without_port_literals_found == NULL) {
+            url_without_port_literals_found = (uint8_t *)alloca(prefilter.n_url_literals);
+            prefilter.scanUrl(req_url_str, input_url_len, url_without_port_literals_found);
+          }
+          if (!url_without_port_literals_found[list_iter->literal_id]) {
+            continue;
+          }
+        }
       }
       else {
         if (req_url_with_port_len < 0) {  //lazy load
@@ -1794,6 +1994,16 @@ UrlRewrite::_regexMappingLookup(UrlMappingRegexList &regex_mappings, URL *reques
 
         req_url_str = req_url_with_port;
         input_url_len = req_url_with_port_len;
+
+        if (list_iter->literal_id >= 0) {
+          if (url_with_port_literals_found == NULL) {
+            url_with_port_literals_found = (uint8_t *)alloca(prefilter.n_url_literals);
+            prefilter.scanUrl(req_url_str, input_url_len, url_with_port_literals_found);
+          }
+          if (!url_with_port_literals_found[list_iter->literal_id]) {
+            continue;
+          }
+        }
       }
 
       if ((match_result=list_iter->match(req_url_str, input_url_len, new_url,
@@ -1990,3 +2200,182 @@ inline int UrlRewrite::_getHostnameKey(URL *url, const char *src_host,
        request_port, url->scheme_get_wksidx());
 }
 
+
+#if TS_HAS_TESTS
+#include "ts/TestBox.h"
+
+// A remap plugin that is not a shared object, counting its instances
+static int test_plugin_new_instances = 0;
+static int test_plugin_delete_instances = 0;
+
+static TSReturnCode
+test_plugin_new_instance(int argc, char *argv[], void **ih, char *errbuf, int errbuf_size)
+{
+  NOWARN_UNUSED(errbuf);
+  NOWARN_UNUSED(errbuf_size);
+  *ih = ats_strdup(argv[argc - 1]);
+  ++test_plugin_new_instances;
+  return TS_SUCCESS;
+}
+
+static void
+test_plugin_delete_instance(void *ih)
+{
+  ats_free(ih);
+  ++test_plugin_delete_instances;
+}
+
+static bool
+test_write_remap(const char *path, const char *plugin, const char **rules, int n_rules)
+{
+  FILE *fp;
+
+  if ((fp = fopen(path, "w")) == NULL) {
+    return false;
+  }
+  for (int i = 0; i < n_rules; ++i) {
+    fprintf(fp, rules[i], plugin);
+    fputc('\n', fp);
+  }
+  return fclose(fp) == 0;
+}
+
+static url_mapping *
+test_find_mapping(UrlRewrite *table, const char *url)
+{
+  UrlMappingContainer container;
+  url_mapping *mapping = NULL;
+  const char *host;
+  int host_len;
+  URL request;
+
+  request.create(NULL);
+  request.parse(url, strlen(url));
+  host = request.host_get(&host_len);
+  if (table->forwardMappingLookup(&request, 0, host, host_len, container)) {
+    mapping = container.getMapping();
+  }
+  request.destroy();
+  return mapping;
+}
+
+REGRESSION_TEST(UrlRewrite_IncrementalReload)(RegressionTest *t, int atype, int *pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  // %s is the plugin. The second load changes the parameter of the
+  // "changed" rule and moves the "moved" rule down by one.
+  const char *first_rules[] = {
+    "map http://same.example.com/ http://origin.example.com/same/ {\n  plugin %s same\n}",
+    "map http://changed.example.com/ http://origin.example.com/changed/ {\n  plugin %s before\n}",
+    "map http://moved.example.com/ http://origin.example.com/moved/ {\n  plugin %s moved\n}"
+  };
+  const char *second_rules[] = {
+    "map http://same.example.com/ http://origin.example.com/same/ {\n  plugin %s same\n}",
+    "map http://changed.example.com/ http://origin.example.com/changed/ {\n  plugin %s after\n}",
+    "map http://new.example.com/ http://origin.example.com/new/",
+    "map http://moved.example.com/ http://origin.example.com/moved/ {\n  plugin %s moved\n}"
+  };
+  char path[] = "/tmp/remap_configXXXXXX";
+  RecInt incremental_reload = 1;
+  remap_plugin_info *pi, *p;
+  UrlRewrite *first = NULL, *second = NULL;
+  url_mapping *same, *changed, *moved, *second_changed, *second_moved;
+  void *same_ih, *moved_ih;
+  int fd;
+
+  box = REGRESSION_TEST_PASSED;
+
+  if ((fd = mkstemp(path)) < 0) {
+    box.check(false, "can't create %s: %s", path, strerror(errno));
+    return;
+  }
+  close(fd);
+
+  // the config file stands in for the plugin's shared object, it only has to exist
+  pi = NEW(new remap_plugin_info(path));
+  pi->dlh = pi;
+  pi->fp_tsremap_new_instance = test_plugin_new_instance;
+  pi->fp_tsremap_delete_instance = test_plugin_delete_instance;
+  if (UrlRewrite::remap_pi_list == NULL) {
+    UrlRewrite::remap_pi_list = pi;
+  } else {
+    UrlRewrite::remap_pi_list->add_to_list(pi);
+  }
+
+  RecGetRecordInt("proxy.config.url_remap.incremental_reload", &incremental_reload);
+  RecSetRecordInt("proxy.config.url_remap.incremental_reload", 2);
+  test_plugin_new_instances = test_plugin_delete_instances = 0;
+
+  if (!box.check(test_write_remap(path, path, first_rules, sizeof(first_rules) / sizeof(first_rules[0])), "can't write %s", path)) {
+    goto Ldone;
+  }
+  first = NEW(new UrlRewrite("proxy.config.url_remap.filename", NULL, path));
+  if (!box.check(first->is_valid(), "first load failed")) {
+    goto Ldone;
+  }
+  box.check(test_plugin_new_instances == 3, "%d plugin instances for 3 rules", test_plugin_new_instances);
+
+  same = test_find_mapping(first, "http://same.example.com/");
+  changed = test_find_mapping(first, "http://changed.example.com/");
+  moved = test_find_mapping(first, "http://moved.example.com/");
+  if (!box.check(same && changed && moved, "a rule of the first load is missing")) {
+    goto Ldone;
+  }
+  same_ih = same->get_instance(0);
+  moved_ih = moved->get_instance(0);
+
+  if (!box.check(test_write_remap(path, path, second_rules, sizeof(second_rules) / sizeof(second_rules[0])), "can't write %s", path)) {
+    goto Ldone;
+  }
+  second = NEW(new UrlRewrite("proxy.config.url_remap.filename", first, path));
+  if (!box.check(second->is_valid(), "second load failed")) {
+    goto Ldone;
+  }
+  box.check(test_plugin_new_instances == 4, "%d plugin instances, only the changed rule needs a new one",
+            test_plugin_new_instances);
+
+  box.check(test_find_mapping(second, "http://same.example.com/") == same, "the unchanged rule is not shared");
+  box.check(test_find_mapping(second, "http://changed.example.com/") != changed, "the changed rule is shared");
+  box.check(test_find_mapping(second, "http://new.example.com/") != NULL, "the new rule is missing");
+
+  second_moved = test_find_mapping(second, "http://moved.example.com/");
+  second_changed = test_find_mapping(second, "http://changed.example.com/");
+  if (box.check(second_moved != NULL && second_moved != moved, "the moved rule has the old rank")) {
+    box.check(second_moved->get_instance(0) == moved_ih, "the moved rule has a new plugin instance");
+  }
+  if (box.check(second_changed != NULL, "the changed rule is missing")) {
+    box.check(second_changed->get_instance(0) != changed->get_instance(0), "the changed rule kept its plugin instance");
+  }
+
+  // as when the freer continuation runs, the second table still in use
+  delete first;
+  first = NULL;
+  box.check(test_plugin_delete_instances == 1, "%d plugin instances deleted with the first table, expected 1",
+            test_plugin_delete_instances);
+  box.check(same->refcount() > 0 && same->get_instance(0) == same_ih, "the shared mapping was freed");
+  box.check(test_find_mapping(second, "http://same.example.com/") == same, "the shared mapping is gone");
+  box.check(second_moved == NULL || second_moved->get_instance(0) == moved_ih, "the moved rule lost its instance");
+
+  delete second;
+  second = NULL;
+  box.check(test_plugin_delete_instances == 4, "%d of 4 plugin instances deleted", test_plugin_delete_instances);
+
+Ldone:
+  delete second;
+  delete first;
+  RecSetRecordInt("proxy.config.url_remap.incremental_reload", incremental_reload);
+
+  if (UrlRewrite::remap_pi_list == pi) {
+    UrlRewrite::remap_pi_list = pi->next;
+  } else {
+    for (p = UrlRewrite::remap_pi_list; p->next != pi; p = p->next)
+      ;
+    p->next = pi->next;
+  }
+  pi->dlh = NULL;
+  delete pi;
+  unlink(path);
+}
+
+#endif // TS_HAS_TESTS
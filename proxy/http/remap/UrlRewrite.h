@@ -64,7 +64,9 @@ enum mapping_type
 class UrlRewrite
 {
 public:
-  UrlRewrite(const char *file_var_in);
+  // test_path is for the regression tests: the remap file to read
+  // instead of the one file_var_in names.
+  UrlRewrite(const char *file_var_in, const UrlRewrite *previous = NULL, const char *test_path = NULL);
   ~UrlRewrite();
   int BuildTable();
   mapping_type Remap_redirect(HTTPHdr * request_header, URL *redirect_url);
@@ -93,6 +95,7 @@ public:
     InkHashTable *hash_lookup; //key format is hostname:port:scheme
     HostnameTrie<SuffixMappings> *suffix_trie;  //key format is hostname:port:scheme
     UrlMappingRegexList regex_list;
+    UrlMappingRegexPrefilter regex_prefilter;
     int suffix_trie_min_rank;
     int regex_list_min_rank;
 
@@ -180,6 +183,10 @@ public:
   int default_to_pac;
   int default_to_pac_port;
 
+  // 0: rebuild every rule on reload, 1: share the unchanged rules with the
+  // previous load, 2: the unchanged rules with remap plugins too
+  int incremental_reload;
+
   char config_file_path[PATH_NAME_MAX];
   char *file_var;
   char *ts_name;                // Used to send redirects when no host info
@@ -195,6 +202,8 @@ public:
 private:
   bool _valid;
   DynamicArray<ACLDefineChecker *> *_oldDefineCheckers;  //for relay delete
+  InkHashTable *_mapping_index;  //rule key to url_mapping, for the next load
+  const UrlRewrite *_previous;   //the load to share rules with, while building
 
   bool _mappingLookup(MappingsStore &mappings, URL *request_url,
       int request_port, const char *request_host,
@@ -210,7 +219,7 @@ private:
 
 
   bool _regexMappingLookup(UrlMappingRegexList &regex_mappings,
-      URL * request_url, int request_port, const char *request_host,
+      const UrlMappingRegexPrefilter &prefilter, URL * request_url, int request_port, const char *request_host,
       int request_host_len, int rank_ceiling,
       UrlMappingContainer &mapping_container);
 
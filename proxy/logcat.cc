@@ -28,7 +28,6 @@
 #include "I_Version.h"
 
 #define PROGRAM_NAME        "traffic_logcat"
-#define MAX_LOGBUFFER_SIZE  65536
 #undef IOCORE_LOG_COLLATION
 
 #include <poll.h>
@@ -44,6 +43,7 @@
 #include "LogObject.h"
 #include "LogConfig.h"
 #include "LogBuffer.h"
+#include "LogBlock.h"
 #include "LogUtils.h"
 #include "LogSock.h"
 #include "Log.h"
@@ -58,7 +58,11 @@ static int elf_flag = 0;
 static int elf2_flag = 0;
 static int auto_filenames = 0;
 static int overwrite_existing_file = 0;
+static int64_t start_time = 0;
+static int64_t end_time = 0;
 static char output_file[1024];
+static char match[1024];
+static char *match_value = NULL;
 extern int CacheClusteringEnabled;
 int auto_clear_cache_flag = 0;
 
@@ -72,6 +76,9 @@ ArgumentDescription argument_descriptions[] = {
   {"elf", 'E', "Convert to Extended Logging Format", "T", &elf_flag, NULL, NULL},
   {"help", 'h', "Give this help", "T", &help, NULL, NULL},
   {"squid", 'S', "Convert to Squid Logging Format", "T", &squid_flag, NULL, NULL},
+  {"start", 's', "Only entries at or after this time (seconds since the epoch)", "L", &start_time, NULL, NULL},
+  {"end", 'e', "Only entries at or before this time (seconds since the epoch)", "L", &end_time, NULL, NULL},
+  {"match", 'm', "Only entries where a field has a value, as <symbol>=<value>", "S1023", match, NULL, NULL},
   {"debug_tags", 'T', "Colon-Separated Debug Tags", "S1023", error_tags, NULL, NULL},
   {"version", 'V', "Print Version Id", "T", &version_flag, NULL, NULL},
   {"overwrite_output", 'w', "Overwrite existing output file(s)", "T",
@@ -81,7 +88,7 @@ ArgumentDescription argument_descriptions[] = {
 };
 int n_argument_descriptions = SIZE(argument_descriptions);
 
-static const char *USAGE_LINE = "Usage: " PROGRAM_NAME " [-o output-file | -a] [-CEhS"
+static const char *USAGE_LINE = "Usage: " PROGRAM_NAME " [-o output-file | -a] [-s start] [-e end] [-m symbol=value] [-CEhS"
 #ifdef DEBUG
   "T"
 #endif
@@ -92,95 +99,53 @@ static const char *USAGE_LINE = "Usage: " PROGRAM_NAME " [-o output-file | -a] [
 int
 process_file(int in_fd, int out_fd)
 {
-  char buffer[MAX_LOGBUFFER_SIZE];
-  int nread, buffer_bytes;
+  LogBlockReader reader(in_fd);
+  LogBufferHeader *header;
   unsigned bytes = 0;
 
-  while (true) {
-    // read the next buffer from file descriptor
-    //
-    Debug("logcat", "Reading buffer ...");
-    memset(buffer, 0, sizeof(buffer));
-
-    // read the first 8 bytes of the header, which will give us the
-    // cookie and the version number.
-    //
-    unsigned first_read_size = sizeof(uint32_t) + sizeof(uint32_t);
-    unsigned header_size = sizeof(LogBufferHeader);
-    LogBufferHeader *header = (LogBufferHeader *) & buffer[0];
-
-    nread = read(in_fd, buffer, first_read_size);
-    if (!nread || nread == EOF)
-      return 0;
-
-    // ensure that this is a valid logbuffer header
-    //
-    if (header->cookie != LOG_SEGMENT_COOKIE) {
-      fprintf(stderr, "Bad LogBuffer!\n");
-      return 1;
-    }
-    // read the rest of the header
-    //
-    unsigned second_read_size = header_size - first_read_size;
+  reader.set_time_range(start_time, end_time);
+  if (match_value)
+    reader.set_field_filter(match, match_value);
 
-    nread = read(in_fd, &buffer[first_read_size], second_read_size);
-    if (!nread || nread == EOF) {
-      if (follow_flag)
-        return 0;
+  // see if there is an alternate format request from the command
+  // line
+  //
+  char *alt_format = NULL;
+  if (squid_flag)
+    alt_format = (char *) LogFormat::squid_format;
+  if (clf_flag)
+    alt_format = (char *) LogFormat::common_format;
+  if (elf_flag)
+    alt_format = (char *) LogFormat::extended_format;
+  if (elf2_flag)
+    alt_format = (char *) LogFormat::extended2_format;
 
-      fprintf(stderr, "Bad LogBufferHeader read!\n");
-      return 1;
-    }
-    // read the rest of the buffer
+  while (true) {
+    // read the next buffer from file descriptor, buffers outside of
+    // the -s/-e window, or whose index rules out the -m value, are
+    // skipped without being read
     //
-    uint32_t byte_count = header->byte_count;
-
-    if (byte_count > sizeof(buffer)) {
-      fprintf(stderr, "Buffer too large!\n");
-      return 1;
-    }
-    buffer_bytes = byte_count - header_size;
-    if (buffer_bytes == 0)
-      return 0;
-    if (buffer_bytes < 0) {
-      fprintf(stderr, "No buffer body!\n");
-      return 1;
-    }
-    // Read the next full buffer (allowing for "partial" reads)
-    nread = 0;
-    while (nread < buffer_bytes) {
-      int rc = read(in_fd, &buffer[header_size] + nread, buffer_bytes - nread);
-
-      if ((rc == EOF) && (!follow_flag)) {
-        fprintf(stderr, "Bad LogBuffer read!\n");
+    Debug("logcat", "Reading buffer ...");
+    switch (reader.next(&header)) {
+    case LogBlockReader::READ_OK:
+      break;
+    case LogBlockReader::READ_EOF:
+      Debug("logcat", "%" PRId64 " buffers read, %" PRId64 " skipped", reader.segments_read, reader.segments_skipped);
+      if (reader.error() && !follow_flag) {
+        fprintf(stderr, "Bad LogBuffer read: %s!\n", reader.error());
         return 1;
       }
-
-      if (rc > 0)
-        nread += rc;
-    }
-
-    if (nread > buffer_bytes) {
-      fprintf(stderr, "Read too many bytes!\n");
+      return 0;
+    default:
+      fprintf(stderr, "Bad LogBuffer: %s!\n", reader.error() ? reader.error() : "read error");
       return 1;
     }
-    // see if there is an alternate format request from the command
-    // line
-    //
-    char *alt_format = NULL;
-    if (squid_flag)
-      alt_format = (char *) LogFormat::squid_format;
-    if (clf_flag)
-      alt_format = (char *) LogFormat::common_format;
-    if (elf_flag)
-      alt_format = (char *) LogFormat::extended_format;
-    if (elf2_flag)
-      alt_format = (char *) LogFormat::extended2_format;
 
     // convert the buffer to ascii entries and place onto stdout
     //
     if (header->fmt_fieldlist()) {
-      bytes += LogFile::write_ascii_logbuffer(header, out_fd, ".", alt_format);
+      bytes += LogFile::write_ascii_logbuffer(header, out_fd, ".", alt_format, start_time, end_time,
+                                              match_value ? match : NULL, match_value);
     } else {
       // TODO investigate why this buffer goes wonky
     }
@@ -243,6 +208,7 @@ main(int argc, char *argv[])
   // process command-line arguments
   //
   output_file[0] = 0;
+  match[0] = 0;
   process_args(argument_descriptions, n_argument_descriptions, argv, USAGE_LINE);
 
   // check for the version number request
@@ -263,6 +229,15 @@ main(int argc, char *argv[])
     fprintf(stderr, "Error: specify only one of -o <file> and -a\n");
     _exit(CMD_LINE_OPTION_ERROR);
   }
+  // split -m into the field symbol and the value
+  //
+  if (match[0] != 0) {
+    if (!(match_value = strchr(match, '=')) || match_value == match) {
+      fprintf(stderr, "Error: -m takes <symbol>=<value>\n");
+      _exit(CMD_LINE_OPTION_ERROR);
+    }
+    *match_value++ = 0;
+  }
   // initialize this application for standalone logging operation
   //
   init_log_standalone_basic(PROGRAM_NAME);
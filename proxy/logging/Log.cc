@@ -1388,7 +1388,13 @@ Log::flush_thread_main(void *args)
       bytes_written = 0;
       logfile = fdata->m_logfile;
 
-      if (logfile->m_file_format == BINARY_LOG) {
+      if (logfile->m_file_format == BINARY_LOG && fdata->m_len >= 0) {
+
+        // a compressed LogBlock
+        buf = (char *)fdata->m_data;
+        total_bytes = fdata->m_len;
+
+      } else if (logfile->m_file_format == BINARY_LOG) {
 
         logbuffer = (LogBuffer *)fdata->m_data;
         LogBufferHeader *buffer_header = logbuffer->header();
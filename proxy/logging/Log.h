@@ -330,8 +330,12 @@ public:
   {
     switch (m_logfile->m_file_format) {
     case BINARY_LOG:
-      logbuffer = (LogBuffer *)m_data;
-      LogBuffer::destroy(logbuffer);
+      if (m_len < 0) {
+        logbuffer = (LogBuffer *)m_data;
+        LogBuffer::destroy(logbuffer);
+      } else {
+        ats_free(m_data);       // a LogBlock
+      }
       break;
     case ASCII_LOG:
     case ASCII_PIPE:
@@ -0,0 +1,816 @@
+/** @file
+
+  Compressed LogBuffer blocks for binary log files, and a reader for
+  binary log files that can skip to a time range.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "libts.h"
+#if TS_HAS_LIBZ
+#include <zlib.h>
+#endif
+
+#include "LogField.h"
+#include "LogFormat.h"
+#include "LogBuffer.h"
+#include "LogBlock.h"
+
+/*-------------------------------------------------------------------------
+  LogBlock
+  -------------------------------------------------------------------------*/
+
+// Is symbol one of the comma separated symbols in list?
+static bool
+symbol_listed(const char *list, const char *symbol)
+{
+  int len = strlen(symbol);
+
+  while (*list) {
+    while (*list == ',' || ParseRules::is_space(*list))
+      list++;
+    const char *end = list;
+    while (*end && *end != ',' && !ParseRules::is_space(*end))
+      end++;
+    if (end - list == len && !strncmp(list, symbol, len))
+      return true;
+    list = end;
+  }
+  return false;
+}
+
+// The request timestamps are kept in the LogEntryHeader; the entry only
+// has room reserved for them (see LogBuffer::resolve_custom_entry).
+static bool
+is_entry_timestamp(LogField * field)
+{
+  const char *sym = field->symbol();
+
+  return field->aggregate() == LogField::NO_AGGREGATE && !strncmp(sym, "cqt", 3) &&
+    sym[3] && strchr("shqndt", sym[3]) && !sym[4];
+}
+
+// Unmarshal field at *read_from into buf, -1 for a timestamp or when
+// the value does not fit. *read_from moves past the field either way.
+static int
+unmarshal_field(LogField * field, unsigned buffer_version, char **read_from, char *buf, int buf_len)
+{
+  if (is_entry_timestamp(field)) {
+    if (buffer_version > 1)
+      *read_from += INK_MIN_ALIGN;
+    return -1;
+  }
+  int n = (int) field->unmarshal(read_from, buf, buf_len);
+  return n < buf_len ? n : -1;
+}
+
+int
+LogBlock::field_value(LogFieldList * fieldlist, unsigned buffer_version, LogEntryHeader * entry,
+                      const char *symbol, char *buf, int buf_len)
+{
+  char *read_from = (char *) entry + sizeof(LogEntryHeader);
+
+  for (LogField *field = fieldlist->first(); field; field = fieldlist->next(field)) {
+    int n = unmarshal_field(field, buffer_version, &read_from, buf, buf_len);
+    if (!strcmp(field->symbol(), symbol))
+      return n;
+  }
+  return -1;
+}
+
+// FNV-1a of "symbol=value"; the probes are double hashed from its halves
+static uint64_t
+index_hash(const char *symbol, const char *value, int len)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+
+  for (const char *p = symbol; *p; p++)
+    h = (h ^ (unsigned char) *p) * 0x100000001b3ULL;
+  h = (h ^ '=') * 0x100000001b3ULL;
+  for (int i = 0; i < len; i++)
+    h = (h ^ (unsigned char) value[i]) * 0x100000001b3ULL;
+  return h;
+}
+
+void
+LogBlock::index_add(char *index, int size, const char *symbol, const char *value, int len)
+{
+  uint64_t h = index_hash(symbol, value, len);
+  uint32_t h1 = (uint32_t) h, h2 = (uint32_t) (h >> 32) | 1;
+  uint32_t mask = size * 8 - 1;
+
+  for (int i = 0; i < LOG_BLOCK_INDEX_PROBES; i++, h1 += h2)
+    index[(h1 & mask) >> 3] |= 1 << (h1 & 7);
+}
+
+bool
+LogBlock::index_lookup(const char *index, int size, const char *symbol, const char *value, int len)
+{
+  uint64_t h = index_hash(symbol, value, len);
+  uint32_t h1 = (uint32_t) h, h2 = (uint32_t) (h >> 32) | 1;
+  uint32_t mask = size * 8 - 1;
+
+  for (int i = 0; i < LOG_BLOCK_INDEX_PROBES; i++, h1 += h2) {
+    if (!(index[(h1 & mask) >> 3] & (1 << (h1 & 7))))
+      return false;
+  }
+  return true;
+}
+
+// Bytes of index for n values: a power of 2 within the bounds
+static int
+index_size_for(int n)
+{
+  int size = LOG_BLOCK_INDEX_MIN_SIZE;
+
+  while (size < LOG_BLOCK_INDEX_MAX_SIZE && size * 8 < n * LOG_BLOCK_INDEX_BITS_PER_VALUE)
+    size <<= 1;
+  return size;
+}
+
+// Index the values of the fields in index_fields, returns the size of
+// the index (0 for none) in *index, allocated with ats_malloc.
+static int
+build_index(LogBufferHeader * header, const char *index_fields, char **index)
+{
+  char *symbols = header->fmt_fieldlist();
+
+  *index = NULL;
+  if (!index_fields || !*index_fields || !symbols || header->format_type == TEXT_LOG || !header->entry_count)
+    return 0;
+
+  LogFieldList fieldlist;
+  bool contains_aggregates = false;
+  int n_indexed = 0;
+
+  LogFormat::parse_symbol_string(symbols, &fieldlist, &contains_aggregates);
+  for (LogField *field = fieldlist.first(); field; field = fieldlist.next(field))
+    n_indexed += !is_entry_timestamp(field) && symbol_listed(index_fields, field->symbol());
+  if (!n_indexed)
+    return 0;
+
+  int size = index_size_for(header->entry_count * n_indexed);
+  char value[LOG_MAX_FORMATTED_LINE];
+  LogBufferIterator iter(header);
+  LogEntryHeader *entry;
+
+  *index = (char *) ats_calloc(1, size);
+  while ((entry = iter.next())) {
+    char *read_from = (char *) entry + sizeof(LogEntryHeader);
+    for (LogField *field = fieldlist.first(); field; field = fieldlist.next(field)) {
+      int n = unmarshal_field(field, header->version, &read_from, value, sizeof(value));
+      if (n >= 0 && symbol_listed(index_fields, field->symbol()))
+        LogBlock::index_add(*index, size, field->symbol(), value, n);
+    }
+  }
+  return size;
+}
+
+char *
+LogBlock::compress(LogBufferHeader * header, int compression, const char *index_fields, int *block_len)
+{
+  int len = header->byte_count;
+  int bound;
+
+  switch (compression) {
+  case LOG_BLOCK_COMPRESSION_FASTLZ:
+    if (len < 16)
+      return NULL;
+    // fastlz wants 5% of slack and at least 66 bytes
+    bound = len + len / 16 + 66;
+    break;
+#if TS_HAS_LIBZ
+  case LOG_BLOCK_COMPRESSION_LIBZ:
+    bound = (int) compressBound(len);
+    break;
+#endif
+  default:
+    return NULL;
+  }
+
+  char *index;
+  int index_size = build_index(header, index_fields, &index);
+  char *block = (char *) ats_malloc(sizeof(LogBlockHeader) + index_size + bound);
+  char *data = block + sizeof(LogBlockHeader) + index_size;
+  int n = -1;
+
+  if (index_size) {
+    memcpy(block + sizeof(LogBlockHeader), index, index_size);
+    ats_free(index);
+  }
+
+  switch (compression) {
+  case LOG_BLOCK_COMPRESSION_FASTLZ:
+    n = fastlz_compress(header, len, data);
+    break;
+#if TS_HAS_LIBZ
+  case LOG_BLOCK_COMPRESSION_LIBZ: {
+    uLongf l = bound;
+    if (Z_OK == ::compress((Bytef *) data, &l, (Bytef *) header, len))
+      n = (int) l;
+    break;
+  }
+#endif
+  }
+
+  if (n <= 0 || n + index_size >= len) {
+    ats_free(block);
+    return NULL;
+  }
+
+  LogBlockHeader *bh = (LogBlockHeader *) block;
+  bh->cookie = LOG_BLOCK_COOKIE;
+  bh->version = LOG_BLOCK_VERSION;
+  bh->compression = compression;
+  bh->compressed_size = n;
+  bh->byte_count = len;
+  bh->entry_count = header->entry_count;
+  bh->low_timestamp = header->low_timestamp;
+  bh->high_timestamp = header->high_timestamp;
+  bh->index_size = index_size;
+  *block_len = sizeof(LogBlockHeader) + index_size + n;
+  return block;
+}
+
+int
+LogBlock::expand(LogBlockHeader * block, char *buf, int buf_len)
+{
+  char *data = (char *) (block + 1) + block->index_size;
+  int n = -1;
+
+  if (block->byte_count > (uint32_t) buf_len || block->byte_count < sizeof(LogBufferHeader))
+    return -1;
+
+  switch (block->compression) {
+  case LOG_BLOCK_COMPRESSION_FASTLZ:
+    n = fastlz_decompress(data, block->compressed_size, buf, block->byte_count);
+    break;
+#if TS_HAS_LIBZ
+  case LOG_BLOCK_COMPRESSION_LIBZ: {
+    uLongf l = block->byte_count;
+    if (Z_OK == uncompress((Bytef *) buf, &l, (Bytef *) data, block->compressed_size))
+      n = (int) l;
+    break;
+  }
+#endif
+  default:
+    break;
+  }
+
+  if (n != (int) block->byte_count || ((LogBufferHeader *) buf)->cookie != LOG_SEGMENT_COOKIE)
+    return -1;
+  return n;
+}
+
+/*-------------------------------------------------------------------------
+  LogBlockReader
+  -------------------------------------------------------------------------*/
+
+LogBlockReader::LogBlockReader(int fd)
+  : segments_read(0), segments_skipped(0), m_fd(fd), m_start(0), m_end(0), m_symbol(NULL), m_value(NULL),
+    m_buf(NULL), m_buf_size(0), m_block(NULL), m_block_size(0), m_index(NULL), m_index_size(0), m_error(NULL)
+{
+}
+
+LogBlockReader::~LogBlockReader()
+{
+  ats_free(m_buf);
+  ats_free(m_block);
+  ats_free(m_index);
+}
+
+// Read len bytes unless the input ends first, returns the number read
+// or -1.
+int
+LogBlockReader::_read(void *buf, int len)
+{
+  int done = 0;
+
+  while (done < len) {
+    int n = ::read(m_fd, (char *) buf + done, len - done);
+    if (n == 0)
+      break;
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      m_error = strerror(errno);
+      return -1;
+    }
+    done += n;
+  }
+  return done;
+}
+
+// Step over len bytes, false if the input ends before that.
+bool
+LogBlockReader::_skip(off_t len)
+{
+  off_t pos = lseek(m_fd, 0, SEEK_CUR);
+
+  if (pos >= 0) {
+    struct stat st;
+    if (fstat(m_fd, &st) < 0 || pos + len > st.st_size)
+      return false;
+    return lseek(m_fd, len, SEEK_CUR) >= 0;
+  }
+
+  char scratch[4096];
+  while (len > 0) {
+    int n = _read(scratch, len < (off_t) sizeof(scratch) ? (int) len : (int) sizeof(scratch));
+    if (n <= 0)
+      return false;
+    len -= n;
+  }
+  return true;
+}
+
+char *
+LogBlockReader::_reserve(char **buf, int *size, int len)
+{
+  if (*size < len) {
+    ats_free(*buf);
+    *buf = (char *) ats_malloc(len);
+    *size = len;
+  }
+  return *buf;
+}
+
+// The input ends in the middle of a segment: a log file that is still
+// being written, or a truncated one. Go back to the start of the
+// segment if we can, so that it can be read again once it is complete.
+LogBlockReader::ReadResult
+LogBlockReader::_partial(off_t start, const char *error)
+{
+  m_error = error;
+  if (start >= 0 && lseek(m_fd, start, SEEK_SET) >= 0)
+    return READ_EOF;
+  return READ_ERROR;
+}
+
+LogBlockReader::ReadResult
+LogBlockReader::align(off_t offset)
+{
+  uint32_t cookie;
+
+  for (;; offset++) {
+    if (lseek(m_fd, offset, SEEK_SET) < 0) {
+      m_error = strerror(errno);
+      return READ_ERROR;
+    }
+    int n = _read(&cookie, sizeof(cookie));
+    if (n < 0)
+      return READ_ERROR;
+    if (n < (int) sizeof(cookie))
+      return READ_EOF;
+    if (cookie == LOG_SEGMENT_COOKIE || cookie == LOG_BLOCK_COOKIE)
+      break;
+  }
+  return lseek(m_fd, offset, SEEK_SET) < 0 ? READ_ERROR : READ_OK;
+}
+
+LogBlockReader::ReadResult
+LogBlockReader::next(LogBufferHeader ** header)
+{
+  union
+  {
+    uint32_t cookie;
+    LogBufferHeader segment;
+    LogBlockHeader block;
+  } h;
+
+  m_error = NULL;
+  for (;;) {
+    off_t start = lseek(m_fd, 0, SEEK_CUR);
+    int n = _read(&h.cookie, sizeof(h.cookie));
+
+    if (n < 0)
+      return READ_ERROR;
+    if (n == 0)
+      return READ_EOF;
+    if (n < (int) sizeof(h.cookie))
+      return _partial(start, "partial segment header");
+
+    if (h.cookie == LOG_SEGMENT_COOKIE) {
+      int rest = sizeof(LogBufferHeader) - sizeof(h.cookie);
+      if ((n = _read((char *) &h.segment + sizeof(h.cookie), rest)) != rest)
+        return n < 0 ? READ_ERROR : _partial(start, "partial LogBufferHeader");
+      if (h.segment.byte_count < sizeof(LogBufferHeader) || h.segment.byte_count > LOG_BLOCK_MAX_SIZE) {
+        m_error = "bad LogBuffer size";
+        return READ_ERROR;
+      }
+      int body = h.segment.byte_count - sizeof(LogBufferHeader);
+      if (!_in_range(h.segment.low_timestamp, h.segment.high_timestamp)) {
+        if (!_skip(body))
+          return _partial(start, "partial LogBuffer");
+        segments_skipped++;
+        continue;
+      }
+      char *buf = _reserve(&m_buf, &m_buf_size, h.segment.byte_count);
+      memcpy(buf, &h.segment, sizeof(LogBufferHeader));
+      if ((n = _read(buf + sizeof(LogBufferHeader), body)) != body)
+        return n < 0 ? READ_ERROR : _partial(start, "partial LogBuffer");
+
+    } else if (h.cookie == LOG_BLOCK_COOKIE) {
+      int rest = LOG_BLOCK_V1_HEADER_SIZE - sizeof(h.cookie);
+      if ((n = _read((char *) &h.block + sizeof(h.cookie), rest)) != rest)
+        return n < 0 ? READ_ERROR : _partial(start, "partial LogBlockHeader");
+      if (h.block.version == 1) {
+        h.block.index_size = 0;
+      } else if (h.block.version == LOG_BLOCK_VERSION) {
+        rest = sizeof(h.block.index_size);
+        if ((n = _read(&h.block.index_size, rest)) != rest)
+          return n < 0 ? READ_ERROR : _partial(start, "partial LogBlockHeader");
+      } else {
+        m_error = "unknown LogBlock version";
+        return READ_ERROR;
+      }
+      if (h.block.compressed_size > LOG_BLOCK_MAX_SIZE || h.block.byte_count > LOG_BLOCK_MAX_SIZE) {
+        m_error = "bad LogBlock size";
+        return READ_ERROR;
+      }
+      if (h.block.index_size > LOG_BLOCK_INDEX_MAX_SIZE || (h.block.index_size & (h.block.index_size - 1))) {
+        m_error = "bad LogBlock index size";
+        return READ_ERROR;
+      }
+      int body = h.block.compressed_size;
+      int index_size = h.block.index_size;
+      bool wanted = _in_range(h.block.low_timestamp, h.block.high_timestamp);
+      if (wanted && index_size && m_symbol && m_value) {
+        char *index = _reserve(&m_index, &m_index_size, index_size);
+        if ((n = _read(index, index_size)) != index_size)
+          return n < 0 ? READ_ERROR : _partial(start, "partial LogBlock index");
+        wanted = LogBlock::index_lookup(index, index_size, m_symbol, m_value, strlen(m_value));
+        index_size = 0;
+      }
+      if (!wanted) {
+        if (!_skip(index_size + body))
+          return _partial(start, "partial LogBlock");
+        segments_skipped++;
+        continue;
+      }
+      if (index_size && !_skip(index_size))
+        return _partial(start, "partial LogBlock");
+      // the data is kept without the index in front of it
+      h.block.index_size = 0;
+      char *block = _reserve(&m_block, &m_block_size, sizeof(LogBlockHeader) + body);
+      memcpy(block, &h.block, sizeof(LogBlockHeader));
+      if ((n = _read(block + sizeof(LogBlockHeader), body)) != body)
+        return n < 0 ? READ_ERROR : _partial(start, "partial LogBlock");
+      char *buf = _reserve(&m_buf, &m_buf_size, h.block.byte_count);
+      if (LogBlock::expand((LogBlockHeader *) block, buf, m_buf_size) < 0) {
+        m_error = "corrupt LogBlock";
+        return READ_ERROR;
+      }
+
+    } else {
+      m_error = "bad segment cookie";
+      return READ_ERROR;
+    }
+
+    segments_read++;
+    *header = (LogBufferHeader *) m_buf;
+    return READ_OK;
+  }
+}
+
+#if TS_HAS_TESTS
+#include "LogAccess.h"
+#include "ts/TestBox.h"
+
+#define TEST_FIELDS "cqhm,pssc"
+
+// A LogBuffer of n entries with the fields TEST_FIELDS, one a second
+// from time t, the statuses taking turns between status and status + 1.
+static LogBufferHeader *
+test_buffer(long t, int n, int status)
+{
+  static const char method[] = "GET";
+  int fields_len = INK_ALIGN_DEFAULT(sizeof(TEST_FIELDS));
+  int method_len = INK_ALIGN_DEFAULT(sizeof(method));
+  int entry_len = sizeof(LogEntryHeader) + method_len + sizeof(int64_t);
+  int len = sizeof(LogBufferHeader) + fields_len + n * entry_len;
+  LogBufferHeader *h = (LogBufferHeader *) ats_calloc(1, len);
+
+  h->cookie = LOG_SEGMENT_COOKIE;
+  h->version = LOG_SEGMENT_VERSION;
+  h->format_type = CUSTOM_LOG;
+  h->byte_count = len;
+  h->entry_count = n;
+  h->low_timestamp = t;
+  h->high_timestamp = t + n - 1;
+  h->fmt_fieldlist_offset = sizeof(LogBufferHeader);
+  h->data_offset = sizeof(LogBufferHeader) + fields_len;
+  memcpy((char *) h + h->fmt_fieldlist_offset, TEST_FIELDS, sizeof(TEST_FIELDS));
+
+  char *p = (char *) h + h->data_offset;
+  for (int i = 0; i < n; i++, p += entry_len) {
+    LogEntryHeader *e = (LogEntryHeader *) p;
+    e->timestamp = t + i;
+    e->entry_len = entry_len;
+    LogAccess::marshal_str(p + sizeof(LogEntryHeader), method, method_len);
+    LogAccess::marshal_int(p + sizeof(LogEntryHeader) + method_len, status + i % 2);
+  }
+  return h;
+}
+
+// An unlinked temporary file with the n segments in it, positioned at
+// the start.
+static int
+test_file(char **segments, int *lens, int n)
+{
+  char path[] = "/tmp/logblockXXXXXX";
+  int fd = mkstemp(path);
+
+  if (fd < 0)
+    return -1;
+  unlink(path);
+  for (int i = 0; i < n; i++) {
+    if (write(fd, segments[i], lens[i]) != lens[i]) {
+      close(fd);
+      return -1;
+    }
+  }
+  lseek(fd, 0, SEEK_SET);
+  return fd;
+}
+
+// Read every segment of fd, counting those that match buffers[i] in
+// turn; returns the number read or -1 if one did not match.
+static int
+test_read_all(LogBlockReader & reader, LogBufferHeader ** expected, int n_expected)
+{
+  LogBufferHeader *h;
+  int n = 0;
+
+  while (reader.next(&h) == LogBlockReader::READ_OK) {
+    if (n >= n_expected || h->byte_count != expected[n]->byte_count || memcmp(h, expected[n], h->byte_count))
+      return -1;
+    n++;
+  }
+  return n;
+}
+
+REGRESSION_TEST(LogBlock_RoundTrip)(RegressionTest * t, int atype, int * pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  static const int compressions[] = {
+    LOG_BLOCK_COMPRESSION_FASTLZ,
+#if TS_HAS_LIBZ
+    LOG_BLOCK_COMPRESSION_LIBZ,
+#endif
+  };
+  LogBufferHeader *lb = test_buffer(1000, 100, 200);
+  char *buf = (char *) ats_malloc(lb->byte_count);
+  int len;
+
+  box = REGRESSION_TEST_PASSED;
+
+  for (unsigned i = 0; i < sizeof(compressions) / sizeof(compressions[0]); i++) {
+    char *block = LogBlock::compress(lb, compressions[i], NULL, &len);
+    box.check(block != NULL, "compression %d did not shrink the buffer", compressions[i]);
+    if (!block)
+      continue;
+    LogBlockHeader *bh = (LogBlockHeader *) block;
+    box.check(bh->cookie == LOG_BLOCK_COOKIE && bh->version == LOG_BLOCK_VERSION && bh->index_size == 0 &&
+              bh->entry_count == 100 && bh->low_timestamp == 1000 && bh->high_timestamp == 1099 &&
+              len == (int) (sizeof(LogBlockHeader) + bh->compressed_size), "compression %d wrote a bad header",
+              compressions[i]);
+    box.check(LogBlock::expand(bh, buf, lb->byte_count) == (int) lb->byte_count && !memcmp(buf, lb, lb->byte_count),
+              "compression %d did not round trip", compressions[i]);
+    box.check(LogBlock::expand(bh, buf, lb->byte_count - 1) < 0, "compression %d expanded into too small a buffer",
+              compressions[i]);
+    ats_free(block);
+  }
+
+  box.check(LogBlock::compress(lb, LOG_BLOCK_COMPRESSION_NONE, NULL, &len) == NULL, "compressed with none");
+
+  // what does not shrink is left to be written as is
+  uint32_t x = 1;
+  for (char *p = (char *) lb + lb->data_offset; p < (char *) lb + lb->byte_count; p++) {
+    x = x * 1103515245 + 12345;
+    *p = x >> 24;
+  }
+  box.check(LogBlock::compress(lb, LOG_BLOCK_COMPRESSION_FASTLZ, NULL, &len) == NULL, "random bytes were compressed");
+
+  ats_free(buf);
+  ats_free(lb);
+}
+
+REGRESSION_TEST(LogBlock_Reader)(RegressionTest * t, int atype, int * pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  LogBufferHeader *lb[4];
+  char *seg[4];
+  int len[4];
+  LogBufferHeader *h;
+  int fd;
+
+  box = REGRESSION_TEST_PASSED;
+
+  // plain buffers and blocks taking turns, a 1000 seconds apart
+  for (int i = 0; i < 4; i++) {
+    lb[i] = test_buffer(1000 * (i + 1), 10, 200);
+    seg[i] = (char *) lb[i];
+    len[i] = lb[i]->byte_count;
+    if (i % 2 && !(seg[i] = LogBlock::compress(lb[i], LOG_BLOCK_COMPRESSION_FASTLZ, NULL, &len[i]))) {
+      box.check(false, "buffer %d did not compress", i);
+      return;
+    }
+  }
+
+  if ((fd = test_file(seg, len, 4)) >= 0) {
+    LogBlockReader reader(fd);
+    box.check(test_read_all(reader, lb, 4) == 4 && !reader.error() && reader.segments_skipped == 0,
+              "did not read back all of the segments");
+
+    LogBufferHeader *middle[] = { lb[1], lb[2] };
+    LogBlockReader range(fd);
+    lseek(fd, 0, SEEK_SET);
+    range.set_time_range(2005, 3000);
+    box.check(test_read_all(range, middle, 2) == 2 && range.segments_skipped == 2,
+              "read %" PRId64 " and skipped %" PRId64 " segments for 2005-3000", range.segments_read,
+              range.segments_skipped);
+
+    LogBlockReader tail(fd);
+    lseek(fd, 0, SEEK_SET);
+    tail.set_time_range(3500, 0);
+    box.check(test_read_all(tail, lb + 3, 1) == 1 && tail.segments_skipped == 3, "did not skip to the last block");
+
+    LogBlockReader aligned(fd);
+    box.check(aligned.align(1) == LogBlockReader::READ_OK && test_read_all(aligned, lb + 1, 3) == 3,
+              "did not align on the first block");
+    close(fd);
+  }
+
+  // a block cut short, then completed
+  int cut_len[] = { len[0], len[1] / 2 };
+  int cut = cut_len[1];
+  if ((fd = test_file(seg, cut_len, 2)) >= 0) {
+    LogBlockReader reader(fd);
+    box.check(reader.next(&h) == LogBlockReader::READ_OK, "did not read the buffer before a partial block");
+    box.check(reader.next(&h) == LogBlockReader::READ_EOF && reader.error() &&
+              lseek(fd, 0, SEEK_CUR) == len[0], "partial block not left to be read again");
+    lseek(fd, 0, SEEK_END);
+    box.check(write(fd, seg[1] + cut, len[1] - cut) == len[1] - cut, "short write");
+    lseek(fd, len[0], SEEK_SET);
+    box.check(reader.next(&h) == LogBlockReader::READ_OK && !memcmp(h, lb[1], lb[1]->byte_count),
+              "did not read the block once complete");
+    close(fd);
+  }
+
+  // a header cut short
+  int header_cut = 10;
+  if ((fd = test_file(seg + 1, &header_cut, 1)) >= 0) {
+    LogBlockReader reader(fd);
+    box.check(reader.next(&h) == LogBlockReader::READ_EOF && reader.error() && lseek(fd, 0, SEEK_CUR) == 0,
+              "partial block header not seen as such");
+    close(fd);
+  }
+
+  // corruptions of the block header and data
+  char *bad = (char *) ats_malloc(len[1]);
+  LogBlockHeader *bh = (LogBlockHeader *) bad;
+  for (int c = 0; c < 5; c++) {
+    memcpy(bad, seg[1], len[1]);
+    switch (c) {
+    case 0:
+      memset(bad + sizeof(LogBlockHeader), 0x5a, bh->compressed_size);
+      break;
+    case 1:
+      bh->cookie = 0x12345678;
+      break;
+    case 2:
+      bh->version = 99;
+      break;
+    case 3:
+      bh->index_size = 3;
+      break;
+    case 4:
+      bh->byte_count = LOG_BLOCK_MAX_SIZE + 1;
+      break;
+    }
+    if ((fd = test_file(&bad, &len[1], 1)) >= 0) {
+      LogBlockReader reader(fd);
+      box.check(reader.next(&h) == LogBlockReader::READ_ERROR && reader.error(), "corruption %d not detected", c);
+      close(fd);
+    }
+  }
+
+  // a version 1 block, which ends its header before the index size
+  int v1_len = len[1] - (sizeof(LogBlockHeader) - LOG_BLOCK_V1_HEADER_SIZE);
+  memcpy(bad, seg[1], LOG_BLOCK_V1_HEADER_SIZE);
+  memcpy(bad + LOG_BLOCK_V1_HEADER_SIZE, seg[1] + sizeof(LogBlockHeader), bh->compressed_size);
+  bh->version = 1;
+  if ((fd = test_file(&bad, &v1_len, 1)) >= 0) {
+    LogBlockReader reader(fd);
+    box.check(test_read_all(reader, lb + 1, 1) == 1, "did not read a version 1 block");
+    close(fd);
+  }
+  ats_free(bad);
+
+  for (int i = 0; i < 4; i++) {
+    if (seg[i] != (char *) lb[i])
+      ats_free(seg[i]);
+    ats_free(lb[i]);
+  }
+}
+
+REGRESSION_TEST(LogBlock_FieldIndex)(RegressionTest * t, int atype, int * pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  LogFieldList fieldlist;
+  bool contains_aggregates;
+  char value[64];
+
+  box = REGRESSION_TEST_PASSED;
+
+  if (LogFormat::parse_symbol_string(TEST_FIELDS, &fieldlist, &contains_aggregates) != 2) {
+    rprintf(t, "the log fields are not set up, skipping\n");
+    return;
+  }
+
+  LogBufferHeader *ok = test_buffer(1000, 50, 200);
+  LogBufferHeader *missing = test_buffer(2000, 50, 404);
+  LogBufferHeader *plain = test_buffer(3000, 50, 404);
+  LogEntryHeader *entry = (LogEntryHeader *) ((char *) ok + ok->data_offset);
+  int n;
+
+  n = LogBlock::field_value(&fieldlist, ok->version, entry, "pssc", value, sizeof(value));
+  box.check(n == 3 && !memcmp(value, "200", 3), "pssc of the first entry is not 200");
+  n = LogBlock::field_value(&fieldlist, ok->version, entry, "cqhm", value, sizeof(value));
+  box.check(n == 3 && !memcmp(value, "GET", 3), "cqhm of the first entry is not GET");
+  box.check(LogBlock::field_value(&fieldlist, ok->version, entry, "crc", value, sizeof(value)) < 0,
+            "found a field not in the entry");
+  box.check(LogBlock::field_value(&fieldlist, ok->version, entry, "pssc", value, 3) < 0,
+            "a value that does not fit was returned");
+
+  int len[3];
+  char *seg[3];
+  seg[0] = LogBlock::compress(ok, LOG_BLOCK_COMPRESSION_FASTLZ, "pssc", &len[0]);
+  seg[1] = LogBlock::compress(missing, LOG_BLOCK_COMPRESSION_FASTLZ, " cqhm , pssc ", &len[1]);
+  seg[2] = (char *) plain;
+  len[2] = plain->byte_count;
+  if (!seg[0] || !seg[1]) {
+    box.check(false, "the test buffers did not compress");
+    ats_free(seg[0]);
+    ats_free(seg[1]);
+    ats_free(ok);
+    ats_free(missing);
+    ats_free(plain);
+    return;
+  }
+
+  LogBlockHeader *bh = (LogBlockHeader *) seg[0];
+  char *index = seg[0] + sizeof(LogBlockHeader);
+  box.check(bh->index_size == LOG_BLOCK_INDEX_MIN_SIZE, "index of %u bytes for 50 values", bh->index_size);
+  box.check(LogBlock::index_lookup(index, bh->index_size, "pssc", "200", 3) &&
+            LogBlock::index_lookup(index, bh->index_size, "pssc", "201", 3), "indexed values not found");
+  box.check(!LogBlock::index_lookup(index, bh->index_size, "pssc", "404", 3), "found a value not indexed");
+  box.check(!LogBlock::index_lookup(index, bh->index_size, "cqhm", "GET", 3), "found a field not indexed");
+  bh = (LogBlockHeader *) seg[1];
+  box.check(LogBlock::index_lookup(seg[1] + sizeof(LogBlockHeader), bh->index_size, "cqhm", "GET", 3),
+            "a second indexed field was not found");
+
+  LogBufferHeader *buf = (LogBufferHeader *) ats_malloc(ok->byte_count);
+  box.check(LogBlock::expand((LogBlockHeader *) seg[0], (char *) buf, ok->byte_count) == (int) ok->byte_count &&
+            !memcmp(buf, ok, ok->byte_count), "an indexed block did not round trip");
+  ats_free(buf);
+
+  // the block without 404 is skipped, the plain buffer can not be
+  int fd = test_file(seg, len, 3);
+  if (fd >= 0) {
+    LogBufferHeader *expected[] = { missing, plain };
+    LogBlockReader reader(fd);
+    reader.set_field_filter("pssc", "404");
+    box.check(test_read_all(reader, expected, 2) == 2 && reader.segments_skipped == 1,
+              "read %" PRId64 " and skipped %" PRId64 " segments for pssc=404", reader.segments_read,
+              reader.segments_skipped);
+    close(fd);
+  }
+
+  ats_free(seg[0]);
+  ats_free(seg[1]);
+  ats_free(ok);
+  ats_free(missing);
+  ats_free(plain);
+}
+#endif
@@ -0,0 +1,187 @@
+/** @file
+
+  Compressed LogBuffer blocks for binary log files, and a reader for
+  binary log files that can skip to a time range.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef LOG_BLOCK_H
+#define LOG_BLOCK_H
+
+#include "libts.h"
+
+struct LogBufferHeader;
+struct LogEntryHeader;
+class LogFieldList;
+
+#define LOG_BLOCK_COOKIE 0xb10cface
+#define LOG_BLOCK_VERSION 2             // 1 had no field value index
+
+// values of proxy.config.log.binary_compression, same as the RAM cache's
+#define LOG_BLOCK_COMPRESSION_NONE   0
+#define LOG_BLOCK_COMPRESSION_FASTLZ 1
+#define LOG_BLOCK_COMPRESSION_LIBZ   2
+
+#define LOG_BLOCK_MAX_SIZE (16 * 1024 * 1024)   // sanity limit for readers
+
+// field value index sizing: bits per indexed value, bounds in bytes
+#define LOG_BLOCK_INDEX_BITS_PER_VALUE 10
+#define LOG_BLOCK_INDEX_MIN_SIZE 64
+#define LOG_BLOCK_INDEX_MAX_SIZE 8192
+#define LOG_BLOCK_INDEX_PROBES 4
+
+/*-------------------------------------------------------------------------
+  LogBlockHeader
+
+  A binary log file is a sequence of segments. A segment is either a
+  LogBuffer as is (it starts with a LogBufferHeader and
+  LOG_SEGMENT_COOKIE) or a block: this header followed by a LogBuffer
+  compressed as a whole. The header repeats the time range and entry
+  count of the LogBuffer, so that readers can step from block to block
+  without expanding the ones they are not interested in.
+
+  From version 2 the compressed data is preceded by index_size bytes of
+  field value index: a Bloom filter of "symbol=value" for the values, as
+  traffic_logcat prints them, of the fields named in
+  proxy.config.log.binary_index_fields. A reader looking for one value
+  skips the blocks whose index says it is not there. A version 1 header
+  ends before index_size.
+  -------------------------------------------------------------------------*/
+
+struct LogBlockHeader
+{
+  uint32_t cookie;              // LOG_BLOCK_COOKIE, where a LogBuffer has LOG_SEGMENT_COOKIE
+  uint32_t version;
+  uint32_t compression;         // LOG_BLOCK_COMPRESSION_*
+  uint32_t compressed_size;     // bytes following this header
+  uint32_t byte_count;          // size of the LogBuffer once expanded
+  uint32_t entry_count;
+  uint32_t low_timestamp;
+  uint32_t high_timestamp;
+  uint32_t index_size;          // 0 or a power of 2
+};
+
+#define LOG_BLOCK_V1_HEADER_SIZE offsetof(LogBlockHeader, index_size)
+
+class LogBlock
+{
+public:
+  // Compress the LogBuffer at header into a block allocated with
+  // ats_malloc, indexing the fields in the comma separated index_fields
+  // (NULL for none). Returns NULL when the buffer does not get any
+  // smaller, in which case it should be written as is.
+  static char *compress(LogBufferHeader * header, int compression, const char *index_fields, int *block_len);
+
+  // Expand the block into buf, returns the size of the LogBuffer or -1.
+  static int expand(LogBlockHeader * block, char *buf, int buf_len);
+
+  // The value of the field symbol in entry, written to buf as logcat
+  // would print it. Returns its length, or -1 if the entry does not have
+  // the field or the value does not fit.
+  static int field_value(LogFieldList * fieldlist, unsigned buffer_version, LogEntryHeader * entry,
+                         const char *symbol, char *buf, int buf_len);
+
+  // Add "symbol=value" to, or look it up in, the index of size bytes.
+  static void index_add(char *index, int size, const char *symbol, const char *value, int len);
+  static bool index_lookup(const char *index, int size, const char *symbol, const char *value, int len);
+};
+
+/*-------------------------------------------------------------------------
+  LogBlockReader
+
+  Reads the LogBuffers of a binary log file one at a time, expanding
+  compressed blocks. If a time range is set, segments whose entries all
+  fall outside of it are skipped over with lseek() (or read and dropped
+  when the input is not seekable) instead of being read and expanded.
+  So are the blocks whose index rules out the field value being looked
+  for; segments without an index are always returned, and it is up to
+  the caller to check their entries (as for the time range).
+  Entries are not in strict time order across segments, so the whole
+  file is still walked, one header at a time.
+  -------------------------------------------------------------------------*/
+
+class LogBlockReader
+{
+public:
+  enum ReadResult
+  {
+    READ_OK = 0,
+    READ_EOF,                   // nothing more, or a partial segment at the end
+    READ_ERROR
+  };
+
+  LogBlockReader(int fd);
+  ~LogBlockReader();
+
+  // Only return segments with entries in [start, end], 0 leaves a side open.
+  void set_time_range(long start, long end)
+  {
+    m_start = start;
+    m_end = end;
+  }
+
+  // Only return segments which may have entries where the field symbol
+  // is value, NULL for any. The strings are not copied.
+  void set_field_filter(const char *symbol, const char *value)
+  {
+    m_symbol = symbol;
+    m_value = value;
+  }
+
+  // Move to the first segment at or after offset.
+  ReadResult align(off_t offset);
+
+  // Point header at the next LogBuffer, valid until the next call.
+  ReadResult next(LogBufferHeader ** header);
+
+  const char *error() const { return m_error; }
+
+  int64_t segments_read;
+  int64_t segments_skipped;
+
+private:
+  int m_fd;
+  long m_start;
+  long m_end;
+  const char *m_symbol;
+  const char *m_value;
+  char *m_buf;                  // the LogBuffer handed out by next()
+  int m_buf_size;
+  char *m_block;                // compressed data being read
+  int m_block_size;
+  char *m_index;                // index of the block being read
+  int m_index_size;
+  const char *m_error;
+
+  int _read(void *buf, int len);
+  bool _skip(off_t len);
+  bool _in_range(uint32_t low, uint32_t high) const
+  {
+    return (!m_start || (long) high >= m_start) && (!m_end || (long) low <= m_end);
+  }
+  char *_reserve(char **buf, int *size, int len);
+  ReadResult _partial(off_t start, const char *error);
+
+  // -- member functions not allowed --
+  LogBlockReader(const LogBlockReader &);
+  LogBlockReader & operator=(const LogBlockReader &);
+};
+
+#endif
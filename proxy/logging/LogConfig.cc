@@ -54,6 +54,7 @@
 #include "LogFormat.h"
 #include "LogFile.h"
 #include "LogBuffer.h"
+#include "LogBlock.h"
 #include "LogHost.h"
 #include "LogObject.h"
 #include "LogConfig.h"
@@ -104,6 +105,9 @@ LogConfig::setup_default_values()
 
   log_buffer_size = (int) (10 * LOG_KILOBYTE);
   max_secs_per_buffer = 5;
+  thread_buffers = 1;
+  binary_compression = LOG_BLOCK_COMPRESSION_NONE;
+  binary_index_fields = ats_strdup("chi,pssc");
   max_space_mb_for_logs = 100;
   max_space_mb_for_orphan_logs = 25;
   max_space_mb_headroom = 10;
@@ -213,6 +217,28 @@ LogConfig::read_configuration_variables()
     max_secs_per_buffer = val;
   }
 
+  thread_buffers = (int) REC_ConfigReadInteger("proxy.config.log.thread_buffers") ? 1 : 0;
+
+  val = (int) REC_ConfigReadInteger("proxy.config.log.binary_compression");
+  switch (val) {
+  case LOG_BLOCK_COMPRESSION_NONE:
+  case LOG_BLOCK_COMPRESSION_FASTLZ:
+#if TS_HAS_LIBZ
+  case LOG_BLOCK_COMPRESSION_LIBZ:
+#endif
+    binary_compression = val;
+    break;
+  default:
+    Warning("proxy.config.log.binary_compression = %d is not supported, binary logs will not be compressed", val);
+    binary_compression = LOG_BLOCK_COMPRESSION_NONE;
+  }
+
+  ptr = REC_ConfigReadString("proxy.config.log.binary_index_fields");
+  if (ptr != NULL) {
+    ats_free(binary_index_fields);
+    binary_index_fields = ptr;
+  }
+
   val = (int) REC_ConfigReadInteger("proxy.config.log.max_space_mb_for_logs");
   if (val > 0) {
     max_space_mb_for_logs = val;
@@ -627,6 +653,7 @@ LogConfig::~LogConfig()
 
   ats_free(hostname);
   ats_free(logfile_dir);
+  ats_free(binary_index_fields);
   ats_free(squid_log_name);
   ats_free(squid_log_header);
   ats_free(common_log_name);
@@ -799,6 +826,9 @@ LogConfig::display(FILE * fd)
   fprintf(fd, "Config variables:\n");
   fprintf(fd, "   log_buffer_size = %d\n", log_buffer_size);
   fprintf(fd, "   max_secs_per_buffer = %d\n", max_secs_per_buffer);
+  fprintf(fd, "   thread_buffers = %d\n", thread_buffers);
+  fprintf(fd, "   binary_compression = %d\n", binary_compression);
+  fprintf(fd, "   binary_index_fields = %s\n", binary_index_fields);
   fprintf(fd, "   max_space_mb_for_logs = %d\n", max_space_mb_for_logs);
   fprintf(fd, "   max_space_mb_for_orphan_logs = %d\n", max_space_mb_for_orphan_logs);
   fprintf(fd, "   use_orphan_log_space_value = %d\n", use_orphan_log_space_value);
@@ -1260,6 +1290,8 @@ LogConfig::register_config_callbacks()
   REC_RegisterConfigUpdateFunc("proxy.config.log.log_buffer_size", &LogConfig::reconfigure, NULL);
 //    REC_RegisterConfigUpdateFunc ("proxy.config.log.max_secs_per_buffer",
 //                            &LogConfig::reconfigure, NULL);
+  REC_RegisterConfigUpdateFunc("proxy.config.log.binary_compression", &LogConfig::reconfigure, NULL);
+  REC_RegisterConfigUpdateFunc("proxy.config.log.binary_index_fields", &LogConfig::reconfigure, NULL);
   REC_RegisterConfigUpdateFunc("proxy.config.log.max_space_mb_for_logs", &LogConfig::reconfigure, NULL);
   REC_RegisterConfigUpdateFunc("proxy.config.log.max_space_mb_for_orphan_logs", &LogConfig::reconfigure, NULL);
   REC_RegisterConfigUpdateFunc("proxy.config.log.max_space_mb_headroom", &LogConfig::reconfigure, NULL);
@@ -191,6 +191,9 @@ public:
 
   int log_buffer_size;
   int max_secs_per_buffer;
+  int thread_buffers;
+  int binary_compression;
+  char *binary_index_fields;
   int max_space_mb_for_logs;
   int max_space_mb_for_orphan_logs;
   int max_space_mb_headroom;
@@ -45,6 +45,7 @@
 #include "LogFilter.h"
 #include "LogFormat.h"
 #include "LogBuffer.h"
+#include "LogBlock.h"
 #include "LogFile.h"
 #include "LogHost.h"
 #include "LogObject.h"
@@ -513,24 +514,40 @@ LogFile::preproc_and_try_delete(LogBuffer * lb)
     // don't change between buffers), it's not worth trying to separate
     // out the buffer-dependent data from the buffer-independent data.
     //
-    LogFlushData *flush_data = new LogFlushData(this, lb);
+    // With compression on, the buffer goes out as a LogBlock instead,
+    // compressed here so that the flush thread only has to write it.
+    //
+    LogFlushData *flush_data;
+    char *block = NULL;
+    int block_len = 0;
+
+    if (Log::config->binary_compression != LOG_BLOCK_COMPRESSION_NONE)
+      block = LogBlock::compress(buffer_header, Log::config->binary_compression, Log::config->binary_index_fields,
+                                &block_len);
+    if (block)
+      flush_data = new LogFlushData(this, block, block_len);
+    else
+      flush_data = new LogFlushData(this, lb);
 
     ProxyMutex *mutex = this_thread()->mutex;
 
     RecIncrRawStat(log_rsb, mutex->thread_holding, log_stat_num_flush_to_disk_stat,
-                   lb->header()->entry_count);
+                   buffer_header->entry_count);
 
     RecIncrRawStat(log_rsb, mutex->thread_holding, log_stat_bytes_flush_to_disk_stat,
-                   lb->header()->byte_count);
+                   buffer_header->byte_count);
 
     ink_atomiclist_push(Log::flush_data_list, flush_data);
 
     Log::flush_notify->signal();
 
     //
-    // LogBuffer will be deleted in flush thread
+    // LogBuffer will be deleted in flush thread, unless it was
+    // compressed into a block
     //
-    return 0;
+    if (!block)
+      return 0;
+    ret = 0;
   }
   else if (m_file_format == ASCII_LOG || m_file_format == ASCII_PIPE) {
     write_ascii_logbuffer3(buffer_header);
@@ -553,11 +570,14 @@ done:
   given file descriptor.  Written as a stand-alone function, it can be
   called from either the local LogBuffer::write routine from inside of the
   proxy, or from an external program (since it is a static function).  The
-  return value is the number of bytes written.
+  return value is the number of bytes written. Entries from before
+  start_time or after end_time are left out, 0 leaves that side open, and
+  so are those where the field match_symbol is not match_value, if given.
   -------------------------------------------------------------------------*/
 
 int
-LogFile::write_ascii_logbuffer(LogBufferHeader * buffer_header, int fd, const char *path, char *alt_format)
+LogFile::write_ascii_logbuffer(LogBufferHeader * buffer_header, int fd, const char *path, char *alt_format,
+                               long start_time, long end_time, const char *match_symbol, const char *match_value)
 {
   ink_assert(buffer_header != NULL);
   ink_assert(fd >= 0);
@@ -588,7 +608,22 @@ LogFile::write_ascii_logbuffer(LogBufferHeader * buffer_header, int fd, const ch
     return 0;
   }
 
+  LogFieldList match_fieldlist;
+  int match_len = 0;
+
+  if (match_symbol) {
+    bool contains_aggregates = false;
+    LogFormat::parse_symbol_string(fieldlist_str, &match_fieldlist, &contains_aggregates);
+    match_len = strlen(match_value);
+  }
+
   while ((entry_header = iter.next())) {
+    if ((start_time && entry_header->timestamp < start_time) || (end_time && entry_header->timestamp > end_time))
+      continue;
+    if (match_symbol && (LogBlock::field_value(&match_fieldlist, buffer_header->version, entry_header, match_symbol,
+                                               fmt_line, LOG_MAX_FORMATTED_LINE) != match_len ||
+                         memcmp(fmt_line, match_value, match_len)))
+      continue;
     fmt_line_bytes = LogBuffer::to_ascii(entry_header, format_type,
                                          &fmt_line[0], LOG_MAX_FORMATTED_LINE,
                                          fieldlist_str, printf_str, buffer_header->version, alt_format);
@@ -159,7 +159,9 @@ public:
     return (m_file_format == BINARY_LOG ? "binary" : (m_file_format == ASCII_PIPE ? "ascii_pipe" : "ascii"));
   }
 
-  static int write_ascii_logbuffer(LogBufferHeader * buffer_header, int fd, const char *path, char *alt_format = NULL);
+  static int write_ascii_logbuffer(LogBufferHeader * buffer_header, int fd, const char *path, char *alt_format = NULL,
+                                   long start_time = 0, long end_time = 0,
+                                   const char *match_symbol = NULL, const char *match_value = NULL);
   int write_ascii_logbuffer3(LogBufferHeader * buffer_header, char *alt_format = NULL);
   static bool rolled_logfile(char *file);
   static bool exists(const char *pathname);
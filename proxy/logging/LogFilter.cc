@@ -93,6 +93,30 @@ LogFilterString::_setValues(size_t n, char **value)
       }
       m_value_uppercase[i][j] = 0;
     }
+    if (n > 1)
+      _compileValues();
+  }
+}
+
+void
+LogFilterString::_compileValues()
+{
+  switch (m_operator) {
+  case MATCH:
+    for (size_t i = 0; i < m_num_values; ++i)
+      m_match_set.put(m_value[i]);
+    break;
+  case CASE_INSENSITIVE_MATCH:
+    for (size_t i = 0; i < m_num_values; ++i)
+      m_case_match_set.put(m_value[i]);
+    break;
+  case CONTAIN:
+  case CASE_INSENSITIVE_CONTAIN:
+    m_contain.compile(m_value, m_num_values, m_operator == CASE_INSENSITIVE_CONTAIN);
+    Debug("log-filter", "filter %s: %zu values compiled into %d states", m_name, m_num_values, m_contain.states());
+    break;
+  default:
+    break;
   }
 }
 
@@ -227,16 +251,33 @@ bool LogFilterString::toss_this_entry(LogAccess * lad)
     // actual length, so we just use the fact that a MATCH is not possible
     // when marsh_len <= (length of the filter string)
     //
-    cond_satisfied = _checkCondition(&ink_string_fast_strcmp, buf, marsh_len, m_value, DATA_LENGTH_LARGER);
+    // With several values, the marshalled string (which is NUL
+    // terminated) is looked up in the compiled set instead.
+    //
+    if (m_num_values > 1)
+      cond_satisfied = m_match_set.get(buf) != NULL;
+    else
+      cond_satisfied = _checkCondition(&ink_string_fast_strcmp, buf, marsh_len, m_value, DATA_LENGTH_LARGER);
     break;
   case CASE_INSENSITIVE_MATCH:
-    cond_satisfied = _checkCondition(&ink_string_fast_strcasecmp, buf, marsh_len, m_value, DATA_LENGTH_LARGER);
+    if (m_num_values > 1)
+      cond_satisfied = m_case_match_set.get(buf) != NULL;
+    else
+      cond_satisfied = _checkCondition(&ink_string_fast_strcasecmp, buf, marsh_len, m_value, DATA_LENGTH_LARGER);
     break;
   case CONTAIN:
-    cond_satisfied = _checkCondition(&_isSubstring, buf, marsh_len, m_value, DATA_LENGTH_LARGER);
+    if (m_num_values > 1)
+      cond_satisfied = m_contain.match(buf, marsh_len) >= 0;
+    else
+      cond_satisfied = _checkCondition(&_isSubstring, buf, marsh_len, m_value, DATA_LENGTH_LARGER);
     break;
   case CASE_INSENSITIVE_CONTAIN:
     {
+      // the compiled matcher folds case itself
+      if (m_num_values > 1) {
+        cond_satisfied = m_contain.match(buf, marsh_len) >= 0;
+        break;
+      }
       if (big_buf) {
         big_buf_upper = (char *)ats_malloc((unsigned int) marsh_len);
         buf_upper = big_buf_upper;
@@ -309,12 +350,25 @@ LogFilterInt::_setValues(size_t n, int64_t *value)
 {
   m_type = INT_FILTER;
   m_num_values = n;
+  m_sorted_value = NULL;
   if (n) {
     m_value = NEW(new int64_t[n]);
     memcpy(m_value, value, n * sizeof(int64_t));
+    if (n > 1) {
+      m_sorted_value = NEW(new int64_t[n]);
+      memcpy(m_sorted_value, value, n * sizeof(int64_t));
+      qsort(m_sorted_value, n, sizeof(int64_t), _compareInt);
+    }
   }
 }
 
+int
+LogFilterInt::_compareInt(const void *a, const void *b)
+{
+  int64_t x = *(const int64_t *) a, y = *(const int64_t *) b;
+  return x < y ? -1 : x > y;
+}
+
 // TODO: ival should be int64_t
 int
 LogFilterInt::_convertStringToInt(char *value, int64_t *ival, LogFieldAliasMap * map)
@@ -408,6 +462,7 @@ LogFilterInt::~LogFilterInt()
   if (m_num_values > 0) {
     delete[]m_value;
   }
+  delete[]m_sorted_value;
 }
 
 /*-------------------------------------------------------------------------
@@ -463,12 +518,7 @@ bool LogFilterInt::toss_this_entry(LogAccess * lad)
   if (m_num_values == 1) {
     cond_satisfied = (value == *m_value);
   } else {
-    for (size_t i = 0; i < m_num_values; ++i) {
-      if (value == m_value[i]) {
-        cond_satisfied = true;
-        break;
-      }
-    }
+    cond_satisfied = bsearch(&value, m_sorted_value, m_num_values, sizeof(int64_t), _compareInt) != NULL;
   }
 
   return (m_action == REJECT && cond_satisfied) || (m_action == ACCEPT && !cond_satisfied);
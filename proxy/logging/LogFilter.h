@@ -26,6 +26,7 @@
 #define LOG_FILTER_H
 
 #include "libts.h"
+#include "AhoCorasick.h"
 #include "LogAccess.h"
 #include "LogField.h"
 #include "LogFormat.h"
@@ -127,7 +128,15 @@ private:
   char **m_value_uppercase;     // m_value in all uppercase
   size_t *m_length;             // length of m_value string
 
+  // With more than one value, the values are compiled into one of these
+  // for the filter's operator, so that each entry is checked in a single
+  // lookup or pass whatever the number of values.
+  HashSet<cchar *, StringHashFns, cchar *> m_match_set;             // MATCH
+  HashSet<cchar *, CaseStringHashFns, cchar *> m_case_match_set;    // CASE_INSENSITIVE_MATCH
+  AhoCorasick m_contain;        // CONTAIN, CASE_INSENSITIVE_CONTAIN
+
   void _setValues(size_t n, char **value);
+  void _compileValues();
 
   // note: OperatorFunction's must return 0 (zero) if condition is satisfied
   // (as strcmp does)
@@ -176,9 +185,11 @@ public:
 
 private:
   int64_t *m_value;            // the array of values
+  int64_t *m_sorted_value;     // m_value sorted, for a binary search when n > 1
 
   void _setValues(size_t n, int64_t *value);
   int _convertStringToInt(char *val, int64_t *ival, LogFieldAliasMap * map);
+  static int _compareInt(const void *a, const void *b);
 
   // -- member functions that are not allowed --
   LogFilterInt();
@@ -128,6 +128,7 @@ LogObject::LogObject(LogFormat *format, const char *log_dir,
     LogBuffer *b = NEW (new LogBuffer (this, Log::config->log_buffer_size));
     ink_debug_assert(b);
     SET_FREELIST_POINTER_VERSION(m_log_buffer, b, 0);
+    _init_thread_buffers();
 
     _setup_rolling(rolling_enabled, rolling_interval_sec, rolling_offset_hr, rolling_size_mb);
 
@@ -144,7 +145,8 @@ LogObject::LogObject(LogObject& rhs)
     m_flush_threads(rhs.m_flush_threads),
     m_rolling_interval_sec(rhs.m_rolling_interval_sec),
     m_last_roll_time(rhs.m_last_roll_time),
-    m_ref_count(0)
+    m_ref_count(0),
+    m_buffer_manager_idx(0)
 {
     m_format = new LogFormat(*(rhs.m_format));
     m_buffer_manager = new LogBufferManager[m_flush_threads];
@@ -176,6 +178,7 @@ LogObject::LogObject(LogObject& rhs)
     LogBuffer *b = NEW (new LogBuffer (this, Log::config->log_buffer_size));
     ink_debug_assert(b);
     SET_FREELIST_POINTER_VERSION(m_log_buffer, b, 0);
+    _init_thread_buffers();
 
     Debug("log-config", "exiting LogObject copy constructor, "
           "filename=%s this=%p", m_filename, this);
@@ -189,6 +192,7 @@ LogObject::~LogObject()
     Debug("log-config", "LogObject refcount = %d, waiting for zero", m_ref_count);
   }
 
+  _flush_thread_buffers(0);
   preproc_buffers();
 
   // here we need to free LogHost if it is remote logging.
@@ -203,6 +207,7 @@ LogObject::~LogObject()
   delete m_format;
   delete[] m_buffer_manager;
   delete (LogBuffer*)FREELIST_POINTER(m_log_buffer);
+  ats_memalign_free(m_thread_buffers);
 }
 
 //-----------------------------------------------------------------------------
@@ -512,6 +517,102 @@ LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
 }
 
 
+void
+LogObject::_init_thread_buffers()
+{
+  // Event threads spawned after this object was created have no slot
+  // and go through m_log_buffer.
+  m_n_thread_buffers = Log::config->thread_buffers ? eventProcessor.n_ethreads : 0;
+  m_thread_buffers = NULL;
+  if (m_n_thread_buffers > 0) {
+    m_thread_buffers = (ThreadBuffer *) ats_memalign(LOG_THREAD_BUFFER_ALIGN,
+                                                     m_n_thread_buffers * sizeof(ThreadBuffer));
+    memset(m_thread_buffers, 0, m_n_thread_buffers * sizeof(ThreadBuffer));
+  }
+}
+
+
+LogBuffer * volatile *
+LogObject::_thread_buffer_slot()
+{
+  EThread *t = this_ethread();
+
+  if (t && t->tt == REGULAR && t->id >= 0 && t->id < m_n_thread_buffers)
+    return &m_thread_buffers[t->id].buffer;
+  return NULL;
+}
+
+
+void
+LogObject::_flush_buffer(LogBuffer * buffer)
+{
+  int idx = m_buffer_manager_idx++ % m_flush_threads;
+  Debug("log-logbuffer", "adding buffer %d to flush list", buffer->get_id());
+  m_buffer_manager[idx].add_to_flush_queue(buffer);
+  Log::preproc_notify[idx].signal();
+}
+
+
+// Like _checkout_write, but for the calling thread's own buffer. The
+// buffer is taken out of its slot for the duration of the write; the
+// caller puts it back after checkin_write. Since no other thread writes
+// into it, the only way checkout_write can fail is for lack of room.
+LogBuffer *
+LogObject::_checkout_thread_write(LogBuffer * volatile *slot, size_t * write_offset, size_t bytes_needed)
+{
+  LogBuffer *buffer = ink_atomic_swap(slot, (LogBuffer *) NULL);
+
+  if (!buffer)
+    buffer = NEW(new LogBuffer(this, Log::config->log_buffer_size));
+
+  switch (buffer->checkout_write(write_offset, bytes_needed)) {
+  case LogBuffer::LB_OK:
+    return buffer;
+
+  case LogBuffer::LB_FULL_NO_WRITERS:
+    _flush_buffer(buffer);
+    buffer = NEW(new LogBuffer(this, Log::config->log_buffer_size));
+    if (buffer->checkout_write(write_offset, bytes_needed) == LogBuffer::LB_OK)
+      return buffer;
+    break;
+
+  case LogBuffer::LB_BUFFER_TOO_SMALL:
+    break;
+
+  default:
+    ink_debug_assert(false);
+  }
+
+  // this entry cannot be logged, keep the buffer for the next one
+  ink_atomic_swap(slot, buffer);
+  return NULL;
+}
+
+
+// Hand the per-thread buffers that expired before time_now (all of them
+// if time_now is 0) to the flush queue. A buffer its thread is writing
+// into right now is not in its slot and is left for the next round.
+void
+LogObject::_flush_thread_buffers(long time_now)
+{
+  for (int i = 0; i < m_n_thread_buffers; i++) {
+    LogBuffer *b = m_thread_buffers[i].buffer;
+
+    if (!b || (time_now && time_now <= b->expiration_time()))
+      continue;
+    b = ink_atomic_swap(&m_thread_buffers[i].buffer, (LogBuffer *) NULL);
+    if (!b)
+      continue;
+    if (b->checkout_write(NULL, 0) == LogBuffer::LB_OK) {
+      // nothing was written into it
+      delete b;
+    } else {
+      _flush_buffer(b);
+    }
+  }
+}
+
+
 int
 LogObject::log(LogAccess * lad, char *text_entry)
 {
@@ -585,7 +686,12 @@ LogObject::log(LogAccess * lad, char *text_entry)
   }
 
   // Now try to place this entry in the current LogBuffer.
-  buffer = _checkout_write(&offset, bytes_needed);
+  LogBuffer * volatile *slot = _thread_buffer_slot();
+
+  if (slot)
+    buffer = _checkout_thread_write(slot, &offset, bytes_needed);
+  else
+    buffer = _checkout_write(&offset, bytes_needed);
 
   if (!buffer) {
     Note("Skipping the current log entry for %s because its size (%zu) exceeds "
@@ -614,6 +720,12 @@ LogObject::log(LogAccess * lad, char *text_entry)
 
   buffer->checkin_write(offset);
 
+  if (slot) {
+    LogBuffer *other = ink_atomic_swap(slot, buffer);
+    ink_debug_assert(other == NULL);
+    NOWARN_UNUSED(other);
+  }
+
   return Log::LOG_OK;
 }
 
@@ -777,8 +889,9 @@ LogObject::check_buffer_expiration(long time_now)
 {
   LogBuffer *b = (LogBuffer*)FREELIST_POINTER(m_log_buffer);
   if (b && time_now > b->expiration_time()) {
-    force_new_buffer();
+    _checkout_write(NULL, 0);
   }
+  _flush_thread_buffers(time_now);
 }
 
 
@@ -1345,3 +1458,192 @@ LogObjectManager::log(LogAccess * lad)
 
   return ret;
 }
+
+#if TS_HAS_TESTS
+#include "ts/TestBox.h"
+
+#define LOG_TEST_ENTRIES_PER_WRITER 10000
+
+// Takes what a LogObject flushes and checks that every writer's entries
+// arrived, and that they arrived in the order the writer logged them.
+struct LogThreadBufferSink:public LogBufferSink
+{
+  int n_writers;
+  int *next_seq;
+  int entries;
+  int out_of_order;
+  int malformed;
+
+  LogThreadBufferSink(int n)
+    : n_writers(n), next_seq((int *) ats_malloc(n * sizeof(int))), entries(0), out_of_order(0), malformed(0)
+  {
+    memset(next_seq, 0, n * sizeof(int));
+  }
+
+  ~LogThreadBufferSink()
+  {
+    ats_free(next_seq);
+  }
+
+  int preproc_and_try_delete(LogBuffer * buffer)
+  {
+    LogBufferIterator iter(buffer->header());
+    LogEntryHeader *entry;
+
+    while ((entry = iter.next())) {
+      int writer, seq;
+
+      if (sscanf((char *) entry + sizeof(LogEntryHeader), "%d %d", &writer, &seq) != 2 ||
+          writer < 0 || writer >= n_writers) {
+        ++malformed;
+        continue;
+      }
+      if (seq != next_seq[writer])
+        ++out_of_order;
+      next_seq[writer] = seq + 1;
+      ++entries;
+    }
+    delete buffer;
+    return 0;
+  }
+};
+
+struct LogThreadBufferWriter:public Continuation
+{
+  LogObject *obj;
+  int writer;
+  ink_hrtime *elapsed;
+  volatile int *running;
+
+  LogThreadBufferWriter(LogObject * o, int w, ink_hrtime * e, volatile int *r)
+    : Continuation(new_ProxyMutex()), obj(o), writer(w), elapsed(e), running(r)
+  {
+    SET_HANDLER(&LogThreadBufferWriter::mainEvent);
+  }
+
+  int mainEvent(int event, Event * e)
+  {
+    char text[32];
+    ink_hrtime start = ink_get_hrtime_internal();
+
+    NOWARN_UNUSED(event);
+    NOWARN_UNUSED(e);
+
+    for (int i = 0; i < LOG_TEST_ENTRIES_PER_WRITER; i++) {
+      snprintf(text, sizeof(text), "%d %d", writer, i);
+      obj->log(NULL, text);
+    }
+    *elapsed = ink_get_hrtime_internal() - start;
+    ink_atomic_increment((int *) running, -1);
+    delete this;
+    return EVENT_DONE;
+  }
+};
+
+// Logs from every net thread into a real LogObject, first through the
+// per-thread buffers and then through the shared buffer, and reports the
+// cost of an entry on each path.
+struct LogThreadBufferTest:public Continuation
+{
+  RegressionTest *t;
+  int *pstatus;
+  bool thread_buffers;
+  LogObject *obj;
+  int n_writers;
+  ink_hrtime *elapsed;
+  volatile int running;
+
+  LogThreadBufferTest(RegressionTest * test, int *status)
+    : Continuation(new_ProxyMutex()), t(test), pstatus(status), thread_buffers(true), obj(NULL),
+      n_writers(eventProcessor.n_threads_for_type[ET_CALL]), running(0)
+  {
+    elapsed = (ink_hrtime *) ats_malloc(n_writers * sizeof(ink_hrtime));
+    SET_HANDLER(&LogThreadBufferTest::mainEvent);
+  }
+
+  ~LogThreadBufferTest()
+  {
+    ats_free(elapsed);
+  }
+
+  void start()
+  {
+    int save = Log::config->thread_buffers;
+
+    Log::config->thread_buffers = thread_buffers;
+    obj = NEW(new TextLogObject("regression_thread_buffers.log", Log::config->logfile_dir, false, NULL, 0, 1));
+    Log::config->thread_buffers = save;
+
+    running = n_writers;
+    for (int i = 0; i < n_writers; i++)
+      eventProcessor.eventthread[ET_CALL][i]->schedule_imm(NEW(new LogThreadBufferWriter(obj, i, &elapsed[i], &running)));
+  }
+
+  void finish()
+  {
+    LogThreadBufferSink sink(n_writers);
+    int expected = n_writers * LOG_TEST_ENTRIES_PER_WRITER;
+    ink_hrtime total = 0;
+
+    obj->force_new_buffer();
+    obj->preproc_buffers_to(&sink);
+    delete obj;
+    obj = NULL;
+
+    for (int i = 0; i < n_writers; i++)
+      total += elapsed[i];
+
+    rprintf(t, "%s buffers: %d threads, %d entries, %" PRId64 " ns per entry\n",
+            thread_buffers ? "per-thread" : "shared", n_writers, sink.entries,
+            sink.entries ? (int64_t) (total / sink.entries) : (int64_t) 0);
+
+    if (sink.entries != expected || sink.malformed) {
+      rprintf(t, "flushed %d of %d entries, %d malformed\n", sink.entries, expected, sink.malformed);
+      *pstatus = REGRESSION_TEST_FAILED;
+    }
+    // Only a thread's own buffers are guaranteed to be queued in order.
+    if (thread_buffers && sink.out_of_order) {
+      rprintf(t, "%d entries were flushed out of their thread's order\n", sink.out_of_order);
+      *pstatus = REGRESSION_TEST_FAILED;
+    }
+  }
+
+  int mainEvent(int event, Event * e)
+  {
+    NOWARN_UNUSED(event);
+
+    if (running > 0)
+      return EVENT_CONT;
+
+    finish();
+    if (thread_buffers && *pstatus == REGRESSION_TEST_INPROGRESS) {
+      thread_buffers = false;
+      start();
+      return EVENT_CONT;
+    }
+
+    if (*pstatus == REGRESSION_TEST_INPROGRESS)
+      *pstatus = REGRESSION_TEST_PASSED;
+    e->cancel();
+    delete this;
+    return EVENT_DONE;
+  }
+};
+
+EXCLUSIVE_REGRESSION_TEST(LogObject_ThreadBuffers)(RegressionTest * t, int atype, int *pstatus)
+{
+  NOWARN_UNUSED(atype);
+
+  if (Log::config == NULL) {
+    rprintf(t, "logging is not initialized, skipping\n");
+    *pstatus = REGRESSION_TEST_PASSED;
+    return;
+  }
+
+  LogThreadBufferTest *test = NEW(new LogThreadBufferTest(t, pstatus));
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+  test->start();
+  eventProcessor.schedule_every(test, HRTIME_MSECONDS(10), ET_CALL);
+}
+
+#endif /* TS_HAS_TESTS */
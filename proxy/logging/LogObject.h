@@ -57,6 +57,8 @@
 
 #define LOG_OBJECT_ARRAY_DELTA 8
 
+#define LOG_THREAD_BUFFER_ALIGN 64      // keep per-thread buffer slots on separate cache lines
+
 #define ACQUIRE_API_MUTEX(_f) \
 ink_mutex_acquire(_APImutex); \
 Debug("log-api-mutex", _f)
@@ -124,6 +126,16 @@ public:
     return idx;
   }
 
+  // Hand every queued buffer to @a sink instead of the file or hosts.
+  size_t preproc_buffers_to(LogBufferSink * sink)
+  {
+    size_t nfb = 0;
+
+    for (int i = 0; i < m_flush_threads; i++)
+      nfb += m_buffer_manager[i].preproc_buffers(sink);
+    return nfb;
+  }
+
   size_t preproc_buffers(int idx = -1)
   {
     size_t nfb;
@@ -192,6 +204,7 @@ public:
 
   void force_new_buffer() {
     _checkout_write(NULL, 0);
+    _flush_thread_buffers(0);
   }
 
   bool operator==(LogObject & rhs);
@@ -233,6 +246,21 @@ private:
   unsigned m_buffer_manager_idx;
   LogBufferManager *m_buffer_manager;
 
+  // Each regular event thread writes into a buffer of its own, indexed
+  // by EThread::id, and only hands it to the flush queue once it is full
+  // or expired. A thread owns its buffer while the slot is NULL, so the
+  // flush thread can take an idle one away by swapping NULL in. Threads
+  // without a slot share m_log_buffer. Whole buffers are flushed, so the
+  // lines of different threads are not in log order; with
+  // proxy.config.log.thread_buffers off there are no slots.
+  struct ThreadBuffer
+  {
+    LogBuffer * volatile buffer;
+    char pad[LOG_THREAD_BUFFER_ALIGN - sizeof(LogBuffer *)];  // one cache line each
+  };
+  ThreadBuffer *m_thread_buffers;
+  int m_n_thread_buffers;
+
   void generate_filenames(const char *log_dir, const char *basename, LogFileFormat file_format);
   void _setup_rolling(int rolling_enabled, int rolling_interval_sec, int rolling_offset_hr, int rolling_size_mb);
 #ifndef TS_MICRO
@@ -241,6 +269,12 @@ private:
 
   LogBuffer *_checkout_write(size_t * write_offset, size_t write_size);
 
+  void _init_thread_buffers();
+  LogBuffer * volatile *_thread_buffer_slot();
+  LogBuffer *_checkout_thread_write(LogBuffer * volatile *slot, size_t * write_offset, size_t write_size);
+  void _flush_thread_buffers(long time_now);
+  void _flush_buffer(LogBuffer * buffer);
+
 private:
   // -- member functions not allowed --
   LogObject();
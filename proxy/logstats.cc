@@ -33,6 +33,7 @@
 #include "LogStandalone.cc"
 
 #include "LogObject.h"
+#include "LogBlock.h"
 #include "hdrs/HTTP.h"
 
 #include <math.h>
@@ -73,10 +74,11 @@ using namespace std;
 // Constants, please update the VERSION number when you make a new build!!!
 #define PROGRAM_NAME		"traffic_logstats"
 
-const int MAX_LOGBUFFER_SIZE = 65536;
 const int DEFAULT_LINE_LEN = 78;
 const double LOG10_1024 = 3.0102999566398116;
 const int MAX_ORIG_STRING = 4096;
+const int TOP_URLS_FACTOR = 10;         // URLs tracked per top URL shown
+const int PARSE_QUEUE_DEPTH = 4;        // Log buffers queued per parsing thread
 
 
 // Optimizations for "strcmp()", treat some fixed length (3 or 4 bytes) strings
@@ -128,12 +130,16 @@ struct StatsCounter
   int64_t bytes;
 };
 
+// The elapsed times are kept as exact sums, so that the stats collected by
+// several parsing threads add up to the same as those of one thread. The
+// average and standard deviation are only computed for the output.
 struct ElapsedStats
 {
   int min;
   int max;
-  float avg;
-  float stddev;
+  int64_t count;
+  int64_t sum;
+  uint64_t sum_sq[2];           // Sum of the squares, 128 bits, high word first
 };
 
 struct OriginStats
@@ -350,8 +356,116 @@ typedef hash_map <const char *, OriginStats *, hash <const char *>, eqstr> Origi
 typedef hash_set <const char *, hash <const char *>, eqstr> OriginSet;
 
 
+void  update_elapsed(ElapsedStats &stat, const int elapsed);
+void  merge_elapsed(ElapsedStats &stat, const ElapsedStats &other);
+double elapsed_avg(const ElapsedStats &stat);
+double elapsed_stddev(const ElapsedStats &stat);
+
+// Add one request to the stats of a URL
+inline void
+update_url(UrlStats &u, int64_t bytes, int time, int result, int http_code)
+{
+  ++(u.req.count);
+  u.req.bytes += bytes;
+
+  if ((http_code >= 600) || (http_code < 200))
+    ++(u.c_000);
+  else if (http_code >= 500)
+    ++(u.c_5xx);
+  else if (http_code >= 400)
+    ++(u.c_4xx);
+  else if (http_code >= 300)
+    ++(u.c_3xx);
+  else // http_code >= 200
+    ++(u.c_2xx);
+
+  switch (result) {
+  case SQUID_LOG_TCP_HIT:
+  case SQUID_LOG_TCP_IMS_HIT:
+  case SQUID_LOG_TCP_REFRESH_HIT:
+  case SQUID_LOG_TCP_DISK_HIT:
+  case SQUID_LOG_TCP_MEM_HIT:
+  case SQUID_LOG_TCP_REF_FAIL_HIT:
+  case SQUID_LOG_UDP_HIT:
+  case SQUID_LOG_UDP_WEAK_HIT:
+  case SQUID_LOG_UDP_HIT_OBJ:
+    ++(u.hits);
+    break;
+  case SQUID_LOG_TCP_MISS:
+  case SQUID_LOG_TCP_IMS_MISS:
+  case SQUID_LOG_TCP_REFRESH_MISS:
+  case SQUID_LOG_TCP_EXPIRED_MISS:
+  case SQUID_LOG_TCP_WEBFETCH_MISS:
+  case SQUID_LOG_UDP_MISS:
+    ++(u.misses);
+    break;
+  case SQUID_LOG_ERR_CLIENT_ABORT:
+  case SQUID_LOG_ERR_CLIENT_ABORT_HIT:
+  case SQUID_LOG_ERR_CLIENT_ABORT_MISS:
+  case SQUID_LOG_ERR_CONNECT_FAIL:
+  case SQUID_LOG_ERR_INVALID_REQ:
+  case SQUID_LOG_ERR_UNKNOWN:
+  case SQUID_LOG_ERR_READ_TIMEOUT:
+    ++(u.errors);
+    break;
+  }
+
+  update_elapsed(u.time, time);
+}
+
+// Print the JSON stats of one URL. A non-negative error is the amount by
+// which "total" may overcount (see UrlTopK).
+void
+dump_url(const UrlStats &u, int as_object, int64_t total = -1, int64_t error = -1)
+{
+  if (as_object)
+    std::cout << "  \"" << u.url << "\" : { ";
+  else
+    std::cout << "  { \"" << u.url << "\" : { ";
+  // Requests
+  std::cout << "\"req\" : { \"total\" : \"" << (total >= 0 ? total : u.req.count);
+  if (error >= 0)
+    std::cout << "\", \"error\" : \"" << error << "\", \"seen\" : \"" << u.req.count;
+  std::cout << "\", \"hits\" : \"" <<  u.hits <<
+    "\", \"misses\" : \"" <<  u.misses <<
+    "\", \"errors\" : \"" <<  u.errors <<
+    "\", \"000\" : \"" <<  u.c_000 <<
+    "\", \"2xx\" : \"" <<  u.c_2xx <<
+    "\", \"3xx\" : \"" <<  u.c_3xx <<
+    "\", \"4xx\" : \"" <<  u.c_4xx <<
+    "\", \"5xx\" : \"" <<  u.c_5xx << "\" }, ";
+  std:: cout << "\"bytes\" : \"" << u.req.bytes << "\", ";
+  // Service times
+  std::cout << "\"svc_t\" : { \"min\" : \"" << u.time.min <<
+    "\", \"max\" : \"" << u.time.max <<
+    "\", \"avg\" : \"" << std::setiosflags(ios::fixed) << std::setprecision(2) << elapsed_avg(u.time) <<
+    "\", \"dev\" : \"" << std::setiosflags(ios::fixed) << std::setprecision(2) << elapsed_stddev(u.time);
+
+  if (as_object)
+    std::cout << "\" } }," << std::endl;
+  else
+    std::cout << "\" } } }," << std::endl;
+}
+
+// Add the stats of other to those of u, for the same URL
+inline void
+merge_url(UrlStats &u, const UrlStats &other)
+{
+  merge_elapsed(u.time, other.time);
+  u.req.count += other.req.count;
+  u.req.bytes += other.req.bytes;
+  u.c_000 += other.c_000;
+  u.c_2xx += other.c_2xx;
+  u.c_3xx += other.c_3xx;
+  u.c_4xx += other.c_4xx;
+  u.c_5xx += other.c_5xx;
+  u.hits += other.hits;
+  u.misses += other.misses;
+  u.errors += other.errors;
+}
+
+
 // LRU class for the URL data
-void  update_elapsed(ElapsedStats &stat, const int elapsed, const StatsCounter &counter);
 
 class UrlLru
 {
@@ -404,52 +518,7 @@ public:
     if (h != _hash.end()) {
       LruStack::iterator &l = h->second;
 
-      ++(l->req.count);
-      l->req.bytes += bytes;
-
-      if ((http_code >= 600) || (http_code < 200))
-        ++(l->c_000);
-      else if (http_code >= 500)
-        ++(l->c_5xx);
-      else if (http_code >= 400)
-        ++(l->c_4xx);
-      else if (http_code >= 300)
-        ++(l->c_3xx);
-      else // http_code >= 200
-        ++(l->c_2xx);
-
-      switch (result) {
-      case SQUID_LOG_TCP_HIT:
-      case SQUID_LOG_TCP_IMS_HIT:
-      case SQUID_LOG_TCP_REFRESH_HIT:
-      case SQUID_LOG_TCP_DISK_HIT:
-      case SQUID_LOG_TCP_MEM_HIT:
-      case SQUID_LOG_TCP_REF_FAIL_HIT:
-      case SQUID_LOG_UDP_HIT:
-      case SQUID_LOG_UDP_WEAK_HIT:
-      case SQUID_LOG_UDP_HIT_OBJ:
-        ++(l->hits);
-        break;
-      case SQUID_LOG_TCP_MISS:
-      case SQUID_LOG_TCP_IMS_MISS:
-      case SQUID_LOG_TCP_REFRESH_MISS:
-      case SQUID_LOG_TCP_EXPIRED_MISS:
-      case SQUID_LOG_TCP_WEBFETCH_MISS:
-      case SQUID_LOG_UDP_MISS:
-        ++(l->misses);
-        break;
-      case SQUID_LOG_ERR_CLIENT_ABORT:
-      case SQUID_LOG_ERR_CLIENT_ABORT_HIT:
-      case SQUID_LOG_ERR_CLIENT_ABORT_MISS:
-      case SQUID_LOG_ERR_CONNECT_FAIL:
-      case SQUID_LOG_ERR_INVALID_REQ:
-      case SQUID_LOG_ERR_UNKNOWN:
-      case SQUID_LOG_ERR_READ_TIMEOUT:
-        ++(l->errors);
-        break;
-      }
-
-      update_elapsed(l->time, time, l->req);
+      update_url(*l, bytes, time, result, http_code);
       // Move this entry to the top of the stack (hence, LRU)
       if (_size > 0)
         _stack.splice(_stack.begin(), _stack, l);
@@ -522,7 +591,7 @@ public:
 
       l->time.min = -1;
       l->time.max = -1;
-      update_elapsed(l->time, time, l->req);
+      update_elapsed(l->time, time);
       _hash[u] = l;
 
       // We running a real LRU or not?
@@ -554,31 +623,7 @@ private:
   void
   _dump_url(LruStack::iterator &u, int as_object)
   {
-    if (as_object)
-      std::cout << "  \"" << u->url << "\" : { ";
-    else
-      std::cout << "  { \"" << u->url << "\" : { ";
-    // Requests
-    std::cout << "\"req\" : { \"total\" : \"" << u->req.count <<
-      "\", \"hits\" : \"" <<  u->hits << 
-      "\", \"misses\" : \"" <<  u->misses << 
-      "\", \"errors\" : \"" <<  u->errors <<
-      "\", \"000\" : \"" <<  u->c_000 <<
-      "\", \"2xx\" : \"" <<  u->c_2xx <<
-      "\", \"3xx\" : \"" <<  u->c_3xx <<
-      "\", \"4xx\" : \"" <<  u->c_4xx <<
-      "\", \"5xx\" : \"" <<  u->c_5xx << "\" }, ";
-    std:: cout << "\"bytes\" : \"" << u->req.bytes << "\", ";
-    // Service times
-    std::cout << "\"svc_t\" : { \"min\" : \"" << u->time.min <<
-      "\", \"max\" : \"" << u->time.max <<
-      "\", \"avg\" : \"" << std::setiosflags(ios::fixed) << std::setprecision(2) << u->time.avg <<
-      "\", \"dev\" : \"" << std::setiosflags(ios::fixed) << std::setprecision(2) << u->time.stddev;
-
-    if (as_object)
-      std::cout << "\" } }," << std::endl;
-    else
-      std::cout << "\" } } }," << std::endl;
+    dump_url(*u, as_object);
   }
 
   LruHash _hash;
@@ -589,12 +634,241 @@ private:
 
 
 ///////////////////////////////////////////////////////////////////////////////
+// Top URLs in bounded memory, using the Space-Saving heavy hitters algorithm:
+// a URL that is not tracked replaces the one with the lowest count and
+// inherits that count as its error, so that a URL's true number of requests
+// is between count - error and count. Any URL seen more than N / size times
+// (N requests in total) is guaranteed to be tracked. The other stats of an
+// entry only cover the requests seen since it was last (re)placed.
+//
+// Two sketches can be merged, which is how the per-thread results of a
+// parallel run are combined.
+class UrlTopK
+{
+  struct Entry
+  {
+    bool operator < (const Entry& rhs) const  { return count < rhs.count;  }
+
+    UrlStats stats;
+    int64_t count;
+    int64_t error;
+  };
+
+  typedef vector<Entry> TopHeap; // A min heap on count
+  typedef hash_map<const char *, int, hash <const char *>, eqstr> TopHash;
+
+public:
+  UrlTopK(int show_urls, int size)
+    : _show_urls(show_urls), _size(size > 0 ? size : 1)
+  {
+    _heap.reserve(_size);
+  }
+
+  ~UrlTopK()
+  {
+    for (TopHeap::iterator e = _heap.begin(); e != _heap.end(); ++e)
+      ats_free(const_cast<char*>(e->stats.url));
+  }
+
+  void
+  add_stat(const char* url, int64_t bytes, int time, int result, int http_code)
+  {
+    TopHash::iterator h = _hash.find(url);
+    int i;
+
+    if (h != _hash.end()) {
+      i = h->second;
+      ++(_heap[i].count);
+      update_url(_heap[i].stats, bytes, time, result, http_code);
+      _sift_down(i);
+    } else if (static_cast<int>(_heap.size()) < _size) {
+      _heap.push_back(_new_entry(url, 0));
+      i = _heap.size() - 1;
+      _hash[_heap[i].stats.url] = i;
+      update_url(_heap[i].stats, bytes, time, result, http_code);
+      _sift_up(i);
+    } else {
+      Entry &e = _heap[0];
+
+      _hash.erase(e.stats.url);
+      ats_free(const_cast<char*>(e.stats.url));
+      e = _new_entry(url, e.count);
+      _hash[e.stats.url] = 0;
+      update_url(e.stats, bytes, time, result, http_code);
+      _sift_down(0);
+    }
+  }
+
+  // Merge other into this sketch, other is left empty.
+  void
+  merge(UrlTopK &other)
+  {
+    int64_t min = _full() ? _heap[0].count : 0;
+    int64_t other_min = other._full() ? other._heap[0].count : 0;
+    TopHeap all;
+
+    // A URL missing from a full sketch may have had up to its lowest count
+    all.reserve(_heap.size() + other._heap.size());
+    for (TopHeap::iterator e = _heap.begin(); e != _heap.end(); ++e) {
+      TopHash::iterator h = other._hash.find(e->stats.url);
+
+      if (h != other._hash.end()) {
+        Entry &o = other._heap[h->second];
+
+        e->count += o.count;
+        e->error += o.error;
+        merge_url(e->stats, o.stats);
+        o.count = -1; // Merged, other's hash still refers to the URL
+      } else {
+        e->count += other_min;
+        e->error += other_min;
+      }
+      all.push_back(*e);
+    }
+    for (TopHeap::iterator o = other._heap.begin(); o != other._heap.end(); ++o) {
+      if (o->count < 0) {
+        ats_free(const_cast<char*>(o->stats.url));
+      } else {
+        o->count += min;
+        o->error += min;
+        all.push_back(*o);
+      }
+    }
+    other._heap.clear();
+    other._hash.clear();
+
+    // Keep the top _size, sorted ascending they already form a heap.
+    sort(all.begin(), all.end());
+    if (static_cast<int>(all.size()) > _size) {
+      int drop = all.size() - _size;
+
+      for (int i = 0; i < drop; ++i)
+        ats_free(const_cast<char*>(all[i].stats.url));
+      all.erase(all.begin(), all.begin() + drop);
+    }
+    _heap.swap(all);
+    _hash.clear();
+    for (int i = 0; i < static_cast<int>(_heap.size()); ++i)
+      _hash[_heap[i].stats.url] = i;
+  }
+
+  // The stats of url with its count and error, NULL if it is not tracked.
+  const UrlStats *
+  find(const char *url, int64_t *count, int64_t *error) const
+  {
+    TopHash::const_iterator h = _hash.find(url);
+
+    if (h == _hash.end())
+      return NULL;
+    *count = _heap[h->second].count;
+    *error = _heap[h->second].error;
+    return &_heap[h->second].stats;
+  }
+
+  void
+  dump(int as_object=0)
+  {
+    TopHeap sorted(_heap);
+    int show = sorted.size();
+
+    if (_show_urls > 0 && _show_urls < show)
+      show = _show_urls;
+
+    sort(sorted.begin(), sorted.end());
+    for (TopHeap::reverse_iterator e = sorted.rbegin(); --show >= 0; ++e)
+      dump_url(e->stats, as_object, e->count, e->error);
+    if (as_object)
+      std::cout << "  \"_timestamp\" : \"" << static_cast<int>(ink_time_wall_seconds()) << "\"" << std::endl;
+    else
+      std::cout << "  { \"_timestamp\" : \"" << static_cast<int>(ink_time_wall_seconds()) << "\" }" << std::endl;
+  }
+
+private:
+  bool
+  _full() const
+  {
+    return static_cast<int>(_heap.size()) >= _size;
+  }
+
+  Entry
+  _new_entry(const char *url, int64_t error)
+  {
+    Entry e;
+
+    memset(&e, 0, sizeof(e));
+    e.stats.url = ats_strdup(url); // We own it.
+    e.stats.time.min = -1;
+    e.stats.time.max = -1;
+    e.count = error + 1;
+    e.error = error;
+    return e;
+  }
+
+  void
+  _swap(int a, int b)
+  {
+    std::swap(_heap[a], _heap[b]);
+    _hash[_heap[a].stats.url] = a;
+    _hash[_heap[b].stats.url] = b;
+  }
+
+  void
+  _sift_up(int i)
+  {
+    while (i > 0 && _heap[i].count < _heap[(i - 1) / 2].count) {
+      _swap(i, (i - 1) / 2);
+      i = (i - 1) / 2;
+    }
+  }
+
+  void
+  _sift_down(int i)
+  {
+    int n = _heap.size();
+
+    while (true) {
+      int smallest = i, l = 2 * i + 1, r = 2 * i + 2;
+
+      if (l < n && _heap[l].count < _heap[smallest].count)
+        smallest = l;
+      if (r < n && _heap[r].count < _heap[smallest].count)
+        smallest = r;
+      if (smallest == i)
+        break;
+      _swap(i, smallest);
+      i = smallest;
+    }
+  }
+
+  TopHeap _heap;
+  TopHash _hash;
+  int _show_urls, _size;
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Stats collected from the log, by one parsing thread or all combined
+inline void init_elapsed(OriginStats *stats);
+
+struct StatsAggregate
+{
+  OriginStats totals;
+  OriginStorage origins;
+  UrlTopK *top_urls;
+  int parse_errors;
+
+  StatsAggregate()
+    : top_urls(NULL), parse_errors(0)
+  {
+    memset(&totals, 0, sizeof(totals));
+    init_elapsed(&totals);
+  }
+};
+
 // Globals, holding the accumulated stats (ok, I'm lazy ...)
-static OriginStats totals;
-static OriginStorage origins;
+static StatsAggregate stats;
 static OriginSet *origin_set;
 static UrlLru *urls;
-static int parse_errors;
 
 // Command line arguments (parsing)
 struct CommandLineArgs
@@ -615,12 +889,16 @@ struct CommandLineArgs
   int urls;			// Produce JSON output of URL stats, arg is LRU size
   int show_urls;		// Max URLs to show
   int as_object;		// Show the URL stats as a single JSON object (not array)
+  int top_urls;			// Produce JSON output of the top URLs, arg is how many
+  int threads;			// Number of threads parsing the log
+  int regression;		// Run the regression tests
   int version;
   int help;
 
   CommandLineArgs()
     : max_origins(0), min_hits(0), max_age(0), line_len(DEFAULT_LINE_LEN), incremental(0),
-      tail(0), summary(0), json(0), cgi(0), urls(0), show_urls(0), as_object(0), version(0), help(0)
+      tail(0), summary(0), json(0), cgi(0), urls(0), show_urls(0), as_object(0), top_urls(0),
+      threads(1), regression(0), version(0), help(0)
   {
     log_file[0] = '\0';
     origin_file[0] = '\0';
@@ -642,6 +920,8 @@ static ArgumentDescription argument_descriptions[] = {
   {"urls", 'u', "Produce JSON stats for URLs, argument is LRU size", "I", &cl.urls, NULL, NULL},
   {"show_urls", 'U', "Only show max this number of URLs", "I", &cl.show_urls, NULL, NULL},
   {"as_object", 'A', "Produce URL stats as a JSON object instead of array", "T", &cl.as_object, NULL, NULL},
+  {"top_urls", 'k', "Produce JSON stats for the top <N> URLs, in bounded memory", "I", &cl.top_urls, NULL, NULL},
+  {"threads", 'p', "Number of threads parsing the log", "I", &cl.threads, NULL, NULL},
   {"incremental", 'i', "Incremental log parsing", "T", &cl.incremental, NULL, NULL},
   {"statetag", 'S', "Name of the state file to use", "S1023", cl.state_tag, NULL, NULL},
   {"tail", 't', "Parse the last <sec> seconds of log", "I", &cl.tail, NULL, NULL},
@@ -652,6 +932,9 @@ static ArgumentDescription argument_descriptions[] = {
   {"max_age", 'a', "Max age for log entries to be considered", "I", &cl.max_age, NULL, NULL},
   {"line_len", 'l', "Output line length", "I", &cl.line_len, NULL, NULL},
   {"debug_tags", 'T', "Colon-Separated Debug Tags", "S1023", &error_tags, NULL, NULL},
+#if TS_HAS_TESTS
+  {"regression", 'R', "Run the regression tests and exit", "T", &cl.regression, NULL, NULL},
+#endif
   {"version", 'V', "Print Version Id", "T", &cl.version, NULL, NULL},
 };
 
@@ -696,6 +979,8 @@ CommandLineArgs::parse_arguments(char** argv)
           show_urls = strtol(val, NULL, 10);
         } else if (0 == strncmp(tok, "as_object", 9)) {
           as_object = strtol(val, NULL, 10);
+        } else if (0 == strncmp(tok, "top_urls", 8)) {
+          top_urls = strtol(val, NULL, 10);
         } else if (0 == strncmp(tok, "min_hits", 8)) {
           min_hits = strtol(val, NULL, 10);
         } else if (0 == strncmp(tok, "incremental", 11)) {
@@ -709,6 +994,13 @@ CommandLineArgs::parse_arguments(char** argv)
     }
   }
 
+  // The top URLs replace the LRU, which needs the log entries in order and
+  // so only works single threaded.
+  if (top_urls > 0)
+    urls = 0;
+  if (urls || threads < 1)
+    threads = 1;
+
   // check for the version number request
   if (version) {
     std::cerr << appVersionInfo.FullVersionInfoStr << std::endl;
@@ -824,13 +1116,22 @@ update_counter(StatsCounter& counter, int size)
   counter.bytes += size;
 }
 
+// Add hi:lo to a 128 bit sum of squares
 inline void
-update_elapsed(ElapsedStats &stat, const int elapsed, const StatsCounter &counter)
+add_sum_sq(uint64_t *sum_sq, uint64_t hi, uint64_t lo)
 {
-  int newcount, oldcount;
-  float oldavg, newavg, sum_of_squares;
+  sum_sq[1] += lo;
+  sum_sq[0] += hi + (sum_sq[1] < lo ? 1 : 0);
+}
+
+inline void
+update_elapsed(ElapsedStats &stat, const int elapsed)
+{
+  ++stat.count;
+  stat.sum += elapsed;
+  add_sum_sq(stat.sum_sq, 0, static_cast<uint64_t>(static_cast<int64_t>(elapsed) * elapsed));
 
-  // Skip all the "0" values.
+  // Skip all the "0" values for the min and max.
   if (0 == elapsed)
     return;
   if (-1 == stat.min)
@@ -840,32 +1141,44 @@ update_elapsed(ElapsedStats &stat, const int elapsed, const StatsCounter &counte
 
   if (stat.max < elapsed)
     stat.max = elapsed;
+}
 
-  // update_counter should have been called on counter.count before calling
-  // update_elapsed.
-  newcount = counter.count;
-  // New count should never be zero, else there was a programming error.
-  ink_release_assert(newcount);
-  oldcount = counter.count - 1;
-  oldavg = stat.avg;
-  newavg = (oldavg * oldcount + elapsed) / newcount;
-  // Now find the new standard deviation from the old one
-
-  if (oldcount != 0)
-    sum_of_squares = (stat.stddev * stat.stddev * oldcount);
-  else
-    sum_of_squares = 0;
+// Add the elapsed stats of other to those of stat, the result is the same
+// no matter how the values were split between the two.
+void
+merge_elapsed(ElapsedStats &stat, const ElapsedStats &other)
+{
+  stat.count += other.count;
+  stat.sum += other.sum;
+  add_sum_sq(stat.sum_sq, other.sum_sq[0], other.sum_sq[1]);
+
+  if (-1 == other.min)
+    return;
+  if ((-1 == stat.min) || (stat.min > other.min))
+    stat.min = other.min;
+  if (stat.max < other.max)
+    stat.max = other.max;
+}
 
-  //Find the old sum of squares.
-  sum_of_squares = sum_of_squares + 2 * oldavg * oldcount * (oldavg - newavg)
-    + oldcount * (newavg * newavg - oldavg * oldavg);
+double
+elapsed_avg(const ElapsedStats &stat)
+{
+  if (0 == stat.count)
+    return 0.0;
+  return static_cast<double>(stat.sum) / stat.count;
+}
 
-  //Now, find the new sum of squares.
-  sum_of_squares = sum_of_squares + (elapsed - newavg) * (elapsed - newavg);
+double
+elapsed_stddev(const ElapsedStats &stat)
+{
+  long double mean, variance;
 
-  stat.stddev = sqrt(sum_of_squares / newcount);
-  stat.avg = newavg;
+  if (0 == stat.count)
+    return 0.0;
+  mean = static_cast<long double>(stat.sum) / stat.count;
+  variance = (ldexpl(stat.sum_sq[0], 64) + stat.sum_sq[1]) / stat.count - mean * mean;
 
+  return variance > 0 ? sqrt(static_cast<double>(variance)) : 0.0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -877,38 +1190,38 @@ update_results_elapsed(OriginStats * stat, int result, int elapsed, int size)
   case SQUID_LOG_TCP_HIT:
     update_counter(stat->results.hits.hit, size);
     update_counter(stat->results.hits.total, size);
-    update_elapsed(stat->elapsed.hits.hit, elapsed, stat->results.hits.hit);
-    update_elapsed(stat->elapsed.hits.total, elapsed, stat->results.hits.total);
+    update_elapsed(stat->elapsed.hits.hit, elapsed);
+    update_elapsed(stat->elapsed.hits.total, elapsed);
     break;
   case SQUID_LOG_TCP_MISS:
     update_counter(stat->results.misses.miss, size);
     update_counter(stat->results.misses.total, size);
-    update_elapsed(stat->elapsed.misses.miss, elapsed, stat->results.misses.miss);
-    update_elapsed(stat->elapsed.misses.total, elapsed, stat->results.misses.total);
+    update_elapsed(stat->elapsed.misses.miss, elapsed);
+    update_elapsed(stat->elapsed.misses.total, elapsed);
     break;
   case SQUID_LOG_TCP_IMS_HIT:
     update_counter(stat->results.hits.ims, size);
     update_counter(stat->results.hits.total, size);
-    update_elapsed(stat->elapsed.hits.ims, elapsed, stat->results.hits.ims);
-    update_elapsed(stat->elapsed.hits.total, elapsed, stat->results.hits.total);
+    update_elapsed(stat->elapsed.hits.ims, elapsed);
+    update_elapsed(stat->elapsed.hits.total, elapsed);
     break;
   case SQUID_LOG_TCP_IMS_MISS:
     update_counter(stat->results.misses.ims, size);
     update_counter(stat->results.misses.total, size);
-    update_elapsed(stat->elapsed.misses.ims, elapsed, stat->results.misses.ims);
-    update_elapsed(stat->elapsed.misses.total, elapsed, stat->results.misses.total);
+    update_elapsed(stat->elapsed.misses.ims, elapsed);
+    update_elapsed(stat->elapsed.misses.total, elapsed);
     break;
   case SQUID_LOG_TCP_REFRESH_HIT:
     update_counter(stat->results.hits.refresh, size);
     update_counter(stat->results.hits.total, size);
-    update_elapsed(stat->elapsed.hits.refresh, elapsed, stat->results.hits.refresh);
-    update_elapsed(stat->elapsed.hits.total, elapsed, stat->results.hits.total);
+    update_elapsed(stat->elapsed.hits.refresh, elapsed);
+    update_elapsed(stat->elapsed.hits.total, elapsed);
     break;
   case SQUID_LOG_TCP_REFRESH_MISS:
     update_counter(stat->results.misses.refresh, size);
     update_counter(stat->results.misses.total, size);
-    update_elapsed(stat->elapsed.misses.refresh, elapsed, stat->results.misses.refresh);
-    update_elapsed(stat->elapsed.misses.total, elapsed, stat->results.misses.total);
+    update_elapsed(stat->elapsed.misses.refresh, elapsed);
+    update_elapsed(stat->elapsed.misses.total, elapsed);
     break;
   case SQUID_LOG_ERR_CLIENT_ABORT:
   case SQUID_LOG_ERR_CLIENT_ABORT_HIT:
@@ -936,16 +1249,16 @@ update_results_elapsed(OriginStats * stat, int result, int elapsed, int size)
   case SQUID_LOG_UDP_HIT_OBJ:
     update_counter(stat->results.hits.other, size);
     update_counter(stat->results.hits.total, size);
-    update_elapsed(stat->elapsed.hits.other, elapsed, stat->results.hits.other);
-    update_elapsed(stat->elapsed.hits.total, elapsed, stat->results.hits.total);
+    update_elapsed(stat->elapsed.hits.other, elapsed);
+    update_elapsed(stat->elapsed.hits.total, elapsed);
     break;
   case SQUID_LOG_TCP_EXPIRED_MISS:
   case SQUID_LOG_TCP_WEBFETCH_MISS:
   case SQUID_LOG_UDP_MISS:
     update_counter(stat->results.misses.other, size);
     update_counter(stat->results.misses.total, size);
-    update_elapsed(stat->elapsed.misses.other, elapsed, stat->results.misses.other);
-    update_elapsed(stat->elapsed.misses.total, elapsed, stat->results.misses.total);
+    update_elapsed(stat->elapsed.misses.other, elapsed);
+    update_elapsed(stat->elapsed.misses.total, elapsed);
     break;
   default:
     if ((result >= SQUID_LOG_ERR_READ_TIMEOUT) && (result <= SQUID_LOG_ERR_UNKNOWN)) {
@@ -1176,13 +1489,194 @@ update_schemes(OriginStats * stat, int scheme, int size)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Add the stats of other to those of stat, for the same Origin
+inline void
+merge_counter(StatsCounter &counter, const StatsCounter &other)
+{
+  counter.count += other.count;
+  counter.bytes += other.bytes;
+}
+
+void
+merge_origin(OriginStats * stat, const OriginStats * other)
+{
+  merge_counter(stat->total, other->total);
+
+  merge_elapsed(stat->elapsed.hits.hit, other->elapsed.hits.hit);
+  merge_elapsed(stat->elapsed.hits.ims, other->elapsed.hits.ims);
+  merge_elapsed(stat->elapsed.hits.refresh, other->elapsed.hits.refresh);
+  merge_elapsed(stat->elapsed.hits.other, other->elapsed.hits.other);
+  merge_elapsed(stat->elapsed.hits.total, other->elapsed.hits.total);
+  merge_elapsed(stat->elapsed.misses.miss, other->elapsed.misses.miss);
+  merge_elapsed(stat->elapsed.misses.ims, other->elapsed.misses.ims);
+  merge_elapsed(stat->elapsed.misses.refresh, other->elapsed.misses.refresh);
+  merge_elapsed(stat->elapsed.misses.other, other->elapsed.misses.other);
+  merge_elapsed(stat->elapsed.misses.total, other->elapsed.misses.total);
+
+  merge_counter(stat->results.hits.hit, other->results.hits.hit);
+  merge_counter(stat->results.hits.ims, other->results.hits.ims);
+  merge_counter(stat->results.hits.refresh, other->results.hits.refresh);
+  merge_counter(stat->results.hits.other, other->results.hits.other);
+  merge_counter(stat->results.hits.total, other->results.hits.total);
+  merge_counter(stat->results.misses.miss, other->results.misses.miss);
+  merge_counter(stat->results.misses.ims, other->results.misses.ims);
+  merge_counter(stat->results.misses.refresh, other->results.misses.refresh);
+  merge_counter(stat->results.misses.other, other->results.misses.other);
+  merge_counter(stat->results.misses.total, other->results.misses.total);
+  merge_counter(stat->results.errors.client_abort, other->results.errors.client_abort);
+  merge_counter(stat->results.errors.connect_fail, other->results.errors.connect_fail);
+  merge_counter(stat->results.errors.invalid_req, other->results.errors.invalid_req);
+  merge_counter(stat->results.errors.unknown, other->results.errors.unknown);
+  merge_counter(stat->results.errors.other, other->results.errors.other);
+  merge_counter(stat->results.errors.total, other->results.errors.total);
+  merge_counter(stat->results.other, other->results.other);
+
+  merge_counter(stat->codes.c_000, other->codes.c_000);
+  merge_counter(stat->codes.c_100, other->codes.c_100);
+  merge_counter(stat->codes.c_200, other->codes.c_200);
+  merge_counter(stat->codes.c_201, other->codes.c_201);
+  merge_counter(stat->codes.c_202, other->codes.c_202);
+  merge_counter(stat->codes.c_203, other->codes.c_203);
+  merge_counter(stat->codes.c_204, other->codes.c_204);
+  merge_counter(stat->codes.c_205, other->codes.c_205);
+  merge_counter(stat->codes.c_206, other->codes.c_206);
+  merge_counter(stat->codes.c_2xx, other->codes.c_2xx);
+  merge_counter(stat->codes.c_300, other->codes.c_300);
+  merge_counter(stat->codes.c_301, other->codes.c_301);
+  merge_counter(stat->codes.c_302, other->codes.c_302);
+  merge_counter(stat->codes.c_303, other->codes.c_303);
+  merge_counter(stat->codes.c_304, other->codes.c_304);
+  merge_counter(stat->codes.c_305, other->codes.c_305);
+  merge_counter(stat->codes.c_307, other->codes.c_307);
+  merge_counter(stat->codes.c_3xx, other->codes.c_3xx);
+  merge_counter(stat->codes.c_400, other->codes.c_400);
+  merge_counter(stat->codes.c_401, other->codes.c_401);
+  merge_counter(stat->codes.c_402, other->codes.c_402);
+  merge_counter(stat->codes.c_403, other->codes.c_403);
+  merge_counter(stat->codes.c_404, other->codes.c_404);
+  merge_counter(stat->codes.c_405, other->codes.c_405);
+  merge_counter(stat->codes.c_406, other->codes.c_406);
+  merge_counter(stat->codes.c_407, other->codes.c_407);
+  merge_counter(stat->codes.c_408, other->codes.c_408);
+  merge_counter(stat->codes.c_409, other->codes.c_409);
+  merge_counter(stat->codes.c_410, other->codes.c_410);
+  merge_counter(stat->codes.c_411, other->codes.c_411);
+  merge_counter(stat->codes.c_412, other->codes.c_412);
+  merge_counter(stat->codes.c_413, other->codes.c_413);
+  merge_counter(stat->codes.c_414, other->codes.c_414);
+  merge_counter(stat->codes.c_415, other->codes.c_415);
+  merge_counter(stat->codes.c_416, other->codes.c_416);
+  merge_counter(stat->codes.c_417, other->codes.c_417);
+  merge_counter(stat->codes.c_4xx, other->codes.c_4xx);
+  merge_counter(stat->codes.c_500, other->codes.c_500);
+  merge_counter(stat->codes.c_501, other->codes.c_501);
+  merge_counter(stat->codes.c_502, other->codes.c_502);
+  merge_counter(stat->codes.c_503, other->codes.c_503);
+  merge_counter(stat->codes.c_504, other->codes.c_504);
+  merge_counter(stat->codes.c_505, other->codes.c_505);
+  merge_counter(stat->codes.c_5xx, other->codes.c_5xx);
+
+  merge_counter(stat->hierarchies.direct, other->hierarchies.direct);
+  merge_counter(stat->hierarchies.none, other->hierarchies.none);
+  merge_counter(stat->hierarchies.sibling, other->hierarchies.sibling);
+  merge_counter(stat->hierarchies.parent, other->hierarchies.parent);
+  merge_counter(stat->hierarchies.empty, other->hierarchies.empty);
+  merge_counter(stat->hierarchies.invalid, other->hierarchies.invalid);
+  merge_counter(stat->hierarchies.other, other->hierarchies.other);
+
+  merge_counter(stat->schemes.http, other->schemes.http);
+  merge_counter(stat->schemes.https, other->schemes.https);
+  merge_counter(stat->schemes.none, other->schemes.none);
+  merge_counter(stat->schemes.other, other->schemes.other);
+
+  merge_counter(stat->methods.options, other->methods.options);
+  merge_counter(stat->methods.get, other->methods.get);
+  merge_counter(stat->methods.head, other->methods.head);
+  merge_counter(stat->methods.post, other->methods.post);
+  merge_counter(stat->methods.put, other->methods.put);
+  merge_counter(stat->methods.del, other->methods.del);
+  merge_counter(stat->methods.trace, other->methods.trace);
+  merge_counter(stat->methods.connect, other->methods.connect);
+  merge_counter(stat->methods.purge, other->methods.purge);
+  merge_counter(stat->methods.none, other->methods.none);
+  merge_counter(stat->methods.other, other->methods.other);
+
+  merge_counter(stat->content.text.plain, other->content.text.plain);
+  merge_counter(stat->content.text.xml, other->content.text.xml);
+  merge_counter(stat->content.text.html, other->content.text.html);
+  merge_counter(stat->content.text.css, other->content.text.css);
+  merge_counter(stat->content.text.javascript, other->content.text.javascript);
+  merge_counter(stat->content.text.other, other->content.text.other);
+  merge_counter(stat->content.text.total, other->content.text.total);
+  merge_counter(stat->content.image.jpeg, other->content.image.jpeg);
+  merge_counter(stat->content.image.gif, other->content.image.gif);
+  merge_counter(stat->content.image.png, other->content.image.png);
+  merge_counter(stat->content.image.bmp, other->content.image.bmp);
+  merge_counter(stat->content.image.other, other->content.image.other);
+  merge_counter(stat->content.image.total, other->content.image.total);
+  merge_counter(stat->content.application.shockwave_flash, other->content.application.shockwave_flash);
+  merge_counter(stat->content.application.quicktime, other->content.application.quicktime);
+  merge_counter(stat->content.application.javascript, other->content.application.javascript);
+  merge_counter(stat->content.application.zip, other->content.application.zip);
+  merge_counter(stat->content.application.other, other->content.application.other);
+  merge_counter(stat->content.application.rss_xml, other->content.application.rss_xml);
+  merge_counter(stat->content.application.rss_atom, other->content.application.rss_atom);
+  merge_counter(stat->content.application.rss_other, other->content.application.rss_other);
+  merge_counter(stat->content.application.total, other->content.application.total);
+  merge_counter(stat->content.audio.wav, other->content.audio.wav);
+  merge_counter(stat->content.audio.mpeg, other->content.audio.mpeg);
+  merge_counter(stat->content.audio.other, other->content.audio.other);
+  merge_counter(stat->content.audio.total, other->content.audio.total);
+  merge_counter(stat->content.none, other->content.none);
+  merge_counter(stat->content.other, other->content.other);
+}
+
+// Move the stats collected in other into agg
+void
+merge_stats(StatsAggregate &agg, StatsAggregate &other)
+{
+  merge_origin(&agg.totals, &other.totals);
+
+  for (OriginStorage::iterator i = other.origins.begin(); i != other.origins.end(); ++i) {
+    OriginStorage::iterator o_iter = agg.origins.find(i->first);
+
+    if (agg.origins.end() == o_iter) {
+      agg.origins[i->first] = i->second;
+    } else {
+      merge_origin(o_iter->second, i->second);
+      ats_free(const_cast<char*>(i->second->server));
+      ats_free(i->second);
+    }
+  }
+  other.origins.clear();
+
+  if (agg.top_urls && other.top_urls)
+    agg.top_urls->merge(*other.top_urls);
+  agg.parse_errors += other.parse_errors;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// The field list of the log format, it is the same for every buffer
+static LogFieldList *fieldlist = NULL;
+
+void
+init_fieldlist(LogBufferHeader * buf_header)
+{
+  if (!fieldlist) {
+    fieldlist = NEW(new LogFieldList);
+    ink_assert(fieldlist != NULL);
+    bool agg = false;
+    LogFormat::parse_symbol_string(buf_header->fmt_fieldlist(), fieldlist, &agg);
+  }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Parse a log buffer
 int
-parse_log_buff(LogBufferHeader * buf_header, bool summary = false)
+parse_log_buff(LogBufferHeader * buf_header, StatsAggregate &agg, bool summary = false)
 {
-  static LogFieldList *fieldlist = NULL;
-
   LogEntryHeader *entry;
   LogBufferIterator buf_iter(buf_header);
   LogField *field;
@@ -1202,12 +1696,8 @@ parse_log_buff(LogBufferHeader * buf_header, bool summary = false)
   HTTPMethod method;
   URLScheme scheme;
 
-  if (!fieldlist) {
-    fieldlist = NEW(new LogFieldList);
-    ink_assert(fieldlist != NULL);
-    bool agg = false;
-    LogFormat::parse_symbol_string(buf_header->fmt_fieldlist(), fieldlist, &agg);
-  }
+  init_fieldlist(buf_header);
+
   // Loop over all entries
   while ((entry = buf_iter.next())) {
     read_from = (char *) entry + sizeof(LogEntryHeader);
@@ -1321,6 +1811,8 @@ parse_log_buff(LogBufferHeader * buf_header, bool summary = false)
         state = P_STATE_RFC931;
         if (urls)
           urls->add_stat(read_from, size, elapsed, result, http_code, cl.as_object);
+        else if (agg.top_urls)
+          agg.top_urls->add_stat(read_from, size, elapsed, result, http_code);
 
         // TODO check for read_from being empty string
         if (0 == flag) {
@@ -1351,15 +1843,15 @@ parse_log_buff(LogBufferHeader * buf_header, bool summary = false)
             // TODO: If we save state (struct) for a run, we probably need to always
             // update the origin data, no matter what the origin_set is.
             if (origin_set ? (origin_set->find(tok) != origin_set->end()) : 1) {
-              o_iter = origins.find(tok);
-              if (origins.end() == o_iter) {
+              o_iter = agg.origins.find(tok);
+              if (agg.origins.end() == o_iter) {
                 o_stats = (OriginStats *)ats_malloc(sizeof(OriginStats));
                 memset(o_stats, 0, sizeof(OriginStats));
                 init_elapsed(o_stats);
                 o_server = ats_strdup(tok);
                 if (o_stats && o_server) {
                   o_stats->server = o_server;
-                  origins[o_server] = o_stats;
+                  agg.origins[o_server] = o_stats;
                 }
               } else
                 o_stats = o_iter->second;
@@ -1374,11 +1866,11 @@ parse_log_buff(LogBufferHeader * buf_header, bool summary = false)
         read_from += LogAccess::round_strlen(tok_len + 1);
 
         // Update the stats so far, since now we have the Origin (maybe)
-        update_results_elapsed(&totals, result, elapsed, size);
-        update_codes(&totals, http_code, size);
-        update_methods(&totals, method, size);
-        update_schemes(&totals, scheme, size);
-        update_counter(totals.total, size);
+        update_results_elapsed(&agg.totals, result, elapsed, size);
+        update_codes(&agg.totals, http_code, size);
+        update_methods(&agg.totals, method, size);
+        update_schemes(&agg.totals, scheme, size);
+        update_counter(agg.totals.total, size);
         if (o_stats != NULL) {
           update_results_elapsed(o_stats, result, elapsed, size);
           update_codes(o_stats, http_code, size);
@@ -1401,37 +1893,37 @@ parse_log_buff(LogBufferHeader * buf_header, bool summary = false)
         hier = *((int64_t *) (read_from));
         switch (hier) {
         case SQUID_HIER_NONE:
-          update_counter(totals.hierarchies.none, size);
+          update_counter(agg.totals.hierarchies.none, size);
           if (o_stats != NULL)
             update_counter(o_stats->hierarchies.none, size);
           break;
         case SQUID_HIER_DIRECT:
-          update_counter(totals.hierarchies.direct, size);
+          update_counter(agg.totals.hierarchies.direct, size);
           if (o_stats != NULL)
             update_counter(o_stats->hierarchies.direct, size);
           break;
         case SQUID_HIER_SIBLING_HIT:
-          update_counter(totals.hierarchies.sibling, size);
+          update_counter(agg.totals.hierarchies.sibling, size);
           if (o_stats != NULL)
             update_counter(o_stats->hierarchies.sibling, size);
           break;
         case SQUID_HIER_PARENT_HIT:
-          update_counter(totals.hierarchies.parent, size);
+          update_counter(agg.totals.hierarchies.parent, size);
           if (o_stats != NULL)
             update_counter(o_stats->hierarchies.direct, size);
           break;
         case SQUID_HIER_EMPTY:
-          update_counter(totals.hierarchies.empty, size);
+          update_counter(agg.totals.hierarchies.empty, size);
           if (o_stats != NULL)
             update_counter(o_stats->hierarchies.empty, size);
           break;
         default:
           if ((hier >= SQUID_HIER_EMPTY) && (hier < SQUID_HIER_INVALID_ASSIGNED_CODE)) {
-            update_counter(totals.hierarchies.other, size);
+            update_counter(agg.totals.hierarchies.other, size);
             if (o_stats != NULL)
               update_counter(o_stats->hierarchies.other, size);
           } else {
-            update_counter(totals.hierarchies.invalid, size);
+            update_counter(agg.totals.hierarchies.invalid, size);
             if (o_stats != NULL)
               update_counter(o_stats->hierarchies.invalid, size);
           }
@@ -1451,129 +1943,129 @@ parse_log_buff(LogBufferHeader * buf_header, bool summary = false)
       case P_STATE_TYPE:
         state = P_STATE_END;
         if (IMAG_AS_INT == *reinterpret_cast <int*>(read_from)) {
-          update_counter(totals.content.image.total, size);
+          update_counter(agg.totals.content.image.total, size);
           if (o_stats != NULL)
             update_counter(o_stats->content.image.total, size);
           tok = read_from + 6;
           switch (*reinterpret_cast <int*>(tok)) {
           case JPEG_AS_INT:
             tok_len = 10;
-            update_counter(totals.content.image.jpeg, size);
+            update_counter(agg.totals.content.image.jpeg, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.image.jpeg, size);
             break;
           case JPG_AS_INT:
             tok_len = 9;
-            update_counter(totals.content.image.jpeg, size);
+            update_counter(agg.totals.content.image.jpeg, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.image.jpeg, size);
             break;
           case GIF_AS_INT:
             tok_len = 9;
-            update_counter(totals.content.image.gif, size);
+            update_counter(agg.totals.content.image.gif, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.image.gif, size);
             break;
           case PNG_AS_INT:
             tok_len = 9;
-            update_counter(totals.content.image.png, size);
+            update_counter(agg.totals.content.image.png, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.image.png, size);
             break;
           case BMP_AS_INT:
             tok_len = 9;
-            update_counter(totals.content.image.bmp, size);
+            update_counter(agg.totals.content.image.bmp, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.image.bmp, size);
             break;
           default:
             tok_len = 6 + strlen(tok);
-            update_counter(totals.content.image.other, size);
+            update_counter(agg.totals.content.image.other, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.image.other, size);
             break;
           }
         } else if (TEXT_AS_INT == *reinterpret_cast <int*>(read_from)) {
           tok = read_from + 5;
-          update_counter(totals.content.text.total, size);
+          update_counter(agg.totals.content.text.total, size);
           if (o_stats != NULL)
             update_counter(o_stats->content.text.total, size);
           switch (*reinterpret_cast <int*>(tok)) {
           case JAVA_AS_INT:
             // TODO verify if really "javascript"
             tok_len = 15;
-            update_counter(totals.content.text.javascript, size);
+            update_counter(agg.totals.content.text.javascript, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.text.javascript, size);
             break;
           case CSS_AS_INT:
             tok_len = 8;
-            update_counter(totals.content.text.css, size);
+            update_counter(agg.totals.content.text.css, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.text.css, size);
             break;
           case XML_AS_INT:
             tok_len = 8;
-            update_counter(totals.content.text.xml, size);
+            update_counter(agg.totals.content.text.xml, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.text.xml, size);
             break;
           case HTML_AS_INT:
             tok_len = 9;
-            update_counter(totals.content.text.html, size);
+            update_counter(agg.totals.content.text.html, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.text.html, size);
             break;
           case PLAI_AS_INT:
             tok_len = 10;
-            update_counter(totals.content.text.plain, size);
+            update_counter(agg.totals.content.text.plain, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.text.plain, size);
             break;
           default:
             tok_len = 5 + strlen(tok);;
-            update_counter(totals.content.text.other, size);
+            update_counter(agg.totals.content.text.other, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.text.other, size);
             break;
           }
         } else if (0 == strncmp(read_from, "application", 11)) {
           tok = read_from + 12;
-          update_counter(totals.content.application.total, size);
+          update_counter(agg.totals.content.application.total, size);
           if (o_stats != NULL)
             update_counter(o_stats->content.application.total, size);
           switch (*reinterpret_cast <int*>(tok)) {
           case ZIP_AS_INT:
             tok_len = 15;
-            update_counter(totals.content.application.zip, size);
+            update_counter(agg.totals.content.application.zip, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.application.zip, size);
             break;
           case JAVA_AS_INT:
             tok_len = 22;
-            update_counter(totals.content.application.javascript, size);
+            update_counter(agg.totals.content.application.javascript, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.application.javascript, size);
           case X_JA_AS_INT:
             tok_len = 24;
-            update_counter(totals.content.application.javascript, size);
+            update_counter(agg.totals.content.application.javascript, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.application.javascript, size);
             break;
           case RSSp_AS_INT:
             if (0 == strcmp(tok+4, "xml")) {
               tok_len = 19;
-              update_counter(totals.content.application.rss_xml, size);
+              update_counter(agg.totals.content.application.rss_xml, size);
               if (o_stats != NULL)
                 update_counter(o_stats->content.application.rss_xml, size);
             } else if (0 == strcmp(tok+4,"atom")) {
               tok_len = 20;
-              update_counter(totals.content.application.rss_atom, size);
+              update_counter(agg.totals.content.application.rss_atom, size);
               if (o_stats != NULL)
                 update_counter(o_stats->content.application.rss_atom, size);
             } else {
               tok_len = 12 + strlen(tok);
-              update_counter(totals.content.application.rss_other, size);
+              update_counter(agg.totals.content.application.rss_other, size);
               if (o_stats != NULL)
                 update_counter(o_stats->content.application.rss_other, size);
             }
@@ -1581,17 +2073,17 @@ parse_log_buff(LogBufferHeader * buf_header, bool summary = false)
           default:
             if (0 == strcmp(tok, "x-shockwave-flash")) {
               tok_len = 29;
-              update_counter(totals.content.application.shockwave_flash, size);
+              update_counter(agg.totals.content.application.shockwave_flash, size);
               if (o_stats != NULL)
                 update_counter(o_stats->content.application.shockwave_flash, size);
             } else if (0 == strcmp(tok, "x-quicktimeplayer")) {
               tok_len = 29;
-              update_counter(totals.content.application.quicktime, size);
+              update_counter(agg.totals.content.application.quicktime, size);
               if (o_stats != NULL)
                 update_counter(o_stats->content.application.quicktime, size);
             } else {
               tok_len = 12 + strlen(tok);
-              update_counter(totals.content.application.other, size);
+              update_counter(agg.totals.content.application.other, size);
               if (o_stats != NULL)
                 update_counter(o_stats->content.application.other, size);
             }
@@ -1599,30 +2091,30 @@ parse_log_buff(LogBufferHeader * buf_header, bool summary = false)
         } else if (0 == strncmp(read_from, "audio", 5)) {
           tok = read_from + 6;
           tok_len = 6 + strlen(tok);
-          update_counter(totals.content.audio.total, size);
+          update_counter(agg.totals.content.audio.total, size);
           if (o_stats != NULL)
             update_counter(o_stats->content.audio.total, size);
           if ((0 == strcmp(tok, "x-wav")) || (0 == strcmp(tok, "wav"))) {
-            update_counter(totals.content.audio.wav, size);
+            update_counter(agg.totals.content.audio.wav, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.audio.wav, size);
           } else if ((0 == strcmp(tok, "x-mpeg")) || (0 == strcmp(tok, "mpeg"))) {
-            update_counter(totals.content.audio.mpeg, size);
+            update_counter(agg.totals.content.audio.mpeg, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.audio.mpeg, size);
           } else {
-            update_counter(totals.content.audio.other, size);
+            update_counter(agg.totals.content.audio.other, size);
             if (o_stats != NULL)
               update_counter(o_stats->content.audio.other, size);
           }
         } else if ('-' == *read_from) {
           tok_len = 1;
-          update_counter(totals.content.none, size);
+          update_counter(agg.totals.content.none, size);
           if (o_stats != NULL)
             update_counter(o_stats->content.none, size);
         } else {
           tok_len = strlen(read_from);
-          update_counter(totals.content.other, size);
+          update_counter(agg.totals.content.other, size);
           if (o_stats != NULL)
             update_counter(o_stats->content.other, size);
         }
@@ -1633,7 +2125,7 @@ parse_log_buff(LogBufferHeader * buf_header, bool summary = false)
       case P_STATE_END:
         // Nothing to do really
         if (flag) {
-          parse_errors++;
+          agg.parse_errors++;
         }
         break;
       }
@@ -1645,103 +2137,187 @@ parse_log_buff(LogBufferHeader * buf_header, bool summary = false)
 
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Parsing the log in several threads: the file is read in the main thread,
+// which queues copies of the log buffers for the parsing threads. Each of
+// those collects the stats in its own StatsAggregate, and they are merged
+// once the whole file is read.
+struct ParseQueue
+{
+  ink_mutex mutex;
+  ink_cond not_empty;
+  ink_cond not_full;
+  list<LogBufferHeader *> buffers;
+  int max_buffers;
+  bool done;
+
+  ParseQueue(int max)
+    : max_buffers(max), done(false)
+  {
+    ink_mutex_init(&mutex, "logstats parse queue");
+    ink_cond_init(&not_empty);
+    ink_cond_init(&not_full);
+  }
+
+  ~ParseQueue()
+  {
+    ink_cond_destroy(&not_full);
+    ink_cond_destroy(&not_empty);
+    ink_mutex_destroy(&mutex);
+  }
+
+  void
+  push(LogBufferHeader * header)
+  {
+    ink_mutex_acquire(&mutex);
+    while (static_cast<int>(buffers.size()) >= max_buffers)
+      ink_cond_wait(&not_full, &mutex);
+    buffers.push_back(header);
+    ink_cond_signal(&not_empty);
+    ink_mutex_release(&mutex);
+  }
+
+  // Returns NULL once the queue is finished and empty.
+  LogBufferHeader *
+  pop()
+  {
+    LogBufferHeader *header = NULL;
+
+    ink_mutex_acquire(&mutex);
+    while (buffers.empty() && !done)
+      ink_cond_wait(&not_empty, &mutex);
+    if (!buffers.empty()) {
+      header = buffers.front();
+      buffers.pop_front();
+      ink_cond_signal(&not_full);
+    }
+    ink_mutex_release(&mutex);
+    return header;
+  }
+
+  void
+  finish()
+  {
+    ink_mutex_acquire(&mutex);
+    done = true;
+    ink_cond_broadcast(&not_empty);
+    ink_mutex_release(&mutex);
+  }
+};
+
+struct ParseThread
+{
+  ink_thread tid;
+  ParseQueue *queue;
+  StatsAggregate agg;
+  int result;
+};
+
+void *
+parse_thread(void *data)
+{
+  ParseThread *t = static_cast<ParseThread *>(data);
+  LogBufferHeader *header;
+
+  while ((header = t->queue->pop())) {
+    if (parse_log_buff(header, t->agg, cl.summary != 0) != 0)
+      t->result = 1;
+    ats_free(header);
+  }
+  return NULL;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Process a file (FD)
 int
 process_file(int in_fd, off_t offset, unsigned max_age)
 {
-  char buffer[MAX_LOGBUFFER_SIZE];
-  int nread, buffer_bytes;
+  LogBlockReader reader(in_fd);
+  LogBufferHeader *header;
+  ParseQueue *queue = NULL;
+  ParseThread *threads = NULL;
+  int result = -1;
 
   Debug("logstats", "Processing file [offset=%" PRId64 "].", (int64_t)offset);
-  while (true) {
-    Debug("logstats", "Reading initial header.");
-    buffer[0] = '\0';
-
-    unsigned first_read_size = sizeof(uint32_t) + sizeof(uint32_t);
-    LogBufferHeader *header = (LogBufferHeader *)&buffer[0];
-
-    // Find the next log header, aligning us properly. This is not
-    // particularly optimal, but we should only have to do this
-    // once, and hopefully we'll be aligned immediately.
-    if (offset > 0) {
-      Debug("logstats", "Re-aligning file read.");
-      while (true) {
-        if (lseek(in_fd, offset, SEEK_SET) < 0) {
-          Debug("logstats", "Internal seek failed (offset=%"  PRId64 ").", (int64_t)offset);
-          return 1;
-        }
-
-        // read the first 8 bytes of the header, which will give us the
-        // cookie and the version number.
-        nread = read(in_fd, buffer, first_read_size);
-        if (!nread || EOF == nread) {
-          return 0;
-        }
-        // ensure that this is a valid logbuffer header
-        if (header->cookie && (LOG_SEGMENT_COOKIE == header->cookie)) {
-          offset = 0;
-          break;
-        }
-        offset++;
-      }
-      if (!header->cookie) {
-        return 0;
-      }
-    } else {
-      nread = read(in_fd, buffer, first_read_size);
-      if (!nread ||  EOF == nread || !header->cookie)
-        return 0;
-
-      // ensure that this is a valid logbuffer header
-      if (header->cookie != LOG_SEGMENT_COOKIE) {
-        Debug("logstats", "Invalid segment cookie (expected %d, got %d)", LOG_SEGMENT_COOKIE, header->cookie);
-        return 1;
-      }
-    }
-
-    Debug("logstats", "LogBuffer version %d, current = %d", header->version, LOG_SEGMENT_VERSION);
-    if (header->version != LOG_SEGMENT_VERSION)
-      return 1;
 
-    // read the rest of the header
-    unsigned second_read_size = sizeof(LogBufferHeader) - first_read_size;
-    nread = read(in_fd, &buffer[first_read_size], second_read_size);
-    if (!nread || EOF == nread) {
-      Debug("logstats", "Second read of header failed (attemped %d bytes at offset %d, got nothing).", second_read_size, first_read_size);
+  // Find the next log header, aligning us properly. This is not
+  // particularly optimal, but we should only have to do this
+  // once, and hopefully we'll be aligned immediately.
+  if (offset > 0) {
+    Debug("logstats", "Re-aligning file read.");
+    switch (reader.align(offset)) {
+    case LogBlockReader::READ_OK:
+      break;
+    case LogBlockReader::READ_EOF:
+      return 0;
+    default:
+      Debug("logstats", "Internal seek failed (offset=%"  PRId64 ").", (int64_t)offset);
       return 1;
     }
+  }
 
-    // read the rest of the buffer
-    if (header->byte_count > sizeof(buffer)) {
-      Debug("logstats", "Header byte count [%d] > expected [%zu]", header->byte_count, sizeof(buffer));
-      return 1;
+  // Possibly skip too old entries (entire buffers are skipped)
+  reader.set_time_range(max_age, 0);
+
+  if (cl.threads > 1) {
+    queue = NEW(new ParseQueue(cl.threads * PARSE_QUEUE_DEPTH));
+    threads = NEW(new ParseThread[cl.threads]);
+    for (int i = 0; i < cl.threads; ++i) {
+      threads[i].queue = queue;
+      threads[i].result = 0;
+      if (stats.top_urls)
+        threads[i].agg.top_urls = NEW(new UrlTopK(cl.top_urls, cl.top_urls * TOP_URLS_FACTOR));
+      threads[i].tid = ink_thread_create(parse_thread, &threads[i]);
     }
+  }
 
-    buffer_bytes = header->byte_count - sizeof(LogBufferHeader);
-    if (buffer_bytes <= 0 || (unsigned int) buffer_bytes > (sizeof(buffer) - sizeof(LogBufferHeader))) {
-      Debug("logstats", "Buffer payload [%d] is wrong.", buffer_bytes);
-      return 1;
+  while (result < 0) {
+    switch (reader.next(&header)) {
+    case LogBlockReader::READ_OK:
+      break;
+    case LogBlockReader::READ_EOF:
+      Debug("logstats", "Done, %" PRId64 " buffers read, %" PRId64 " too old", reader.segments_read, reader.segments_skipped);
+      result = 0;
+      continue;
+    default:
+      Debug("logstats", "Failed to read log buffer: %s", reader.error());
+      result = 1;
+      continue;
     }
 
-    nread = read(in_fd, &buffer[sizeof(LogBufferHeader)], buffer_bytes);
-    if (!nread || EOF == nread) {
-      Debug("logstats", "Failed to read buffer payload [%d bytes]", buffer_bytes);
-      return 1;
+    Debug("logstats", "LogBuffer version %d, current = %d", header->version, LOG_SEGMENT_VERSION);
+    if (header->version != LOG_SEGMENT_VERSION) {
+      result = 1;
+    } else if (queue) {
+      // The reader reuses its buffer, so hand over a copy.
+      LogBufferHeader *copy = (LogBufferHeader *)ats_malloc(header->byte_count);
+
+      memcpy(copy, header, header->byte_count);
+      init_fieldlist(copy);
+      queue->push(copy);
+    } else if (parse_log_buff(header, stats, cl.summary != 0) != 0) {
+      Debug("logstats", "Failed to parse log buffer.");
+      result = 1;
     }
+  }
 
-    // Possibly skip too old entries (the entire buffer is skipped)
-    if (header->high_timestamp >= max_age) {
-      if (parse_log_buff(header, cl.summary != 0) != 0) {
+  if (queue) {
+    queue->finish();
+    for (int i = 0; i < cl.threads; ++i) {
+      ink_thread_join(threads[i].tid);
+      if (threads[i].result != 0) {
         Debug("logstats", "Failed to parse log buffer.");
-        return 1;
+        result = 1;
       }
-    } else {
-      Debug("logstats", "Skipping old buffer (age=%d, max=%d)", header->high_timestamp, max_age);
+      merge_stats(stats, threads[i].agg);
+      delete threads[i].agg.top_urls;
     }
+    delete[] threads;
+    delete queue;
   }
 
-  return 0;
+  return result;
 }
 
 
@@ -1802,17 +2378,17 @@ format_elapsed_line(const char *desc, const ElapsedStats &stat, bool json=false)
     std::cout << "    " << '"' << desc << "\" : " << "{ ";
     std::cout << "\"min\": \"" << stat.min << "\", ";
     std::cout << "\"max\": \"" << stat.max << "\", ";
-    std::cout << "\"avg\": \"" << std::setiosflags(ios::fixed) << std::setprecision(2) << stat.avg << "\", ";
-    std::cout << "\"dev\": \"" << std::setiosflags(ios::fixed) << std::setprecision(2) << stat.stddev << "\" }," << std::endl;
+    std::cout << "\"avg\": \"" << std::setiosflags(ios::fixed) << std::setprecision(2) << elapsed_avg(stat) << "\", ";
+    std::cout << "\"dev\": \"" << std::setiosflags(ios::fixed) << std::setprecision(2) << elapsed_stddev(stat) << "\" }," << std::endl;
   } else {
     std::cout << std::left << std::setw(24) << desc;
     std::cout << std::right << std::setw(7);
     format_int(stat.min);
     std::cout << std::right << std::setw(13);
     format_int(stat.max);
-    snprintf(buf, sizeof(buf), "%17.3f", stat.avg);
+    snprintf(buf, sizeof(buf), "%17.3f", elapsed_avg(stat));
     std::cout << std::right << buf;
-    snprintf(buf, sizeof(buf), "%17.3f", stat.stddev);
+    snprintf(buf, sizeof(buf), "%17.3f", elapsed_stddev(stat));
     std::cout << std::right << buf << std::endl;
   }
 }
@@ -2106,8 +2682,11 @@ my_exit(const ExitStatus& status)
   int max_origins;
 
   // Special case for URLs output.
-  if (urls) {
-    urls->dump(cl.as_object);
+  if (urls || stats.top_urls) {
+    if (urls)
+      urls->dump(cl.as_object);
+    else
+      stats.top_urls->dump(cl.as_object);
     if (cl.as_object)
       std::cout << "}" << std::endl;
     else
@@ -2135,9 +2714,9 @@ my_exit(const ExitStatus& status)
     }
   }
 
-  if (!origins.empty()) {
+  if (!stats.origins.empty()) {
     // Sort the Origins by 'traffic'
-    for (OriginStorage::iterator i = origins.begin(); i != origins.end(); i++)
+    for (OriginStorage::iterator i = stats.origins.begin(); i != stats.origins.end(); i++)
       if (use_origin(i->second))
         vec.push_back(*i);
     sort(vec.begin(), vec.end());
@@ -2172,11 +2751,11 @@ my_exit(const ExitStatus& status)
     first = false;
     if (cl.json) {
       std::cout << "{ \"total\": {" << std::endl;
-      print_detail_stats(&totals, cl.json);
+      print_detail_stats(&stats.totals, cl.json);
       std::cout << "  }";
     } else {
       format_center("Totals (all Origins combined)");
-      print_detail_stats(&totals);
+      print_detail_stats(&stats.totals);
       std::cout << std::endl << std::endl << std::endl;
     }
   }
@@ -2240,6 +2819,299 @@ open_main_log(ExitStatus& status)
 
 
 
+#if TS_HAS_TESTS
+#include "ts/TestBox.h"
+
+#define TEST_SQUID_FIELDS "cqtq,ttms,chi,crc,pssc,psql,cqhm,cquc,caun,phr,pqsn,psct"
+#define TEST_URLS 40
+
+static const char *
+test_url(int i)
+{
+  static char urls[TEST_URLS][64];
+
+  if (!urls[i][0])
+    snprintf(urls[i], sizeof(urls[i]), "http://origin%d.example.com/path/%d", i % 5, i);
+  return urls[i];
+}
+
+// A squid log buffer of n entries made up from seed, over the TEST_URLS
+// URLs of five origins, with a mix of results, codes, methods, sizes and
+// elapsed times (some of them 0, some large).
+static LogBufferHeader *
+test_squid_buffer(unsigned seed, int n)
+{
+  static const int results[] = {
+    SQUID_LOG_TCP_HIT, SQUID_LOG_TCP_MISS, SQUID_LOG_TCP_IMS_HIT, SQUID_LOG_TCP_REFRESH_MISS,
+    SQUID_LOG_TCP_MEM_HIT, SQUID_LOG_TCP_EXPIRED_MISS, SQUID_LOG_ERR_CLIENT_ABORT, SQUID_LOG_ERR_CONNECT_FAIL
+  };
+  static const int codes[] = { 200, 206, 304, 404, 503 };
+  static const char *methods[] = { "GET", "POST", "HEAD", "PURGE" };
+  static const char *types[] = { "text/html", "image/jpeg", "application/javascript", "audio/mpeg" };
+  int fields_len = INK_ALIGN_DEFAULT(sizeof(TEST_SQUID_FIELDS));
+  int len = sizeof(LogBufferHeader) + fields_len + n * 256;
+  LogBufferHeader *h = (LogBufferHeader *) ats_calloc(1, len);
+  sockaddr_in ip;
+
+  memset(&ip, 0, sizeof(ip));
+  ip.sin_family = AF_INET;
+  ip.sin_addr.s_addr = htonl(0x7f000001);
+
+  h->cookie = LOG_SEGMENT_COOKIE;
+  h->version = LOG_SEGMENT_VERSION;
+  h->format_type = SQUID_LOG;
+  h->entry_count = n;
+  h->fmt_fieldlist_offset = sizeof(LogBufferHeader);
+  h->data_offset = sizeof(LogBufferHeader) + fields_len;
+  memcpy((char *) h + h->fmt_fieldlist_offset, TEST_SQUID_FIELDS, sizeof(TEST_SQUID_FIELDS));
+
+  char *p = (char *) h + h->data_offset;
+  for (int i = 0; i < n; i++) {
+    LogEntryHeader *e = (LogEntryHeader *) p;
+    char *q = p + sizeof(LogEntryHeader);
+    const char *s;
+
+    seed = seed * 1103515245 + 12345;
+    e->timestamp = 1000 + i;
+    LogAccess::marshal_int(q, e->timestamp);
+    q += INK_MIN_ALIGN;
+    LogAccess::marshal_int(q, (seed >> 8) % 5 == 0 ? 0 : (seed >> 4) % ((seed >> 20) % 2 ? 100 : 3000000));
+    q += INK_MIN_ALIGN;
+    q += LogAccess::marshal_ip(q, ats_ip_sa_cast(&ip));
+    LogAccess::marshal_int(q, results[(seed >> 12) % (sizeof(results) / sizeof(results[0]))]);
+    q += INK_MIN_ALIGN;
+    LogAccess::marshal_int(q, codes[(seed >> 16) % (sizeof(codes) / sizeof(codes[0]))]);
+    q += INK_MIN_ALIGN;
+    LogAccess::marshal_int(q, (seed >> 10) % 100000);
+    q += INK_MIN_ALIGN;
+    s = methods[(seed >> 24) % (sizeof(methods) / sizeof(methods[0]))];
+    LogAccess::marshal_str(q, s, LogAccess::strlen(s));
+    q += LogAccess::strlen(s);
+    s = test_url((seed >> 14) % TEST_URLS);
+    LogAccess::marshal_str(q, s, LogAccess::strlen(s));
+    q += LogAccess::strlen(s);
+    LogAccess::marshal_str(q, "-", LogAccess::strlen("-"));
+    q += LogAccess::strlen("-");
+    LogAccess::marshal_int(q, (seed >> 18) % 2 ? SQUID_HIER_DIRECT : SQUID_HIER_NONE);
+    q += INK_MIN_ALIGN;
+    LogAccess::marshal_str(q, "-", LogAccess::strlen("-"));
+    q += LogAccess::strlen("-");
+    s = types[(seed >> 22) % (sizeof(types) / sizeof(types[0]))];
+    LogAccess::marshal_str(q, s, LogAccess::strlen(s));
+    q += LogAccess::strlen(s);
+
+    e->entry_len = q - p;
+    p = q;
+  }
+  h->byte_count = p - (char *) h;
+  h->low_timestamp = 1000;
+  h->high_timestamp = 1000 + n - 1;
+  return h;
+}
+
+// Free everything collected in the global stats
+static void
+test_reset_stats()
+{
+  for (OriginStorage::iterator i = stats.origins.begin(); i != stats.origins.end(); ++i) {
+    ats_free(const_cast<char*>(i->second->server));
+    ats_free(i->second);
+  }
+  stats.origins.clear();
+  memset(&stats.totals, 0, sizeof(stats.totals));
+  init_elapsed(&stats.totals);
+  delete stats.top_urls;
+  stats.top_urls = NULL;
+  stats.parse_errors = 0;
+}
+
+// Everything the global stats would print, the Origins in name order and
+// the top URLs with their error.
+static std::string
+test_stats_output()
+{
+  std::ostringstream out;
+  std::streambuf *saved = std::cout.rdbuf(out.rdbuf());
+  vector<std::string> names;
+
+  print_detail_stats(&stats.totals);
+  print_detail_stats(&stats.totals, true);
+  for (OriginStorage::iterator i = stats.origins.begin(); i != stats.origins.end(); ++i)
+    names.push_back(i->first);
+  sort(names.begin(), names.end());
+  for (vector<std::string>::iterator n = names.begin(); n != names.end(); ++n) {
+    std::cout << *n << std::endl;
+    print_detail_stats(stats.origins[n->c_str()], true);
+  }
+  for (int i = 0; i < TEST_URLS; i++) {
+    int64_t count, error;
+    const UrlStats *u = stats.top_urls->find(test_url(i), &count, &error);
+
+    if (u)
+      dump_url(*u, 0, count, error);
+  }
+  std::cout.rdbuf(saved);
+  return out.str();
+}
+
+REGRESSION_TEST(Logstats_Elapsed)(RegressionTest * t, int atype, int * pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  ElapsedStats all, a, b, big;
+  int values[] = { 0, 10, 20, 30, 40 };
+
+  box = REGRESSION_TEST_PASSED;
+
+  memset(&all, 0, sizeof(all));
+  all.min = all.max = -1;
+  a = b = big = all;
+  for (int i = 0; i < 5; i++) {
+    update_elapsed(all, values[i]);
+    update_elapsed(i < 2 ? a : b, values[i]);
+  }
+  box.check(all.count == 5 && all.sum == 100 && all.min == 10 && all.max == 40,
+            "count %" PRId64 " sum %" PRId64 " min %d max %d", all.count, all.sum, all.min, all.max);
+  box.check(elapsed_avg(all) == 20.0, "average %f, expected 20", elapsed_avg(all));
+  box.check(fabs(elapsed_stddev(all) - sqrt(200.0)) < 1e-9, "deviation %f, expected %f",
+            elapsed_stddev(all), sqrt(200.0));
+
+  merge_elapsed(b, a);
+  box.check(!memcmp(&all, &b, sizeof(all)), "merging the two halves is not the same as adding them all");
+
+  // The squares add up to more than 64 bits
+  for (int i = 0; i < 8; i++)
+    update_elapsed(big, INT_MAX);
+  box.check(big.sum_sq[0] != 0, "the sum of squares did not carry");
+  box.check(elapsed_avg(big) == INT_MAX && elapsed_stddev(big) < 1.0, "average %f deviation %f for equal values",
+            elapsed_avg(big), elapsed_stddev(big));
+}
+
+// Parse the same log with one and with several threads, the output has to
+// be the same.
+REGRESSION_TEST(Logstats_Parallel)(RegressionTest * t, int atype, int * pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  LogFieldList fields;
+  bool contains_aggregates;
+  const int n_buffers = 16, n_entries = 200;
+  int thread_counts[] = { 1, 4 };
+  std::string output[2];
+  char path[] = "/tmp/logstatsXXXXXX";
+  int fd;
+
+  box = REGRESSION_TEST_PASSED;
+
+  if (LogFormat::parse_symbol_string(TEST_SQUID_FIELDS, &fields, &contains_aggregates) != 12) {
+    rprintf(t, "the log fields are not set up, skipping\n");
+    return;
+  }
+  if ((fd = mkstemp(path)) < 0) {
+    box.check(false, "can't create a temporary log file");
+    return;
+  }
+  unlink(path);
+  for (int i = 0; i < n_buffers; i++) {
+    LogBufferHeader *h = test_squid_buffer(i + 1, n_entries);
+
+    box.check(write(fd, h, h->byte_count) == (ssize_t) h->byte_count, "can't write the temporary log file");
+    ats_free(h);
+  }
+
+  int saved_threads = cl.threads, saved_top_urls = cl.top_urls;
+  for (int i = 0; i < 2; i++) {
+    test_reset_stats();
+    cl.threads = thread_counts[i];
+    cl.top_urls = TEST_URLS;
+    stats.top_urls = NEW(new UrlTopK(cl.top_urls, cl.top_urls * TOP_URLS_FACTOR));
+    lseek(fd, 0, SEEK_SET);
+    box.check(process_file(fd, 0, 0) == 0, "parsing with %d threads failed", cl.threads);
+    box.check(stats.totals.total.count == n_buffers * n_entries, "%" PRId64 " entries parsed with %d threads",
+              stats.totals.total.count, cl.threads);
+    box.check(stats.origins.size() == 5, "%d origins with %d threads", (int) stats.origins.size(), cl.threads);
+    output[i] = test_stats_output();
+  }
+  box.check(output[0] == output[1], "the stats of 1 and %d threads differ", thread_counts[1]);
+  test_reset_stats();
+  cl.threads = saved_threads;
+  cl.top_urls = saved_top_urls;
+  close(fd);
+}
+
+REGRESSION_TEST(Logstats_TopK)(RegressionTest * t, int atype, int * pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  int64_t count, error;
+
+  box = REGRESSION_TEST_PASSED;
+
+  // Under capacity the merged counts are exact
+  {
+    UrlTopK a(5, 20), b(5, 20);
+    const UrlStats *u;
+
+    for (int i = 0; i < 10; i++) {
+      for (int j = 0; j <= i; j++)
+        a.add_stat(test_url(i), 100, 10, SQUID_LOG_TCP_HIT, 200);
+      b.add_stat(test_url(i + 5), 100, 30, SQUID_LOG_TCP_MISS, 200);
+    }
+    a.merge(b);
+    for (int i = 0; i < 15; i++) {
+      int64_t expected = (i < 10 ? i + 1 : 0) + (i >= 5 ? 1 : 0);
+
+      u = a.find(test_url(i), &count, &error);
+      if (box.check(u != NULL, "%s was dropped", test_url(i))) {
+        box.check(count == expected && error == 0 && u->req.count == expected,
+                  "%s count %" PRId64 " error %" PRId64 ", expected %" PRId64, test_url(i), count, error, expected);
+      }
+    }
+    u = a.find(test_url(7), &count, &error);
+    box.check(u && u->hits == 8 && u->misses == 1 && u->time.min == 10 && u->time.max == 30,
+              "the URL stats were not merged");
+    box.check(b.find(test_url(7), &count, &error) == NULL, "the merged sketch was not emptied");
+  }
+
+  // Over capacity the heavy hitters are kept, and every count is within
+  // its error of the true count
+  {
+    const int n_sketches = 4, size = 16, n = 4000;
+    UrlTopK *sketch[n_sketches];
+    int64_t truth[TEST_URLS];
+    unsigned seed = 1;
+
+    memset(truth, 0, sizeof(truth));
+    for (int i = 0; i < n_sketches; i++)
+      sketch[i] = NEW(new UrlTopK(size, size));
+    for (int i = 0; i < n; i++) {
+      int url;
+
+      seed = seed * 1103515245 + 12345;
+      // URLs 0 to 2 get 15% of the requests each, the rest are spread out
+      url = (seed >> 16) % 100;
+      url = url < 45 ? url / 15 : 3 + (seed >> 8) % (TEST_URLS - 3);
+      ++truth[url];
+      sketch[(seed >> 4) % n_sketches]->add_stat(test_url(url), 100, 10, SQUID_LOG_TCP_HIT, 200);
+    }
+    for (int i = 1; i < n_sketches; i++) {
+      sketch[0]->merge(*sketch[i]);
+      delete sketch[i];
+    }
+    for (int i = 0; i < TEST_URLS; i++) {
+      if (sketch[0]->find(test_url(i), &count, &error)) {
+        box.check(count - error <= truth[i] && truth[i] <= count,
+                  "%s count %" PRId64 " error %" PRId64 ", true count %" PRId64, test_url(i), count, error, truth[i]);
+      } else {
+        box.check(i >= 3, "heavy hitter %s was dropped", test_url(i));
+      }
+    }
+    delete sketch[0];
+  }
+}
+#endif
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // main
 int
@@ -2258,11 +3130,7 @@ main(int argc, char *argv[])
   // Before accessing file system initialize Layout engine
   Layout::create();
 
-  memset(&totals, 0, sizeof(totals));
-  init_elapsed(&totals);
-
   origin_set = NULL;
-  parse_errors = 0;
 
   // Get log directory
   ink_strlcpy(system_log_dir, Layout::get()->logdir, sizeof(system_log_dir));
@@ -2289,6 +3157,13 @@ main(int argc, char *argv[])
   init_log_standalone_basic(PROGRAM_NAME);
   Log::init(Log::NO_REMOTE_MANAGEMENT | Log::LOGCAT);
 
+#if TS_HAS_TESTS
+  if (cl.regression) {
+    RegressionTest::run((char *) "Logstats_.*");
+    _exit(RegressionTest::final_status == REGRESSION_TEST_PASSED ? 0 : 1);
+  }
+#endif
+
   // Do we have a list of Origins on the command line?
   if (cl.origin_list[0] != '\0') {
     char *tok;
@@ -2346,8 +3221,11 @@ main(int argc, char *argv[])
   }
 
   // Should we calculate per URL data;
-  if (cl.urls != 0) {
-    urls = NEW(new UrlLru(cl.urls, cl.show_urls));
+  if (cl.urls != 0 || cl.top_urls > 0) {
+    if (cl.top_urls > 0)
+      stats.top_urls = NEW(new UrlTopK(cl.top_urls, cl.top_urls * TOP_URLS_FACTOR));
+    else
+      urls = NEW(new UrlLru(cl.urls, cl.show_urls));
     if (cl.as_object)
       std::cout << "{" << std::endl;
     else
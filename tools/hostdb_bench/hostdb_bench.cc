@@ -0,0 +1,246 @@
+/** @file
+
+  Compare HostDB lookup throughput through the MultiCache partition
+  locks with lookups through the lock free read cache
+  (proxy.config.hostdb.read_cache.size).
+
+  The "locked" mode models HostDBProcessor::getbyname_imm() without the
+  read cache: the key picks one of MULTI_CACHE_PARTITIONS mutexes, the
+  lookup try-locks it and copies the entry out. A failed try-lock is
+  what makes HostDB reschedule the lookup MUTEX_RETRY_DELAY later, so
+  those are counted as deferred lookups and retried at once. The
+  "read_cache" mode does the same lookups with ReadMostlyCache::get()
+  first and only takes the lock when that misses.
+
+  Every thread looks up random keys out of a shared, preloaded working
+  set for a fixed time.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <getopt.h>
+#include <stdint.h>
+
+#include "P_HostDBReadCache.h"
+
+#define PARTITIONS 64           // MULTI_CACHE_PARTITIONS
+
+// The read cache only needs these two out of libtsutil.
+void *
+ats_malloc(size_t size)
+{
+  return malloc(size);
+}
+
+void
+ats_free(void *ptr)
+{
+  free(ptr);
+}
+
+// Roughly the size of a HostDBInfo.
+struct Entry
+{
+  uint64_t md5_high;
+  char data[56];
+};
+
+static int n_keys = 16384;
+static double seconds = 1.0;
+
+static uint64_t *keys;
+static Entry *table;            // open addressed, as a stand in for the MultiCache buckets
+static uint64_t table_mask;
+static pthread_mutex_t partition_mutex[PARTITIONS];
+static ReadMostlyCache<Entry> read_cache;
+
+static volatile int running;
+
+struct Worker
+{
+  pthread_t tid;
+  bool use_read_cache;
+  unsigned int seed;
+  uint64_t lookups;
+  uint64_t deferred;
+  uint64_t sink;
+};
+
+static double
+now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t
+mix(uint64_t x)
+{
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x ? x : 1;
+}
+
+static Entry *
+lookup_block(uint64_t key)
+{
+  for (uint64_t i = key & table_mask;; i = (i + 1) & table_mask)
+    if (table[i].md5_high == key)
+      return &table[i];
+}
+
+static void
+setup()
+{
+  uint64_t size = 1;
+  while (size < (uint64_t) n_keys * 2)
+    size <<= 1;
+  table = (Entry *) calloc(size, sizeof(Entry));
+  table_mask = size - 1;
+  keys = (uint64_t *) malloc(n_keys * sizeof(uint64_t));
+  for (int i = 0; i < PARTITIONS; i++)
+    pthread_mutex_init(&partition_mutex[i], NULL);
+  // the read cache is sized like the table so that the working set fits
+  read_cache.init(n_keys * 2);
+  for (int i = 0; i < n_keys; i++) {
+    keys[i] = mix(i + 1);
+    uint64_t j = keys[i] & table_mask;
+    while (table[j].md5_high)
+      j = (j + 1) & table_mask;
+    table[j].md5_high = keys[i];
+    memset(table[j].data, i, sizeof(table[j].data));
+    read_cache.put(keys[i], &table[j]);
+  }
+}
+
+static void *
+worker(void *arg)
+{
+  Worker *w = (Worker *) arg;
+  Entry copy;
+
+  while (running) {
+    for (int n = 0; n < 1024; n++) {
+      uint64_t key = keys[rand_r(&w->seed) % n_keys];
+      // a read cache miss falls back to the partition lock, as in HostDB
+      if (!w->use_read_cache || !read_cache.get(key, &copy)) {
+        pthread_mutex_t *m = &partition_mutex[key % PARTITIONS];
+        while (pthread_mutex_trylock(m)) {
+          w->deferred++;
+        }
+        copy = *lookup_block(key);
+        pthread_mutex_unlock(m);
+      }
+      w->sink += copy.data[0];
+      w->lookups++;
+    }
+  }
+  return NULL;
+}
+
+static void
+run(const char *name, bool use_read_cache, int n_threads)
+{
+  Worker *w = (Worker *) calloc(n_threads, sizeof(Worker));
+
+  running = 1;
+  double start = now();
+  for (int i = 0; i < n_threads; i++) {
+    w[i].use_read_cache = use_read_cache;
+    w[i].seed = i + 1;
+    pthread_create(&w[i].tid, NULL, worker, &w[i]);
+  }
+  usleep((useconds_t) (seconds * 1e6));
+  running = 0;
+
+  uint64_t lookups = 0, deferred = 0;
+  for (int i = 0; i < n_threads; i++) {
+    pthread_join(w[i].tid, NULL);
+    lookups += w[i].lookups;
+    deferred += w[i].deferred;
+  }
+  double wall = now() - start;
+
+  printf("%-10s %3d threads  %9.2f Mlookups/s  %6.2f%% deferred\n", name, n_threads,
+         lookups / wall / 1e6, lookups ? 100.0 * deferred / (lookups + deferred) : 0.0);
+  free(w);
+}
+
+static void
+usage()
+{
+  fprintf(stderr, "usage: hostdb_bench [-k keys] [-s seconds] [-t max_threads] [locked|read_cache]...\n");
+  exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+  int c;
+  int max_threads = 32;
+  bool locked = false, cached = false;
+
+  while ((c = getopt(argc, argv, "k:s:t:h")) != -1) {
+    switch (c) {
+    case 'k':
+      n_keys = atoi(optarg);
+      break;
+    case 's':
+      seconds = atof(optarg);
+      break;
+    case 't':
+      max_threads = atoi(optarg);
+      break;
+    default:
+      usage();
+    }
+  }
+  if (n_keys <= 0 || seconds <= 0 || max_threads <= 0)
+    usage();
+
+  for (int i = optind; i < argc; ++i) {
+    if (!strcmp(argv[i], "locked"))
+      locked = true;
+    else if (!strcmp(argv[i], "read_cache"))
+      cached = true;
+    else
+      usage();
+  }
+  if (!locked && !cached)
+    locked = cached = true;
+
+  setup();
+  for (int n = 1; n <= max_threads; n *= 2) {
+    if (locked)
+      run("locked", false, n);
+    if (cached)
+      run("read_cache", true, n);
+  }
+  return 0;
+}
@@ -0,0 +1,241 @@
+/** @file
+
+  Compare the CPU cost of relaying bytes between two TCP connections
+  through a user space buffer (what the HttpTunnel does by default)
+  with relaying them through a kernel pipe with splice() (what it does
+  with proxy.config.http.splice_tunnel enabled).
+
+  A sender thread streams data over loopback to the relay, which
+  forwards it over a second loopback connection to a sink thread. Only
+  the CPU time of the relay thread is charged to the relay.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+static int64_t total_bytes = 4LL << 30;
+static int chunk_size = 64 * 1024;
+static int pipe_size = 1024 * 1024;
+
+static double
+now(clockid_t clock)
+{
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+die(const char *what)
+{
+  perror(what);
+  exit(1);
+}
+
+// Connected pair of loopback TCP sockets.
+static void
+tcp_pair(int fds[2])
+{
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  int lfd = socket(AF_INET, SOCK_STREAM, 0);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (lfd < 0 || bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(lfd, 1) < 0 ||
+      getsockname(lfd, (struct sockaddr *)&addr, &len) < 0)
+    die("listen");
+  if ((fds[0] = socket(AF_INET, SOCK_STREAM, 0)) < 0 || connect(fds[0], (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    die("connect");
+  if ((fds[1] = accept(lfd, NULL, NULL)) < 0)
+    die("accept");
+  close(lfd);
+}
+
+static void *
+sender(void *arg)
+{
+  int fd = (intptr_t)arg;
+  char *buf = (char *)malloc(chunk_size);
+  int64_t left = total_bytes;
+
+  memset(buf, 'x', chunk_size);
+  while (left > 0) {
+    ssize_t r = write(fd, buf, left < chunk_size ? left : chunk_size);
+    if (r <= 0)
+      die("sender write");
+    left -= r;
+  }
+  close(fd);
+  free(buf);
+  return NULL;
+}
+
+static void *
+sink(void *arg)
+{
+  int fd = (intptr_t)arg;
+  char *buf = (char *)malloc(chunk_size);
+
+  while (read(fd, buf, chunk_size) > 0)
+    ;
+  close(fd);
+  free(buf);
+  return NULL;
+}
+
+static int64_t
+relay_copy(int in, int out)
+{
+  char *buf = (char *)malloc(chunk_size);
+  int64_t done = 0;
+  ssize_t r;
+
+  while ((r = read(in, buf, chunk_size)) > 0) {
+    for (ssize_t off = 0; off < r;) {
+      ssize_t w = write(out, buf + off, r - off);
+      if (w <= 0)
+        die("relay write");
+      off += w;
+    }
+    done += r;
+  }
+  free(buf);
+  return done;
+}
+
+static int64_t
+relay_splice(int in, int out)
+{
+  int p[2];
+  int64_t done = 0;
+  ssize_t r;
+
+  if (pipe(p) < 0)
+    die("pipe");
+#ifdef F_SETPIPE_SZ
+  fcntl(p[1], F_SETPIPE_SZ, pipe_size);
+#endif
+  while ((r = splice(in, NULL, p[1], NULL, pipe_size, SPLICE_F_MOVE | SPLICE_F_MORE)) > 0) {
+    for (ssize_t left = r; left > 0;) {
+      ssize_t w = splice(p[0], NULL, out, NULL, left, SPLICE_F_MOVE | SPLICE_F_MORE);
+      if (w <= 0)
+        die("relay splice");
+      left -= w;
+    }
+    done += r;
+  }
+  close(p[0]);
+  close(p[1]);
+  return done;
+}
+
+static void
+run(const char *name, int64_t (*relay)(int, int))
+{
+  int a[2], b[2];
+  pthread_t ts, tk;
+
+  tcp_pair(a);
+  tcp_pair(b);
+  pthread_create(&ts, NULL, sender, (void *)(intptr_t)a[0]);
+  pthread_create(&tk, NULL, sink, (void *)(intptr_t)b[1]);
+
+  double wall = now(CLOCK_MONOTONIC);
+  double cpu = now(CLOCK_THREAD_CPUTIME_ID);
+  int64_t done = relay(a[1], b[0]);
+  cpu = now(CLOCK_THREAD_CPUTIME_ID) - cpu;
+  wall = now(CLOCK_MONOTONIC) - wall;
+
+  close(a[1]);
+  close(b[0]);
+  pthread_join(ts, NULL);
+  pthread_join(tk, NULL);
+
+  if (done != total_bytes)
+    fprintf(stderr, "%s: relayed %lld of %lld bytes\n", name, (long long)done, (long long)total_bytes);
+
+  double gbits = done * 8 / 1e9;
+  printf("%-7s %8.2f Gbps  %7.3f s cpu  %7.3f cpu-s/Gbit  %5.1f%% of a core per Gbps\n",
+         name, gbits / wall, cpu, cpu / gbits, 100 * (cpu / wall) / (gbits / wall));
+}
+
+static void
+usage()
+{
+  fprintf(stderr, "usage: splice_bench [-b bytes] [-c chunk_size] [-p pipe_size] [copy|splice]...\n");
+  exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+  int c;
+
+  while ((c = getopt(argc, argv, "b:c:p:h")) != -1) {
+    switch (c) {
+    case 'b':
+      total_bytes = strtoll(optarg, NULL, 0);
+      break;
+    case 'c':
+      chunk_size = atoi(optarg);
+      break;
+    case 'p':
+      pipe_size = atoi(optarg);
+      break;
+    default:
+      usage();
+    }
+  }
+  if (total_bytes <= 0 || chunk_size <= 0 || pipe_size <= 0)
+    usage();
+
+  if (optind == argc) {
+    run("copy", relay_copy);
+    run("splice", relay_splice);
+  }
+  for (int i = optind; i < argc; ++i) {
+    if (!strcmp(argv[i], "copy"))
+      run("copy", relay_copy);
+    else if (!strcmp(argv[i], "splice"))
+      run("splice", relay_splice);
+    else
+      usage();
+  }
+  return 0;
+}